@@ -5,7 +5,7 @@
 *    by John A. Magliacane, KD2BD in November 2000.  The -x switch code     *
 *           was contributed by Tom Busch, WB8WOR in October 2001.           *
 *                                                                           *
-*         To build: "cc -Wall -O3 -s -lm earthtrack -o earthtrack"          *
+*   To build: "./build", which uses the client library in ../libpredict,    *
 *        then:  "ln -s earthtrack earthtrack2".  Invoke earthtrack          *
 *       to run with xearth.  Invoke earthtrack2 to run with xplanet         *
 *                           version 1.0 or above.                           *
@@ -37,18 +37,14 @@
 #include <math.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <netdb.h>
 #include <signal.h>
-#include <errno.h>
-#include <arpa/inet.h>
+#include "predict_client.h"
 
 #ifndef PI
 #define PI 3.141592653589793
 #endif
 
-char	string[625], error;
+char	string[128], error;
 double	R0=6378.16, TWOPI=6.283185307179586,
 	HALFPI=1.570796326794896, deg2rad=1.74532925199e-02;
 FILE	*markerfd=NULL, *greatarcfd=NULL;
@@ -61,129 +57,6 @@ void handler()
 	signal(SIGALRM,handler);
 }
 
-int connectsock(char *host, char *service, char *protocol)
-{
-	/* This function is used to connect to the server.  "host" is the
-	   name of the computer on which PREDICT is running in server mode.
-	   "service" is the name of the socket port.  "protocol" is the
-	   socket protocol (UDP). */
-
-	struct hostent *phe;
-	struct servent *pse;
-	struct protoent *ppe;
-	struct sockaddr_in sin;
-	
-	int s, type;
-	
-	memset((char *)&sin, 0, sizeof(struct sockaddr_in));
-	sin.sin_family=AF_INET;
-	
-	if ((pse=getservbyname(service,protocol)))
-		sin.sin_port=pse->s_port;
-
-	else if ((sin.sin_port=htons((unsigned short)atoi(service)))==0)
-	{
-		printf("Can't get services\n");
-		return -1;
-	}
-
-	if ((phe=gethostbyname(host)))
-		bcopy(phe->h_addr,(char *)&sin.sin_addr,phe->h_length);
-
-	else if ((sin.sin_addr.s_addr=inet_addr(host))==INADDR_NONE)
-	{
-		printf("Can't get host: %c%s%c!\n",34,host,34);
-		return -1;
-	}
-	
-	if ((ppe=getprotobyname(protocol))==0)
-		return -1;
-
-	if (strcmp(protocol,"udp")==0)
-		type=SOCK_DGRAM;
-	else
-		type=SOCK_STREAM;
-	
-	s=socket(PF_INET,type,ppe->p_proto);
-
-	if (s<0)
-	{
-		printf("Can't get socket.\n");
-		return -1;
-	}
-
-	if (connect(s,(struct sockaddr *)&sin,sizeof(sin))<0)
-	{
-		printf("Can't connect to socket.\n");
-		return -1;
-	}
-
-	return s;
-}
-
-void get_response(int sock, char *buf)
-{
-	/* This function gets a response from the
-	   server in the form of a character string. */
-
-	int n;
-
-	n=read(sock,buf,625);
-
-	if (n<0)
-	{
-		if (errno==EINTR)
-			return;
-
-		if (errno==ECONNREFUSED)
-		{
-			fprintf(stderr, "Connection refused - PREDICT server not running\n");
-			exit (1);
-		}
-	}
-
-	buf[n]='\0';
-}
-
-char *send_command(host, command)
-char *host, *command;
-{
-	int sk;
-
-	/* This function sends "command" to PREDICT running on
-	   machine "host", and returns the result of the command
-	   as a pointer to a character string. */
-
-	/* Open a network socket */
-	sk=connectsock(host,"predict","udp");
-
-	if (sk<0)
-	{
-		error=1;
-		string[0]=0;
-	}
-
-	else
-	{
-		/* Build a command buffer */
-		sprintf(string,"%s\n",command);
-
-		/* Send the command to the server */
-   		write(sk,command,strlen(string));
-
-		/* clear string[] so it can be re-used for the response */
-		string[0]=0;
-
-		/* Get the response */
-   		get_response(sk,string);
-
-		/* Close the connection */
-   		close(sk);
-	}
-
-	return string;
-}
-
 double arccos(x,y)
 double x, y;
 {
@@ -347,21 +220,117 @@ char *destination;
 	return error;
 }
 
+int TextQth(client,qth)
+struct predict_client *client;
+struct predict_qth *qth;
+{
+	/* This function, and the two that follow, obtain the
+	   same data as the binary requests through the text
+	   commands understood by every version of PREDICT, for
+	   servers that don't speak the binary protocol.  -1 is
+	   returned if PREDICT doesn't answer. */
+
+	char buf[128];
+
+	memset(qth,0,sizeof(struct predict_qth));
+
+	if (predict_command(client,"GET_QTH",buf,sizeof(buf))<1 || sscanf(buf,"%31s%lf%lf",qth->callsign,&qth->lat,&qth->lon)!=3)
+		return -1;
+
+	return 0;
+}
+
+int TextList(client,list,max)
+struct predict_client *client;
+struct predict_entry *list;
+int max;
+{
+	/* GET_LIST answers with a line per database entry,
+	   which is empty for entries holding no satellite.
+	   The number of satellites placed in "list" is
+	   returned. */
+
+	char buf[1024];
+	int x, y, count;
+
+	if (predict_command(client,"GET_LIST",buf,sizeof(buf))==-1)
+		return -1;
+
+	for (x=0, count=0; buf[x]!=0 && count<max; x++)
+	{
+		for (y=0; buf[x]!='\n' && buf[x]!=0; x++)
+		{
+			if (y<31)
+				list[count].name[y++]=buf[x];
+		}
+
+		list[count].name[y]=0;
+		list[count].catnum=0;
+
+		if (y)
+			count++;
+
+		if (buf[x]==0)
+			break;
+	}
+
+	return count;
+}
+
+int TextSats(client,list,count,sats)
+struct predict_client *client;
+struct predict_entry *list;
+int count;
+struct predict_sat *sats;
+{
+	/* The tracking data of each satellite named in "list" is
+	   requested with GET_SAT.  The first line of its response
+	   is the satellite name, which may contain spaces.  The
+	   rest is numerical, and is parsed with sscanf(). */
+
+	char command[64], buf[256];
+	int x, y;
+	long next_event;
+
+	for (x=0; x<count; x++)
+	{
+		sprintf(command,"GET_SAT %s",list[x].name);
+
+		if (predict_command(client,command,buf,sizeof(buf))<1 || strncmp(buf,"Huh?",4)==0)
+			return -1;
+
+		for (y=0; buf[y]!='\n' && buf[y]!=0; y++);
+
+		memset(&sats[x],0,sizeof(struct predict_sat));
+		strncpy(sats[x].name,list[x].name,sizeof(sats[x].name)-1);
+
+		if (sscanf(buf+y,"%lf %lf %lf %lf %ld %lf %lf %lf %lf %d %c",&sats[x].lon,&sats[x].lat,&sats[x].az,&sats[x].el,&next_event,&sats[x].footprint,&sats[x].range,&sats[x].altitude,&sats[x].velocity,&sats[x].orbitnum,&sats[x].visibility)!=11)
+			return -1;
+
+		sats[x].next_event=(double)next_event;
+	}
+
+	return count;
+}
+
 int main(argc,argv)
 char argc, *argv[];
 {
-	int x, y, z, updateinterval, satnum=0, radius=50, sleeptime=20;
-	char buf[128], command[255], satlist[625], /* satname[26], */
-	     satnamelist[26][26], callsign[15], markerfile[50],
+	int x, y, z, updateinterval, radius=50, sleeptime=20;
+	int sats, listed=0;
+	char buf[128], command[255], markerfile[50],
 	     greatarcfile[50], configfile[50], sat2track[30],
 	     hostname[50], color[35], xtra[50], xplanet=0,
-	     xearth=0, visibility, circledrawn=0, zoom=0;
-	float az, el, slat, slong, qthlat,
-	      qthlong, footprint, range, altitude,
-	      velocity, mapcenterlat, mapcenterlong;
-	long next_event_time, orbitnum, starttime, endtime, current_time;
+	     xearth=0, circledrawn=0, zoom=0, text=0;
+	float qthlat, qthlong, mapcenterlat, mapcenterlong;
+	long starttime, endtime;
+	double current_time;
 	time_t t;
 	FILE *fd=NULL;
+	struct predict_client *client;
+	struct predict_qth qth;
+	struct predict_entry list[24];
+	struct predict_sat sat[24];
 
 	/* Parse command-line arguments */
 
@@ -480,45 +449,44 @@ char argc, *argv[];
 		}
 	}
 
-	/* Get QTH info from PREDICT */
-
-	strcpy(buf, send_command(hostname,"GET_QTH"));
-	sscanf(buf,"%s%f%f",callsign,&qthlat,&qthlong);
-
-	qthlong=convertlong(qthlong);
-
-	mapcenterlat=qthlat;
-	mapcenterlong=qthlong;
-
-	/* Get the list of satellite names from PREDICT */
+	/* Get QTH info from PREDICT, using its binary
+	   protocol through libpredict's client library,
+	   or its text commands if it doesn't speak it. */
 
-	strcpy(satlist, send_command(hostname,"GET_LIST"));
+	client=predict_connect(hostname,NULL);
+	x=-1;
 
-	if (satlist[0]!=0)
+	if (client!=NULL)
 	{
-		/* Parse the response of GET_LIST, and place each
-		   name in the character array satnamelist[]. */
+		x=predict_get_qth(client,&qth);
 
-		for (x=0, y=0, z=0; y<strlen(satlist); y++)
+		if (x==-1)
 		{
-			if (satlist[y]!='\n')
-			{
-				satnamelist[z][x]=satlist[y];
-				x++;
-			}
-
-			else
-			{
-				satnamelist[z][x]=0;
-				z++;
-				x=0;
-			}
+			x=TextQth(client,&qth);
+			text=(x==0);
 		}
+	}
 
-		satnum=z;
+	if (x==-1)
+	{
+		fprintf(stderr,"%c*** Error: No response from PREDICT on %s\n",7,hostname);
+		exit(-1);
 	}
 
+	qthlat=qth.lat;
+	qthlong=convertlong(qth.lon);
+
+	mapcenterlat=qthlat;
+	mapcenterlong=qthlong;
+
+	/* Make sure PREDICT has satellites to track */
+
+	if (text)
+		listed=TextList(client,list,24);
 	else
+		listed=predict_get_list(client,list,24);
+
+	if (listed<1)
 		error=1;
 
 	while (error==0)
@@ -529,55 +497,44 @@ char argc, *argv[];
 		markerfd=fopen(markerfile,"w");
 		greatarcfd=fopen(greatarcfile,"w");
 
-		fprintf(markerfd,"%8.3f %8.3f %c%s%c\n",qthlat,qthlong,34,callsign,34);
+		fprintf(markerfd,"%8.3f %8.3f %c%s%c\n",qthlat,qthlong,34,qth.callsign,34);
 
-		for (z=0; z<satnum; z++)
+		/* Get the tracking data of every satellite from
+		   PREDICT in a single request (or one GET_SAT per
+		   satellite in text), along with the current time. */
+
+		if (text)
 		{
-			sprintf(command,"GET_SAT %s",satnamelist[z]);
-			strcpy(buf,send_command(hostname,command));
+			sats=TextSats(client,list,listed,sat);
 
-			if (buf[0]==0)
+			if (predict_command(client,"GET_TIME",buf,sizeof(buf))<1 || sscanf(buf,"%lf",&current_time)!=1)
 				error=1;
+		}
 
-			/* The first element of the response is the satellite
-			   name.  It is ended with a '\n' character and may
-			   contain spaces. */
-
-
-			/**
-			for (x=0; buf[x]!='\n'; x++)
-				satname[x]=buf[x];
-
-			satname[x]=0
-			**/
-
-			for (x=0; buf[x]!='\n'; x++);
-
-			x++;
+		else
+		{
+			sats=predict_get_sats(client,NULL,0,sat,24);
 
-			/* The rest of the data from GET_SAT is numerical,
-		 	   and can be parsed using the sscanf() function.
-			   First, the satellite name is removed from "buf",
-			   and then "buf" is parsed for numerical data
-			   using an sscanf(). */
+			if (predict_get_time(client,&current_time)==-1)
+				error=1;
+		}
 
-			for (y=0; buf[x+y]!=0; y++)
-				buf[y]=buf[x+y];
+		if (sats==-1)
+			error=1;
 
-			buf[y]=0;
+		for (x=0; error==0 && x<sats; x++)
+		{
 			color[0]=0;
- 
-			sscanf(buf,"%f %f %f %f %ld %f %f %f %f %ld %c",&slong,&slat,&az,&el,&next_event_time,&footprint,&range,&altitude,&velocity,&orbitnum,&visibility);
 
-			if (strcmp(satnamelist[z],sat2track)==0 && range>0.0)
+			if (strcmp(sat[x].name,sat2track)==0 && sat[x].range>0.0)
 			{
-				mapcenterlat=slat;
-				mapcenterlong=convertlong(slong);
-				rangecircle(slat,slong,footprint,visibility);
+				mapcenterlat=sat[x].lat;
+				mapcenterlong=convertlong(sat[x].lon);
+				rangecircle(sat[x].lat,sat[x].lon,sat[x].footprint,sat[x].visibility);
 				circledrawn=1;
 
 				if (zoom)
-					radius=(int)(100.0*(R0/footprint));
+					radius=(int)(100.0*(R0/sat[x].footprint));
 				else
 					radius=50;
 
@@ -585,27 +542,21 @@ char argc, *argv[];
 					radius=50;
 			}
 
-			if (range>0.0)
+			if (sat[x].range>0.0)
 			{
 				if (xplanet)
-					strcpy(color,vis2color(visibility));
+					strcpy(color,vis2color(sat[x].visibility));
 				else
 					color[0]=0;
 
-				fprintf(markerfd,"%8.3f %8.3f %c%s%c %s\n",slat,convertlong(slong),34,satnamelist[z],34,color);
-
-
-				/* Get current time from PREDICT server */
-
-				strcpy(buf, send_command(hostname,"GET_TIME"));
-				sscanf(buf,"%ld",&current_time);
+				fprintf(markerfd,"%8.3f %8.3f %c%s%c %s\n",sat[x].lat,convertlong(sat[x].lon),34,sat[x].name,34,color);
 
 				/* Draw range circle if satellite is in range,
 				   or will be in range within 5 minutes. */
 
-				if (xplanet && zoom==0 && (el>=0.0 || ((next_event_time-current_time)<300)))
+				if (xplanet && zoom==0 && (sat[x].el>=0.0 || ((sat[x].next_event-current_time)<300.0)))
 				{
-					rangecircle(slat,slong,footprint,visibility);
+					rangecircle(sat[x].lat,sat[x].lon,sat[x].footprint,sat[x].visibility);
 					circledrawn=1;
 				}
 			}
@@ -644,6 +595,8 @@ char argc, *argv[];
 		}
 	}
 
+	predict_disconnect(client);
+
 	if (error)
 	{
 		unlink(markerfile);
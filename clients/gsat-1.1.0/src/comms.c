@@ -331,6 +331,7 @@ timeout_callback( gpointer data )
   gint sx, sy;
   GdkPoint footprintdots[360], qthfootprintdots[360];
   char visible;
+  int batch;
   static int flash, azflash;
 
   TWOPI=2.0*PI;
@@ -365,9 +366,9 @@ timeout_callback( gpointer data )
 /*      doprediction=FALSE; */
 /*    } */
 
-  /* Get satellite data */
+  /* Get satellite data and doppler shift in a single request */
   /* Build a command buffer */
-  sprintf(buf,"GET_SAT %s\n",satname);
+  sprintf(buf,"GET_SATS %s\n",satname);
 
   /* Send the command to the server */
   send_command(netsocket,buf);
@@ -379,18 +380,20 @@ timeout_callback( gpointer data )
     return TRUE;
   }
 
-  /* Get doppler data */
-  /* Build a command buffer */
-  sprintf(buf2,"GET_DOPPLER %s\n",satname);
+  if( strncmp(buf,"Huh?",4)==0 || strncmp(buf,"NONE",4)==0 ) {
+    /* Older servers: get satellite data */
+    /* Build a command buffer */
+    sprintf(buf,"GET_SAT %s\n",satname);
 
-  /* Send the command to the server */
-  send_command(netsocket,buf2);
+    /* Send the command to the server */
+    send_command(netsocket,buf);
 
-  /* Get the response */
-  if(get_response(netsocket,buf2)==-1) {
-    error_dialog("Too many errors receiving response from server, disconnecting");
-    on_cb_disconnect_clicked();
-    return TRUE;
+    /* Get the response */
+    if(get_response(netsocket,buf)==-1) {
+      error_dialog("Too many errors receiving response from server, disconnecting");
+      on_cb_disconnect_clicked();
+      return TRUE;
+    }
   }
 
   /* Parse the satellite data */
@@ -414,12 +417,31 @@ timeout_callback( gpointer data )
 
   buf[j]=0;
  
-  sscanf(buf,"%f %f %f %f %ld %f %f %f %f %ld %c %f %f %f",
-	 &slong, &slat, &az, &el, &aostime, &footprint, &range,
-	 &altitude, &velocity, &orbitnumber, &visible, &phase, &eclipse, &squint);
+  /* GET_SATS returns the doppler shift after the other data.
+     Older servers answer GET_SATS as GET_SAT, without it. */
+  batch=(sscanf(buf,"%f %f %f %f %ld %f %f %f %f %ld %c %f %f %f %f",
+		&slong, &slat, &az, &el, &aostime, &footprint, &range,
+		&altitude, &velocity, &orbitnumber, &visible, &phase, &eclipse,
+		&squint, &doppler)==15);
+
+  if( !batch ) {
+    /* Get doppler data */
+    /* Build a command buffer */
+    sprintf(buf2,"GET_DOPPLER %s\n",satname);
+
+    /* Send the command to the server */
+    send_command(netsocket,buf2);
+
+    /* Get the response */
+    if(get_response(netsocket,buf2)==-1) {
+      error_dialog("Too many errors receiving response from server, disconnecting");
+      on_cb_disconnect_clicked();
+      return TRUE;
+    }
 
-  /* Get doppler shift */
-  sscanf(buf2,"%f",&doppler );
+    /* Get doppler shift */
+    sscanf(buf2,"%f",&doppler );
+  }
 
   /* Get qth data */
   /* Build a command buffer */
@@ -24,148 +24,53 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <time.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <netdb.h>
-#include <signal.h>
-#include <errno.h>
-#include <arpa/inet.h>
+#include "predict_client.h"
 
-char string[625];
-
-int connectsock(char *host, char *service, char *protocol)
+int reload(host)
+char *host;
 {
-	/* This function is used to connect to the server.  "host" is the
-	   name of the computer on which PREDICT is running in server mode.
-	   "service" is the name of the socket port.  "protocol" is the
-	   socket protocol.  It should be set to UDP. */
-
-	struct hostent *phe;
-	struct servent *pse;
-	struct protoent *ppe;
-	struct sockaddr_in sin;
-	
-	int s, type;
-	
-	memset((char *)&sin, 0, sizeof(struct sockaddr_in));
-	sin.sin_family=AF_INET;
-	
-	if ((pse=getservbyname(service,protocol)))
-		sin.sin_port=pse->s_port;
+	/* This function asks PREDICT running on machine
+	   "host" to reload its TLE database. */
 
-	else if ((sin.sin_port=htons((unsigned short)atoi(service)))==0)
-	{
-		printf("Can't get services\n");
-		return -1;
-	}
+	struct predict_client *client;
+	int result;
+	char reply[16];
 
-	if ((phe=gethostbyname(host)))
-		bcopy(phe->h_addr,(char *)&sin.sin_addr,phe->h_length);
+	client=predict_connect(host,NULL);
 
-	else if ((sin.sin_addr.s_addr=inet_addr(host))==INADDR_NONE)
+	if (client==NULL)
 	{
-		printf("Can't get host: %c%s%c.\n",34,host,34);
+		fprintf(stderr,"Can't get host: %c%s%c.\n",34,host,34);
 		return -1;
 	}
-	
-	if ((ppe=getprotobyname(protocol))==0)
-		return -1;
-
-	if (strcmp(protocol,"udp")==0)
-		type=SOCK_DGRAM;
-	else
-		type=SOCK_STREAM;
-	
-	s=socket(PF_INET,type,ppe->p_proto);
-
-	if (s<0)
-	{
-		printf("Can't get socket.\n");
-		return -1;
-	}
-
-	if (connect(s,(struct sockaddr *)&sin,sizeof(sin))<0)
-	{
-		printf("Can't connect to socket.\n");
-		return -1;
-	}
-
-	return s;
-}
-
-void get_response(int sock, char *buf)
-{
-	/* This function gets a response from the
-	   server in the form of a character string. */
-
-	int n;
-
-	n=read(sock,buf,625);
-
-	if (n<0)
-	{
-		if (errno==EINTR)
-			return;
-
-		if (errno==ECONNREFUSED)
-		{
-			fprintf(stderr, "Connection refused - server not running\n");
-			exit(1);
-		}
-	}
 
-	buf[n]='\0';
-}
-
-char *send_command(host, command)
-char *host, *command;
-{
-	int sk;
-
-	/* This function sends "command" to PREDICT running on
-	   machine "host", and returns the result of the command
-	   as a pointer to a character string. */
+	result=predict_reload_tle(client);
 
-	/* Open a network socket */
-	sk=connectsock(host,"predict","udp");
+	/* A PREDICT without the binary protocol
+	   is sent its text command instead */
 
-	if (sk<0)
-		exit(-1);
+	if (result==-1 && predict_command(client,"RELOAD_TLE",reply,sizeof(reply))!=-1)
+		result=0;
 
-	/* Build a command buffer */
-	sprintf(string,"%s\n",command);
+	if (result==-1)
+		fprintf(stderr,"No response from the PREDICT server on %s\n",host);
 
-	/* Send the command to the server */
-   	write(sk,command,strlen(string));
+	predict_disconnect(client);
 
-	/* clear string[] so it can be re-used for the response */
-	string[0]=0;
-
-	/* Get the response */
-   	get_response(sk,string);
-
-	/* Close the connection */
-   	close(sk);
-
-	return string;
+	return result;
 }
 
 int main(argc,argv)
 int argc;
 char *argv[];
 {
-	int x;
+	int x, error=0;
 
 	if (argc==1)
-		send_command("localhost", "RELOAD_TLE");
+		error=reload("localhost");
 	else
 		for (x=1; x<argc; x++)
-			send_command(argv[x],"RELOAD_TLE");
+			error|=reload(argv[x]);
 
-	exit(0);
+	exit(error?1:0);
 }
-
@@ -0,0 +1,81 @@
+/****************************************************************************
+*        catalog: Lists the satellites tracked by a PREDICT server          *
+*****************************************************************************
+*                                                                           *
+*  A simple example of the use of libpredict.  It prints the tracking      *
+*  data that PREDICT publishes in shared memory, either for every          *
+*  satellite, or for the satellite named on the command line.              *
+*                                                                           *
+*  Usage: catalog [-n port] [satellite]                                     *
+*                                                                           *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "predict_shm.h"
+
+int main(int argc, char *argv[])
+{
+	struct predict_catalog *catalog, copy;
+	struct predict_sat sat;
+	char *port=NULL, *name=NULL;
+	int x;
+
+	for (x=1; x<argc; x++)
+	{
+		if (strcmp(argv[x],"-n")==0 && x+1<argc)
+			port=argv[++x];
+		else
+			name=argv[x];
+	}
+
+	catalog=predict_open_catalog(port);
+
+	if (catalog==NULL)
+	{
+		fprintf(stderr,"No catalog found.  Is PREDICT running in server mode?\n");
+		return 1;
+	}
+
+	if (name!=NULL)
+	{
+		if (predict_read_sat(catalog,name,&sat)==-1)
+		{
+			fprintf(stderr,"%s: No such satellite.\n",name);
+			return 1;
+		}
+
+		printf("%s (%d)\n",sat.name,sat.catnum);
+		printf("Azimuth   : %8.2f deg\n",sat.az);
+		printf("Elevation : %8.2f deg\n",sat.el);
+		printf("Range     : %8.1f km\n",sat.range);
+		printf("Range Rate: %8.3f km/s\n",sat.range_rate);
+		printf("Latitude  : %8.2f N\n",sat.lat);
+		printf("Longitude : %8.2f W\n",sat.lon);
+		printf("Doppler   : %8.1f Hz at 100 MHz\n",sat.doppler);
+		printf("Next Event: %8.0f\n",sat.next_event);
+	}
+
+	else
+	{
+		if (predict_read_catalog(catalog,&copy)==-1)
+		{
+			fprintf(stderr,"The catalog has not been published yet.\n");
+			return 1;
+		}
+
+		printf("Generation %u at %.3f\n",copy.generation,copy.time);
+
+		for (x=0; x<(int)copy.satellites; x++)
+		{
+			if (copy.sat[x].name[0])
+				printf("%-15s %6d %7.2f %7.2f %9.1f %8.3f %c %10.0f\n",copy.sat[x].name,copy.sat[x].catnum,copy.sat[x].az,copy.sat[x].el,copy.sat[x].range,copy.sat[x].range_rate,copy.sat[x].visibility,copy.sat[x].next_event);
+		}
+
+		printf("Sun  %7.2f %7.2f\nMoon %7.2f %7.2f\n",copy.sun_az,copy.sun_el,copy.moon_az,copy.moon_el);
+	}
+
+	predict_close_catalog(catalog);
+
+	return 0;
+}
@@ -0,0 +1,203 @@
+/****************************************************************************
+*       libpredict: Reader library for PREDICT's shared memory data         *
+*****************************************************************************
+*                                                                           *
+*  These functions map the catalog and Doppler feed published by PREDICT   *
+*  in server mode, and make consistent copies of them for clients.  The    *
+*  layout of both is described in predict_shm.h.                           *
+*                                                                           *
+*****************************************************************************
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify it   *
+* under the terms of the GNU General Public License as published by the     *
+* Free Software Foundation; either version 2 of the License or any later    *
+* version.                                                                  *
+*                                                                           *
+* This program is distributed in the hope that it will useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or     *
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License     *
+* for more details.                                                         *
+*                                                                           *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "predict_shm.h"
+
+static void *map_segment(const char *name, const char *port, size_t size)
+{
+	/* This function maps the shared memory segment "name"
+	   published by the PREDICT server on "port" read-only.
+	   A segment smaller than "size" (of another layout) is
+	   left alone, since reading past its end would fault. */
+
+	char path[64];
+	int fd;
+	void *map;
+	struct stat info;
+
+	if (port==NULL || port[0]==0)
+		snprintf(path,sizeof(path),"/%s",name);
+	else
+		snprintf(path,sizeof(path),"/%s-%s",name,port);
+
+	fd=shm_open(path,O_RDONLY,0);
+
+	if (fd==-1)
+		return NULL;
+
+	if (fstat(fd,&info)==-1 || info.st_size<(off_t)size)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	map=mmap(NULL,size,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+
+	if (map==MAP_FAILED)
+		return NULL;
+
+	return map;
+}
+
+static void read_segment(const void *segment, const uint32_t *seq, void *copy, size_t size)
+{
+	/* This function copies "size" bytes of "segment", whose
+	   sequence number is at "seq", retrying until PREDICT
+	   did not write to it while it was being copied. */
+
+	uint32_t before, after;
+
+	for (;;)
+	{
+		before=__atomic_load_n(seq,__ATOMIC_ACQUIRE);
+
+		if (before&1)
+		{
+			sched_yield();
+			continue;
+		}
+
+		memcpy(copy,segment,size);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		after=__atomic_load_n(seq,__ATOMIC_ACQUIRE);
+
+		if (before==after)
+			break;
+	}
+}
+
+struct predict_catalog *predict_open_catalog(const char *port)
+{
+	struct predict_catalog *catalog;
+
+	catalog=(struct predict_catalog *)map_segment("predict-catalog",port,sizeof(struct predict_catalog));
+
+	if (catalog!=NULL && (catalog->magic!=PREDICT_CATALOG_MAGIC || catalog->version!=PREDICT_CATALOG_VERSION || predict_server_running(catalog->pid)==0))
+	{
+		munmap(catalog,sizeof(struct predict_catalog));
+		catalog=NULL;
+	}
+
+	return catalog;
+}
+
+int predict_read_catalog(const struct predict_catalog *catalog, struct predict_catalog *copy)
+{
+	read_segment(catalog,&catalog->seq,copy,sizeof(struct predict_catalog));
+
+	if (copy->generation==0)
+		return -1;
+
+	return 0;
+}
+
+int predict_read_sat(const struct predict_catalog *catalog, const char *satellite, struct predict_sat *copy)
+{
+	/* The satellite is found by name or object number in a
+	   consistent copy of the catalog, so that all of its
+	   data comes from the same update. */
+
+	struct predict_catalog last;
+	int x, catnum;
+	char *end;
+
+	if (predict_read_catalog(catalog,&last)==-1)
+		return -1;
+
+	catnum=(int)strtol(satellite,&end,10);
+
+	for (x=0; x<(int)last.satellites && x<24; x++)
+	{
+		if (last.sat[x].name[0]==0)
+			continue;
+
+		if ((*end==0 && last.sat[x].catnum==catnum) || strcmp(last.sat[x].name,satellite)==0)
+		{
+			memcpy(copy,&last.sat[x],sizeof(struct predict_sat));
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+void predict_close_catalog(struct predict_catalog *catalog)
+{
+	if (catalog!=NULL)
+		munmap(catalog,sizeof(struct predict_catalog));
+}
+
+struct predict_doppler *predict_open_doppler(const char *port)
+{
+	struct predict_doppler *doppler;
+
+	doppler=(struct predict_doppler *)map_segment("predict-doppler",port,sizeof(struct predict_doppler));
+
+	if (doppler!=NULL && (doppler->magic!=PREDICT_DOPPLER_MAGIC || doppler->version!=PREDICT_DOPPLER_VERSION || predict_server_running(doppler->pid)==0))
+	{
+		munmap(doppler,sizeof(struct predict_doppler));
+		doppler=NULL;
+	}
+
+	return doppler;
+}
+
+int predict_read_doppler(const struct predict_doppler *doppler, struct predict_doppler *copy)
+{
+	read_segment(doppler,&doppler->seq,copy,sizeof(struct predict_doppler));
+
+	if (copy->generation==0)
+		return -1;
+
+	return 0;
+}
+
+void predict_close_doppler(struct predict_doppler *doppler)
+{
+	if (doppler!=NULL)
+		munmap(doppler,sizeof(struct predict_doppler));
+}
+
+int predict_server_running(int pid)
+{
+	/* A process that exists but belongs to another
+	   user (EPERM) is running all the same. */
+
+	if (pid<=0)
+		return 0;
+
+	if (kill((pid_t)pid,0)==0 || errno==EPERM)
+		return 1;
+
+	return 0;
+}
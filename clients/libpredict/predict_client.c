@@ -0,0 +1,431 @@
+/****************************************************************************
+*       libpredict: Client library for PREDICT's binary socket protocol     *
+*****************************************************************************
+*                                                                           *
+*  These functions send requests in the binary form described in          *
+*  predict_proto.h to a PREDICT server over UDP, and decode its replies.  *
+*  Values are encoded and decoded a byte at a time, so that the library   *
+*  works the same on hosts of either byte order.                          *
+*                                                                           *
+*****************************************************************************
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify it   *
+* under the terms of the GNU General Public License as published by the     *
+* Free Software Foundation; either version 2 of the License or any later    *
+* version.                                                                  *
+*                                                                           *
+* This program is distributed in the hope that it will useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or     *
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License     *
+* for more details.                                                         *
+*                                                                           *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include "predict_client.h"
+
+struct predict_client
+{
+	int		sock;
+	unsigned int	seq;
+	double		time;
+	unsigned char	reply[8192];
+};
+
+static void put_int(unsigned char *out, unsigned long long value, int bytes)
+{
+	int x;
+
+	for (x=0; x<bytes; x++)
+		out[x]=(unsigned char)((value>>(8*x))&0xff);
+}
+
+static unsigned long long get_int(const unsigned char *in, int bytes)
+{
+	unsigned long long value=0;
+	int x;
+
+	for (x=bytes-1; x>=0; x--)
+		value=(value<<8)|in[x];
+
+	return value;
+}
+
+static double get_double(const unsigned char *in)
+{
+	unsigned long long bits;
+	double value;
+
+	bits=get_int(in,8);
+	memcpy(&value,&bits,8);
+
+	return value;
+}
+
+static void get_string(char *out, const unsigned char *in, int size)
+{
+	/* Strings are NUL terminated in the protocol, but
+	   are copied defensively all the same. */
+
+	memcpy(out,in,size);
+	out[size-1]=0;
+}
+
+struct predict_client *predict_connect(const char *host, const char *port)
+{
+	struct predict_client *client;
+	struct addrinfo hints, *addr;
+	int sock;
+
+	memset(&hints,0,sizeof(hints));
+	hints.ai_family=AF_INET;
+	hints.ai_socktype=SOCK_DGRAM;
+
+	if (host==NULL)
+		host="localhost";
+
+	if (port!=NULL)
+	{
+		if (getaddrinfo(host,port,&hints,&addr)!=0)
+			return NULL;
+	}
+
+	else if (getaddrinfo(host,"predict",&hints,&addr)!=0 && getaddrinfo(host,"1210",&hints,&addr)!=0)
+		return NULL;
+
+	sock=socket(addr->ai_family,addr->ai_socktype,addr->ai_protocol);
+
+	if (sock==-1 || connect(sock,addr->ai_addr,addr->ai_addrlen)==-1)
+	{
+		if (sock!=-1)
+			close(sock);
+
+		freeaddrinfo(addr);
+		return NULL;
+	}
+
+	freeaddrinfo(addr);
+
+	client=(struct predict_client *)calloc(1,sizeof(struct predict_client));
+
+	if (client==NULL)
+	{
+		close(sock);
+		return NULL;
+	}
+
+	client->sock=sock;
+	client->seq=(unsigned int)time(NULL)^(unsigned int)getpid();
+
+	return client;
+}
+
+void predict_disconnect(struct predict_client *client)
+{
+	if (client!=NULL)
+	{
+		close(client->sock);
+		free(client);
+	}
+}
+
+static int request(struct predict_client *client, int command, const unsigned char *data, int size)
+{
+	/* This function sends "command", with "size" bytes of
+	   "data", and waits for the matching reply, which is left
+	   in client->reply.  The length of its data is returned,
+	   or -1 if none could be had.  Replies to earlier requests
+	   that arrive late are told apart by sequence number. */
+
+	unsigned char message[1024];
+	struct pollfd wait;
+	int tries, n;
+
+	if (size>(int)sizeof(message)-PREDICT_HEADER_SIZE)
+		return -1;
+
+	client->seq++;
+
+	put_int(message,PREDICT_PROTO_MAGIC,4);
+	put_int(message+4,PREDICT_PROTO_VERSION,2);
+	put_int(message+6,(unsigned long long)command,2);
+	put_int(message+8,client->seq,4);
+	put_int(message+12,(unsigned long long)size,4);
+	put_int(message+16,0,8);
+
+	if (size>0)
+		memcpy(message+PREDICT_HEADER_SIZE,data,size);
+
+	for (tries=0; tries<PREDICT_CLIENT_TRIES; tries++)
+	{
+		if (send(client->sock,message,PREDICT_HEADER_SIZE+size,0)==-1)
+			return -1;
+
+		wait.fd=client->sock;
+		wait.events=POLLIN;
+
+		while (poll(&wait,1,PREDICT_CLIENT_TIMEOUT)==1)
+		{
+			n=(int)recv(client->sock,client->reply,sizeof(client->reply),0);
+
+			if (n==-1)
+			{
+				if (errno==EINTR)
+					continue;
+
+				return -1;	/* No server (ECONNREFUSED) */
+			}
+
+			/* A server that doesn't speak the binary
+			   protocol answers "Huh?" in text */
+
+			if (n<PREDICT_HEADER_SIZE || get_int(client->reply,4)!=PREDICT_PROTO_MAGIC)
+				return -1;
+
+			if (get_int(client->reply+8,4)!=client->seq)
+				continue;
+
+			if (get_int(client->reply+6,2)!=(unsigned long long)command || get_int(client->reply+12,4)>(unsigned long long)(n-PREDICT_HEADER_SIZE))
+				return -1;
+
+			client->time=(double)(long long)get_int(client->reply+16,8)/1.0e9;
+
+			return (int)get_int(client->reply+12,4);
+		}
+	}
+
+	return -1;
+}
+
+double predict_data_time(const struct predict_client *client)
+{
+	return client->time;
+}
+
+int predict_get_list(struct predict_client *client, struct predict_entry *list, int max)
+{
+	unsigned char *data=client->reply+PREDICT_HEADER_SIZE;
+	int x, count, length;
+
+	length=request(client,PREDICT_GET_LIST,NULL,0);
+
+	if (length<4)
+		return -1;
+
+	count=(int)get_int(data,4);
+
+	if (count>(length-4)/PREDICT_LIST_SIZE)
+		return -1;
+
+	for (x=0; x<count && x<max; x++)
+	{
+		get_string(list[x].name,data+4+x*PREDICT_LIST_SIZE,32);
+		list[x].catnum=(int)get_int(data+4+x*PREDICT_LIST_SIZE+32,4);
+	}
+
+	return x;
+}
+
+int predict_get_sats(struct predict_client *client, const int *catnums, int count, struct predict_sat *sats, int max)
+{
+	unsigned char query[1000], *data=client->reply+PREDICT_HEADER_SIZE, *in;
+	int x, length;
+
+	if (count<0 || count>(int)(sizeof(query)-4)/4)
+		return -1;
+
+	put_int(query,(unsigned long long)count,4);
+
+	for (x=0; x<count; x++)
+		put_int(query+4+4*x,(unsigned long long)catnums[x],4);
+
+	length=request(client,PREDICT_GET_SATS,query,4+4*count);
+
+	if (length<4)
+		return -1;
+
+	count=(int)get_int(data,4);
+
+	if (count>(length-4)/PREDICT_RECORD_SIZE)
+		return -1;
+
+	for (x=0; x<count && x<max; x++)
+	{
+		in=data+4+x*PREDICT_RECORD_SIZE;
+
+		memset(&sats[x],0,sizeof(struct predict_sat));
+		get_string(sats[x].name,in,sizeof(sats[x].name));
+		sats[x].catnum=(int)get_int(in+32,4);
+		sats[x].orbitnum=(int)get_int(in+36,4);
+		sats[x].visibility=(char)in[40];
+		sats[x].in_view=(char)in[41];
+		sats[x].next_event=(double)(long long)get_int(in+48,8);
+		sats[x].lon=get_double(in+56);
+		sats[x].lat=get_double(in+64);
+		sats[x].az=get_double(in+72);
+		sats[x].el=get_double(in+80);
+		sats[x].footprint=get_double(in+88);
+		sats[x].range=get_double(in+96);
+		sats[x].range_rate=get_double(in+104);
+		sats[x].altitude=get_double(in+112);
+		sats[x].velocity=get_double(in+120);
+		sats[x].phase=get_double(in+128);
+		sats[x].eclipse_depth=get_double(in+136);
+		sats[x].squint=get_double(in+144);
+		sats[x].doppler=get_double(in+152);
+	}
+
+	return x;
+}
+
+int predict_get_pass(struct predict_client *client, int catnum, double start, struct predict_pass *pass)
+{
+	unsigned char query[12], *data=client->reply+PREDICT_HEADER_SIZE;
+	int length;
+
+	put_int(query,(unsigned long long)catnum,4);
+	put_int(query+4,(unsigned long long)(long long)start,8);
+
+	length=request(client,PREDICT_GET_PASS,query,12);
+
+	if (length<0)
+		return -1;
+
+	if (length<PREDICT_PASS_SIZE)
+		return 0;
+
+	pass->catnum=(int)get_int(data,4);
+	pass->aos=get_double(data+8);
+	pass->aos_az=get_double(data+16);
+	pass->tca=get_double(data+24);
+	pass->tca_az=get_double(data+32);
+	pass->tca_el=get_double(data+40);
+	pass->tca_range=get_double(data+48);
+	pass->maxel_time=get_double(data+56);
+	pass->maxel=get_double(data+64);
+	pass->maxel_az=get_double(data+72);
+	pass->los=get_double(data+80);
+	pass->los_az=get_double(data+88);
+
+	return 1;
+}
+
+int predict_get_qth(struct predict_client *client, struct predict_qth *qth)
+{
+	unsigned char *data=client->reply+PREDICT_HEADER_SIZE;
+
+	if (request(client,PREDICT_GET_QTH,NULL,0)<56)
+		return -1;
+
+	get_string(qth->callsign,data,32);
+	qth->lat=get_double(data+32);
+	qth->lon=get_double(data+40);
+	qth->altitude=get_double(data+48);
+
+	return 0;
+}
+
+int predict_get_time(struct predict_client *client, double *time)
+{
+	if (request(client,PREDICT_GET_TIME,NULL,0)<8)
+		return -1;
+
+	*time=(double)(long long)get_int(client->reply+PREDICT_HEADER_SIZE,8)/1.0e9;
+
+	return 0;
+}
+
+static int get_position(struct predict_client *client, int command, double *az, double *el)
+{
+	if (request(client,command,NULL,0)<16)
+		return -1;
+
+	*az=get_double(client->reply+PREDICT_HEADER_SIZE);
+	*el=get_double(client->reply+PREDICT_HEADER_SIZE+8);
+
+	return 0;
+}
+
+int predict_get_sun(struct predict_client *client, double *az, double *el)
+{
+	return get_position(client,PREDICT_GET_SUN,az,el);
+}
+
+int predict_get_moon(struct predict_client *client, double *az, double *el)
+{
+	return get_position(client,PREDICT_GET_MOON,az,el);
+}
+
+int predict_get_version(struct predict_client *client, char *version, int size)
+{
+	char copy[16];
+
+	if (size<1 || request(client,PREDICT_GET_VERSION,NULL,0)<16)
+		return -1;
+
+	get_string(copy,client->reply+PREDICT_HEADER_SIZE,16);
+	strncpy(version,copy,size-1);
+	version[size-1]=0;
+
+	return 0;
+}
+
+int predict_reload_tle(struct predict_client *client)
+{
+	if (request(client,PREDICT_RELOAD_TLE,NULL,0)<0)
+		return -1;
+
+	return 0;
+}
+
+int predict_command(struct predict_client *client, const char *command, char *reply, int size)
+{
+	/* Text replies carry no sequence number, so replies
+	   to earlier requests that are still waiting (such
+	   as a late "Huh?") are discarded first. */
+
+	struct pollfd wait;
+	int tries, n;
+
+	if (size<1)
+		return -1;
+
+	while (recv(client->sock,client->reply,sizeof(client->reply),MSG_DONTWAIT)>=0);
+
+	for (tries=0; tries<PREDICT_CLIENT_TRIES; tries++)
+	{
+		if (send(client->sock,command,strlen(command),0)==-1)
+			return -1;
+
+		wait.fd=client->sock;
+		wait.events=POLLIN;
+
+		while (poll(&wait,1,PREDICT_CLIENT_TIMEOUT)==1)
+		{
+			n=(int)recv(client->sock,reply,size-1,0);
+
+			if (n==-1)
+			{
+				if (errno==EINTR)
+					continue;
+
+				return -1;
+			}
+
+			reply[n]=0;
+
+			return n;
+		}
+	}
+
+	return -1;
+}
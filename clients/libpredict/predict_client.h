@@ -0,0 +1,123 @@
+/****************************************************************************
+*         PREDICT: Client library for the binary socket protocol            *
+*****************************************************************************
+*                                                                           *
+*  These functions query a PREDICT server, local or remote, using the     *
+*  binary protocol described in predict_proto.h, and return its replies   *
+*  decoded into native structures.  Requests are sent over UDP, and are   *
+*  retried if no reply arrives in time.                                    *
+*                                                                           *
+*****************************************************************************
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify it   *
+* under the terms of the GNU General Public License as published by the     *
+* Free Software Foundation; either version 2 of the License or any later    *
+* version.                                                                  *
+*                                                                           *
+* This program is distributed in the hope that it will useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or     *
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License     *
+* for more details.                                                         *
+*                                                                           *
+*****************************************************************************/
+
+#ifndef PREDICT_CLIENT_H
+#define PREDICT_CLIENT_H
+
+#include "predict_proto.h"
+#include "predict_shm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A connection to a PREDICT server, returned by predict_connect() */
+
+struct predict_client;
+
+struct predict_entry
+{
+	char	name[32];
+	int	catnum;
+};
+
+struct predict_pass
+{
+	int	catnum;
+	double	aos, aos_az;	/* Unix time, degrees */
+	double	tca, tca_az, tca_el, tca_range;	/* Closest approach, km */
+	double	maxel_time, maxel, maxel_az;
+	double	los, los_az;
+};
+
+struct predict_qth
+{
+	char	callsign[32];
+	double	lat, lon;	/* Degrees north and west */
+	double	altitude;	/* Meters */
+};
+
+/* predict_connect() returns a connection to the PREDICT server
+   running on "host" (NULL for "localhost") at "port" (NULL for
+   the "predict" service, or 1210 if there is none), or NULL if
+   the host or port can't be found.  No request is sent until one
+   of the functions below is called.
+
+   Each of them returns -1 if the server did not answer (after
+   PREDICT_CLIENT_TRIES attempts, PREDICT_CLIENT_TIMEOUT
+   milliseconds apart), answered in text (a version of PREDICT
+   without the binary protocol), or could not answer the request.
+
+   predict_get_list() fills "list" with the names and object numbers
+   of up to "max" satellites, returning how many there were.
+
+   predict_get_sats() fills "sats" with the tracking data of up to
+   "max" of the "count" satellites whose object numbers are given
+   in "catnums", or of every satellite if "count" is 0, returning
+   how many were found.  predict_sat is the structure used by the
+   shared memory catalog (see predict_shm.h).
+
+   predict_get_pass() fills "pass" with the times of AOS, closest
+   approach, maximum elevation and LOS of the pass of satellite
+   "catnum" in progress at, or following, Unix time "start" (0 for
+   now, otherwise within a year of PREDICT's clock), with the
+   azimuths at each, returning 1, or 0 if the satellite has no pass
+   to come.
+
+   predict_get_time() returns the time of PREDICT's clock, which may
+   run ahead of or faster than the system clock (-start and -warp),
+   as a Unix time.  predict_data_time() returns the time for which
+   the data of the last reply received on "client" was calculated.
+
+   predict_command() sends the text command "command" (such as
+   "GET_SAT ISS"), as understood by every version of PREDICT, and
+   copies up to "size"-1 bytes of the reply to "reply", returning its
+   length.  Clients use it to fall back to the text commands when a
+   server doesn't speak the binary protocol.
+
+   The other functions return 0 on success. */
+
+#define PREDICT_CLIENT_TRIES	3
+#define PREDICT_CLIENT_TIMEOUT	1000
+
+struct predict_client *predict_connect(const char *host, const char *port);
+void predict_disconnect(struct predict_client *client);
+
+int predict_get_list(struct predict_client *client, struct predict_entry *list, int max);
+int predict_get_sats(struct predict_client *client, const int *catnums, int count, struct predict_sat *sats, int max);
+int predict_get_pass(struct predict_client *client, int catnum, double start, struct predict_pass *pass);
+int predict_get_qth(struct predict_client *client, struct predict_qth *qth);
+int predict_get_time(struct predict_client *client, double *time);
+int predict_get_sun(struct predict_client *client, double *az, double *el);
+int predict_get_moon(struct predict_client *client, double *az, double *el);
+int predict_get_version(struct predict_client *client, char *version, int size);
+int predict_reload_tle(struct predict_client *client);
+int predict_command(struct predict_client *client, const char *command, char *reply, int size);
+
+double predict_data_time(const struct predict_client *client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
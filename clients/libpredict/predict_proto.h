@@ -0,0 +1,137 @@
+/****************************************************************************
+*         PREDICT: Binary protocol of the socket server (version 1)         *
+*****************************************************************************
+*                                                                           *
+*  Alongside its text commands, PREDICT's socket server answers requests   *
+*  made in a compact binary form, which carries every value at its full    *
+*  precision and needs no formatting or parsing on either end.  A request  *
+*  is recognized as binary by the magic number at its start, so clients    *
+*  may mix both forms freely.  Over UDP, each request and reply is a       *
+*  single datagram.  Over TCP, the length in the header frames them.       *
+*                                                                           *
+*  Every message starts with a 24 byte header, followed by "length" bytes  *
+*  of data.  All integers are little-endian, and all floating point        *
+*  values are IEEE 754 doubles, little-endian, whatever the byte order of  *
+*  the hosts involved.  Offsets are in bytes.                              *
+*                                                                           *
+*****************************************************************************
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify it   *
+* under the terms of the GNU General Public License as published by the     *
+* Free Software Foundation; either version 2 of the License or any later    *
+* version.                                                                  *
+*                                                                           *
+* This program is distributed in the hope that it will useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or     *
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License     *
+* for more details.                                                         *
+*                                                                           *
+*****************************************************************************/
+
+#ifndef PREDICT_PROTO_H
+#define PREDICT_PROTO_H
+
+/* Header:
+
+	 0  u32  magic		PREDICT_PROTO_MAGIC ("PRDB")
+	 4  u16  version	PREDICT_PROTO_VERSION
+	 6  u16  command	One of the commands below.  Replies carry
+				the command of the request, or'ed with
+				PREDICT_ERROR if it couldn't be answered.
+	 8  u32  seq		Chosen by the client, returned in the reply
+	12  u32  length		Bytes of data following the header
+	16  i64  time		Replies: Unix time (nanoseconds) for which
+				the tracking data was calculated.
+				Requests: 0 */
+
+#define PREDICT_PROTO_MAGIC	0x42445250
+#define PREDICT_PROTO_VERSION	1
+#define PREDICT_HEADER_SIZE	24
+#define PREDICT_ERROR		0x8000
+
+/* Commands, and the data of their requests and replies:
+
+   PREDICT_GET_LIST	Request: nothing
+			Reply:	 u32 count, then for each satellite:
+				 0  char name[32]  (NUL terminated)
+				32  u32  catnum
+
+   PREDICT_GET_SATS	Request: u32 count, then "count" u32 object
+				 numbers (0 for every satellite)
+			Reply:	 u32 count, then a PREDICT_RECORD_SIZE
+				 byte record for each satellite found:
+				 0  char name[32]
+				32  u32  catnum
+				36  u32  orbitnum
+				40  u8   visibility ('N', 'D', or 'V')
+				41  u8   in_view (1 while above the horizon)
+				42  6 bytes of padding
+				48  i64  next AOS (or LOS while in view),
+					 Unix time in seconds, 0 if none
+				56  f64  longitude (degrees West)
+				64  f64  latitude (degrees North)
+				72  f64  azimuth (degrees)
+				80  f64  elevation (degrees)
+				88  f64  footprint (km)
+				96  f64  range (km)
+			       104  f64  range rate (km/s)
+			       112  f64  altitude (km)
+			       120  f64  velocity (km/s)
+			       128  f64  orbital phase (degrees)
+			       136  f64  eclipse depth (degrees)
+			       144  f64  squint (degrees, 360 if unknown)
+			       152  f64  Doppler shift of a 100 MHz downlink (Hz)
+
+   PREDICT_GET_QTH	Request: nothing
+			Reply:	 0  char callsign[32]
+				32  f64  latitude (degrees North)
+				40  f64  longitude (degrees West)
+				48  f64  altitude (meters)
+
+   PREDICT_GET_TIME	Request: nothing
+			Reply:	 i64 Unix time (nanoseconds) of PREDICT's clock
+
+   PREDICT_GET_SUN,	Request: nothing
+   PREDICT_GET_MOON	Reply:	 f64 azimuth, elevation (degrees)
+
+   PREDICT_GET_VERSION	Request: nothing
+			Reply:	 char version[16]
+
+   PREDICT_RELOAD_TLE	Request: nothing
+			Reply:	 nothing
+
+   PREDICT_GET_PASS	Request: u32 catnum, i64 start (Unix time
+				 in seconds, 0 for now, otherwise
+				 within a year of PREDICT's clock)
+			Reply:	 nothing if the satellite has no pass
+				 to come, or for the pass in progress
+				 at or following "start":
+				 0  u32  catnum
+				 4  4 bytes of padding
+				 8  f64  AOS (Unix time, seconds)
+				16  f64  azimuth at AOS
+				24  f64  TCA (time of closest approach)
+				32  f64  azimuth at TCA
+				40  f64  elevation at TCA
+				48  f64  range at TCA (km)
+				56  f64  time of maximum elevation
+				64  f64  maximum elevation
+				72  f64  azimuth at maximum elevation
+				80  f64  LOS
+				88  f64  azimuth at LOS */
+
+#define PREDICT_GET_LIST	1
+#define PREDICT_GET_SATS	2
+#define PREDICT_GET_QTH		3
+#define PREDICT_GET_TIME	4
+#define PREDICT_GET_SUN		5
+#define PREDICT_GET_MOON	6
+#define PREDICT_GET_VERSION	7
+#define PREDICT_RELOAD_TLE	8
+#define PREDICT_GET_PASS	9
+
+#define PREDICT_LIST_SIZE	36
+#define PREDICT_RECORD_SIZE	160
+#define PREDICT_PASS_SIZE	96
+
+#endif
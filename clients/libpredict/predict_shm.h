@@ -0,0 +1,149 @@
+/****************************************************************************
+*          PREDICT: Shared memory layout of the live tracking data          *
+*****************************************************************************
+*                                                                           *
+*  When running in server mode, PREDICT publishes its tracking data in     *
+*  POSIX shared memory, where clients on the same host can read it at any  *
+*  rate without system calls.  This file describes the layout of the two   *
+*  segments, and declares the functions of the reader library (libpredict) *
+*  that clients may use to read them.  It is also used by PREDICT itself.  *
+*                                                                           *
+*  Each segment starts with a magic number and a version, followed by a   *
+*  sequence number that is odd while PREDICT is writing to it.  A          *
+*  consistent copy is made by reading the sequence number, copying the     *
+*  data, and reading the sequence number again, retrying if the two        *
+*  differ or are odd.  The library does this.  The segments are laid out   *
+*  with types of fixed width, and with every field aligned to its size,    *
+*  so that 32 and 64 bit clients see the same layout as PREDICT.           *
+*                                                                           *
+*****************************************************************************
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify it   *
+* under the terms of the GNU General Public License as published by the     *
+* Free Software Foundation; either version 2 of the License or any later    *
+* version.                                                                  *
+*                                                                           *
+* This program is distributed in the hope that it will useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or     *
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License     *
+* for more details.                                                         *
+*                                                                           *
+*****************************************************************************/
+
+#ifndef PREDICT_SHM_H
+#define PREDICT_SHM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The catalog: the tracking data of every satellite in PREDICT's
+   database, as served by GET_SAT and GET_DOPPLER, along with the
+   positions of the Sun and Moon.  It is published under the name
+   "/predict-catalog", or "/predict-catalog-<port>" if PREDICT was
+   started with "-n <port>".  It is rewritten every time PREDICT's
+   tracking engine updates, and "generation" counts the updates. */
+
+#define PREDICT_CATALOG_MAGIC	0x50524443	/* "PRDC" */
+#define PREDICT_CATALOG_VERSION	2
+
+struct predict_sat
+{
+	char	name[25];
+	char	visibility;	/* 'V'isible, 'D'aylight, or 'N'ot visible */
+	char	in_view;	/* 1 while above the horizon (mask) */
+	char	reserved[5];
+	int32_t	catnum;		/* Object number */
+	int32_t	orbitnum;	/* Orbit number */
+	double	az, el;		/* Degrees */
+	double	range;		/* km */
+	double	range_rate;	/* km/sec, positive while receding */
+	double	lat, lon;	/* Sub-satellite point, degrees north and west */
+	double	altitude;	/* km */
+	double	velocity;	/* km/sec */
+	double	footprint;	/* km */
+	double	doppler;	/* Doppler shift (Hz) of a 100 MHz downlink */
+	double	next_event;	/* Unix time of the next AOS, or LOS while in view */
+	double	phase;		/* Orbital phase, degrees */
+	double	eclipse_depth;	/* Degrees */
+	double	squint;		/* Degrees, 360 if unknown */
+};
+
+struct predict_catalog
+{
+	uint32_t	magic;		/* PREDICT_CATALOG_MAGIC */
+	uint32_t	version;	/* PREDICT_CATALOG_VERSION */
+	uint32_t	seq;		/* Odd while being written */
+	uint32_t	satellites;	/* Entries of sat[] in use */
+	uint32_t	generation;	/* Counts the updates */
+	int32_t		pid;		/* Process ID of PREDICT */
+	double		time;		/* Unix time of the data */
+	double		sun_az, sun_el, moon_az, moon_el;
+	struct predict_sat sat[24];
+};
+
+/* The Doppler feed: the Doppler corrected uplink and downlink
+   frequencies (MHz) of every transponder in PREDICT's transponder
+   database, as served by GET_FREQ.  It is published under the name
+   "/predict-doppler", or "/predict-doppler-<port>", and is only
+   rewritten when a frequency changes by the step given with -dstep
+   (or a satellite comes into or goes out of view). */
+
+#define PREDICT_DOPPLER_MAGIC	0x50524446	/* "PRDF" */
+#define PREDICT_DOPPLER_VERSION	2
+
+struct predict_doppler
+{
+	uint32_t	magic;		/* PREDICT_DOPPLER_MAGIC */
+	uint32_t	version;	/* PREDICT_DOPPLER_VERSION */
+	uint32_t	seq;		/* Odd while being written */
+	uint32_t	generation;	/* Counts the updates */
+	int32_t		pid;		/* Process ID of PREDICT */
+	uint32_t	reserved;
+	double		time;		/* Unix time of the latest */
+	struct
+	{
+		int32_t	catnum;
+		int32_t	transponders;
+		char	name[25], in_view;
+		char	reserved[6];
+		char	transponder[10][80];
+		double	uplink[10], downlink[10];	/* MHz */
+	} sat[24];
+};
+
+/* Reader library.  The open functions map the segment published by
+   the PREDICT server on "port" (NULL for the default port) read-only,
+   returning NULL if there is none, or if its magic number or version
+   isn't the one given above.  The read functions make a consistent
+   copy of the whole segment, returning 0, or -1 if PREDICT has yet to
+   publish it.  predict_read_sat() copies the entry of a single
+   satellite (given by name or object number), returning -1 if there
+   is no such satellite.
+
+   PREDICT removes both segments when it exits, or is terminated by
+   SIGTERM or SIGINT, but they are left behind if it is killed
+   otherwise, and a client may hold a segment open after PREDICT has
+   been restarted and published a new one.  predict_server_running()
+   returns 1 if the PREDICT whose process ID is "pid" (as given in
+   either segment) is still running, or 0 if it is not.  The open
+   functions also return NULL for a segment left behind. */
+
+struct predict_catalog *predict_open_catalog(const char *port);
+int predict_read_catalog(const struct predict_catalog *catalog, struct predict_catalog *copy);
+int predict_read_sat(const struct predict_catalog *catalog, const char *satellite, struct predict_sat *copy);
+void predict_close_catalog(struct predict_catalog *catalog);
+
+struct predict_doppler *predict_open_doppler(const char *port);
+int predict_read_doppler(const struct predict_doppler *doppler, struct predict_doppler *copy);
+void predict_close_doppler(struct predict_doppler *doppler);
+
+int predict_server_running(int pid);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,128 @@
+/****************************************************************************
+*                                                                           *
+*  This program is a template for client programs that use PREDICT's      *
+*  binary socket protocol through the client library found in             *
+*  ../libpredict, rather than sending text commands and parsing their     *
+*  responses as demo.c does.  Each request is answered with values that   *
+*  are ready for use, at their full precision.                            *
+*                                                                           *
+*  Syntax: demo-b [host [port]]  (the defaults are "localhost" and the    *
+*  "predict" service).                                                    *
+*                                                                           *
+*****************************************************************************
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify it   *
+* under the terms of the GNU General Public License as published by the     *
+* Free Software Foundation; either version 2 of the License or any later    *
+* version.                                                                  *
+*                                                                           *
+* This program is distributed in the hope that it will useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or     *
+* FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License     *
+* for more details.                                                         *
+*                                                                           *
+*****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "predict_client.h"
+
+int main(argc,argv)
+int argc;
+char *argv[];
+{
+	int x, sats, catnum[2];
+	char version[16];
+	double now, az, el;
+	time_t t;
+	struct predict_client *client;
+	struct predict_qth qth;
+	struct predict_entry list[24];
+	struct predict_sat sat[24];
+	struct predict_pass pass;
+
+	/* Open a connection to the server.  No data
+	   is exchanged until the first request. */
+
+	client=predict_connect(argc>1?argv[1]:NULL,argc>2?argv[2]:NULL);
+
+	if (client==NULL)
+	{
+		fprintf(stderr,"Can't find the PREDICT server\n");
+		exit(1);
+	}
+
+	if (predict_get_version(client,version,sizeof(version))==-1)
+	{
+		fprintf(stderr,"No response from the PREDICT server\n");
+		exit(1);
+	}
+
+	printf("PREDICT version %s\n",version);
+
+	/* The ground station and the time of PREDICT's clock */
+
+	predict_get_qth(client,&qth);
+	predict_get_time(client,&now);
+	t=(time_t)now;
+
+	printf("Ground station: %s, %.4f N, %.4f W, %.0f m\n",qth.callsign,qth.lat,qth.lon,qth.altitude);
+	printf("Time: %.3f = %s",now,asctime(gmtime(&t)));
+
+	/* The Sun and Moon */
+
+	predict_get_sun(client,&az,&el);
+	printf("Sun:  Az %6.2f  El %6.2f\n",az,el);
+
+	predict_get_moon(client,&az,&el);
+	printf("Moon: Az %6.2f  El %6.2f\n",az,el);
+
+	/* The satellites in PREDICT's database */
+
+	sats=predict_get_list(client,list,24);
+
+	printf("\n%d satellites:\n",sats);
+
+	for (x=0; x<sats; x++)
+		printf("%6d  %s\n",list[x].catnum,list[x].name);
+
+	/* Tracking data of every satellite, all obtained
+	   from the same update of PREDICT's tracking engine */
+
+	sats=predict_get_sats(client,NULL,0,sat,24);
+	t=(time_t)predict_data_time(client);
+
+	printf("\nTracking data for %s",asctime(gmtime(&t)));
+	printf("\nName                       Az      El    Range   Range Rate   Doppler  Vis  Next AOS/LOS\n");
+
+	for (x=0; x<sats; x++)
+		printf("%-20s %8.2f %7.2f %8.1f %10.4f %11.1f   %c   %.0f\n",sat[x].name,sat[x].az,sat[x].el,sat[x].range,sat[x].range_rate,sat[x].doppler,sat[x].visibility,sat[x].next_event);
+
+	/* Only some satellites, selected by object number */
+
+	if (sats>1)
+	{
+		catnum[0]=sat[sats-1].catnum;
+		catnum[1]=sat[0].catnum;
+
+		sats=predict_get_sats(client,catnum,2,sat,24);
+
+		printf("\nSelected by object number:\n");
+
+		for (x=0; x<sats; x++)
+			printf("%6d  %-20s Lat %7.3f  Lon %7.3f  Alt %8.2f km  Orbit %d\n",sat[x].catnum,sat[x].name,sat[x].lat,sat[x].lon,sat[x].altitude,sat[x].orbitnum);
+	}
+
+	/* The next pass of the first satellite */
+
+	if (predict_get_list(client,list,1)==1 && predict_get_pass(client,list[0].catnum,0.0,&pass)==1)
+	{
+		printf("\nNext pass of %s:\n",list[0].name);
+		printf("AOS %.0f Az %5.1f  TCA %.0f Az %5.1f El %4.1f Range %.0f km  LOS %.0f Az %5.1f\n",pass.aos,pass.aos_az,pass.tca,pass.tca_az,pass.tca_el,pass.tca_range,pass.los,pass.los_az);
+	}
+
+	predict_disconnect(client);
+
+	exit(0);
+}
@@ -34,8 +34,18 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <termios.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/soundcard.h>
+#include <sys/mman.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <signal.h>
 
 #include "predict.h"
+#include "clients/libpredict/predict_shm.h"
+#include "clients/libpredict/predict_proto.h"
 
 /* Constants used by SGP4/SDP4 code */
 
@@ -137,13 +147,13 @@ struct	{  char line1[70];
 	   double nddot6;
   	   double bstar;
 	   long orbitnum;
-	}  sat[24];
+	}  sat[24], new_sat[24];
 
 struct	{  char callsign[17];
 	   double stnlat;
 	   double stnlong;
 	   int stnalt;
-	}  qth;
+	}  qth, new_qth;
 
 struct	{  char name[25];
 	   long catnum;
@@ -159,32 +169,100 @@ struct	{  char name[25];
 	   unsigned char dayofweek[10];
 	   int phase_start[10];
 	   int phase_end[10];
-	}  sat_db[24];
+	}  sat_db[24], new_sat_db[24];
 
-/* Global variables for sharing data among functions... */
+/* Global variables for sharing data among functions...  Those
+   describing the satellite being calculated are private to each
+   thread, so predictions may be made on several threads at once. */
 
-double	tsince, jul_epoch, jul_utc, eclipse_depth=0,
-	sat_azi, sat_ele, sat_range, sat_range_rate,
+__thread double	tsince, jul_epoch, jul_utc, eclipse_depth=0,
+	sat_azi, sat_ele, sat_clear, sat_range, sat_range_rate,
 	sat_lat, sat_lon, sat_alt, sat_vel, phase,
-	sun_azi, sun_ele, daynum, fm, fk, age, aostime,
-	lostime, ax, ay, az, rx, ry, rz, squint, alat, alon,
-	sun_ra, sun_dec, sun_lat, sun_lon, sun_range, sun_range_rate,
-	moon_az, moon_el, moon_dx, moon_ra, moon_dec, moon_gha, moon_dv;
+	daynum, fm, fk, age, aostime, lostime, ax, ay, az,
+	rx, ry, rz, squint, alat, alon;
 
-char	qthfile[50], tlefile[50], dbfile[50], temp[80], output[25],
-	serial_port[15], resave=0, reload_tle=0, netport[7],
-	once_per_second=0, ephem[5], sat_sun_status, findsun,
-	calc_squint, database=0, xterm, io_lat='N', io_lon='W';
+__thread double	sun_azi, sun_ele, sun_ra, sun_dec, sun_lat, sun_lon,
+	sun_range, sun_range_rate, moon_az, moon_el, moon_dx,
+	moon_ra, moon_dec, moon_gha, moon_dv;
 
-int	indx, antfd, iaz, iel, ma256, isplat, isplong, socket_flag=0,
-	Flags=0;
+__thread char	temp[80], output[25], ephem[5], sat_sun_status,
+	findsun, calc_squint;
 
-long	rv, irk;
+char	qthfile[50], tlefile[50], dbfile[50], hznfile[50],
+	serial_port[15], resave=0, reload_tle=0, netport[7], once_per_second=0,
+	database=0, xterm, io_lat='N', io_lon='W';
+
+__thread int	indx, iaz, iel, ma256, isplat, isplong, Flags=0;
+
+int	socket_flag=0;
+
+/* The tracking engine keeps the data served through the socket up
+   to date for every satellite in the database, whether or not a
+   tracking screen is open.  It runs track_rate times per second on
+   a thread of its own, and engine_running is set while it does.
+   reload_tle asks it to reload the data files.  Both flags are
+   shared between threads, and are read and set atomically.  In
+   daemon mode, PREDICT runs the engine and the socket server
+   without a user interface. */
+
+char	engine_running=0, daemon_mode=0;
+
+double	track_rate=5.0;
+
+/* Satellites are updated at track_rate while in range, but only
+   every idle_period seconds (or at AOS, if sooner) while out of
+   range.  engine_aos[] and engine_los[] hold the next AOS and LOS
+   of each satellite found by the engine. */
+
+double	idle_period=5.0, engine_aos[24], engine_los[24];
+
+/* High-rate tracking.  Between the full calculations made once a
+   second, the positions of satellites in range are interpolated
+   from propagator samples, to within interp_error km.  hires is
+   set for tracking at high rates, when rotator headings are given
+   to a tenth of a degree.  tle_id changes whenever the orbital
+   elements of any satellite change, so that samples taken from
+   the old elements aren't used. */
+
+char	hires=0;
+
+int	tle_id=0;
+
+double	interp_error=0.001;
+
+/* Horizon mask of the ground station: the minimum usable elevation
+   (degrees) at each whole degree of azimuth, with entry 360 repeating
+   entry 0.  AOS and LOS occur where a satellite crosses the mask,
+   and sat_clear holds the elevation above it.  horizon_id changes
+   whenever a different mask is loaded, so that AOS/LOS times found
+   against the old mask are recomputed. */
+
+double	horizon[361], new_horizon[361], horizon_min=0.0, horizon_max=0.0;
+
+int	horizon_id=0;
+
+/* The satellite and ground station data (sat[], sat_db[], qth,
+   obs_geodetic and the horizon mask) are shared by the user
+   interface, the tracking engine, the rotator planner and the
+   socket workers, each of which holds data_lock for reading while
+   it uses them.  ReadDataFiles() loads the data files into the
+   new_ copies of each first, and holds data_lock for writing only
+   while it publishes them.  The user interface holds data_lock at
+   all times except while waiting for keyboard input, and holds it
+   for writing while the data are edited.  data_hold is how the
+   calling thread holds data_lock ('r', 'w', or 0 for not at all). */
+
+pthread_rwlock_t data_lock=PTHREAD_RWLOCK_INITIALIZER;
+
+__thread char	data_hold=0;
+
+__thread long	rv, irk;
 
 unsigned char val[256];
 
-/* The following variables are used by the socket server.  They
-   are updated in the MultiTrack() and SingleTrack() functions. */
+/* The following variables hold the data served through the socket.
+   They are the working copy of the tracking engine, which publishes
+   them in a snapshot at the end of each tick. */
 
 char	visibility_array[24], tracking_mode[30];
 
@@ -237,13 +315,452 @@ typedef struct	{
 		   double  ds50;
 		}  deep_arg_t;
 
+/* Pass summary structure filled by PassDetails().  Times
+   are day numbers; angles are in degrees, range in km. */
+
+typedef struct	{
+		   int	   sat;
+		   double  aos, aos_az, tca, tca_az, tca_el, tca_range,
+			   maxel_time, maxel, maxel_az, los, los_az,
+			   vis_start, vis_end;
+		}  pass_t;
+
+/* Eclipse and daily illumination structures filled by the
+   illumination engine.  An eclipse with no umbral phase has
+   entry and exit set to zero.  Times are day numbers, and
+   sunlit is the fraction of the day spent in sunlight. */
+
+typedef struct	{
+		   double  entry, exit, penumbra_entry, penumbra_exit;
+		}  eclipse_t;
+
+typedef struct	{
+		   int	   count;
+		   double  start, end, sunlit;
+		   eclipse_t eclipse[40];
+		}  illum_t;
+
+/* Close approach between satellites "a" and "b" found by the
+   conjunction screening mode.  Times are day numbers, miss
+   distance is in km, and relative speed is in km/sec. */
+
+typedef struct	{
+		   int	   a, b;
+		   double  tca, miss, speed;
+		}  conjunction_t;
+
+/* Rise, set, transit, or twilight event of the Sun or Moon found
+   by the celestial event engine.  The time is a day number, and
+   the azimuth and elevation are in degrees. */
+
+typedef struct	{
+		   char	   body, *name;
+		   double  time, az, el;
+		}  celestial_t;
+
+/* Entry of the tracking engine's schedule: the day number at
+   which satellite "sat" is next due to be updated. */
+
+typedef struct	{
+		   double  time;
+		   int	   sat;
+		}  schedule_t;
+
+/* One sample of the Doppler table export: the Unix time, the
+   range rate (km/s), and the elevation (degrees) at that time. */
+
+typedef struct	{
+		   double  time, range_rate;
+		   float   el;
+		}  sample_t;
+
+/* State published by the tracking engine at the end of each tick:
+   the data served through the socket for every satellite, the next
+   AOS found for each, the Doppler corrected uplink and downlink
+   frequencies (MHz) of each of its transponders, and the positions
+   of the Sun and Moon.  The
+   generation is incremented with every tick, and "time" is the day
+   number for which the state was calculated. */
+
+typedef struct	{
+		   unsigned long generation;
+		   double  time;
+		   char	   visibility[24];
+		   float   az[24], el[24], lon[24], lat[24],
+			   footprint[24], range[24], altitude[24],
+			   velocity[24], eclipse_depth[24], phase[24],
+			   squint[24];
+		   double  doppler[24], nextevent[24], aos[24],
+			   uplink[24][10], downlink[24][10];
+		   long	   orbitnum[24];
+		   double  sun_azi, sun_ele, sun_lat, sun_lon, sun_ra,
+			   moon_az, moon_el, moon_dec, moon_gha, moon_ra;
+		}  snapshot_t;
+
+/* Command queued for the antenna rotator: the day number at
+   which it is to be sent, and the azimuth and elevation. */
+
+typedef struct	{
+		   double  time;
+		   float   az, el;
+		}  command_t;
+
+/* Client of the socket server being answered: the socket to
+   answer through, whether it is a TCP connection, the address
+   of a UDP client, and the time of the monotonic clock (ns) by
+   which the answer must be sent.  "failed" is set once the
+   answer can't be delivered. */
+
+typedef struct	{
+		   int	   sock;
+		   char	   tcp, failed;
+		   struct  sockaddr_in addr;
+		   long long deadline;
+		}  client_t;
+
+/* TCP connection to the socket server: its descriptor (-1 if
+   the slot is free), whether a worker is serving it, the part
+   of a request received so far, and the time of the monotonic
+   clock (ns) by which it must be completed, or by which the
+   next request must begin to arrive if the connection is idle. */
+
+typedef struct	{
+		   int	   fd, length;
+		   char	   busy, request[1024];
+		   long long deadline;
+		}  connection_t;
+
+/* Antenna driven by the rotator output: the serial port of its
+   rotator and the port's descriptor, its state, whether it is
+   flipped for passes through north, whether it needs a heading
+   every second, and how many seconds early headings are sent.
+   It tracks satellite catnum[x] from day number start[x] until
+   end[x] (always, if both are 0) for each of its assignments,
+   and commands wait in its queue until they come due. */
+
+typedef struct	{
+		   char	   port[50], state, flip, once;
+		   int	   fd, assignments, head, count;
+		   long	   catnum[16];
+		   double  lead, start[16], end[16];
+		   command_t queue[256];
+		   pthread_mutex_t lock;
+		   pthread_cond_t cond;
+		   struct termios tty;
+		}  antenna_t;
+
+/* Clip of the spoken announcements, held in memory as the raw
+   PCM samples of the vocalizer's .wav file of the same name. */
+
+typedef struct	{
+		   char	   *name;
+		   unsigned char *pcm;
+		   long	   bytes;
+		   int	   channels, bits, rate;
+		}  sound_t;
+
+/* Stretch of a satellite's trajectory over which its position is
+   interpolated: the ECI position and velocity at the start (0) and
+   end (1) of a span of "step" seconds beginning at day number
+   "start", as propagated for satellite "sat" from its elements of
+   generation "id". */
+
+typedef struct	{
+		   int	   sat, id;
+		   double  start, step;
+		   vector_t pos[2], vel[2];
+		}  segment_t;
+
+/* Layout of the Doppler feed that the tracking engine publishes in
+   shared memory, shared with the reader library in clients/libpredict.
+   "seq" is odd while the feed is being written, and "generation" is
+   incremented whenever a frequency changes. */
+
+typedef struct predict_doppler feed_t;
+
+/* Layout of the catalog of tracking data that the tracking engine
+   publishes in shared memory on every tick, along the same lines. */
+
+typedef struct predict_catalog catalog_t;
+
 /* Global structure used by SGP4/SDP4 code. */
 
-geodetic_t obs_geodetic;
+geodetic_t obs_geodetic, new_obs;
 
 /* Two-line Orbital Elements for the satellite used by SGP4/SDP4 code. */
 
-tle_t tle;
+__thread tle_t tle;
+
+/* Work queues of the batch worker thread pool.  Each worker
+   owns the range of job numbers from head to tail-1. */
+
+struct	{  pthread_mutex_t lock;
+	   int head, tail;
+	}  workqueue[24];
+
+int	workers;
+
+void	(*workfunction)();
+
+/* Time window and per-satellite temporary files
+   used by the batch pass prediction mode. */
+
+double	batch_start, batch_end;
+
+char	batch_visual;
+
+FILE	*passfile[24];
+
+/* Satellite, days, and results of the illumination engine.
+   When penumbra is set, time spent in the penumbra counts as
+   half sunlit, and eclipse events include the penumbral phase. */
+
+int	illum_sat, illum_days;
+
+double	illum_start, illum_end;
+
+illum_t	*illum_day=NULL;
+
+char	penumbra=0;
+
+/* State of the conjunction screening mode.  Positions of every
+   satellite at each time step of the current chunk are held in
+   cs_pos[], and the shape and plane of each orbit in cs_orbit[].
+   Candidate close approaches are gathered in cs_list[]. */
+
+int	cs_steps, cs_count, cs_size, cs_hash[1024], cs_next[24],
+	cs_cell[24][3];
+
+double	cs_start, cs_threshold;
+
+vector_t	*cs_pos=NULL;
+
+struct	{  double p, perigee, apogee;
+	   vector_t normal, ecc;
+	}  cs_orbit[24];
+
+conjunction_t	*cs_list=NULL;
+
+__thread int	cs_a, cs_b;
+
+/* Ground stations used by the mutual visibility mode.  Station 0
+   is the one read from the qth file, and the rest are read from
+   the files given with -st. */
+
+int	stations=1;
+
+char	station_file[8][50], station_call[8][17];
+
+geodetic_t	station[8];
+
+double	mv_minel;
+
+__thread int	mv_station;
+
+/* State of the coverage heatmap mode.  Each worker thread sums
+   minutes of coverage into its own grid, and marks the cells
+   covered at each step of a chunk in its own bit masks.  Both
+   are registered in cov_grid[] and cov_masks[] so that the grids
+   can be reduced, and all of them freed, once the work is done. */
+
+int	cov_rows, cov_cols, cov_minutes, cov_threads=0;
+
+long	*cov_grid[24];
+
+unsigned long long	*cov_masks[24];
+
+double	cov_start, cov_res;
+
+pthread_mutex_t	cov_lock=PTHREAD_MUTEX_INITIALIZER;
+
+__thread long	*cov_mine=NULL;
+
+__thread unsigned long long	*cov_mask=NULL;
+
+/* Satellite, sample rate (Hz), and passes of the Doppler table
+   export.  dx_pass[] holds the AOS and LOS of each pass, and the
+   worker that samples pass x leaves dx_count[x] samples in
+   dx_sample[x].  Passes are written to dx_fd in order, under
+   dx_lock, as soon as all of those before them have been, and
+   dx_next is the next one to be written.  The remaining globals
+   describe the transponders and the format of the table. */
+
+int	dx_sat, dx_passes, dx_first, dx_next, dx_xponders;
+
+double	dx_rate, (*dx_pass)[2]=NULL, dx_downlink[10], dx_uplink[10];
+
+sample_t	**dx_sample=NULL;
+
+long	*dx_count=NULL;
+
+char	dx_binary;
+
+FILE	*dx_fd;
+
+pthread_mutex_t	dx_lock=PTHREAD_MUTEX_INITIALIZER;
+
+/* Snapshots of the tracking engine's state.  The engine fills the
+   buffer that isn't current, and then makes it current.  The
+   sequence number of a buffer is odd while it is being filled, so
+   readers (the socket server and the multi-tracking screen) can
+   copy a consistent view without taking a lock, retrying in the
+   rare event that the engine came around to the same buffer while
+   they were copying it.  The engine never waits on a reader. */
+
+snapshot_t	snapshot[2];
+
+unsigned long	snapshot_seq[2]={0,0}, snapshot_generation=0;
+
+int	snapshot_current=0;
+
+/* Simulation clock.  The time is kept as an integer number of
+   nanoseconds since 01-Jan-70 UTC, derived from the monotonic
+   clock, which is anchored to UTC once at startup: clock_origin
+   is the monotonic time of the anchor, and clock_base the time
+   of the simulation at that instant.  Time runs clock_warp
+   millionths as fast as it really does, so that the program may
+   replay a stretch of time from any start (-start), faster or
+   slower than real time (-warp).  Adjustments made to the system
+   clock while the program runs are not followed. */
+
+long long	clock_origin=0, clock_base=0, clock_warp=1000000;
+
+#define NS_PER_DAY 86400000000000LL
+
+/* Socket server.  Each of its server_workers threads has a UDP
+   socket and a TCP listening socket of its own, all bound to the
+   same port with SO_REUSEPORT so that the kernel spreads clients
+   across them.  Every socket and TCP connection is registered in
+   one-shot mode with a single epoll instance (server_epoll), so
+   the next request is taken by whichever worker is idle, and a
+   slow request only ties up the worker answering it.  A request
+   must be answered within server_deadline seconds (a long list
+   of positions or pass is abandoned as soon as the deadline
+   passes), and an idle TCP connection is closed after server_idle
+   seconds. */
+
+#define SERVER_UDP 0x10000
+#define SERVER_TCP 0x20000
+
+int	server_workers=0, server_epoll=-1, server_udp[16], server_tcp[16];
+
+double	server_deadline=5.0, server_idle=300.0;
+
+connection_t	connection[256];
+
+pthread_mutex_t	connection_lock=PTHREAD_MUTEX_INITIALIZER;
+
+long long	server_sweep=0;
+
+/* Antenna rotators.  Each antenna's rotator is driven through a
+   serial port, and either follows the satellite being tracked in
+   Single Satellite Tracking Mode (rotator_sat), or tracks the
+   satellites assigned to it in the antenna file (antfile).  One
+   planner thread calculates the headings of every antenna up to
+   rotator_ahead seconds in advance, and queues commands that are
+   each sent "lead" seconds before the time for which they were
+   calculated, so that the rotator's mechanical lag is made up
+   for.  An output thread for each antenna sends its commands as
+   they come due, so the rotators keep moving while the user
+   interface or the disk is busy.  Serial ports are written without
+   blocking, and are reopened if a rotator goes away.  An antenna's
+   state is 1 while its rotator is connected, and 2 while it is
+   being reconnected.  Flipped rotators track passes that would
+   swing them through their stop at north from the opposite azimuth,
+   with the elevation past 90 degrees.  rotator_lead and rotator_flip
+   apply to the antenna given on the command line. */
+
+antenna_t	antenna[8];
+
+int	antennas=0, rotator_sat=-1;
+
+char	antfile[50], rotator_flip=0;
+
+double	rotator_lead=0.0, rotator_ahead=5.0;
+
+/* Spoken announcements.  The clips are loaded once at startup,
+   and announcements (lists of clip names) are queued for an
+   audio worker thread that plays them in turn.  The first
+   twenty clips are the numbers zero through nineteen, and the
+   next eight the tens from twenty through ninety. */
+
+sound_t	sound[39]={{"zero"}, {"one"}, {"two"}, {"three"}, {"four"},
+	{"five"}, {"six"}, {"seven"}, {"eight"}, {"nine"}, {"ten"},
+	{"eleven"}, {"twelve"}, {"thirteen"}, {"fourteen"}, {"fifteen"},
+	{"sixteen"}, {"seventeen"}, {"eighteen"}, {"nineteen"},
+	{"twenty"}, {"thirty"}, {"forty"}, {"fifty"}, {"sixty"},
+	{"seventy"}, {"eighty"}, {"ninety"}, {"hundred"}, {"intro"},
+	{"azimuth"}, {"elevation"}, {"approaching"}, {"receding"},
+	{"visible"}, {"alarm"}, {"eclipse"}, {"sunlight"}, {"los"}};
+
+char	*speech_queue[4][16];
+
+int	speech_head=0, speech_count=0, speech_length[4];
+
+pthread_mutex_t	speech_lock=PTHREAD_MUTEX_INITIALIZER;
+
+pthread_cond_t	speech_cond=PTHREAD_COND_INITIALIZER;
+
+/* Time of the last full calculation made by the tracking
+   engine for each satellite, and the trajectory segments
+   over which its position is interpolated in between. */
+
+double	engine_full[24];
+
+segment_t	engine_segment[24];
+
+/* Doppler correction engine.  The tracking engine corrects the
+   frequencies of every transponder of every satellite as it
+   updates them, but only lets a frequency change once it has
+   moved by doppler_step Hz or more, so that radios controlled
+   from it aren't retuned for every small change.  The working
+   frequencies are published in the snapshot, and through the
+   shared memory feed "feed" (named feedname) if it could be
+   created.  doppler_changed is set when a frequency changes. */
+
+double	uplink_array[24][10], downlink_array[24][10], doppler_step=10.0;
+
+char	feedname[40], doppler_changed=0;
+
+feed_t	*feed=NULL;
+
+/* Shared memory catalog "catalog" (named catalogname), holding the
+   snapshot of every tick in a fixed binary layout for clients on
+   the same host.  It is left out if it couldn't be created. */
+
+char	catalogname[40];
+
+catalog_t	*catalog=NULL;
+
+/* Handlers of SIGTERM and SIGINT in place before the shared memory
+   segments were created, to which Terminate() passes the signals
+   on once it has removed the segments. */
+
+struct sigaction	old_sigterm, old_sigint;
+
+/* Per-day interpolation coefficients of the celestial event engine.
+   The right ascension, declination, and horizontal parallax of the
+   Sun (entry 0) and Moon (entry 1) are sampled every six hours across
+   the day beginning at "day", and held as Newton divided differences.
+   The threshold of the current search is cel_threshold degrees plus
+   cel_parallax times the body's horizontal parallax.  cel_hour holds
+   the hour angle (radians) of the last position computed. */
+
+__thread struct	{  double day, ra[5], dec[5], hp[5];
+		}  celestial[2]={{-1.0},{-1.0}};
+
+__thread char	cel_body;
+
+__thread double	cel_threshold, cel_parallax, cel_hour;
+
+/* Mean orbital elements and secular rates of the satellite being
+   calculated, used by the analytic pass prefilter.  Angles are
+   in radians, rates in radians per day, and sma is in km. */
+
+__thread struct	{  char usable;
+	   double epoch, meanmo, drag, sma, eccn, incl, raan,
+		  raandot, argper, argperdot, meanan;
+		}  prefilter;
 
 /* Functions for testing and setting/clearing flags used in SGP4/SDP4 code */
 
@@ -592,7 +1109,7 @@ void Date_Time(double julian_date, struct tm *cdate)
 	time_t jtime;
 
 	jtime=(julian_date-2440587.5)*86400.0;
-	*cdate=*gmtime(&jtime);
+	gmtime_r(&jtime,cdate);
 }
 
 double Delta_ET(double year)
@@ -762,7 +1279,7 @@ void SGP4(double tsince, tle_t * tle, vector_t * pos, vector_t * vel)
 	/* are vector_t structures returning ECI satellite position and */ 
 	/* velocity. Use Convert_Sat_State() to convert to km and km/s. */
 
-	static double aodp, aycof, c1, c4, c5, cosio, d2, d3, d4, delmo,
+	static __thread double aodp, aycof, c1, c4, c5, cosio, d2, d3, d4, delmo,
 	omgcof, eta, omgdot, sinio, xnodp, sinmo, t2cof, t3cof, t4cof,
 	t5cof, x1mth2, x3thm1, x7thm1, xmcof, xmdot, xnodcf, xnodot, xlcof;
 
@@ -1010,7 +1527,7 @@ void Deep(int ientry, tle_t * tle, deep_arg_t * deep_arg)
 	/* This function is used by SDP4 to add lunar and solar */
 	/* perturbation effects to deep-space orbit objects.    */
 
-	static double thgr, xnq, xqncl, omegaq, zmol, zmos, savtsn, ee2, e3,
+	static __thread double thgr, xnq, xqncl, omegaq, zmol, zmos, savtsn, ee2, e3,
 	xi2, xl2, xl3, xl4, xgh2, xgh3, xgh4, xh2, xh3, sse, ssi, ssg, xi3,
 	se2, si2, sl2, sgh2, sh2, se3, si3, sl3, sgh3, sh3, sl4, sgh4, ssl,
 	ssh, d3210, d3222, d4410, d4422, d5220, d5232, d5421, d5433, del1,
@@ -1520,7 +2037,7 @@ void SDP4(double tsince, tle_t * tle, vector_t * pos, vector_t * vel)
 
 	int i;
 
-	static double x3thm1, c1, x1mth2, c4, xnodcf, t2cof, xlcof,
+	static __thread double x3thm1, c1, x1mth2, c4, xnodcf, t2cof, xlcof,
 	aycof, x7thm1;
 
 	double a, axn, ayn, aynl, beta, betal, capu, cos2u, cosepw, cosik,
@@ -1532,7 +2049,7 @@ void SDP4(double tsince, tle_t * tle, vector_t * pos, vector_t * vel)
 	perigee, psisq, tsi, qoms24, s4, pinvsq, temp, tempa, temp1,
 	temp2, temp3, temp4, temp5, temp6, bx, by, bz, cx, cy, cz;
 
-	static deep_arg_t deep_arg;
+	static __thread deep_arg_t deep_arg;
 
 	/* Initialization */
 
@@ -1830,7 +2347,13 @@ void Calculate_Obs(double time, vector_t *pos, vector_t *vel, geodetic_t *geodet
 
 	vector_t obs_pos, obs_vel, range, rgvel;
 
-	Calculate_User_PosVel(time, geodetic, &obs_pos, &obs_vel);
+	/* Calculate_User_PosVel() stores the sidereal time in the
+	   geodetic structure, so work on a private copy in case
+	   the same location is in use by several threads. */
+
+	geodetic_t observer=*geodetic;
+
+	Calculate_User_PosVel(time, &observer, &obs_pos, &obs_vel);
 
 	range.x=pos->x-obs_pos.x;
 	range.y=pos->y-obs_pos.y;
@@ -1848,10 +2371,10 @@ void Calculate_Obs(double time, vector_t *pos, vector_t *vel, geodetic_t *geodet
 
 	Magnitude(&range);
 
-	sin_lat=sin(geodetic->lat);
-	cos_lat=cos(geodetic->lat);
-	sin_theta=sin(geodetic->theta);
-	cos_theta=cos(geodetic->theta);
+	sin_lat=sin(observer.lat);
+	cos_lat=cos(observer.lat);
+	sin_theta=sin(observer.theta);
+	cos_theta=cos(observer.theta);
 	top_s=sin_lat*cos_theta*range.x+sin_lat*sin_theta*range.y-cos_lat*range.z;
 	top_e=-sin_theta*range.x+cos_theta*range.y;
 	top_z=cos_lat*cos_theta*range.x+cos_lat*sin_theta*range.y+sin_lat*range.z;
@@ -1938,6 +2461,91 @@ void Calculate_RADec(double time, vector_t *pos, vector_t *vel, geodetic_t *geod
 
 /* .... SGP4/SDP4 functions end .... */
 
+long long Monotonic()
+{
+	/* Read the monotonic clock in nanoseconds */
+
+	struct timespec clock;
+
+	clock_gettime(CLOCK_MONOTONIC,&clock);
+
+	return (1000000000LL*(long long)clock.tv_sec+(long long)clock.tv_nsec);
+}
+
+void StartClock(start, warp)
+long start;
+double warp;
+{
+	/* This function anchors the simulation clock to UTC,
+	   starting it at Unix time "start" (or the present
+	   time if 0), running "warp" times as fast as real
+	   time. */
+
+	struct timespec utc;
+
+	clock_gettime(CLOCK_REALTIME,&utc);
+	clock_origin=Monotonic();
+
+	if (start==0)
+		clock_base=1000000000LL*(long long)utc.tv_sec+(long long)utc.tv_nsec;
+	else
+		clock_base=1000000000LL*(long long)start;
+
+	if (warp>0.0)
+		clock_warp=(long long)rint(1.0e6*warp);
+	else
+		clock_warp=1000000;
+}
+
+long long ClockNow()
+{
+	/* Return the time of the simulation in nanoseconds
+	   since 01-Jan-70 00:00:00 UTC.  Elapsed time is split
+	   into whole and partial milliseconds, so that scaling
+	   it by clock_warp can't overflow. */
+
+	long long elapsed;
+
+	if (clock_origin==0)
+		StartClock(0L,1.0);
+
+	elapsed=Monotonic()-clock_origin;
+
+	if (clock_warp==1000000)
+		return (clock_base+elapsed);
+
+	return (clock_base+(elapsed/1000000LL)*clock_warp+((elapsed%1000000LL)*clock_warp)/1000000LL);
+}
+
+time_t ClockTime()
+{
+	/* Return the time of the simulation in Unix time */
+
+	return (time_t)(ClockNow()/1000000000LL);
+}
+
+void ClockDeadline(daynum, deadline)
+double daynum;
+struct timespec *deadline;
+{
+	/* This function converts the day number of the
+	   simulation "daynum" to the time of the monotonic
+	   clock at which it comes due. */
+
+	long long ns, sim;
+
+	sim=(long long)floor(daynum);
+	sim=NS_PER_DAY*(sim+3651LL)+(long long)rint((double)NS_PER_DAY*(daynum-floor(daynum)))-clock_base;
+
+	if (clock_warp==1000000)
+		ns=clock_origin+sim;
+	else
+		ns=clock_origin+(long long)((long double)sim*1.0e6L/(long double)clock_warp);
+
+	deadline->tv_sec=(time_t)(ns/1000000000LL);
+	deadline->tv_nsec=(long)(ns%1000000000LL);
+}
+
 void bailout(string)
 char *string;
 {
@@ -1954,26 +2562,78 @@ char *string;
 	fprintf(stderr,"*** predict: %s!\n",string);
 }
 
-void TrackDataOut(antfd, elevation, azimuth)
+int OpenRotator(a)
+antenna_t *a;
+{
+	/* This function opens the serial port to which the rotator
+	   of antenna "a" is connected for writing without blocking,
+	   and returns its descriptor, or -1 if it can't be opened.
+	   The port's original settings are saved, so that they may
+	   be restored on exit. */
+
+	int port;
+	struct termios newtty;
+
+	port=open(a->port, O_WRONLY|O_NOCTTY|O_NONBLOCK);
+
+	if (port!=-1)
+	{
+		tcgetattr(port, &a->tty);
+
+		memset(&newtty, 0, sizeof(newtty));
+
+		/* 9600 baud, 8-bits, no parity,
+		   1-stop bit, no handshaking */
+
+		newtty.c_cflag=B9600|CS8|CLOCAL;
+		newtty.c_iflag=IGNPAR;
+		newtty.c_oflag=0;
+		newtty.c_lflag=0;
+
+		tcflush(port, TCIFLUSH);
+		tcsetattr(port, TCSANOW, &newtty);
+	}
+
+	return port;
+}
+
+int TrackDataOut(antfd, elevation, azimuth)
 int antfd;
 double elevation, azimuth;
 {
 	/* This function sends Azimuth and Elevation data
-	   to an antenna tracker connected to the serial port */
+	   to an antenna tracker connected to the serial port.
+	   If the port can't take the data within a second, it
+	   is dropped, since a newer heading will follow.  -1 is
+	   returned if the port has failed. */
 
-	int n, port;
+	int n, sent, length;
 	char message[30]="\n";
-
-	port=antfd;
+	struct pollfd room;
 
 	sprintf(message, "AZ%3.1f EL%3.1f \x0D\x0A", azimuth,elevation);
-	n=write(port,message,strlen(message));
+	length=strlen(message);
 
-	if (n<0)
+	for (sent=0; sent<length; sent+=n)
 	{
-		bailout("Error Writing To Antenna Port");
-		exit(-1);
+		n=write(antfd,message+sent,length-sent);
+
+		if (n<0)
+		{
+			if (errno!=EAGAIN && errno!=EINTR)
+				return -1;
+
+			room.fd=antfd;
+			room.events=POLLOUT;
+
+			if (poll(&room,1,1000)<=0)
+				return 0;
+
+			n=0;
+		}
 	}
+
+	return 0;
 }
 
 int passivesock(char *service, char *protocol, int qlen)
@@ -1983,13 +2643,15 @@ int passivesock(char *service, char *protocol, int qlen)
 	struct servent *pse;
 	struct protoent *ppe;
 	struct sockaddr_in sin;
-	int sd, type;
+	int sd, type, on=1;
 	
 	memset((char *)&sin, 0, sizeof(struct sockaddr_in));
 	sin.sin_family=AF_INET;
 	sin.sin_addr.s_addr=INADDR_ANY;
 	
-	if ((pse=getservbyname(service,protocol)))
+	/* TCP is served on the port of the UDP service */
+
+	if ((pse=getservbyname(service,protocol)) || (pse=getservbyname(service,"udp")))
 		sin.sin_port=htons(ntohs((unsigned short)pse->s_port)+portbase);
 
 	else if ((sin.sin_port=htons((unsigned short)atoi(service)))==0)
@@ -2017,13 +2679,20 @@ int passivesock(char *service, char *protocol, int qlen)
 		exit(-1);
 	}
 	
+	/* Let each worker of the socket server bind a socket
+	   of its own to the port, and the TCP port be reused
+	   straight away when the server is restarted */
+
+	setsockopt(sd,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on));
+	setsockopt(sd,SOL_SOCKET,SO_REUSEPORT,&on,sizeof(on));
+
 	if (bind(sd,(struct sockaddr *)&sin,sizeof(sin))<0)
 	{
 		bailout("Can't bind");
 		exit(-1);
 	}
 	
-	if ((type=SOCK_STREAM && listen(s,qlen))<0)
+	if (type==SOCK_STREAM && listen(sd,qlen)<0)
 	{
 		bailout("Listen fail");
 		exit(-1);
@@ -2032,3871 +2701,9041 @@ int passivesock(char *service, char *protocol, int qlen)
 	return sd;
 }
 
-void socket_server(predict_name)
-char *predict_name;
+void PublishSnapshot(time)
+double time;
 {
-	/* This is the socket server code */
-
-	int i, j, n, sock;
-	socklen_t alen;
-	struct sockaddr_in fsin;
-	char buf[80], buff[1000], satname[50], tempname[30], ok;
-	time_t t;
-	long nxtevt;
-	FILE *fd=NULL;
+	/* This function is called by the tracking engine to publish
+	   its state as calculated for "time". */
 
-	/* Open a socket port at "predict" or netport if defined */
+	int x;
+	unsigned long seq;
+	snapshot_t *view;
+
+	x=1-snapshot_current;
+	view=&snapshot[x];
+	seq=snapshot_seq[x];
+
+	__atomic_store_n(&snapshot_seq[x],seq+1,__ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	view->generation=++snapshot_generation;
+	view->time=time;
+
+	memcpy(view->visibility,visibility_array,sizeof(view->visibility));
+	memcpy(view->az,az_array,sizeof(view->az));
+	memcpy(view->el,el_array,sizeof(view->el));
+	memcpy(view->lon,long_array,sizeof(view->lon));
+	memcpy(view->lat,lat_array,sizeof(view->lat));
+	memcpy(view->footprint,footprint_array,sizeof(view->footprint));
+	memcpy(view->range,range_array,sizeof(view->range));
+	memcpy(view->altitude,altitude_array,sizeof(view->altitude));
+	memcpy(view->velocity,velocity_array,sizeof(view->velocity));
+	memcpy(view->eclipse_depth,eclipse_depth_array,sizeof(view->eclipse_depth));
+	memcpy(view->phase,phase_array,sizeof(view->phase));
+	memcpy(view->squint,squint_array,sizeof(view->squint));
+	memcpy(view->doppler,doppler,sizeof(view->doppler));
+	memcpy(view->nextevent,nextevent,sizeof(view->nextevent));
+	memcpy(view->aos,engine_aos,sizeof(view->aos));
+	memcpy(view->orbitnum,orbitnum_array,sizeof(view->orbitnum));
+	memcpy(view->uplink,uplink_array,sizeof(view->uplink));
+	memcpy(view->downlink,downlink_array,sizeof(view->downlink));
+
+	view->sun_azi=sun_azi;
+	view->sun_ele=sun_ele;
+	view->sun_lat=sun_lat;
+	view->sun_lon=sun_lon;
+	view->sun_ra=sun_ra;
+	view->moon_az=moon_az;
+	view->moon_el=moon_el;
+	view->moon_dec=moon_dec;
+	view->moon_gha=moon_gha;
+	view->moon_ra=moon_ra;
+
+	__atomic_store_n(&snapshot_seq[x],seq+2,__ATOMIC_RELEASE);
+	__atomic_store_n(&snapshot_current,x,__ATOMIC_RELEASE);
+}
 
-	if (netport[0]==0)
-		strncpy(netport,"predict",7);
+void ReadSnapshot(view)
+snapshot_t *view;
+{
+	/* This function copies the snapshot most recently
+	   published by the tracking engine into "view". */
 
-	sock=passivesock(netport,"udp",10);
- 	alen=sizeof(fsin);
-	
-	/* This is the main loop for monitoring the socket
-	   port and sending back replies to clients */
+	int x;
+	unsigned long before, after;
 
-	while (1)
+	do
 	{
-		/* Get datagram from socket port */
-		
-		if ((n=recvfrom(sock,buf,sizeof(buf),0,(struct sockaddr *)&fsin,&alen)) < 0)
-			exit (-1);
+		x=__atomic_load_n(&snapshot_current,__ATOMIC_ACQUIRE);
+		before=__atomic_load_n(&snapshot_seq[x],__ATOMIC_ACQUIRE);
 
-		buf[n]=0;
-		ok=0;
+		memcpy(view,&snapshot[x],sizeof(snapshot_t));
 
-		/* Parse the command in the datagram */
-		if ((strncmp("GET_SAT",buf,7)==0) && (strncmp("GET_SAT_POS",buf,11)!=0))
-		{
-			/* Parse "buf" for satellite name */
-			for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
-
-			for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<25; j++)
-				satname[j-i]=buf[j];
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		after=__atomic_load_n(&snapshot_seq[x],__ATOMIC_RELAXED);
 
-			satname[j-i]=0;
+	} while ((before&1) || before!=after);
+}
 
-			/* Do a simple search for the matching satellite name */
+void HoldData(mode)
+char mode;
+{
+	/* This function changes how the calling thread holds
+	   data_lock: for reading (mode=='r'), for writing
+	   (mode=='w'), or not at all (mode==0). */
 
-			for (i=0; i<24; i++)
-			{
-				if ((strncmp(satname,sat[i].name,25)==0) || (atol(satname)==sat[i].catnum))
-				{
-					nxtevt=(long)rint(86400.0*(nextevent[i]+3651.0));
+	if (mode==data_hold)
+		return;
 
-					/* Build text buffer with satellite data */
-					sprintf(buff,"%s\n%-7.2f\n%+-6.2f\n%-7.2f\n%+-6.2f\n%ld\n%-7.2f\n%-7.2f\n%-7.2f\n%-7.2f\n%ld\n%c\n%-7.2f\n%-7.2f\n%-7.2f\n",sat[i].name,long_array[i],lat_array[i],az_array[i],el_array[i],nxtevt,footprint_array[i],range_array[i],altitude_array[i],velocity_array[i],orbitnum_array[i],visibility_array[i],phase_array[i],eclipse_depth_array[i],squint_array[i]);
+	if (data_hold)
+		pthread_rwlock_unlock(&data_lock);
 
-					/* Send buffer back to the client that sent the request */
-					sendto(sock,buff,strlen(buff),0,(struct sockaddr*)&fsin,sizeof(fsin));
-					ok=1;
-					break;
-				}
-			}
-		}
+	if (mode=='r')
+		pthread_rwlock_rdlock(&data_lock);
 
-		if (strncmp("GET_TLE",buf,7)==0)
-		{
-			/* Parse "buf" for satellite name */
-			for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
+	if (mode=='w')
+		pthread_rwlock_wrlock(&data_lock);
 
-			for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<25; j++)
-				satname[j-i]=buf[j];
+	data_hold=mode;
+}
 
-			satname[j-i]=0;
+/* Functions defined further on that the socket server
+   calls to answer requests in memory */
 
-			/* Do a simple search for the matching satellite name */
+void	WritePositions(), WritePass(), WriteEvents();
+double	Horizon();
+char	NextPass();
 
-			for (i=0; i<24; i++)
-			{
-				if ((strncmp(satname,sat[i].name,25)==0) || (atol(satname)==sat[i].catnum))
-				{
-					/* Build text buffer with satellite data */
+void Reply(client, data, n)
+client_t *client;
+char *data;
+int n;
+{
+	/* This function sends "n" bytes of "data" to "client".
+	   A client whose answer isn't sent by the deadline of its
+	   request, or a TCP client that doesn't accept it by then,
+	   is given up on. */
 
-					sprintf(buff,"%s\n%s\n%s\n",sat[i].name,sat[i].line1, sat[i].line2);
-					/* Send buffer back to the client that sent the request */
-					sendto(sock,buff,strlen(buff),0,(struct sockaddr*)&fsin,sizeof(fsin));
-					ok=1;
-					break;
-				}
-			}
-		}
+	int sent, wait;
+	struct pollfd pfd;
 
-		if (strncmp("GET_DOPPLER",buf,11)==0)
-		{
-			/* Parse "buf" for satellite name */
-			for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
+	if (client->failed==0 && Monotonic()>client->deadline)
+		client->failed=1;
 
-			for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<25; j++)
-				satname[j-i]=buf[j];
+	if (client->failed)
+		return;
 
-			satname[j-i]=0;
+	if (client->tcp==0)
+	{
+		sendto(client->sock,data,n,0,(struct sockaddr *)&client->addr,sizeof(client->addr));
+		return;
+	}
 
-			/* Do a simple search for the matching satellite name */
+	while (n>0)
+	{
+		sent=send(client->sock,data,n,MSG_NOSIGNAL|MSG_DONTWAIT);
 
-			for (i=0; i<24; i++)
-			{
-				if ((strncmp(satname,sat[i].name,25)==0) || (atol(satname)==sat[i].catnum))
-				{
-					/* Get Normalized (100 MHz)
-					   Doppler shift for sat[i] */
+		if (sent>0)
+		{
+			data+=sent;
+			n-=sent;
+			continue;
+		}
 
-					sprintf(buff,"%f\n",doppler[i]);
-
-					/* Send buffer back to client who sent request */
-					sendto(sock,buff,strlen(buff),0,(struct sockaddr*)&fsin,sizeof(fsin));
-					ok=1;
-					break;
-				}
-			}
-		}
-
-		if (strncmp("GET_LIST",buf,8)==0)
-		{
-			buff[0]=0;
-
-			for (i=0; i<24; i++)
-			{
-				if (sat[i].name[0]!=0)
-					strcat(buff,sat[i].name);
-
-				strcat(buff,"\n");
-			}
-
-			sendto(sock,buff,strlen(buff),0,(struct sockaddr *)&fsin,sizeof(fsin));
-			ok=1;
-		}
-
-		if (strncmp("RELOAD_TLE",buf,10)==0)
-		{
-			buff[0]=0;
-			sendto(sock,buff,strlen(buff),0,(struct sockaddr *)&fsin,sizeof(fsin));
-			reload_tle=1;
-			ok=1;
-		}
-
-		if (strncmp("GET_SUN",buf,7)==0)
-		{
-			buff[0]=0;
-			sprintf(buff,"%-7.2f\n%+-6.2f\n%-7.2f\n%-7.2f\n%-7.2f\n",sun_azi, sun_ele, sun_lat, sun_lon, sun_ra);
-			sendto(sock,buff,strlen(buff),0,(struct sockaddr *)&fsin,sizeof(fsin));
-			ok=1;
-		}
-
-		if (strncmp("GET_MOON",buf,8)==0)
+		if (sent==-1 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR)
 		{
-			buff[0]=0;
-			sprintf(buff,"%-7.2f\n%+-6.2f\n%-7.2f\n%-7.2f\n%-7.2f\n",moon_az, moon_el, moon_dec, moon_gha, moon_ra);
-			sendto(sock,buff,strlen(buff),0,(struct sockaddr *)&fsin,sizeof(fsin));
-			ok=1;
+			client->failed=1;
+			return;
 		}
 
-		if (strncmp("GET_MODE",buf,8)==0)
-		{
-			sendto(sock,tracking_mode,strlen(tracking_mode),0,(struct sockaddr *)&fsin,sizeof(fsin));
-			ok=1;
-		}
+		wait=(int)((client->deadline-Monotonic())/1000000LL);
 
-		if (strncmp("GET_VERSION",buf,11)==0)
+		if (wait<=0)
 		{
-			buff[0]=0;
-			sprintf(buff,"%s\n",version);
-			sendto(sock,buff,strlen(buff),0,(struct sockaddr *)&fsin,sizeof(fsin));
-			ok=1;
+			client->failed=1;
+			return;
 		}
 
-		if (strncmp("GET_QTH",buf,7)==0)
-		{
-			buff[0]=0;
-			sprintf(buff,"%s\n%g\n%g\n%d\n",qth.callsign, qth.stnlat, qth.stnlong, qth.stnalt);
-			sendto(sock,buff,strlen(buff),0,(struct sockaddr *)&fsin,sizeof(fsin));
-			ok=1;
-		}
+		pfd.fd=client->sock;
+		pfd.events=POLLOUT;
+		poll(&pfd,1,wait);
+	}
+}
 
-		if (strncmp("GET_TIME$",buf,9)==0)
-		{
-			buff[0]=0;
-			t=time(NULL);
-			sprintf(buff,"%s",asctime(gmtime(&t)));
+void SendText(client, text, eof)
+client_t *client;
+char *text;
+char eof;
+{
+	/* This function sends "text" to a client of the socket
+	   server a line at a time, in datagrams of at most 79
+	   characters, followed by an EOF marker (CNTRL-Z) if
+	   "eof" is set. */
 
-			if (buff[8]==32)
-				buff[8]='0';
+	int n;
+	char marker[3];
 
-			sendto(sock,buff,strlen(buff),0,(struct sockaddr *)&fsin,sizeof(fsin));
-			buf[0]=0;
-			ok=1;
-		}
+	while (*text)
+	{
+		for (n=0; n<79 && text[n]!=0 && text[n]!='\n'; n++);
 
-		if (strncmp("GET_TIME",buf,8)==0)
-		{
-			buff[0]=0;
-			t=time(NULL);
-			sprintf(buff,"%lu\n",(unsigned long)t);
-			sendto(sock,buff,strlen(buff),0,(struct sockaddr *)&fsin,sizeof(fsin));
-			ok=1;
-		}
+		if (n<79 && text[n]=='\n')
+			n++;
 
-		if (strncmp("GET_SAT_POS",buf,11)==0)
-		{
-			/* Parse "buf" for satellite name and arguments */
-			for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
+		Reply(client,text,n);
+		text+=n;
+	}
 
-			for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<49; j++)
-				satname[j-i]=buf[j];
+	if (eof)
+	{
+		sprintf(marker,"%c\n",26);  /* Control-Z */
+		Reply(client,marker,2);
+	}
+}
 
-			satname[j-i]=0;
+int SatRecord(view, x, mask, out, size)
+snapshot_t *view;
+int x, size;
+long mask;
+char *out;
+{
+	/* This function writes the record of satellite "x" in
+	   "view" returned by GET_SATS and GET_ALL to "out": its
+	   name on a line of its own, followed by a line holding
+	   the fields selected by "mask", in the order of GET_SAT,
+	   and the Doppler shift of GET_DOPPLER.  The length of
+	   the record is returned, or 0 if it doesn't fit in the
+	   "size" bytes of "out", in which case nothing is. */
 
-			/* Send request to predict with output
-			   directed to a temporary file under /tmp */
+	int n;
 
-			strcpy(tempname,"/tmp/XXXXXX\0");
-			i=mkstemp(tempname);
+	n=snprintf(out,size,"%s\n",sat[x].name);
 
-			sprintf(buff,"%s -f %s -t %s -q %s -o %s\n",predict_name,satname,tlefile,qthfile,tempname);
-			system(buff);
+	if ((mask&0x1) && n<size)
+		n+=snprintf(out+n,size-n,"%.2f ",view->lon[x]);
 
-			/* Append an EOF marker (CNTRL-Z) to the end of file */
+	if ((mask&0x2) && n<size)
+		n+=snprintf(out+n,size-n,"%+.2f ",view->lat[x]);
 
-			fd=fopen(tempname,"a");
-			fprintf(fd,"%c\n",26);  /* Control-Z */
-			fclose(fd);
+	if ((mask&0x4) && n<size)
+		n+=snprintf(out+n,size-n,"%.2f ",view->az[x]);
 
-			buff[0]=0;
+	if ((mask&0x8) && n<size)
+		n+=snprintf(out+n,size-n,"%+.2f ",view->el[x]);
 
-			/* Send the file to the client */
+	if ((mask&0x10) && n<size)
+		n+=snprintf(out+n,size-n,"%ld ",(long)rint(86400.0*(view->nextevent[x]+3651.0)));
 
-			fd=fopen(tempname,"rb");
+	if ((mask&0x20) && n<size)
+		n+=snprintf(out+n,size-n,"%.2f ",view->footprint[x]);
 
-			fgets(buff,80,fd);
+	if ((mask&0x40) && n<size)
+		n+=snprintf(out+n,size-n,"%.2f ",view->range[x]);
 
-			do
-			{
-				sendto(sock,buff,strlen(buff),0,(struct sockaddr *)&fsin,sizeof(fsin));
-				fgets(buff,80,fd);
-				/* usleep(2);  if needed (for flow-control) */
+	if ((mask&0x80) && n<size)
+		n+=snprintf(out+n,size-n,"%.2f ",view->altitude[x]);
 
-			} while (feof(fd)==0);
+	if ((mask&0x100) && n<size)
+		n+=snprintf(out+n,size-n,"%.2f ",view->velocity[x]);
 
-			fclose(fd);
-			unlink(tempname);
-			close(i);
-			ok=1;
-		}
+	if ((mask&0x200) && n<size)
+		n+=snprintf(out+n,size-n,"%ld ",view->orbitnum[x]);
 
-		if (strncmp("PREDICT",buf,7)==0)
-		{
-			/* Parse "buf" for satellite name and arguments */
-			for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
+	if ((mask&0x400) && n<size)
+		n+=snprintf(out+n,size-n,"%c ",view->visibility[x]);
 
-			for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<49; j++)
-				satname[j-i]=buf[j];
+	if ((mask&0x800) && n<size)
+		n+=snprintf(out+n,size-n,"%.2f ",view->phase[x]);
 
-			satname[j-i]=0;
+	if ((mask&0x1000) && n<size)
+		n+=snprintf(out+n,size-n,"%.2f ",view->eclipse_depth[x]);
 
-			/* Send request to predict with output
-			   directed to a temporary file under /tmp */
+	if ((mask&0x2000) && n<size)
+		n+=snprintf(out+n,size-n,"%.2f ",view->squint[x]);
 
-			strcpy(tempname,"/tmp/XXXXXX\0");
-			i=mkstemp(tempname);
+	if ((mask&0x4000) && n<size)
+		n+=snprintf(out+n,size-n,"%f ",view->doppler[x]);
 
-			sprintf(buff,"%s -p %s -t %s -q %s -o %s\n",predict_name, satname,tlefile,qthfile,tempname);
-			system(buff);
+	if (n+2>size)
+	{
+		out[0]=0;
+		return 0;
+	}
 
-			/* Append an EOF marker (CNTRL-Z) to the end of file */
+	/* End the line in place of the last separator */
 
-			fd=fopen(tempname,"a");
-			fprintf(fd,"%c\n",26);  /* Control-Z */
-			fclose(fd);
+	if (out[n-1]==' ')
+		n--;
 
-			buff[0]=0;
+	out[n++]='\n';
+	out[n]=0;
 
-			/* Send the file to the client */
+	return n;
+}
 
-			fd=fopen(tempname,"rb");
+void PutInt(out, value, bytes)
+unsigned char *out;
+unsigned long long value;
+int bytes;
+{
+	/* This function writes "value" to "out" as a
+	   little-endian integer of "bytes" bytes, as
+	   used by the binary protocol. */
 
-			fgets(buff,80,fd);
+	int x;
 
-			do
-			{
-				sendto(sock,buff,strlen(buff),0,(struct sockaddr *)&fsin,sizeof(fsin));
-				fgets(buff,80,fd);
-				/* usleep(2);  if needed (for flow-control) */
+	for (x=0; x<bytes; x++)
+		out[x]=(unsigned char)((value>>(8*x))&0xff);
+}
 
-			} while (feof(fd)==0);
+unsigned long long GetInt(in, bytes)
+unsigned char *in;
+int bytes;
+{
+	unsigned long long value=0;
+	int x;
 
-			fclose(fd);
-			unlink(tempname);
-			close(i);
-			ok=1;
-		}
+	for (x=bytes-1; x>=0; x--)
+		value=(value<<8)|in[x];
 
-		if (ok==0)
-			sendto(sock,"Huh?\n",5,0,(struct sockaddr *)&fsin,sizeof(fsin));
-	} 	
+	return value;
 }
 
-void Banner()
+void PutDouble(out, value)
+unsigned char *out;
+double value;
 {
-	curs_set(0);
-	bkgdset(COLOR_PAIR(3));
-	clear();
-	refresh();
+	unsigned long long bits;
 
-	attrset(COLOR_PAIR(6)|A_REVERSE|A_BOLD);
-	mvprintw(3,18,"                                           ");
-	mvprintw(4,18,"         --== PREDICT  v%s ==--         ",version);
-	mvprintw(5,18,"   Released by John A. Magliacane, KD2BD   ");
-	mvprintw(6,18,"                  May 2018                 ");
-	mvprintw(7,18,"                                           ");
+	memcpy(&bits,&value,8);
+	PutInt(out,bits,8);
 }
 
-void AnyKey()
+void BinaryRecord(view, x, out)
+snapshot_t *view;
+int x;
+unsigned char *out;
 {
-	mvprintw(23,24,"<< Press Any Key To Continue >>");
-	refresh();
-	getch();
+	/* This function writes the PREDICT_GET_SATS record
+	   of satellite "x" in "view" to "out". */
+
+	memset(out,0,PREDICT_RECORD_SIZE);
+	strncpy((char *)out,sat[x].name,31);
+	PutInt(out+32,(unsigned long long)sat[x].catnum,4);
+	PutInt(out+36,(unsigned long long)view->orbitnum[x],4);
+	out[40]=view->visibility[x];
+	out[41]=(sat[x].meanmo!=0.0 && view->el[x]>=Horizon(view->az[x]));
+	PutInt(out+48,(unsigned long long)(long long)rint(86400.0*(view->nextevent[x]+3651.0)),8);
+	PutDouble(out+56,view->lon[x]);
+	PutDouble(out+64,view->lat[x]);
+	PutDouble(out+72,view->az[x]);
+	PutDouble(out+80,view->el[x]);
+	PutDouble(out+88,view->footprint[x]);
+	PutDouble(out+96,view->range[x]);
+	PutDouble(out+104,-view->doppler[x]*299792458.0/100.0e09);
+	PutDouble(out+112,view->altitude[x]);
+	PutDouble(out+120,view->velocity[x]);
+	PutDouble(out+128,view->phase[x]);
+	PutDouble(out+136,view->eclipse_depth[x]);
+	PutDouble(out+144,view->squint[x]);
+	PutDouble(out+152,view->doppler[x]);
 }
 
-double FixAngle(x)
-double x;
+void ServeBinary(client, in, n)
+client_t *client;
+unsigned char *in;
+int n;
 {
-	/* This function reduces angles greater than
-	   two pi by subtracting two pi from the angle */
-
-	while (x>twopi)
-		x-=twopi;
+	/* This function answers the request of the binary
+	   protocol (see predict_proto.h) in the "n" bytes
+	   of "in" received by the socket server from "client". */
 
-	return x;
-}
-
-double PrimeAngle(x)
-double x;
-{
-	/* This function is used in the FindMoon() function. */
+	int x, y, count, command, error=0;
+	long catnum;
+	unsigned long length, size=0;
+	unsigned char reply[8192], *body;
+	double start, now;
+	snapshot_t view;
+	pass_t pass;
 
-	x=x-360.0*floor(x/360.0);
-	return x;
-}
+	command=(int)GetInt(in+6,2);
+	length=(unsigned long)GetInt(in+12,4);
+	body=reply+PREDICT_HEADER_SIZE;
 
-char *SubString(string,start,end)
-char *string, start, end;
-{
-	/* This function returns a substring based on the starting
-	   and ending positions provided.  It is used heavily in
-	   the AutoUpdate function when parsing 2-line element data. */
+	ReadSnapshot(&view);
 
-	unsigned x, y;
+	if (GetInt(in+4,2)!=PREDICT_PROTO_VERSION || length>(unsigned long)(n-PREDICT_HEADER_SIZE))
+		error=1;
 
-	if (end>=start)
+	else if (command==PREDICT_GET_LIST)
 	{
-		for (x=start, y=0; x<=end && string[x]!=0; x++)
-			if (string[x]!=' ')
+		for (x=0, count=0; x<24; x++)
+		{
+			if (sat[x].name[0]!=0)
 			{
-				temp[y]=string[x];
-				y++;
+				memset(body+4+size,0,PREDICT_LIST_SIZE);
+				strncpy((char *)body+4+size,sat[x].name,31);
+				PutInt(body+4+size+32,(unsigned long long)sat[x].catnum,4);
+				size+=PREDICT_LIST_SIZE;
+				count++;
 			}
+		}
 
-		temp[y]=0;
-		return temp;
+		PutInt(body,count,4);
+		size+=4;
 	}
-	else
-		return NULL;
-}
 
-void CopyString(source, destination, start, end)
-char *source, *destination, start, end;
-{
-	/* This function copies elements of the string "source"
-	   bounded by "start" and "end" into the string "destination". */
+	else if (command==PREDICT_GET_SATS)
+	{
+		/* Records of the satellites requested by
+		   object number, or of all of them */
 
-	unsigned j, k=0;
+		count=0;
 
-	for (j=start; j<=end; j++)
-		if (source[k]!=0)
+		if (length>=4)
 		{
-			destination[j]=source[k];
-			k++;
+			count=(int)GetInt(in+PREDICT_HEADER_SIZE,4);
+
+			if (count<0 || count>(int)(length-4)/4)
+				count=(int)(length-4)/4;
 		}
-}
 
-char *Abbreviate(string,n)
-char *string;
-int n;
-{
-	/* This function returns an abbreviated substring of the original,
-	   including a '~' character if a non-blank character is chopped
-	   out of the generated substring.  n is the length of the desired
-	   substring.  It is used for abbreviating satellite names. */
+		size=4;
 
-	strncpy(temp,string,79);
+		for (y=0; y<(count?count:24); y++)
+		{
+			if (count)
+			{
+				catnum=(long)GetInt(in+PREDICT_HEADER_SIZE+4+4*y,4);
 
-	if (temp[n]!=0 && temp[n]!=32)
-	{
-		temp[n-2]='~';
-		temp[n-1]=temp[strlen(temp)-1];
-	}
+				for (x=0; x<24 && (sat[x].name[0]==0 || sat[x].catnum!=catnum); x++);
+			}
 
-	temp[n]=0;
+			else
+				x=(sat[y].name[0]!=0?y:24);
 
-	return temp;
-}
+			if (x<24 && size+PREDICT_RECORD_SIZE<=sizeof(reply)-PREDICT_HEADER_SIZE)
+			{
+				BinaryRecord(&view,x,body+size);
+				size+=PREDICT_RECORD_SIZE;
+			}
+		}
 
-char KepCheck(line1,line2)
-char *line1, *line2;
-{
-	/* This function scans line 1 and line 2 of a NASA 2-Line element
-	   set and returns a 1 if the element set appears to be valid or
-	   a 0 if it does not.  If the data survives this torture test,
-	   it's a pretty safe bet we're looking at a valid 2-line
-	   element set and not just some random text that might pass
-	   as orbital data based on a simple checksum calculation alone. */
+		PutInt(body,(size-4)/PREDICT_RECORD_SIZE,4);
+	}
 
-	int x;
-	unsigned sum1, sum2;
+	else if (command==PREDICT_GET_QTH)
+	{
+		memset(body,0,32);
+		strncpy((char *)body,qth.callsign,31);
+		PutDouble(body+32,qth.stnlat);
+		PutDouble(body+40,qth.stnlong);
+		PutDouble(body+48,(double)qth.stnalt);
+		size=56;
+	}
 
-	/* Compute checksum for each line */
+	else if (command==PREDICT_GET_TIME)
+	{
+		PutInt(body,(unsigned long long)ClockNow(),8);
+		size=8;
+	}
 
-	for (x=0, sum1=0, sum2=0; x<=67; sum1+=val[(int)line1[x]], sum2+=val[(int)line2[x]], x++);
+	else if (command==PREDICT_GET_SUN)
+	{
+		PutDouble(body,view.sun_azi);
+		PutDouble(body+8,view.sun_ele);
+		size=16;
+	}
 
-	/* Perform a "torture test" on the data */
+	else if (command==PREDICT_GET_MOON)
+	{
+		PutDouble(body,view.moon_az);
+		PutDouble(body+8,view.moon_el);
+		size=16;
+	}
 
-	x=(val[(int)line1[68]]^(sum1%10)) | (val[(int)line2[68]]^(sum2%10)) |
-	  (line1[0]^'1')  | (line1[1]^' ')  | (line1[7]^'U')  |
-	  (line1[8]^' ')  | (line1[17]^' ') | (line1[23]^'.') |
-	  (line1[32]^' ') | (line1[34]^'.') | (line1[43]^' ') |
-	  (line1[52]^' ') | (line1[61]^' ') | (line1[62]^'0') |
-	  (line1[63]^' ') | (line2[0]^'2')  | (line2[1]^' ')  |
-	  (line2[7]^' ')  | (line2[11]^'.') | (line2[16]^' ') |
-	  (line2[20]^'.') | (line2[25]^' ') | (line2[33]^' ') |
-	  (line2[37]^'.') | (line2[42]^' ') | (line2[46]^'.') |
-	  (line2[51]^' ') | (line2[54]^'.') | (line1[2]^line2[2]) |
-	  (line1[3]^line2[3]) | (line1[4]^line2[4]) |
-	  (line1[5]^line2[5]) | (line1[6]^line2[6]) |
-	  (isdigit(line1[68]) ? 0 : 1) | (isdigit(line2[68]) ? 0 : 1) |
-	  (isdigit(line1[18]) ? 0 : 1) | (isdigit(line1[19]) ? 0 : 1) |
-	  (isdigit(line2[31]) ? 0 : 1) | (isdigit(line2[32]) ? 0 : 1);
+	else if (command==PREDICT_GET_VERSION)
+	{
+		memset(body,0,16);
+		strncpy((char *)body,version,15);
+		size=16;
+	}
 
-	return (x ? 0 : 1);
-}
+	else if (command==PREDICT_GET_PASS && length>=12)
+	{
+		/* The pass of the satellite requested by object
+		   number, in progress at or following the time
+		   given (0 for now), or nothing if there is none.
+		   As for the PREDICT and GET_PASS commands, the
+		   time must be within one year of now. */
 
-void InternalUpdate(x)
-int x;
-{
-	/* Updates data in TLE structure based on
-	   line1 and line2 stored in structure. */
+		catnum=(long)GetInt(in+PREDICT_HEADER_SIZE,4);
+		start=(double)(long long)GetInt(in+PREDICT_HEADER_SIZE+4,8);
+		now=(double)ClockTime();
 
-	double tempnum;
+		if (start==0.0)
+			start=now;
 
-	strncpy(sat[x].designator,SubString(sat[x].line1,9,16),8);
-	sat[x].designator[9]=0;
-	sat[x].catnum=atol(SubString(sat[x].line1,2,6));
-	sat[x].year=atoi(SubString(sat[x].line1,18,19));
-	sat[x].refepoch=atof(SubString(sat[x].line1,20,31));
-	tempnum=1.0e-5*atof(SubString(sat[x].line1,44,49));
-	sat[x].nddot6=tempnum/pow(10.0,(sat[x].line1[51]-'0'));
-	tempnum=1.0e-5*atof(SubString(sat[x].line1,53,58));
-	sat[x].bstar=tempnum/pow(10.0,(sat[x].line1[60]-'0'));
-	sat[x].setnum=atol(SubString(sat[x].line1,64,67));
-	sat[x].incl=atof(SubString(sat[x].line2,8,15));
-	sat[x].raan=atof(SubString(sat[x].line2,17,24));
-	sat[x].eccn=1.0e-07*atof(SubString(sat[x].line2,26,32));
-	sat[x].argper=atof(SubString(sat[x].line2,34,41));
-	sat[x].meanan=atof(SubString(sat[x].line2,43,50));
-	sat[x].meanmo=atof(SubString(sat[x].line2,52,62));
-	sat[x].drag=atof(SubString(sat[x].line1,33,42));
-	sat[x].orbitnum=atof(SubString(sat[x].line2,63,67));
-}
+		for (x=0; x<24 && (sat[x].name[0]==0 || sat[x].catnum!=catnum); x++);
 
-char *noradEvalue(value)
-double value;
-{
-	/* Converts numeric values to E notation used in NORAD TLEs */
+		if (x==24 || start<now-31557600.0 || start>now+31557600.0)
+			error=1;
 
-	char string[15];
+		else if (NextPass(x,start/86400.0-3651.0,&pass))
+		{
+			PutInt(body,(unsigned long long)catnum,4);
+			PutInt(body+4,0,4);
+			PutDouble(body+8,86400.0*(pass.aos+3651.0));
+			PutDouble(body+16,pass.aos_az);
+			PutDouble(body+24,86400.0*(pass.tca+3651.0));
+			PutDouble(body+32,pass.tca_az);
+			PutDouble(body+40,pass.tca_el);
+			PutDouble(body+48,pass.tca_range);
+			PutDouble(body+56,86400.0*(pass.maxel_time+3651.0));
+			PutDouble(body+64,pass.maxel);
+			PutDouble(body+72,pass.maxel_az);
+			PutDouble(body+80,86400.0*(pass.los+3651.0));
+			PutDouble(body+88,pass.los_az);
+			size=PREDICT_PASS_SIZE;
+		}
+	}
 
-	sprintf(string,"%11.4e",value*10.0);
+	else if (command==PREDICT_RELOAD_TLE)
+		__atomic_store_n(&reload_tle,1,__ATOMIC_RELEASE);
 
-	output[0]=string[0];
-	output[1]=string[1];
-	output[2]=string[3];
-	output[3]=string[4];
-	output[4]=string[5];
-	output[5]=string[6];
-	output[6]='-';
-	output[7]=string[10];
-	output[8]=0;
+	else
+		error=1;
 
-	return output;
+	if (error)
+	{
+		command|=PREDICT_ERROR;
+		size=0;
+	}
+
+	PutInt(reply,PREDICT_PROTO_MAGIC,4);
+	PutInt(reply+4,PREDICT_PROTO_VERSION,2);
+	PutInt(reply+6,(unsigned long long)command,2);
+	memcpy(reply+8,in+8,4);
+	PutInt(reply+12,size,4);
+	PutInt(reply+16,(unsigned long long)(long long)rint(86400.0e9*(view.time+3651.0)),8);
+
+	Reply(client,(char *)reply,PREDICT_HEADER_SIZE+(int)size);
 }
 
-void Data2TLE(x)
-int x;
+void ServeRequest(client, buf)
+client_t *client;
+char *buf;
 {
-	/* This function converts orbital data held in the numeric
-	   portion of the sat tle structure to ASCII TLE format,
-	   and places the result in ASCII portion of the structure. */
- 
-	int i;
-	char string[15], line1[70], line2[70];
-	unsigned sum;
+	/* This function answers the request in "buf" received
+	   by the socket server from "client" */
 
-	/* Fill lines with blanks */
+	int i, j, n;
+	char buff[8192], satname[50], line[128], sent[24], *text, *next, ok=0;
+	time_t t;
+	long nxtevt, mask;
+	size_t size;
+	struct tm tm;
+	FILE *fd=NULL;
+	snapshot_t view;
 
-	for (i=0; i<70; line1[i]=32, line2[i]=32, i++);
 
-	line1[69]=0;
-	line2[69]=0;
+	/* Parse the command in the datagram */
+	if ((strncmp("GET_SAT",buf,7)==0) && (strncmp("GET_SAT_POS",buf,11)!=0) && (strncmp("GET_SATS",buf,8)!=0))
+	{
+		/* Parse "buf" for satellite name */
+		for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
 
-	/* Insert static characters */
+		for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<25; j++)
+			satname[j-i]=buf[j];
 
-	line1[0]='1';
-	line1[7]='U'; /* Unclassified */
-	line2[0]='2';
+		satname[j-i]=0;
 
-	line1[62]='0'; /* For publically released TLEs */
+		/* Do a simple search for the matching satellite name */
 
-	/* Insert orbital data */
+		for (i=0; i<24; i++)
+		{
+			if ((strncmp(satname,sat[i].name,25)==0) || (atol(satname)==sat[i].catnum))
+			{
+				ReadSnapshot(&view);
 
-	sprintf(string,"%05ld",sat[x].catnum);
-	CopyString(string,line1,2,6);
-	CopyString(string,line2,2,6);
+				nxtevt=(long)rint(86400.0*(view.nextevent[i]+3651.0));
 
-	CopyString(sat[x].designator,line1,9,16);
+				/* Build text buffer with satellite data */
+				sprintf(buff,"%s\n%-7.2f\n%+-6.2f\n%-7.2f\n%+-6.2f\n%ld\n%-7.2f\n%-7.2f\n%-7.2f\n%-7.2f\n%ld\n%c\n%-7.2f\n%-7.2f\n%-7.2f\n",sat[i].name,view.lon[i],view.lat[i],view.az[i],view.el[i],nxtevt,view.footprint[i],view.range[i],view.altitude[i],view.velocity[i],view.orbitnum[i],view.visibility[i],view.phase[i],view.eclipse_depth[i],view.squint[i]);
 
-	sprintf(string,"%02d",sat[x].year);
-	CopyString(string,line1,18,19);
+				/* Send buffer back to the client that sent the request */
+				Reply(client,buff,strlen(buff));
+				ok=1;
+				break;
+			}
+		}
+	}
 
-	sprintf(string,"%12.8f",sat[x].refepoch);
-	CopyString(string,line1,20,32);
+	if (strncmp("GET_SATS",buf,8)==0 || strncmp("GET_ALL",buf,7)==0)
+	{
+		/* Parse "buf" for an optional field mask (in hex) */
+		for (i=0; buf[i]!=32 && buf[i]!='\n' && buf[i]!=0; i++);
+		for (; buf[i]==32; i++);
 
-	sprintf(string,"%.9f",fabs(sat[x].drag));
+		mask=0x7fff;
 
-	CopyString(string,line1,33,42);
+		if (buf[i]=='0' && (buf[i+1]=='x' || buf[i+1]=='X'))
+		{
+			mask=strtol(buf+i,&next,16);
 
-	if (sat[x].drag<0.0)
-		line1[33]='-';
-	else
-		line1[33]=32;
+			for (i=next-buf; buf[i]==32; i++);
+		}
 
-	CopyString(noradEvalue(sat[x].nddot6),line1,44,51);
-	CopyString(noradEvalue(sat[x].bstar),line1,53,60);
+		/* Send the records of the satellites named
+		   (separated by commas), or of all of them,
+		   from a single snapshot.  A satellite named
+		   more than once is sent once. */
 
-	sprintf(string,"%4lu",sat[x].setnum);
-	CopyString(string,line1,64,67);
+		ReadSnapshot(&view);
+		memset(sent,0,sizeof(sent));
+		n=0;
 
-	sprintf(string,"%9.4f",sat[x].incl);
-	CopyString(string,line2,7,15);
-				
-	sprintf(string,"%9.4f",sat[x].raan);
-	CopyString(string,line2,16,24);
+		if (buf[4]=='A')
+		{
+			for (j=0; j<24; j++)
+				if (sat[j].name[0]!=0)
+					n+=SatRecord(&view,j,mask,buff+n,(int)sizeof(buff)-n);
+		}
 
-	sprintf(string,"%13.12f",sat[x].eccn);
-	
-	/* Erase eccentricity's decimal point */
+		else
+		{
+			while (buf[i]!=0 && buf[i]!='\n')
+			{
+				for (; buf[i]==32; i++);
 
-	for (i=2; i<=9; string[i-2]=string[i], i++);
+				for (j=0; buf[i]!=',' && buf[i]!='\n' && buf[i]!=0 && j<25; i++, j++)
+					satname[j]=buf[i];
 
-	CopyString(string,line2,26,32);
+				satname[j]=0;
 
-	sprintf(string,"%9.4f",sat[x].argper);
-	CopyString(string,line2,33,41);
+				if (buf[i]==',')
+					i++;
 
-	sprintf(string,"%9.5f",sat[x].meanan);
-	CopyString(string,line2,43,50);
+				for (j=0; j<24; j++)
+				{
+					if ((strncmp(satname,sat[j].name,25)==0) || (atol(satname)==sat[j].catnum))
+					{
+						if (sent[j]==0)
+							n+=SatRecord(&view,j,mask,buff+n,(int)sizeof(buff)-n);
 
-	sprintf(string,"%12.9f",sat[x].meanmo);
-	CopyString(string,line2,52,62);
+						sent[j]=1;
+						break;
+					}
+				}
+			}
+		}
 
-	sprintf(string,"%5lu",sat[x].orbitnum);
-	CopyString(string,line2,63,67);
+		if (n==0)
+			strcpy(buff,"NONE\n");
 
-	/* Compute and insert checksum for line 1 and line 2 */
+		Reply(client,buff,strlen(buff));
+		ok=1;
+	}
 
-	for (i=0, sum=0; i<=67; sum+=val[(int)line1[i]], i++);
+	if (strncmp("GET_TLE",buf,7)==0)
+	{
+		/* Parse "buf" for satellite name */
+		for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
 
-	line1[68]=(sum%10)+'0';
+		for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<25; j++)
+			satname[j-i]=buf[j];
 
-	for (i=0, sum=0; i<=67; sum+=val[(int)line2[i]], i++);
+		satname[j-i]=0;
 
-	line2[68]=(sum%10)+'0';
+		/* Do a simple search for the matching satellite name */
 
-	line1[69]=0;
-	line2[69]=0;
+		for (i=0; i<24; i++)
+		{
+			if ((strncmp(satname,sat[i].name,25)==0) || (atol(satname)==sat[i].catnum))
+			{
+				/* Build text buffer with satellite data */
 
-	strcpy(sat[x].line1,line1);
-	strcpy(sat[x].line2,line2);
-}
+				sprintf(buff,"%s\n%s\n%s\n",sat[i].name,sat[i].line1, sat[i].line2);
+				/* Send buffer back to the client that sent the request */
+				Reply(client,buff,strlen(buff));
+				ok=1;
+				break;
+			}
+		}
+	}
 
-double ReadBearing(input)
-char *input;
-{
-	/* This function takes numeric input in the form of a character
-	   string, and returns an equivalent bearing in degrees as a
-	   decimal number (double).  The input may either be expressed
-	   in decimal format (74.2467) or degree, minute, second
-	   format (74 14 48).  This function also safely handles
-	   extra spaces found either leading, trailing, or
-	   embedded within the numbers expressed in the
-	   input string.  Decimal seconds are permitted. */
- 
-	char string[20];
-	double bearing=0.0, seconds;
-	int a, b, length, degrees, minutes;
+	if (strncmp("GET_DOPPLER",buf,11)==0)
+	{
+		/* Parse "buf" for satellite name */
+		for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
 
-	/* Copy "input" to "string", and ignore any extra
-	   spaces that might be present in the process. */
+		for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<25; j++)
+			satname[j-i]=buf[j];
 
-	string[0]=0;
-	length=strlen(input);
+		satname[j-i]=0;
 
-	for (a=0, b=0; a<length && a<18; a++)
-	{
-		if ((input[a]!=32 && input[a]!='\n') || (input[a]==32 && input[a+1]!=32 && b!=0))
+		/* Do a simple search for the matching satellite name */
+
+		for (i=0; i<24; i++)
 		{
-			string[b]=input[a];
-			b++;
-		}	 
+			if ((strncmp(satname,sat[i].name,25)==0) || (atol(satname)==sat[i].catnum))
+			{
+				/* Get Normalized (100 MHz)
+				   Doppler shift for sat[i] */
+
+				ReadSnapshot(&view);
+				sprintf(buff,"%f\n",view.doppler[i]);
+
+				/* Send buffer back to client who sent request */
+				Reply(client,buff,strlen(buff));
+				ok=1;
+				break;
+			}
+		}
 	}
 
-	string[b]=0;
+	if (strncmp("GET_FREQ",buf,8)==0)
+	{
+		/* Parse "buf" for satellite name */
+		for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
 
-	/* Count number of spaces in the clean string. */
+		for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<25; j++)
+			satname[j-i]=buf[j];
 
-	length=strlen(string);
+		satname[j-i]=0;
 
-	for (a=0, b=0; a<length; a++)
-		if (string[a]==32)
-			b++;
+		/* Do a simple search for the matching satellite name */
 
-	if (b==0)  /* Decimal Format (74.2467) */
-		sscanf(string,"%lf",&bearing);
+		for (i=0; i<24; i++)
+		{
+			if ((strncmp(satname,sat[i].name,25)==0) || (atol(satname)==sat[i].catnum))
+			{
+				/* Doppler corrected uplink and downlink
+				   frequencies of each transponder */
 
-	if (b==2)  /* Degree, Minute, Second Format (74 14 48) */
+				ReadSnapshot(&view);
+				buff[0]=0;
+
+				for (j=0; j<sat_db[i].transponders; j++)
+				{
+					sprintf(line,"%.6f %.6f %s\n",view.uplink[i][j],view.downlink[i][j],sat_db[i].transponder_name[j]);
+					strcat(buff,line);
+				}
+
+				Reply(client,buff,strlen(buff));
+				ok=1;
+				break;
+			}
+		}
+	}
+
+	if (strncmp("GET_LIST",buf,8)==0)
 	{
-		sscanf(string,"%d %d %lf",&degrees, &minutes, &seconds);
+		buff[0]=0;
 
-		if (degrees<0.0)
+		for (i=0; i<24; i++)
 		{
-			minutes=-minutes;
-			seconds=-seconds;
+			if (sat[i].name[0]!=0)
+				strcat(buff,sat[i].name);
+
+			strcat(buff,"\n");
 		}
 
-		bearing=(double)degrees+((double)minutes/60)+(seconds/3600);
+		Reply(client,buff,strlen(buff));
+		ok=1;
 	}
 
-	/* Bizarre results return a 0.0 */
+	if (strncmp("RELOAD_TLE",buf,10)==0)
+	{
+		buff[0]=0;
+		Reply(client,buff,strlen(buff));
+		__atomic_store_n(&reload_tle,1,__ATOMIC_RELEASE);
+		ok=1;
+	}
 
-	if (bearing>360.0 || bearing<-360.0)
-		bearing=0.0;
+	if ((strncmp("GET_SUN",buf,7)==0) && (strncmp("GET_SUN_EVENTS",buf,14)!=0))
+	{
+		ReadSnapshot(&view);
+		sprintf(buff,"%-7.2f\n%+-6.2f\n%-7.2f\n%-7.2f\n%-7.2f\n",view.sun_azi, view.sun_ele, view.sun_lat, view.sun_lon, view.sun_ra);
+		Reply(client,buff,strlen(buff));
+		ok=1;
+	}
 
-	return bearing;
-}
+	if ((strncmp("GET_MOON",buf,8)==0) && (strncmp("GET_MOON_EVENTS",buf,15)!=0))
+	{
+		ReadSnapshot(&view);
+		sprintf(buff,"%-7.2f\n%+-6.2f\n%-7.2f\n%-7.2f\n%-7.2f\n",view.moon_az, view.moon_el, view.moon_dec, view.moon_gha, view.moon_ra);
+		Reply(client,buff,strlen(buff));
+		ok=1;
+	}
 
-char ReadDataFiles()
-{
-	/* This function reads "predict.qth", "predict.tle",
-	   and (optionally) "predict.db" files into memory.
-  	   Return values are as follows:
+	if (strncmp("GET_MODE",buf,8)==0)
+	{
+		Reply(client,tracking_mode,strlen(tracking_mode));
+		ok=1;
+	}
 
-	   0: Neither the qth nor the tle files were loaded
-	   1: Only the qth file was loaded
-	   2: Only the tle file was loaded
-	   3: The qth and tle files were loaded successfully */
+	if (strncmp("GET_VERSION",buf,11)==0)
+	{
+		buff[0]=0;
+		sprintf(buff,"%s\n",version);
+		Reply(client,buff,strlen(buff));
+		ok=1;
+	}
 
-	FILE *fd;
-	long catnum;
-	unsigned char dayofweek;
-	int x=0, y, entry=0, max_entries=10, transponders=0;
-	char flag=0, match, name[80], line1[80], line2[80];
+	if (strncmp("GET_QTH",buf,7)==0)
+	{
+		buff[0]=0;
+		sprintf(buff,"%s\n%g\n%g\n%d\n",qth.callsign, qth.stnlat, qth.stnlong, qth.stnalt);
+		Reply(client,buff,strlen(buff));
+		ok=1;
+	}
 
-	fd=fopen(qthfile,"r");
-	
-	if (fd!=NULL)
+	if (strncmp("GET_TIME$",buf,9)==0)
 	{
-		fgets(qth.callsign,16,fd);
-		qth.callsign[strlen(qth.callsign)-1]=0;
-		fscanf(fd,"%lf", &qth.stnlat);
-		fscanf(fd,"%lf", &qth.stnlong);
-		fscanf(fd,"%d", &qth.stnalt);
-		fclose(fd);
+		buff[0]=0;
+		t=ClockTime();
+		asctime_r(gmtime_r(&t,&tm),buff);
 
-		obs_geodetic.lat=qth.stnlat*deg2rad;
-		obs_geodetic.lon=-qth.stnlong*deg2rad;
-		obs_geodetic.alt=((double)qth.stnalt)/1000.0;
-		obs_geodetic.theta=0.0;
+		if (buff[8]==32)
+			buff[8]='0';
 
-		flag=1;
+		Reply(client,buff,strlen(buff));
+		buf[0]=0;
+		ok=1;
 	}
 
-	fd=fopen(tlefile,"r");
+	if (strncmp("GET_TIME",buf,8)==0)
+	{
+		buff[0]=0;
+		t=ClockTime();
+		sprintf(buff,"%lu\n",(unsigned long)t);
+		Reply(client,buff,strlen(buff));
+		ok=1;
+	}
 
-	if (fd!=NULL)
+	if (strncmp("GET_SAT_POS",buf,11)==0)
 	{
-		while (x<24 && feof(fd)==0)
-		{
-			/* Initialize variables */
+		/* Parse "buf" for satellite name and arguments,
+		   separated by newlines as on the command line */
+		for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
 
-			name[0]=0;
-			line1[0]=0;
-			line2[0]=0;
+		for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<48; j++)
+			satname[j-i]=(buf[j]==32?'\n':buf[j]);
 
-			/* Read element set */
+		satname[j-i]='\n';
+		satname[j-i+1]=0;
 
-			fgets(name,75,fd);
-			fgets(line1,75,fd);
-			fgets(line2,75,fd);
+		/* Calculate the positions in memory
+		   and send them to the client */
 
-			if (KepCheck(line1,line2) && (feof(fd)==0))
-			{
-				/* We found a valid TLE! */
+		fd=open_memstream(&text,&size);
+		WritePositions(satname,fd,client->deadline);
+		fclose(fd);
 
-				/* Some TLE sources left justify the sat
-				   name in a 24-byte field that is padded
-				   with blanks.  The following lines cut
-				   out the blanks as well as the line feed
-				   character read by the fgets() function. */
- 
-				y=strlen(name);
+		SendText(client,text,1);
+		free(text);
+		ok=1;
+	}
 
-				while (name[y]==32 || name[y]==0 || name[y]==10 || name[y]==13 || y==0)
-				{
-					name[y]=0;
-					y--;
-				}
-				
-				/* Copy TLE data into the sat data structure */
+	if (strncmp("PREDICT",buf,7)==0)
+	{
+		/* Parse "buf" for satellite name and arguments,
+		   separated by newlines as on the command line */
+		for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
 
-				strncpy(sat[x].name,name,24);
-				strncpy(sat[x].line1,line1,69);
-				strncpy(sat[x].line2,line2,69);
+		for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<48; j++)
+			satname[j-i]=(buf[j]==32?'\n':buf[j]);
 
-				/* Update individual parameters */
+		satname[j-i]='\n';
+		satname[j-i+1]=0;
 
-				InternalUpdate(x);
+		/* Calculate the pass in memory
+		   and send it to the client */
 
-				x++;
-			}
-		}
+		fd=open_memstream(&text,&size);
+		WritePass(satname,fd,0,client->deadline);
+		fclose(fd);
 
+		SendText(client,text,1);
+		free(text);
+		ok=1;
+	}
+
+	if (strncmp("GET_PASS",buf,8)==0)
+	{
+		/* Parse "buf" for satellite name and arguments,
+		   separated by newlines as on the command line */
+		for (i=0; buf[i]!=32 && buf[i]!=0 && i<39; i++);
+
+		for (j=++i; buf[j]!='\n' && buf[j]!=0 && (j-i)<48; j++)
+			satname[j-i]=(buf[j]==32?'\n':buf[j]);
+
+		satname[j-i]='\n';
+		satname[j-i+1]=0;
+
+		fd=open_memstream(&text,&size);
+		WritePass(satname,fd,1,client->deadline);
 		fclose(fd);
-		flag+=2;
-		resave=0;
 
-		/* Load satellite database file */
+		/* Send only the pass summary line to the client */
 
-		fd=fopen(dbfile,"r");
+		strcpy(buff,"NONE\n");
 
-		if (fd!=NULL)
+		for (next=text; *next; next=strchr(next,'\n')+1)
 		{
-			database=1;
+			if (strncmp("PASS",next,4)==0)
+			{
+				buff[0]=0;
+				strncat(buff,next,strchr(next,'\n')+1-next);
+			}
+		}
 
-			fgets(line1,40,fd);
+		free(text);
 
-			while (strncmp(line1,"end",3)!=0 && line1[0]!='\n' && feof(fd)==0)
-			{
-				/* The first line is the satellite
-				   name which is ignored here. */
+		Reply(client,buff,strlen(buff));
+		ok=1;
+	}
 
-				fgets(line1,40,fd);
-				sscanf(line1,"%ld",&catnum);
+	if (strncmp("GET_SUN_EVENTS",buf,14)==0 || strncmp("GET_MOON_EVENTS",buf,15)==0)
+	{
+		/* Send the events of the requested body
+		   over the next 24 hours to the client */
 
-				/* Search for match */
+		fd=open_memstream(&text,&size);
+		WriteEvents("",fd);
+		fclose(fd);
 
-				for (y=0, match=0; y<24 && match==0; y++)
-				{
-					if (catnum==sat[y].catnum)
-						match=1;
-				}
+		buff[0]=0;
 
-				if (match)
-				{
-					transponders=0;
-					entry=0;
-					y--;
-				}
+		for (next=text; *next; next=strchr(next,'\n')+1)
+		{
+			if (strncmp(buf[4]=='S'?"sun ":"moon",next+32,4)==0)
+				strncat(buff,next,strchr(next,'\n')+1-next);
+		}
 
-				fgets(line1,40,fd);
+		free(text);
 
-				if (match)
-				{
-					if (strncmp(line1,"No",2)!=0)
-					{
-						sscanf(line1,"%lf, %lf",&sat_db[y].alat, &sat_db[y].alon);
-						sat_db[y].squintflag=1;
-					}
+		if (buff[0]==0)
+			strcpy(buff,"NONE\n");
 
-					else
-						sat_db[y].squintflag=0;
-				}
+		Reply(client,buff,strlen(buff));
+		ok=1;
+	}
 
-				fgets(line1,80,fd);
+	if (ok==0)
+		Reply(client,"Huh?\n",5);
+}
 
-				while (strncmp(line1,"end",3)!=0 && line1[0]!='\n' && feof(fd)==0)
-				{
-					if (entry<max_entries)
-					{
-						if (match)
-						{
-							if (strncmp(line1,"No",2)!=0)
-							{
-								line1[strlen(line1)-1]=0;
-								strcpy(sat_db[y].transponder_name[entry],line1);
-							}
-							else
-								sat_db[y].transponder_name[entry][0]=0;
-						}
+void Arm(fd, tag)
+int fd;
+unsigned long long tag;
+{
+	/* This function (re)arms socket "fd" of the socket
+	   server in server_epoll, to be reported once with
+	   "tag" the next time it becomes readable. */
 
-						fgets(line1,40,fd);
+	struct epoll_event event;
 
-						if (match)
-							sscanf(line1,"%lf, %lf", &sat_db[y].uplink_start[entry], &sat_db[y].uplink_end[entry]);
+	event.events=EPOLLIN|EPOLLONESHOT;
+	event.data.u64=tag;
 
-						fgets(line1,40,fd);
+	if (epoll_ctl(server_epoll,EPOLL_CTL_MOD,fd,&event)==-1)
+		epoll_ctl(server_epoll,EPOLL_CTL_ADD,fd,&event);
+}
 
-						if (match)
-							sscanf(line1,"%lf, %lf", &sat_db[y].downlink_start[entry], &sat_db[y].downlink_end[entry]);
+void CloseConnection(c)
+connection_t *c;
+{
+	/* Called with connection_lock held */
 
-						fgets(line1,40,fd);
+	epoll_ctl(server_epoll,EPOLL_CTL_DEL,c->fd,NULL);
+	close(c->fd);
+	c->fd=-1;
+	c->busy=0;
+}
 
-						if (match)
-						{
-							if (strncmp(line1,"No",2)!=0)
-							{
-								dayofweek=(unsigned char)atoi(line1);
-								sat_db[y].dayofweek[entry]=dayofweek;
-							}
-							else
-								sat_db[y].dayofweek[entry]=0;
-						}
+void SweepConnections()
+{
+	/* This function closes the TCP connections that have
+	   outlived their deadlines.  It is run by any worker
+	   that finds a second has passed since the last sweep. */
 
-						fgets(line1,40,fd);
+	int x;
+	long long now;
 
-						if (match)
-						{
-							if (strncmp(line1,"No",2)!=0)
-								sscanf(line1,"%d, %d",&sat_db[y].phase_start[entry], &sat_db[y].phase_end[entry]);
-							else
-							{
-								sat_db[y].phase_start[entry]=0;
-								sat_db[y].phase_end[entry]=0;
-							}
+	now=Monotonic();
 
-							if (sat_db[y].uplink_start[entry]!=0.0 || sat_db[y].downlink_start[entry]!=0.0)
-								transponders++;
+	if (now<__atomic_load_n(&server_sweep,__ATOMIC_RELAXED) || pthread_mutex_trylock(&connection_lock))
+		return;
 
-							entry++;
-						}
-					}
-					fgets(line1,80,fd);
-				}
-				fgets(line1,80,fd);
+	__atomic_store_n(&server_sweep,now+1000000000LL,__ATOMIC_RELAXED);
 
-				if (match)
-					sat_db[y].transponders=transponders;
+	for (x=0; x<256; x++)
+		if (connection[x].fd!=-1 && connection[x].busy==0 && connection[x].deadline<now)
+			CloseConnection(&connection[x]);
 
-				entry=0;
-				transponders=0;
-			}
+	pthread_mutex_unlock(&connection_lock);
+}
 
-			fclose(fd);
-		}
+void AcceptConnection(sock)
+int sock;
+{
+	/* This function accepts a connection on listening
+	   socket "sock", if there is a free slot for it. */
+
+	int x, fd;
+
+	fd=accept(sock,NULL,NULL);
+
+	if (fd==-1)
+		return;
+
+	fcntl(fd,F_SETFL,O_NONBLOCK);
+
+	pthread_mutex_lock(&connection_lock);
+
+	for (x=0; x<256 && connection[x].fd!=-1; x++);
+
+	if (x==256)
+	{
+		pthread_mutex_unlock(&connection_lock);
+		close(fd);
+		return;
 	}
 
-	return flag;
+	connection[x].fd=fd;
+	connection[x].length=0;
+	connection[x].busy=0;
+	connection[x].deadline=Monotonic()+(long long)(1.0e9*server_idle);
+
+	/* The descriptor goes in the tag, so that an event
+	   for a connection since closed can be told apart */
+
+	Arm(fd,((unsigned long long)fd<<32)|(unsigned long long)x);
+
+	pthread_mutex_unlock(&connection_lock);
 }
 
-char CopyFile(source, destination)
-char *source;
-char *destination;
+void ServeConnection(x, fd)
+int x, fd;
 {
-	/* This function copies file "source" to file "destination"
-	   in 64k chunks.  The permissions on the destination file
-	   are set to rw-r--r--  (0644).  A 0 is returned if no
-	   errors are encountered.  A 1 indicates a problem writing
-	   to the destination file.  A 2 indicates a problem reading
-	   the source file.  */
+	/* This function reads what has arrived on TCP connection
+	   "x", and answers each complete request, one per line. */
 
-	int x, sd, dd;
-	char error=0, buffer[65536];
+	int n, y;
+	char buf[1024], closed=0;
+	client_t client;
+	connection_t *c;
 
-	sd=open(source,O_RDONLY);
+	c=&connection[x];
 
-	if (sd!=-1)
+	pthread_mutex_lock(&connection_lock);
+
+	if (c->fd!=fd)
 	{
-		dd=open(destination,O_WRONLY | O_CREAT| O_TRUNC, 0644);
+		pthread_mutex_unlock(&connection_lock);
+		return;
+	}
 
-		if (dd!=-1)
+	c->busy=1;
+	pthread_mutex_unlock(&connection_lock);
+
+	client.sock=fd;
+	client.tcp=1;
+	client.failed=0;
+
+	while (closed==0)
+	{
+		n=read(fd,c->request+c->length,sizeof(c->request)-1-c->length);
+
+		if (n==0 || (n==-1 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR))
+			closed=1;
+
+		if (n<=0)
+			break;
+
+		c->length+=n;
+		c->request[c->length]=0;
+
+		/* Answer each line received, and any request
+		   too long to fit the buffer as it stands */
+
+		while (c->length>0 && client.failed==0)
 		{
-			x=read(sd,&buffer,65536);
+			/* Binary requests are framed by the
+			   length given in their headers */
 
-			while (x)
+			if (c->length>=4 && GetInt((unsigned char *)c->request,4)==PREDICT_PROTO_MAGIC)
 			{
-				write(dd,&buffer,x);
-				x=read(sd,&buffer,65536);
-			}
+				if (c->length<PREDICT_HEADER_SIZE)
+					break;
 
-			close(dd);
-		}
-		else
-			error=1;
+				y=PREDICT_HEADER_SIZE+(int)GetInt((unsigned char *)c->request+12,4);
 
-		close(sd);
-	}
-	else
-		error+=2;
+				if (y>(int)sizeof(c->request)-1 || y<PREDICT_HEADER_SIZE)
+				{
+					client.failed=1;
+					break;
+				}
 
-	return error;
-}
+				if (y>c->length)
+					break;
 
-void SaveQTH()
-{
-	/* This function saves QTH data to the QTH data file. */
+				client.deadline=Monotonic()+(long long)(1.0e9*server_deadline);
+				HoldData('r');
+				ServeBinary(&client,(unsigned char *)c->request,y);
+				HoldData(0);
+				memmove(c->request,c->request+y,c->length-y);
+				c->length-=y;
+				continue;
+			}
 
-	FILE *fd;	
+			for (y=0; y<c->length && c->request[y]!='\n'; y++);
 
-	fd=fopen(qthfile,"w");
+			if (y==c->length && c->length<(int)sizeof(c->request)-1)
+				break;
 
-	fprintf(fd,"%s\n",qth.callsign);
-	fprintf(fd," %g\n",qth.stnlat);
-	fprintf(fd," %g\n",qth.stnlong);
-	fprintf(fd," %d\n",qth.stnalt);
+			memcpy(buf,c->request,y);
+			buf[y]=0;
 
-	fclose(fd);
-}
+			if (y<c->length)
+				y++;
 
-void SaveTLE()
-{
-	int x;
-	FILE *fd;
+			memmove(c->request,c->request+y,c->length-y);
+			c->length-=y;
 
- 	/* Save orbital data to tlefile */
+			if (buf[0]!=0 && buf[0]!='\r')
+			{
+				client.deadline=Monotonic()+(long long)(1.0e9*server_deadline);
+				HoldData('r');
+				ServeRequest(&client,buf);
+				HoldData(0);
+			}
+		}
 
-	fd=fopen(tlefile,"w");
+		if (client.failed)
+			closed=1;
+	}
 
-	for (x=0; x<24; x++)
-	{
-		/* Convert numeric orbital data to ASCII TLE format */
+	pthread_mutex_lock(&connection_lock);
 
-		Data2TLE(x);
+	if (closed)
+		CloseConnection(c);
 
-		/* Write name, line1, line2 to predict.tle */
+	else
+	{
+		/* A partial request must be completed by its
+		   deadline, and an idle connection reused */
 
-		fprintf(fd,"%s\n", sat[x].name);  
-		fprintf(fd,"%s\n", sat[x].line1);
-		fprintf(fd,"%s\n", sat[x].line2);
+		if (c->length>0)
+			c->deadline=Monotonic()+(long long)(1.0e9*server_deadline);
+		else
+			c->deadline=Monotonic()+(long long)(1.0e9*server_idle);
+
+		c->busy=0;
+		Arm(fd,((unsigned long long)fd<<32)|(unsigned long long)x);
 	}
 
-	fclose(fd);
+	pthread_mutex_unlock(&connection_lock);
 }
 
-int AutoUpdate(string)
-char *string;
+void *ServerWorker(arg)
+void *arg;
 {
-	/* This function updates PREDICT's orbital datafile from a NASA
-	   2-line element file either through a menu (interactive mode)
-	   or via the command line.  string==filename of 2-line element
-	   set if this function is invoked via the command line. */
-
-	char line1[80], line2[80], str0[80], str1[80], str2[80],
-	     filename[50], saveflag=0, interactive=0, savecount=0;
-
-	float database_epoch=0.0, tle_epoch=0.0, database_year, tle_year;
-	int i, success=0, kepcount=0;
-	FILE *fd;
+	/* This function is the body of each worker thread of
+	   the socket server.  It takes the next socket reported
+	   ready by server_epoll, reads a single request from it,
+	   and re-arms it before answering, so that any other
+	   requests waiting on it are taken by other workers. */
+
+	int x, n;
+	unsigned long long tag;
+	socklen_t alen;
+	char buf[1024];
+	client_t client;
+	struct epoll_event event;
 
-	do
+	while (1)
 	{
-		if (string[0]==0)
-		{
-			interactive=1;
-			curs_set(1);
-			bkgdset(COLOR_PAIR(3));
-			refresh();
-			clear();
-			echo();
+		n=epoll_wait(server_epoll,&event,1,1000);
 
-			for (i=5; i<8; i+=2)
-				mvprintw(i,19,"------------------------------------------");
+		SweepConnections();
 
-			mvprintw(6,19,"* Keplerian Database Auto Update Utility *");
-			bkgdset(COLOR_PAIR(2));
-			mvprintw(19,18,"Enter NASA Two-Line Element Source File Name");
-			mvprintw(13,18,"-=> ");
-			refresh();
-			wgetnstr(stdscr,filename,49);
-			clear();
-			curs_set(0);
-		}
-		else
-			strcpy(filename,string);
+		if (n!=1)
+			continue;
 
-		/* Prevent "." and ".." from being used as a
-		   filename, otherwise strange things happen. */
+		tag=event.data.u64;
+		x=(int)(tag&0xffff);
 
-		if (strlen(filename)==0 || strncmp(filename,".",1)==0 || strncmp(filename,"..",2)==0)
-			return 0;
+		if (tag&SERVER_UDP)
+		{
+			alen=sizeof(client.addr);
+			n=recvfrom(server_udp[x],buf,sizeof(buf)-1,MSG_DONTWAIT,(struct sockaddr *)&client.addr,&alen);
+			Arm(server_udp[x],tag);
 
-		fd=fopen(filename,"r");
+			if (n<0)
+				continue;
 
-		if (interactive && fd==NULL)
-		{
-			bkgdset(COLOR_PAIR(5));
-			clear();
-			move(12,0);
+			buf[n]=0;
+			client.sock=server_udp[x];
+			client.tcp=0;
+			client.failed=0;
+			client.deadline=Monotonic()+(long long)(1.0e9*server_deadline);
 
-			for (i=47; i>strlen(filename); i-=2)
-				printw(" ");
+			HoldData('r');
 
-			printw("*** ERROR: File \"%s\" not found! ***\n",filename);
-			beep();
-			attrset(COLOR_PAIR(7)|A_BOLD);
-			AnyKey();
+			if (n>=PREDICT_HEADER_SIZE && GetInt((unsigned char *)buf,4)==PREDICT_PROTO_MAGIC)
+				ServeBinary(&client,(unsigned char *)buf,n);
+			else
+				ServeRequest(&client,buf);
+
+			HoldData(0);
 		}
 
-		if (fd!=NULL)
+		else if (tag&SERVER_TCP)
 		{
-			success=1;
+			AcceptConnection(server_tcp[x]);
+			Arm(server_tcp[x],tag);
+		}
 
-			fgets(str0,75,fd);
-			fgets(str1,75,fd);
-			fgets(str2,75,fd);
-		
-			do
-			{
-				if (KepCheck(str1,str2))
-				{
-					/* We found a valid TLE!
-					   Copy strings str1 and
-					   str2 into line1 and line2 */
+		else
+			ServeConnection(x,(int)(tag>>32));
+	}
 
-					strncpy(line1,str1,75);
-					strncpy(line2,str2,75);
-					kepcount++;
+	return NULL;
+}
 
-					/* Scan for object number in datafile to see
-					   if this is something we're interested in */
+void socket_server(predict_name)
+char *predict_name;
+{
+	/* This is the socket server code.  It opens the
+	   sockets of each worker, starts the workers, and
+	   then serves as the first of them. */
 
-					for (i=0; (i<24 && sat[i].catnum!=atol(SubString(line1,2,6))); i++);
+	int x;
+	long n;
+	pthread_t thread;
 
-					if (i!=24)
-					{
-						/* We found it!  Check to see if it's more
-						   recent than the data we already have. */
+	/* Open a socket port at "predict" or netport if defined */
 
-						if (sat[i].year<57)
-							database_year=365.25*(100.0+(float)sat[i].year);
-						else
-							database_year=365.25*(float)sat[i].year;
+	if (netport[0]==0)
+		strncpy(netport,"predict",7);
 
-						database_epoch=(float)sat[i].refepoch+database_year;
+	n=sysconf(_SC_NPROCESSORS_ONLN);
 
-						tle_year=(float)atof(SubString(line1,18,19));
+	if (n<2)
+		n=2;
+
+	if (n>16)
+		n=16;
+
+	server_workers=(int)n;
+	server_epoll=epoll_create1(0);
+
+	for (x=0; x<256; x++)
+		connection[x].fd=-1;
+
+	for (x=0; x<server_workers; x++)
+	{
+		server_udp[x]=passivesock(netport,"udp",10);
+		server_tcp[x]=passivesock(netport,"tcp",64);
+		fcntl(server_tcp[x],F_SETFL,O_NONBLOCK);
+		Arm(server_udp[x],SERVER_UDP|x);
+		Arm(server_tcp[x],SERVER_TCP|x);
+	}
+
+	for (x=1; x<server_workers; x++)
+	{
+		pthread_create(&thread,NULL,ServerWorker,NULL);
+		pthread_detach(thread);
+	}
+
+	ServerWorker(NULL);
+}
+
+void Banner()
+{
+	curs_set(0);
+	bkgdset(COLOR_PAIR(3));
+	clear();
+	refresh();
+
+	attrset(COLOR_PAIR(6)|A_REVERSE|A_BOLD);
+	mvprintw(3,18,"                                           ");
+	mvprintw(4,18,"         --== PREDICT  v%s ==--         ",version);
+	mvprintw(5,18,"   Released by John A. Magliacane, KD2BD   ");
+	mvprintw(6,18,"                  May 2018                 ");
+	mvprintw(7,18,"                                           ");
+}
+
+int GetKey()
+{
+	/* This function reads a key from the keyboard, letting
+	   go of data_lock while it waits, so that the tracking
+	   engine can reload the data files in the meantime. */
+
+	int key;
+	char mode;
+
+	mode=data_hold;
+	HoldData(0);
+	key=getch();
+	HoldData(mode);
+
+	return key;
+}
+
+void GetString(string, size)
+char *string;
+int size;
+{
+	/* The same, for a string of up to "size" characters */
+
+	char mode;
+
+	mode=data_hold;
+	HoldData(0);
+	wgetnstr(stdscr,string,size);
+	HoldData(mode);
+}
+
+void AnyKey()
+{
+	mvprintw(23,24,"<< Press Any Key To Continue >>");
+	refresh();
+	GetKey();
+}
+
+double FixAngle(x)
+double x;
+{
+	/* This function reduces angles greater than
+	   two pi by subtracting two pi from the angle */
+
+	while (x>twopi)
+		x-=twopi;
+
+	return x;
+}
+
+double PrimeAngle(x)
+double x;
+{
+	/* This function is used in the FindMoon() function. */
+
+	x=x-360.0*floor(x/360.0);
+	return x;
+}
+
+char *SubString(string,start,end)
+char *string, start, end;
+{
+	/* This function returns a substring based on the starting
+	   and ending positions provided.  It is used heavily in
+	   the AutoUpdate function when parsing 2-line element data. */
+
+	unsigned x, y;
+
+	if (end>=start)
+	{
+		for (x=start, y=0; x<=end && string[x]!=0; x++)
+			if (string[x]!=' ')
+			{
+				temp[y]=string[x];
+				y++;
+			}
+
+		temp[y]=0;
+		return temp;
+	}
+	else
+		return NULL;
+}
+
+void CopyString(source, destination, start, end)
+char *source, *destination, start, end;
+{
+	/* This function copies elements of the string "source"
+	   bounded by "start" and "end" into the string "destination". */
+
+	unsigned j, k=0;
+
+	for (j=start; j<=end; j++)
+		if (source[k]!=0)
+		{
+			destination[j]=source[k];
+			k++;
+		}
+}
+
+char *Abbreviate(string,n)
+char *string;
+int n;
+{
+	/* This function returns an abbreviated substring of the original,
+	   including a '~' character if a non-blank character is chopped
+	   out of the generated substring.  n is the length of the desired
+	   substring.  It is used for abbreviating satellite names. */
+
+	strncpy(temp,string,79);
+
+	if (temp[n]!=0 && temp[n]!=32)
+	{
+		temp[n-2]='~';
+		temp[n-1]=temp[strlen(temp)-1];
+	}
+
+	temp[n]=0;
+
+	return temp;
+}
+
+char KepCheck(line1,line2)
+char *line1, *line2;
+{
+	/* This function scans line 1 and line 2 of a NASA 2-Line element
+	   set and returns a 1 if the element set appears to be valid or
+	   a 0 if it does not.  If the data survives this torture test,
+	   it's a pretty safe bet we're looking at a valid 2-line
+	   element set and not just some random text that might pass
+	   as orbital data based on a simple checksum calculation alone. */
+
+	int x;
+	unsigned sum1, sum2;
+
+	/* Compute checksum for each line */
+
+	for (x=0, sum1=0, sum2=0; x<=67; sum1+=val[(int)line1[x]], sum2+=val[(int)line2[x]], x++);
+
+	/* Perform a "torture test" on the data */
+
+	x=(val[(int)line1[68]]^(sum1%10)) | (val[(int)line2[68]]^(sum2%10)) |
+	  (line1[0]^'1')  | (line1[1]^' ')  | (line1[7]^'U')  |
+	  (line1[8]^' ')  | (line1[17]^' ') | (line1[23]^'.') |
+	  (line1[32]^' ') | (line1[34]^'.') | (line1[43]^' ') |
+	  (line1[52]^' ') | (line1[61]^' ') | (line1[62]^'0') |
+	  (line1[63]^' ') | (line2[0]^'2')  | (line2[1]^' ')  |
+	  (line2[7]^' ')  | (line2[11]^'.') | (line2[16]^' ') |
+	  (line2[20]^'.') | (line2[25]^' ') | (line2[33]^' ') |
+	  (line2[37]^'.') | (line2[42]^' ') | (line2[46]^'.') |
+	  (line2[51]^' ') | (line2[54]^'.') | (line1[2]^line2[2]) |
+	  (line1[3]^line2[3]) | (line1[4]^line2[4]) |
+	  (line1[5]^line2[5]) | (line1[6]^line2[6]) |
+	  (isdigit(line1[68]) ? 0 : 1) | (isdigit(line2[68]) ? 0 : 1) |
+	  (isdigit(line1[18]) ? 0 : 1) | (isdigit(line1[19]) ? 0 : 1) |
+	  (isdigit(line2[31]) ? 0 : 1) | (isdigit(line2[32]) ? 0 : 1);
+
+	return (x ? 0 : 1);
+}
+
+void InternalUpdate(x)
+int x;
+{
+	/* Updates data in TLE structure based on
+	   line1 and line2 stored in structure. */
+
+	double tempnum;
+
+	tle_id++;
+
+	strncpy(sat[x].designator,SubString(sat[x].line1,9,16),8);
+	sat[x].designator[9]=0;
+	sat[x].catnum=atol(SubString(sat[x].line1,2,6));
+	sat[x].year=atoi(SubString(sat[x].line1,18,19));
+	sat[x].refepoch=atof(SubString(sat[x].line1,20,31));
+	tempnum=1.0e-5*atof(SubString(sat[x].line1,44,49));
+	sat[x].nddot6=tempnum/pow(10.0,(sat[x].line1[51]-'0'));
+	tempnum=1.0e-5*atof(SubString(sat[x].line1,53,58));
+	sat[x].bstar=tempnum/pow(10.0,(sat[x].line1[60]-'0'));
+	sat[x].setnum=atol(SubString(sat[x].line1,64,67));
+	sat[x].incl=atof(SubString(sat[x].line2,8,15));
+	sat[x].raan=atof(SubString(sat[x].line2,17,24));
+	sat[x].eccn=1.0e-07*atof(SubString(sat[x].line2,26,32));
+	sat[x].argper=atof(SubString(sat[x].line2,34,41));
+	sat[x].meanan=atof(SubString(sat[x].line2,43,50));
+	sat[x].meanmo=atof(SubString(sat[x].line2,52,62));
+	sat[x].drag=atof(SubString(sat[x].line1,33,42));
+	sat[x].orbitnum=atof(SubString(sat[x].line2,63,67));
+}
+
+char *noradEvalue(value)
+double value;
+{
+	/* Converts numeric values to E notation used in NORAD TLEs */
+
+	char string[15];
+
+	sprintf(string,"%11.4e",value*10.0);
+
+	output[0]=string[0];
+	output[1]=string[1];
+	output[2]=string[3];
+	output[3]=string[4];
+	output[4]=string[5];
+	output[5]=string[6];
+	output[6]='-';
+	output[7]=string[10];
+	output[8]=0;
+
+	return output;
+}
+
+void Data2TLE(x)
+int x;
+{
+	/* This function converts orbital data held in the numeric
+	   portion of the sat tle structure to ASCII TLE format,
+	   and places the result in ASCII portion of the structure. */
+ 
+	int i;
+	char string[15], line1[70], line2[70];
+	unsigned sum;
+
+	/* Fill lines with blanks */
+
+	for (i=0; i<70; line1[i]=32, line2[i]=32, i++);
+
+	line1[69]=0;
+	line2[69]=0;
+
+	/* Insert static characters */
+
+	line1[0]='1';
+	line1[7]='U'; /* Unclassified */
+	line2[0]='2';
+
+	line1[62]='0'; /* For publically released TLEs */
+
+	/* Insert orbital data */
+
+	sprintf(string,"%05ld",sat[x].catnum);
+	CopyString(string,line1,2,6);
+	CopyString(string,line2,2,6);
+
+	CopyString(sat[x].designator,line1,9,16);
+
+	sprintf(string,"%02d",sat[x].year);
+	CopyString(string,line1,18,19);
+
+	sprintf(string,"%12.8f",sat[x].refepoch);
+	CopyString(string,line1,20,32);
+
+	sprintf(string,"%.9f",fabs(sat[x].drag));
+
+	CopyString(string,line1,33,42);
+
+	if (sat[x].drag<0.0)
+		line1[33]='-';
+	else
+		line1[33]=32;
+
+	CopyString(noradEvalue(sat[x].nddot6),line1,44,51);
+	CopyString(noradEvalue(sat[x].bstar),line1,53,60);
+
+	sprintf(string,"%4lu",sat[x].setnum);
+	CopyString(string,line1,64,67);
+
+	sprintf(string,"%9.4f",sat[x].incl);
+	CopyString(string,line2,7,15);
+				
+	sprintf(string,"%9.4f",sat[x].raan);
+	CopyString(string,line2,16,24);
+
+	sprintf(string,"%13.12f",sat[x].eccn);
+	
+	/* Erase eccentricity's decimal point */
+
+	for (i=2; i<=9; string[i-2]=string[i], i++);
+
+	CopyString(string,line2,26,32);
+
+	sprintf(string,"%9.4f",sat[x].argper);
+	CopyString(string,line2,33,41);
+
+	sprintf(string,"%9.5f",sat[x].meanan);
+	CopyString(string,line2,43,50);
+
+	sprintf(string,"%12.9f",sat[x].meanmo);
+	CopyString(string,line2,52,62);
+
+	sprintf(string,"%5lu",sat[x].orbitnum);
+	CopyString(string,line2,63,67);
+
+	/* Compute and insert checksum for line 1 and line 2 */
+
+	for (i=0, sum=0; i<=67; sum+=val[(int)line1[i]], i++);
+
+	line1[68]=(sum%10)+'0';
+
+	for (i=0, sum=0; i<=67; sum+=val[(int)line2[i]], i++);
+
+	line2[68]=(sum%10)+'0';
+
+	line1[69]=0;
+	line2[69]=0;
+
+	strcpy(sat[x].line1,line1);
+	strcpy(sat[x].line2,line2);
+}
+
+double ReadBearing(input)
+char *input;
+{
+	/* This function takes numeric input in the form of a character
+	   string, and returns an equivalent bearing in degrees as a
+	   decimal number (double).  The input may either be expressed
+	   in decimal format (74.2467) or degree, minute, second
+	   format (74 14 48).  This function also safely handles
+	   extra spaces found either leading, trailing, or
+	   embedded within the numbers expressed in the
+	   input string.  Decimal seconds are permitted. */
+ 
+	char string[20];
+	double bearing=0.0, seconds;
+	int a, b, length, degrees, minutes;
+
+	/* Copy "input" to "string", and ignore any extra
+	   spaces that might be present in the process. */
+
+	string[0]=0;
+	length=strlen(input);
+
+	for (a=0, b=0; a<length && a<18; a++)
+	{
+		if ((input[a]!=32 && input[a]!='\n') || (input[a]==32 && input[a+1]!=32 && b!=0))
+		{
+			string[b]=input[a];
+			b++;
+		}	 
+	}
+
+	string[b]=0;
+
+	/* Count number of spaces in the clean string. */
+
+	length=strlen(string);
+
+	for (a=0, b=0; a<length; a++)
+		if (string[a]==32)
+			b++;
+
+	if (b==0)  /* Decimal Format (74.2467) */
+		sscanf(string,"%lf",&bearing);
+
+	if (b==2)  /* Degree, Minute, Second Format (74 14 48) */
+	{
+		sscanf(string,"%d %d %lf",&degrees, &minutes, &seconds);
+
+		if (degrees<0.0)
+		{
+			minutes=-minutes;
+			seconds=-seconds;
+		}
+
+		bearing=(double)degrees+((double)minutes/60)+(seconds/3600);
+	}
+
+	/* Bizarre results return a 0.0 */
+
+	if (bearing>360.0 || bearing<-360.0)
+		bearing=0.0;
+
+	return bearing;
+}
+
+double Horizon(azimuth)
+double azimuth;
+{
+	/* This function returns the elevation of the horizon
+	   mask at "azimuth" (degrees) by linear interpolation
+	   between the whole degrees of the mask table. */
+
+	int x;
+
+	if (horizon_min==horizon_max)
+		return horizon_min;
+
+	x=(int)azimuth;
+
+	if (x<0)
+		x=0;
+
+	if (x>359)
+		x=359;
+
+	return (horizon[x]+(horizon[x+1]-horizon[x])*(azimuth-x));
+}
+
+void ReadHorizon(file, mask)
+char *file;
+double *mask;
+{
+	/* This function reads the horizon mask from "file".  Each
+	   line holds either an azimuth and the elevation of the
+	   terrain in that direction (both in degrees), or a single
+	   minimum elevation that applies in every direction.  The
+	   terrain is interpolated linearly between the azimuths
+	   given, and wraps around through north.  The mask is the
+	   higher of the terrain and the minimum elevation.  If the
+	   file can't be read, the mask is the true horizon (0).
+	   The mask is returned in "mask", for SetHorizon(). */
+
+	int x, y, z, n=0;
+	double azim[360], elev[360], floor_el=-90.0, a, e, span;
+	char line[80];
+	FILE *fd;
+
+	fd=fopen(file,"r");
+
+	if (fd!=NULL)
+	{
+		while (fgets(line,80,fd)!=NULL)
+		{
+			x=sscanf(line,"%lf%*[ ,\t]%lf",&a,&e);
+
+			if (x==1 && a>floor_el)
+				floor_el=a;
+
+			if (x==2 && n<360)
+			{
+				a=fmod(a,360.0);
+
+				if (a<0.0)
+					a+=360.0;
+
+				/* Keep the points sorted by azimuth */
+
+				for (y=n; y>0 && azim[y-1]>a; y--)
+				{
+					azim[y]=azim[y-1];
+					elev[y]=elev[y-1];
+				}
+
+				azim[y]=a;
+				elev[y]=e;
+				n++;
+			}
+		}
+
+		fclose(fd);
+	}
+
+	for (x=0; x<360; x++)
+	{
+		if (n==0)
+			mask[x]=(floor_el>-90.0 ? floor_el : 0.0);
+
+		else
+		{
+			/* Find the points on either side of azimuth x */
+
+			for (y=0; y<n && azim[y]<=x; y++);
+
+			z=(y+n-1)%n;
+			y=y%n;
+
+			span=azim[y]-azim[z];
+
+			if (span<=0.0)
+				span+=360.0;
+
+			a=x-azim[z];
+
+			if (a<0.0)
+				a+=360.0;
+
+			mask[x]=elev[z]+(elev[y]-elev[z])*a/span;
+		}
+
+		if (mask[x]<floor_el)
+			mask[x]=floor_el;
+	}
+
+	mask[360]=mask[0];
+}
+
+void SetHorizon(mask)
+double *mask;
+{
+	/* This function makes "mask" the horizon mask in use. */
+
+	int x;
+
+	if (memcmp(mask,horizon,sizeof(horizon))!=0)
+	{
+		memcpy(horizon,mask,sizeof(horizon));
+		horizon_id++;
+	}
+
+	horizon_min=horizon[0];
+	horizon_max=horizon[0];
+
+	for (x=1; x<360; x++)
+	{
+		if (horizon[x]<horizon_min)
+			horizon_min=horizon[x];
+
+		if (horizon[x]>horizon_max)
+			horizon_max=horizon[x];
+	}
+}
+
+char ReadDataFiles()
+{
+	/* This function reads "predict.qth", "predict.tle",
+	   and (optionally) "predict.db" files into memory.
+  	   Return values are as follows:
+
+	   0: Neither the qth nor the tle files were loaded
+	   1: Only the qth file was loaded
+	   2: Only the tle file was loaded
+	   3: The qth and tle files were loaded successfully
+
+	   The files are loaded into the new_ copies of the data,
+	   which are published together once they have been read. */
+
+	FILE *fd;
+	long catnum, catnums[24];
+	unsigned char dayofweek;
+	int x=0, y, entry=0, max_entries=10, transponders=0;
+	char flag=0, db=0, match, mode, name[80], line1[80], line2[80];
+
+	mode=data_hold;
+	HoldData('r');
+
+	for (y=0; y<24; y++)
+		catnums[y]=sat[y].catnum;
+
+	HoldData(mode);
+
+	fd=fopen(qthfile,"r");
+	
+	if (fd!=NULL)
+	{
+		fgets(new_qth.callsign,16,fd);
+		new_qth.callsign[strlen(new_qth.callsign)-1]=0;
+		fscanf(fd,"%lf", &new_qth.stnlat);
+		fscanf(fd,"%lf", &new_qth.stnlong);
+		fscanf(fd,"%d", &new_qth.stnalt);
+		fclose(fd);
+
+		new_obs.lat=new_qth.stnlat*deg2rad;
+		new_obs.lon=-new_qth.stnlong*deg2rad;
+		new_obs.alt=((double)new_qth.stnalt)/1000.0;
+		new_obs.theta=0.0;
+
+		ReadHorizon(hznfile,new_horizon);
+
+		flag=1;
+	}
+
+	fd=fopen(tlefile,"r");
+
+	if (fd!=NULL)
+	{
+		while (x<24 && feof(fd)==0)
+		{
+			/* Initialize variables */
+
+			name[0]=0;
+			line1[0]=0;
+			line2[0]=0;
+
+			/* Read element set */
+
+			fgets(name,75,fd);
+			fgets(line1,75,fd);
+			fgets(line2,75,fd);
+
+			if (KepCheck(line1,line2) && (feof(fd)==0))
+			{
+				/* We found a valid TLE! */
+
+				/* Some TLE sources left justify the sat
+				   name in a 24-byte field that is padded
+				   with blanks.  The following lines cut
+				   out the blanks as well as the line feed
+				   character read by the fgets() function. */
+ 
+				y=strlen(name);
+
+				while (name[y]==32 || name[y]==0 || name[y]==10 || name[y]==13 || y==0)
+				{
+					name[y]=0;
+					y--;
+				}
+				
+				/* Copy TLE data into the sat data structure */
+
+				strncpy(new_sat[x].name,name,24);
+				strncpy(new_sat[x].line1,line1,69);
+				strncpy(new_sat[x].line2,line2,69);
+
+				catnums[x]=atol(SubString(line1,2,6));
+
+				x++;
+			}
+		}
+
+		fclose(fd);
+		flag+=2;
+
+		/* Load satellite database file */
+
+		fd=fopen(dbfile,"r");
+
+		if (fd!=NULL)
+		{
+			db=1;
+			memset(new_sat_db,0,sizeof(new_sat_db));
+
+			fgets(line1,40,fd);
+
+			while (strncmp(line1,"end",3)!=0 && line1[0]!='\n' && feof(fd)==0)
+			{
+				/* The first line is the satellite
+				   name which is ignored here. */
+
+				fgets(line1,40,fd);
+				sscanf(line1,"%ld",&catnum);
+
+				/* Search for match */
+
+				for (y=0, match=0; y<24 && match==0; y++)
+				{
+					if (catnum==catnums[y])
+						match=1;
+				}
+
+				if (match)
+				{
+					transponders=0;
+					entry=0;
+					y--;
+				}
+
+				fgets(line1,40,fd);
+
+				if (match)
+				{
+					if (strncmp(line1,"No",2)!=0)
+					{
+						sscanf(line1,"%lf, %lf",&new_sat_db[y].alat, &new_sat_db[y].alon);
+						new_sat_db[y].squintflag=1;
+					}
+
+					else
+						new_sat_db[y].squintflag=0;
+				}
+
+				fgets(line1,80,fd);
+
+				while (strncmp(line1,"end",3)!=0 && line1[0]!='\n' && feof(fd)==0)
+				{
+					if (entry<max_entries)
+					{
+						if (match)
+						{
+							if (strncmp(line1,"No",2)!=0)
+							{
+								line1[strlen(line1)-1]=0;
+								strcpy(new_sat_db[y].transponder_name[entry],line1);
+							}
+							else
+								new_sat_db[y].transponder_name[entry][0]=0;
+						}
+
+						fgets(line1,40,fd);
+
+						if (match)
+							sscanf(line1,"%lf, %lf", &new_sat_db[y].uplink_start[entry], &new_sat_db[y].uplink_end[entry]);
+
+						fgets(line1,40,fd);
+
+						if (match)
+							sscanf(line1,"%lf, %lf", &new_sat_db[y].downlink_start[entry], &new_sat_db[y].downlink_end[entry]);
+
+						fgets(line1,40,fd);
+
+						if (match)
+						{
+							if (strncmp(line1,"No",2)!=0)
+							{
+								dayofweek=(unsigned char)atoi(line1);
+								new_sat_db[y].dayofweek[entry]=dayofweek;
+							}
+							else
+								new_sat_db[y].dayofweek[entry]=0;
+						}
+
+						fgets(line1,40,fd);
+
+						if (match)
+						{
+							if (strncmp(line1,"No",2)!=0)
+								sscanf(line1,"%d, %d",&new_sat_db[y].phase_start[entry], &new_sat_db[y].phase_end[entry]);
+							else
+							{
+								new_sat_db[y].phase_start[entry]=0;
+								new_sat_db[y].phase_end[entry]=0;
+							}
+
+							if (new_sat_db[y].uplink_start[entry]!=0.0 || new_sat_db[y].downlink_start[entry]!=0.0)
+								transponders++;
+
+							entry++;
+						}
+					}
+					fgets(line1,80,fd);
+				}
+				fgets(line1,80,fd);
+
+				if (match)
+					new_sat_db[y].transponders=transponders;
+
+				entry=0;
+				transponders=0;
+			}
+
+			fclose(fd);
+		}
+	}
+
+	/* Publish the new data */
+
+	HoldData('w');
+
+	if (flag&1)
+	{
+		qth=new_qth;
+		obs_geodetic=new_obs;
+		SetHorizon(new_horizon);
+	}
+
+	if (flag&2)
+	{
+		for (y=0; y<x; y++)
+		{
+			strncpy(sat[y].name,new_sat[y].name,24);
+			strncpy(sat[y].line1,new_sat[y].line1,69);
+			strncpy(sat[y].line2,new_sat[y].line2,69);
+
+			/* Update individual parameters */
+
+			InternalUpdate(y);
+		}
+
+		if (db)
+		{
+			memcpy(sat_db,new_sat_db,sizeof(sat_db));
+			database=1;
+		}
+
+		resave=0;
+	}
+
+	HoldData(mode);
+
+	return flag;
+}
+
+char CopyFile(source, destination)
+char *source;
+char *destination;
+{
+	/* This function copies file "source" to file "destination"
+	   in 64k chunks.  The permissions on the destination file
+	   are set to rw-r--r--  (0644).  A 0 is returned if no
+	   errors are encountered.  A 1 indicates a problem writing
+	   to the destination file.  A 2 indicates a problem reading
+	   the source file.  */
+
+	int x, sd, dd;
+	char error=0, buffer[65536];
+
+	sd=open(source,O_RDONLY);
+
+	if (sd!=-1)
+	{
+		dd=open(destination,O_WRONLY | O_CREAT| O_TRUNC, 0644);
+
+		if (dd!=-1)
+		{
+			x=read(sd,&buffer,65536);
+
+			while (x)
+			{
+				write(dd,&buffer,x);
+				x=read(sd,&buffer,65536);
+			}
+
+			close(dd);
+		}
+		else
+			error=1;
+
+		close(sd);
+	}
+	else
+		error+=2;
+
+	return error;
+}
+
+void SaveQTH()
+{
+	/* This function saves QTH data to the QTH data file. */
+
+	FILE *fd;	
+
+	fd=fopen(qthfile,"w");
+
+	fprintf(fd,"%s\n",qth.callsign);
+	fprintf(fd," %g\n",qth.stnlat);
+	fprintf(fd," %g\n",qth.stnlong);
+	fprintf(fd," %d\n",qth.stnalt);
+
+	fclose(fd);
+}
+
+void SaveTLE()
+{
+	int x;
+	FILE *fd;
+
+ 	/* Save orbital data to tlefile */
+
+	fd=fopen(tlefile,"w");
+
+	for (x=0; x<24; x++)
+	{
+		/* Convert numeric orbital data to ASCII TLE format */
+
+		Data2TLE(x);
+
+		/* Write name, line1, line2 to predict.tle */
+
+		fprintf(fd,"%s\n", sat[x].name);  
+		fprintf(fd,"%s\n", sat[x].line1);
+		fprintf(fd,"%s\n", sat[x].line2);
+	}
+
+	fclose(fd);
+}
+
+int AutoUpdate(string)
+char *string;
+{
+	/* This function updates PREDICT's orbital datafile from a NASA
+	   2-line element file either through a menu (interactive mode)
+	   or via the command line.  string==filename of 2-line element
+	   set if this function is invoked via the command line. */
+
+	char line1[80], line2[80], str0[80], str1[80], str2[80],
+	     filename[50], saveflag=0, interactive=0, savecount=0, mode;
+
+	float database_epoch=0.0, tle_epoch=0.0, database_year, tle_year;
+	int i, success=0, kepcount=0;
+	FILE *fd;
+
+	do
+	{
+		if (string[0]==0)
+		{
+			interactive=1;
+			curs_set(1);
+			bkgdset(COLOR_PAIR(3));
+			refresh();
+			clear();
+			echo();
+
+			for (i=5; i<8; i+=2)
+				mvprintw(i,19,"------------------------------------------");
+
+			mvprintw(6,19,"* Keplerian Database Auto Update Utility *");
+			bkgdset(COLOR_PAIR(2));
+			mvprintw(19,18,"Enter NASA Two-Line Element Source File Name");
+			mvprintw(13,18,"-=> ");
+			refresh();
+			GetString(filename,49);
+			clear();
+			curs_set(0);
+		}
+		else
+			strcpy(filename,string);
+
+		/* Prevent "." and ".." from being used as a
+		   filename, otherwise strange things happen. */
+
+		if (strlen(filename)==0 || strncmp(filename,".",1)==0 || strncmp(filename,"..",2)==0)
+			return 0;
+
+		fd=fopen(filename,"r");
+
+		if (interactive && fd==NULL)
+		{
+			bkgdset(COLOR_PAIR(5));
+			clear();
+			move(12,0);
+
+			for (i=47; i>strlen(filename); i-=2)
+				printw(" ");
+
+			printw("*** ERROR: File \"%s\" not found! ***\n",filename);
+			beep();
+			attrset(COLOR_PAIR(7)|A_BOLD);
+			AnyKey();
+		}
+
+		if (fd!=NULL)
+		{
+			success=1;
+
+			fgets(str0,75,fd);
+			fgets(str1,75,fd);
+			fgets(str2,75,fd);
+		
+			do
+			{
+				if (KepCheck(str1,str2))
+				{
+					/* We found a valid TLE!
+					   Copy strings str1 and
+					   str2 into line1 and line2 */
+
+					strncpy(line1,str1,75);
+					strncpy(line2,str2,75);
+					kepcount++;
+
+					/* Scan for object number in datafile to see
+					   if this is something we're interested in */
+
+					for (i=0; (i<24 && sat[i].catnum!=atol(SubString(line1,2,6))); i++);
+
+					if (i!=24)
+					{
+						/* We found it!  Check to see if it's more
+						   recent than the data we already have. */
+
+						if (sat[i].year<57)
+							database_year=365.25*(100.0+(float)sat[i].year);
+						else
+							database_year=365.25*(float)sat[i].year;
+
+						database_epoch=(float)sat[i].refepoch+database_year;
+
+						tle_year=(float)atof(SubString(line1,18,19));
 
 						if (tle_year<57.0)
 							tle_year+=100.0;
 
-						tle_epoch=(float)atof(SubString(line1,20,31))+(tle_year*365.25);
+						tle_epoch=(float)atof(SubString(line1,20,31))+(tle_year*365.25);
+
+						/* Update only if TLE epoch >= epoch in data file
+						   so we don't overwrite current data with older
+						   data. */
+
+						if (tle_epoch>=database_epoch)
+						{
+							if (saveflag==0)
+							{
+								if (interactive)
+								{
+									clear();
+									bkgdset(COLOR_PAIR(2));
+									mvprintw(3,35,"Updating.....");
+									refresh();
+									move(7,0);
+								}
+								saveflag=1;
+							}
+
+							if (interactive)
+							{
+								bkgdset(COLOR_PAIR(3));
+								printw("     %-15s",sat[i].name);
+							}
+
+							savecount++;
+
+							/* Copy TLE data into the sat data structure */
+
+							mode=data_hold;
+							HoldData('w');
+							strncpy(sat[i].line1,line1,69);
+							strncpy(sat[i].line2,line2,69);
+							InternalUpdate(i);
+							HoldData(mode);
+						}
+					}
+
+					 fgets(str0,75,fd);     	
+					 fgets(str1,75,fd);
+					 fgets(str2,75,fd);
+				}
+
+				else
+				{
+					strcpy(str0,str1);   
+					strcpy(str1,str2);   
+					fgets(str2,75,fd);
+				}
+			
+			} while (feof(fd)==0);
+
+			fclose(fd);
+
+			if (interactive)
+			{
+				bkgdset(COLOR_PAIR(2));
+
+				if (kepcount==1)
+					mvprintw(18,21,"  Only 1 NASA Two Line Element was found.");
+				else
+					mvprintw(18,21,"%3u NASA Two Line Elements were read.",kepcount);
+
+				if (saveflag)
+				{
+					if (savecount==1)
+						mvprintw(19,21,"  Only 1 satellite was updated.");
+					else
+					{
+						if (savecount==24)
+							mvprintw(19,21,"  All satellites were updated!");
+						else
+							mvprintw(19,21,"%3u out of 24 satellites were updated.",savecount);
+					}
+				}
+
+				refresh();
+			}
+		}
+
+		if (interactive)
+		{
+			noecho();
+
+			if (strlen(filename) && fd!=NULL) 
+			{
+				attrset(COLOR_PAIR(4)|A_BOLD);
+				AnyKey();
+			}
+		}
+
+		if (saveflag)
+			SaveTLE();
+	}
+	while (success==0 && interactive);
+
+	return (saveflag ? 0 : -1);
+}
+
+int Select()
+{
+	/* This function displays the names of satellites contained
+	   within the program's database and returns an index that
+	   corresponds to the satellite selected by the user.  An
+	   ESC or CR returns a -1. */
+
+	int x, y, z, key=0;
+
+	clear();
+
+	bkgdset(COLOR_PAIR(2)|A_BOLD);
+	printw("\n\n\t\t\t      Select a Satellite:\n\n");
+
+	attrset(COLOR_PAIR(3)|A_BOLD);
+
+	for (x=0, y=8, z=16; y<16; ++x, ++y, ++z)
+	{
+		printw("\n\t[%c]: %-15s", x+'A', Abbreviate(sat[x].name,15));
+		printw("\t[%c]: %-15s", y+'A', Abbreviate(sat[y].name,15));
+		printw("\t[%c]: %-15s\n", z+'A', Abbreviate(sat[z].name,15));
+	}
+
+	attrset(COLOR_PAIR(4)|A_BOLD);
+
+	printw("\n\n\t\t<< Enter Selection  -  Press [ESC] To Exit >>");
+	refresh();
+
+	do
+	{
+		key=toupper(GetKey());
+
+		if (key==27 || key=='\n')
+			return -1;
+
+	} while (key<'A' || key>'X');
+
+	return(key-'A');
+}
+
+long DayNum(m,d,y)
+int  m, d, y;
+{
+	/* This function calculates the day number from m/d/y. */
+
+	long dn;
+	double mm, yy;
+
+	if (m<3)
+	{ 
+		y--; 
+		m+=12; 
+	}
+
+	if (y<57)
+		y+=100;
+
+	yy=(double)y;
+	mm=(double)m;
+	dn=(long)(floor(365.25*(yy-80.0))-floor(19.0+yy/100.0)+floor(4.75+yy/400.0)-16.0);
+	dn+=d+30*m+(long)floor(0.6*mm-0.3);
+	return dn;
+}
+
+double CurrentDaynum()
+{
+	/* Read the simulation clock and return the number
+	   of days since 31Dec79 00:00:00 UTC (daynum 0).
+	   Whole days are separated from the fraction of the
+	   day in integer arithmetic, so that no precision is
+	   lost to the size of the number of seconds. */
+
+	long long ns;
+
+	ns=ClockNow()-3651LL*NS_PER_DAY;
+
+	return ((double)(ns/NS_PER_DAY)+(double)(ns%NS_PER_DAY)/(double)NS_PER_DAY);
+}
+
+char *Daynum2String(daynum)
+double daynum;
+{
+	/* This function takes the given epoch as a fractional number of
+	   days since 31Dec79 00:00:00 UTC and returns the corresponding
+	   date as a string of the form "Tue 12Oct99 17:22:37". */
+
+	char timestr[26];
+	time_t t;
+	struct tm tm;
+	int x;
+
+	/* Convert daynum to Unix time (seconds since 01-Jan-70) */
+	t=(time_t)(86400.0*(daynum+3651.0));
+
+	asctime_r(gmtime_r(&t,&tm),timestr);
+
+	if (timestr[8]==' ')
+		timestr[8]='0';
+
+	for (x=0; x<=3; output[x]=timestr[x], x++);
+
+	output[4]=timestr[8];
+	output[5]=timestr[9];
+	output[6]=timestr[4];
+	output[7]=timestr[5];
+	output[8]=timestr[6];
+	output[9]=timestr[22];
+	output[10]=timestr[23];
+	output[11]=' ';
+
+	for (x=12; x<=19; output[x]=timestr[x-1], x++);
+
+	output[20]=0;
+	return output;
+}
+
+double GetStartTime(mode)
+char mode;
+{
+	/* This function prompts the user for the time and date
+	   the user wishes to begin prediction calculations,
+	   and returns the corresponding fractional day number.
+	   31Dec79 00:00:00 returns 0.  Default is NOW. */
+
+	int	x, hr, min, sec ,mm=0, dd=0, yy; 
+	char	good, mon[5], line[30], string[30], bozo_count=0,
+		*month[12]= {"Jan", "Feb", "Mar", "Apr", "May",
+		"Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+	do
+	{
+		bkgdset(COLOR_PAIR(2)|A_BOLD);
+		clear();
+
+		if (mode=='m')
+			printw("\n\n\n\t     Starting UTC Date and Time for Predictions of the Moon\n\n");
+
+		if (mode=='o')
+			printw("\n\n\n\t     Starting UTC Date and Time for Predictions of the Sun\n\n");
+
+		if (mode!='m' && mode!='o')
+			printw("\n\n\n\t     Starting UTC Date and Time for Predictions of %-15s\n\n",sat[indx].name);
+
+		bozo_count++;
+
+		strcpy(string,Daynum2String(CurrentDaynum()));
+
+		for (x=4; x<24; x++)
+			string[x-4]=string[x];
+
+		attrset(COLOR_PAIR(4)|A_BOLD);
+		printw("\t\t    Format: %s -or- ",string);
+		string[7]=0;
+		printw("%s",string);
+		attrset(COLOR_PAIR(2)|A_BOLD);
+		mvprintw(21,30,"Default is `NOW'");
+		attrset(COLOR_PAIR(3)|A_BOLD);
+		mvprintw(13,1,"Enter Start Date & Time >> ");
+		curs_set(1);
+		refresh();
+		echo();
+		string[0]=0;
+		GetString(string,29);
+		curs_set(0);
+		noecho();
+		       
+		if (strlen(string)!=0)
+			strcpy(line,string);
+		else
+			/* Select `NOW' */
+			return(CurrentDaynum());
+
+		if (strlen(line)==7)
+		{
+			line[7]=' ';
+			line[8]='0';
+			line[9]='0';
+			line[10]=':';
+			line[11]='0';
+			line[12]='0';
+			line[13]=':';
+			line[14]='0';
+			line[15]='0';
+			line[16]=0;
+		}
+			
+		/* Check Day */
+		good = (isdigit(line[0]) && isdigit(line[1])) ? 1 : 0;
+
+		/* Month */
+		good = (good && isalpha(line[2]) && isalpha(line[3]) && isalpha(line[4])) ? 1 : 0;
+
+		/* Year */
+		good = (good && isdigit(line[5]) && isdigit(line[6]) && (line[7]==' ')) ? 1 : 0;
+
+		/* Hour */
+		good = (good && isdigit(line[8]) && isdigit(line[9]) && (line[10]==':')) ? 1 : 0;
+
+		/* Minute */
+		good = (good && isdigit(line[11]) && isdigit(line[12]) && (line[13]==':')) ? 1 : 0;
+
+		/* Seconds */
+		good = (good && isdigit(line[14]) && isdigit(line[15])) ? 1 : 0;
+
+	     	if (good)
+		{ 
+			/* Decode Day */
+			dd=10*(line[0]-'0')+line[1]-'0';
+
+			/* Decode Month Number */
+			line[2]=toupper(line[2]);
+			line[3]=tolower(line[3]);
+			line[4]=tolower(line[4]);
+
+			mon[0]=line[2];
+			mon[1]=line[3];
+			mon[2]=line[4];
+			mon[3]=0;
+
+			for (mm=0; (mm<12 && strcmp(mon,month[mm])!=0); mm++);
+
+			mm++;
+	
+			good=(mm>12) ? 0 : 1;
+		}
+
+		if (good==0)
+			beep();
+
+	} while (good==0 && bozo_count<6);
+
+	if (good==0)
+	{
+		/* If the user can't enter the starting date/time
+		   correctly after several attempts, then the user
+		   is a "bozo" and obviously can't follow directions. */
+
+		bailout("Too Many Errors");
+		exit(-1);
+	}
+
+	/* Decode Year */
+	yy=10*(line[5]-'0')+line[6]-'0';
+
+	/* Decode Time */
+	for (x=8; x<16; x++)
+		string[x-8]=line[x];
+
+	string[8]=0;
+
+	hr=10*(line[8]-'0')+line[9]-'0';
+	min=10*(line[11]-'0')+line[12]-'0';
+	sec=10*(line[14]-'0')+line[15]-'0';
+	
+	return ((double)DayNum(mm,dd,yy)+((hr/24.0)+(min/1440.0)+(sec/86400.0)));
+}
+
+void MoonPosition(jd, right_ascension, declination, parallax)
+double jd, *right_ascension, *declination, *parallax;
+{
+	/* This function returns the geocentric right ascension and
+	   declination of the Moon (in radians) and its horizontal
+	   parallax (in degrees) at Julian date "jd".  This code was
+	   derived from a Javascript implementation of the Meeus
+	   method for determining the exact position of the Moon
+	   found at: http://www.geocities.com/s_perona/ingles/poslun.htm. */
+
+	double	ss, t, t2, t3, d, ff, l1, m, m1, ex, om, l,
+		b, w1, w2, bt, p, lm, ra, dec, z, ob;
+
+	t=(jd-2415020.0)/36525.0;
+	t2=t*t;
+	t3=t2*t;
+	l1=270.434164+481267.8831*t-0.001133*t2+0.0000019*t3;
+	m=358.475833+35999.0498*t-0.00015*t2-0.0000033*t3;
+	m1=296.104608+477198.8491*t+0.009192*t2+0.0000144*t3;
+	d=350.737486+445267.1142*t-0.001436*t2+0.0000019*t3;
+	ff=11.250889+483202.0251*t-0.003211*t2-0.0000003*t3;
+	om=259.183275-1934.142*t+0.002078*t2+0.0000022*t3;
+	om=om*deg2rad;
+	
+	/* Additive terms */
+
+	l1=l1+0.000233*sin((51.2+20.2*t)*deg2rad);
+	ss=0.003964*sin((346.56+132.87*t-0.0091731*t2)*deg2rad);
+	l1=l1+ss+0.001964*sin(om);
+	m=m-0.001778*sin((51.2+20.2*t)*deg2rad);
+	m1=m1+0.000817*sin((51.2+20.2*t)*deg2rad);
+	m1=m1+ss+0.002541*sin(om);
+	d=d+0.002011*sin((51.2+20.2*t)*deg2rad);
+	d=d+ss+0.001964*sin(om);
+	ff=ff+ss-0.024691*sin(om);
+	ff=ff-0.004328*sin(om+(275.05-2.3*t)*deg2rad);
+	ex=1.0-0.002495*t-0.00000752*t2;
+	om=om*deg2rad;
+
+	l1=PrimeAngle(l1);
+	m=PrimeAngle(m);
+	m1=PrimeAngle(m1);
+	d=PrimeAngle(d);
+	ff=PrimeAngle(ff);
+	om=PrimeAngle(om);
+
+	m=m*deg2rad;
+	m1=m1*deg2rad;
+	d=d*deg2rad;
+	ff=ff*deg2rad;
+
+	/* Ecliptic Longitude */
+
+	l=l1+6.28875*sin(m1)+1.274018*sin(2.0*d-m1)+0.658309*sin(2.0*d);
+	l=l+0.213616*sin(2.0*m1)-ex*0.185596*sin(m)-0.114336*sin(2.0*ff);
+	l=l+0.058793*sin(2.0*d-2.0*m1)+ex*0.057212*sin(2.0*d-m-m1)+0.05332*sin(2.0*d+m1);
+	l=l+ex*0.045874*sin(2.0*d-m)+ex*0.041024*sin(m1-m)-0.034718*sin(d);
+	l=l-ex*0.030465*sin(m+m1)+0.015326*sin(2.0*d-2.0*ff)-0.012528*sin(2.0*ff+m1);
+	
+	l=l-0.01098*sin(2.0*ff-m1)+0.010674*sin(4.0*d-m1)+0.010034*sin(3.0*m1);
+	l=l+0.008548*sin(4.0*d-2.0*m1)-ex*0.00791*sin(m-m1+2.0*d)-ex*0.006783*sin(2.0*d+m);
+	
+	l=l+0.005162*sin(m1-d)+ex*0.005*sin(m+d)+ex*0.004049*sin(m1-m+2.0*d);
+	l=l+0.003996*sin(2.0*m1+2.0*d)+0.003862*sin(4.0*d)+0.003665*sin(2.0*d-3.0*m1);
+
+	l=l+ex*0.002695*sin(2.0*m1-m)+0.002602*sin(m1-2.0*ff-2.0*d)+ex*0.002396*sin(2.0*d-m-2.0*m1);
+
+	l=l-0.002349*sin(m1+d)+ex*ex*0.002249*sin(2.0*d-2.0*m)-ex*0.002125*sin(2.0*m1+m);
+
+	l=l-ex*ex*0.002079*sin(2.0*m)+ex*ex*0.002059*sin(2.0*d-m1-2.0*m)-0.001773*sin(m1+2.0*d-2.0*ff);
+
+	l=l+ex*0.00122*sin(4.0*d-m-m1)-0.00111*sin(2.0*m1+2.0*ff)+0.000892*sin(m1-3.0*d);
+
+	l=l-ex*0.000811*sin(m+m1+2.0*d)+ex*0.000761*sin(4.0*d-m-2.0*m1)+ex*ex*.000717*sin(m1-2.0*m);
+
+	l=l+ex*ex*0.000704*sin(m1-2.0*m-2.0*d)+ex*0.000693*sin(m-2.0*m1+2.0*d)+ex*0.000598*sin(2.0*d-m-2.0*ff)+0.00055*sin(m1+4.0*d);
+
+	l=l+0.000538*sin(4.0*m1)+ex*0.000521*sin(4.0*d-m)+0.000486*sin(2.0*m1-d);
+
+	l=l-0.001595*sin(2.0*ff+2.0*d);
+
+	/* Ecliptic latitude */
+
+	b=5.128189*sin(ff)+0.280606*sin(m1+ff)+0.277693*sin(m1-ff)+0.173238*sin(2.0*d-ff);
+	b=b+0.055413*sin(2.0*d+ff-m1)+0.046272*sin(2.0*d-ff-m1)+0.032573*sin(2.0*d+ff);
+
+	b=b+0.017198*sin(2.0*m1+ff)+9.266999e-03*sin(2.0*d+m1-ff)+0.008823*sin(2.0*m1-ff);
+	b=b+ex*0.008247*sin(2.0*d-m-ff)+0.004323*sin(2.0*d-ff-2.0*m1)+0.0042*sin(2.0*d+ff+m1);
+
+	b=b+ex*0.003372*sin(ff-m-2.0*d)+ex*0.002472*sin(2.0*d+ff-m-m1)+ex*0.002222*sin(2.0*d+ff-m);
+
+	b=b+0.002072*sin(2.0*d-ff-m-m1)+ex*0.001877*sin(ff-m+m1)+0.001828*sin(4.0*d-ff-m1);
+
+	b=b-ex*0.001803*sin(ff+m)-0.00175*sin(3.0*ff)+ex*0.00157*sin(m1-m-ff)-0.001487*sin(ff+d)-ex*0.001481*sin(ff+m+m1)+ex*0.001417*sin(ff-m-m1)+ex*0.00135*sin(ff-m)+0.00133*sin(ff-d);
+
+	b=b+0.001106*sin(ff+3.0*m1)+0.00102*sin(4.0*d-ff)+0.000833*sin(ff+4.0*d-m1);
+
+	b=b+0.000781*sin(m1-3.0*ff)+0.00067*sin(ff+4.0*d-2.0*m1)+0.000606*sin(2.0*d-3.0*ff);
+
+	b=b+0.000597*sin(2.0*d+2.0*m1-ff)+ex*0.000492*sin(2.0*d+m1-m-ff)+0.00045*sin(2.0*m1-ff-2.0*d);
+
+	b=b+0.000439*sin(3.0*m1-ff)+0.000423*sin(ff+2.0*d+2.0*m1)+0.000422*sin(2.0*d-ff-3.0*m1);
+
+	b=b-ex*0.000367*sin(m+ff+2.0*d-m1)-ex*0.000353*sin(m+ff+2.0*d)+0.000331*sin(ff+4.0*d);
+
+	b=b+ex*0.000317*sin(2.0*d+ff-m+m1)+ex*ex*0.000306*sin(2.0*d-2.0*m-ff)-0.000283*sin(m1+3.0*ff);
+
+	w1=0.0004664*cos(om*deg2rad);
+	w2=0.0000754*cos((om+275.05-2.3*t)*deg2rad);
+	bt=b*(1.0-w1-w2);
+
+	/* Parallax calculations */
+
+	p=0.950724+0.051818*cos(m1)+0.009531*cos(2.0*d-m1)+0.007843*cos(2.0*d)+0.002824*cos(2.0*m1)+0.000857*cos(2.0*d+m1)+ex*0.000533*cos(2.0*d-m)+ex*0.000401*cos(2.0*d-m-m1);
+
+	p=p+0.000173*cos(3.0*m1)+0.000167*cos(4.0*d-m1)-ex*0.000111*cos(m)+0.000103*cos(4.0*d-2.0*m1)-0.000084*cos(2.0*m1-2.0*d)-ex*0.000083*cos(2.0*d+m)+0.000079*cos(2.0*d+2.0*m1);
+
+	p=p+0.000072*cos(4.0*d)+ex*0.000064*cos(2.0*d-m+m1)-ex*0.000063*cos(2.0*d+m-m1);
+
+	p=p+ex*0.000041*cos(m+d)+ex*0.000035*cos(2.0*m1-m)-0.000033*cos(3.0*m1-2.0*d);
+
+	p=p-0.00003*cos(m1+d)-0.000029*cos(2.0*ff-2.0*d)-ex*0.000029*cos(2.0*m1+m);
+
+	p=p+ex*ex*0.000026*cos(2.0*d-2.0*m)-0.000023*cos(2.0*ff-2.0*d+m1)+ex*0.000019*cos(4.0*d-m-m1);
+
+	b=bt*deg2rad;
+	lm=l*deg2rad;
+	*parallax=p;
+
+	/* Semi-diameter calculation */
+	/* sem=10800.0*asin(0.272488*p*deg2rad)/pi; */
+
+	/* Convert ecliptic coordinates to equatorial coordinates */
+
+	z=(jd-2415020.5)/365.2422;
+	ob=23.452294-(0.46845*z+5.9e-07*z*z)/3600.0;
+	ob=ob*deg2rad;
+	dec=asin(sin(b)*cos(ob)+cos(b)*sin(ob)*sin(lm));
+	ra=acos(cos(b)*cos(lm)/cos(dec));
+	
+	if (lm>pi)
+		ra=twopi-ra;
+
+	*right_ascension=ra;
+	*declination=dec;
+}
+
+void FindMoon(daynum)
+double daynum;
+{
+	/* This function determines the position of the moon, including
+	   the azimuth and elevation headings, relative to the latitude
+	   and longitude of the tracking station.  The Moon's geocentric
+	   position is found by MoonPosition(). */
+
+	double	jd, t, t1, t2, t3, p, h, ra, dec, n, el, az,
+		teg, th, mm, dv;
+
+	jd=daynum+2444238.5;
+
+	MoonPosition(jd,&ra,&dec,&p);
+	moon_dx=3.0/(pi*p);
+
+	/* ra = right ascension */
+	/* dec = declination */
+
+	n=qth.stnlat*deg2rad;    /* North latitude of tracking station */
+
+	/* Find siderial time in radians */
+
+	t=(jd-2451545.0)/36525.0;
+	teg=280.46061837+360.98564736629*(jd-2451545.0)+(0.000387933*t-t*t/38710000.0)*t;
+
+	while (teg>360.0)
+		teg-=360.0;
+
+	th=FixAngle((teg-qth.stnlong)*deg2rad);
+	h=th-ra;
+
+	az=atan2(sin(h),cos(h)*sin(n)-tan(dec)*cos(n))+pi;
+	el=asin(sin(n)*sin(dec)+cos(n)*cos(dec)*cos(h));
+
+	moon_az=az/deg2rad;
+	moon_el=el/deg2rad;
+
+	/* Radial velocity approximation.  This code was derived
+	   from "Amateur Radio Software", by John Morris, GM4ANB,
+	   published by the RSGB in 1985. */
+
+	mm=FixAngle(1.319238+daynum*0.228027135);  /* mean moon position */
+	t2=0.10976;
+	t1=mm+t2*sin(mm);
+	dv=0.01255*moon_dx*moon_dx*sin(t1)*(1.0+t2*cos(mm));
+	dv=dv*4449.0;
+	t1=6378.0;
+	t2=384401.0;
+	t3=t1*t2*(cos(dec)*cos(n)*sin(h));
+	t3=t3/sqrt(t2*t2-t2*t1*sin(el));
+	moon_dv=dv+t3*0.0753125;
+
+	moon_dec=dec/deg2rad;
+	moon_ra=ra/deg2rad;
+	moon_gha=teg-moon_ra;
+
+	if (moon_gha<0.0)
+		moon_gha+=360.0;
+}
+
+void FindSun(daynum)
+double daynum;
+{
+	/* This function finds the position of the Sun */
+
+	/* Zero vector for initializations */
+	vector_t zero_vector={0,0,0,0};
+
+	/* Solar ECI position vector  */
+	vector_t solar_vector=zero_vector;
+
+	/* Solar observed azi and ele vector  */
+	vector_t solar_set=zero_vector;
+
+	/* Solar right ascension and declination vector */
+	vector_t solar_rad=zero_vector;
+
+	/* Solar lat, long, alt vector */
+	geodetic_t solar_latlonalt;
+
+	jul_utc=daynum+2444238.5;
+
+	Calculate_Solar_Position(jul_utc, &solar_vector);
+	Calculate_Obs(jul_utc, &solar_vector, &zero_vector, &obs_geodetic, &solar_set);
+	sun_azi=Degrees(solar_set.x); 
+	sun_ele=Degrees(solar_set.y);
+	sun_range=1.0+((solar_set.z-AU)/AU);
+	sun_range_rate=1000.0*solar_set.w;
+
+	Calculate_LatLonAlt(jul_utc, &solar_vector, &solar_latlonalt);
+
+	sun_lat=Degrees(solar_latlonalt.lat);
+	sun_lon=360.0-Degrees(solar_latlonalt.lon);
+
+	Calculate_RADec(jul_utc, &solar_vector, &zero_vector, &obs_geodetic, &solar_rad);
+
+	sun_ra=Degrees(solar_rad.x);
+	sun_dec=Degrees(solar_rad.y);
+}
+
+void PrefilterInit(x)
+int x;
+{
+	/* This function loads the mean orbital elements of satellite
+	   "x" into the "prefilter" structure, and computes the secular
+	   drift of the ascending node and argument of perigee caused
+	   by the Earth's oblateness (J2).  The prefilter is used only
+	   for near-earth orbits, where these secular terms dominate. */
+
+	double p, k, cosi;
+
+	prefilter.usable=0;
+
+	if (sat[x].meanmo==0.0 || isFlagSet(DEEP_SPACE_EPHEM_FLAG) || sat[x].eccn>0.2)
+		return;
+
+	prefilter.epoch=Julian_Date_of_Epoch((1000.0*(double)sat[x].year)+sat[x].refepoch);
+	prefilter.meanmo=twopi*sat[x].meanmo;
+	prefilter.drag=twopi*sat[x].drag;
+	prefilter.sma=331.25*exp(log(1440.0/sat[x].meanmo)*(2.0/3.0));
+	prefilter.eccn=sat[x].eccn;
+	prefilter.incl=sat[x].incl*deg2rad;
+	prefilter.raan=sat[x].raan*deg2rad;
+	prefilter.argper=sat[x].argper*deg2rad;
+	prefilter.meanan=sat[x].meanan*deg2rad;
+
+	p=prefilter.sma*(1.0-Sqr(prefilter.eccn));
+	k=1.5*xj2*Sqr(xkmper/p)*prefilter.meanmo;
+	cosi=cos(prefilter.incl);
+
+	prefilter.raandot=-k*cosi;
+	prefilter.argperdot=0.5*k*(5.0*Sqr(cosi)-1.0);
+	prefilter.usable=1;
+}
+
+double PrefilterMargin(time)
+double time;
+{
+	/* This function evaluates the analytic orbit at "time" (a day
+	   number), and returns the angle (in radians) by which the
+	   satellite's sub-satellite point lies outside of the circle
+	   on the Earth's surface from which it can be seen above the
+	   horizon.  A negative result means the station lies inside
+	   that circle.  A safety margin that grows with the age of
+	   the element set covers the terms left out of the model. */
+
+	double jd, dt, m, ea, nu, r, u, raan, theta, lat, cosu, sinu,
+	       cosr, sinr, cosi, sini, sx, sy, sz, cospsi, psi, lambda;
+	int x;
+
+	jd=time+2444238.5;
+	dt=jd-prefilter.epoch;
+
+	/* Mean anomaly including the decay of the orbit */
+
+	m=FMod2p(prefilter.meanan+(prefilter.meanmo+prefilter.drag*dt)*dt);
+
+	/* Solve Kepler's equation for the eccentric anomaly */
+
+	for (x=0, ea=m; x<5; x++)
+		ea=m+prefilter.eccn*sin(ea);
+
+	nu=2.0*atan2(sqrt(1.0+prefilter.eccn)*sin(0.5*ea),sqrt(1.0-prefilter.eccn)*cos(0.5*ea));
+	r=prefilter.sma*(1.0-prefilter.eccn*cos(ea));
+
+	/* Unit vector toward the satellite */
+
+	u=prefilter.argper+prefilter.argperdot*dt+nu;
+	raan=prefilter.raan+prefilter.raandot*dt;
+	cosu=cos(u);
+	sinu=sin(u);
+	cosr=cos(raan);
+	sinr=sin(raan);
+	cosi=cos(prefilter.incl);
+	sini=sin(prefilter.incl);
+
+	/* Unit vector toward the station */
+
+	theta=ThetaG_JD(jd)+obs_geodetic.lon;
+	lat=obs_geodetic.lat;
+	sx=cos(lat)*cos(theta);
+	sy=cos(lat)*sin(theta);
+	sz=sin(lat);
+
+	cospsi=sx*(cosr*cosu-sinr*sinu*cosi)+sy*(sinr*cosu+cosr*sinu*cosi)+sz*sinu*sini;
+
+	if (cospsi>1.0)
+		cospsi=1.0;
+
+	if (cospsi<-1.0)
+		cospsi=-1.0;
+
+	psi=acos(cospsi);
+
+	/* Allow for the lowest point of the horizon mask */
+
+	lambda=acos(xkmper*cos(horizon_min*deg2rad)/r)-horizon_min*deg2rad;
+
+	/* 4 degrees plus 0.2 degrees per day of element set age */
+
+	return (psi-lambda-deg2rad*(4.0+0.2*fabs(dt)));
+}
+
+double SkipInvisible(time)
+double time;
+{
+	/* This function returns the start of the next interval in
+	   which a pass of the current satellite is geometrically
+	   possible, or "time" itself if one may already be under
+	   way.  Only the analytic orbit is evaluated, so intervals
+	   in which the satellite cannot be seen are passed over
+	   without calling SGP4/SDP4.  The orbit is sampled every 5
+	   degrees of mean anomaly, which is finer than the shortest
+	   interval the safety margin allows, and the search gives
+	   up after three days. */
+
+	double step, t;
+
+	if (prefilter.usable==0 || PrefilterMargin(time)<=0.0)
+		return time;
+
+	step=(5.0*deg2rad)/prefilter.meanmo;
+
+	for (t=time+step; t<time+3.0; t+=step)
+	{
+		if (PrefilterMargin(t)<=0.0)
+			return (t-step);
+	}
+
+	return t;
+}
+
+void PreCalc(x)
+int x;
+{
+	/* This function copies TLE data from PREDICT's sat structure
+	   to the SGP4/SDP4's single dimensioned tle structure, and
+	   prepares the tracking code for the update. */
+
+	strcpy(tle.sat_name,sat[x].name);
+	strcpy(tle.idesg,sat[x].designator);
+	tle.catnr=sat[x].catnum;
+	tle.epoch=(1000.0*(double)sat[x].year)+sat[x].refepoch;
+	tle.xndt2o=sat[x].drag;
+	tle.xndd6o=sat[x].nddot6;
+	tle.bstar=sat[x].bstar;
+	tle.xincl=sat[x].incl;
+	tle.xnodeo=sat[x].raan;
+	tle.eo=sat[x].eccn;
+	tle.omegao=sat[x].argper;
+	tle.xmo=sat[x].meanan;
+	tle.xno=sat[x].meanmo;
+	tle.revnum=sat[x].orbitnum;
+
+	if (sat_db[x].squintflag)
+	{
+		calc_squint=1;
+		alat=deg2rad*sat_db[x].alat;
+		alon=deg2rad*sat_db[x].alon;
+	}
+	else
+		calc_squint=0;
+ 
+	/* Clear all flags */
+
+	ClearFlag(ALL_FLAGS);
+
+	/* Select ephemeris type.  This function will set or clear the
+	   DEEP_SPACE_EPHEM_FLAG depending on the TLE parameters of the
+	   satellite.  It will also pre-process tle members for the
+	   ephemeris functions SGP4 or SDP4, so this function must
+	   be called each time a new tle set is used. */
+
+	select_ephemeris(&tle);
+
+	PrefilterInit(x);
+}
+
+void Propagate(time, pos, vel)
+double time;
+vector_t *pos, *vel;
+{
+	/* This function returns the ECI position (km) and velocity
+	   (km/sec) of the satellite last initialized by PreCalc()
+	   at "time".  Nothing relating to the ground station is
+	   calculated, so it is the cheapest way to obtain the
+	   satellite's state vector. */
+
+	jul_utc=time+2444238.5;
+
+	/* Convert satellite's epoch time to Julian  */
+	/* and calculate time since epoch in minutes */
+
+	jul_epoch=Julian_Date_of_Epoch(tle.epoch);
+	tsince=(jul_utc-jul_epoch)*xmnpda;
+	age=jul_utc-jul_epoch;
+
+	/* Call NORAD routines according to deep-space flag. */
+
+	if (isFlagSet(DEEP_SPACE_EPHEM_FLAG))
+		SDP4(tsince, &tle, pos, vel);
+	else
+		SGP4(tsince, &tle, pos, vel);
+
+	/* Scale position and velocity vectors to km and km/sec */
+
+	Convert_Sat_State(pos, vel);
+}
+
+void Calc()
+{
+	/* This is the stuff we need to do repetitively while tracking. */
+
+	/* Zero vector for initializations */
+	vector_t zero_vector={0,0,0,0};
+
+	/* Satellite position and velocity vectors */
+	vector_t vel=zero_vector;
+	vector_t pos=zero_vector;
+
+	/* Satellite Az, El, Range, Range rate */
+	vector_t obs_set;
+
+	/* Solar ECI position vector  */
+	vector_t solar_vector=zero_vector;
+
+	/* Solar observed azi and ele vector  */
+	vector_t solar_set;
+
+	/* Satellite's predicted geodetic position */
+	geodetic_t sat_geodetic;
+
+	/* Copy the ephemeris type in use to ephem string. */
+
+		if (isFlagSet(DEEP_SPACE_EPHEM_FLAG))
+			strcpy(ephem,"SDP4");
+		else
+			strcpy(ephem,"SGP4");
+
+	Propagate(daynum, &pos, &vel);
+
+	/* Calculate velocity of satellite */
+
+	Magnitude(&vel);
+	sat_vel=vel.w;
+
+	/** All angles in rads. Distance in km. Velocity in km/s **/
+	/* Calculate satellite Azi, Ele, Range and Range-rate */
+
+	Calculate_Obs(jul_utc, &pos, &vel, &obs_geodetic, &obs_set);
+
+	/* Calculate satellite Lat North, Lon East and Alt. */
+
+	Calculate_LatLonAlt(jul_utc, &pos, &sat_geodetic);
+
+	/* Calculate squint angle */
+
+	if (calc_squint)
+		squint=(acos(-(ax*rx+ay*ry+az*rz)/obs_set.z))/deg2rad;
+
+	/* Calculate solar position and satellite eclipse depth. */
+	/* Also set or clear the satellite eclipsed flag accordingly. */
+
+	Calculate_Solar_Position(jul_utc, &solar_vector);
+	Calculate_Obs(jul_utc, &solar_vector, &zero_vector, &obs_geodetic, &solar_set);
+
+	if (Sat_Eclipsed(&pos, &solar_vector, &eclipse_depth))
+		SetFlag(SAT_ECLIPSED_FLAG);
+	else
+		ClearFlag(SAT_ECLIPSED_FLAG);
+
+	if (isFlagSet(SAT_ECLIPSED_FLAG))
+		sat_sun_status=0;  /* Eclipse */
+	else
+		sat_sun_status=1; /* In sunlight */
+
+	/* Convert satellite and solar data */
+	sat_azi=Degrees(obs_set.x);
+	sat_ele=Degrees(obs_set.y);
+	sat_clear=sat_ele-Horizon(sat_azi);
+	sat_range=obs_set.z;
+	sat_range_rate=obs_set.w;
+	sat_lat=Degrees(sat_geodetic.lat);
+	sat_lon=Degrees(sat_geodetic.lon);
+	sat_alt=sat_geodetic.alt;
+
+	fk=12756.33*acos(xkmper/(xkmper+sat_alt));
+	fm=fk/1.609344;
+
+	rv=(long)floor((tle.xno*xmnpda/twopi+age*tle.bstar*ae)*age+tle.xmo/twopi)+tle.revnum;
+
+	sun_azi=Degrees(solar_set.x); 
+	sun_ele=Degrees(solar_set.y);
+
+	irk=(long)rint(sat_range);
+	isplat=(int)rint(sat_lat);
+	isplong=(int)rint(360.0-sat_lon);
+	iaz=(int)rint(sat_azi);
+	iel=(int)rint(sat_ele);
+	ma256=(int)rint(256.0*(phase/twopi));
+
+	if (sat_sun_status)
+	{
+		if (Degrees(solar_set.y)<=-12.0 && rint(sat_ele)>=0.0)
+			findsun='+';
+		else
+			findsun='*';
+	}
+	else
+		findsun=' ';
+}
+
+void Hermite(segment, t, pos, vel)
+segment_t *segment;
+double t;
+vector_t *pos, *vel;
+{
+	/* This function evaluates the cubic Hermite polynomial
+	   through the ends of "segment" at "t" seconds from its
+	   start, returning the interpolated position (km) and
+	   velocity (km/sec). */
+
+	double u, h, h00, h10, h01, h11, d00, d10, d01, d11;
+
+	h=segment->step;
+	u=t/h;
+
+	h00=(2.0*u-3.0)*u*u+1.0;
+	h10=((u-2.0)*u+1.0)*u*h;
+	h01=(3.0-2.0*u)*u*u;
+	h11=(u-1.0)*u*u*h;
+
+	d00=6.0*(u-1.0)*u/h;
+	d10=(3.0*u-4.0)*u+1.0;
+	d01=-d00;
+	d11=(3.0*u-2.0)*u;
+
+	pos->x=h00*segment->pos[0].x+h10*segment->vel[0].x+h01*segment->pos[1].x+h11*segment->vel[1].x;
+	pos->y=h00*segment->pos[0].y+h10*segment->vel[0].y+h01*segment->pos[1].y+h11*segment->vel[1].y;
+	pos->z=h00*segment->pos[0].z+h10*segment->vel[0].z+h01*segment->pos[1].z+h11*segment->vel[1].z;
+
+	vel->x=d00*segment->pos[0].x+d10*segment->vel[0].x+d01*segment->pos[1].x+d11*segment->vel[1].x;
+	vel->y=d00*segment->pos[0].y+d10*segment->vel[0].y+d01*segment->pos[1].y+d11*segment->vel[1].y;
+	vel->z=d00*segment->pos[0].z+d10*segment->vel[0].z+d01*segment->pos[1].z+d11*segment->vel[1].z;
+
+	Magnitude(pos);
+	Magnitude(vel);
+}
+
+void Interpolate(segment, x, time, pos, vel)
+segment_t *segment;
+int x;
+double time;
+vector_t *pos, *vel;
+{
+	/* This function returns the ECI position and velocity of
+	   satellite x (last initialized by PreCalc()) at "time",
+	   interpolated over "segment".  When "time" falls outside
+	   the segment, a new one is sampled from the propagator.
+	   Segments are up to 30 seconds long, and are halved until
+	   the interpolated position at the middle (where the error
+	   of the cubic is greatest) is within interp_error km of
+	   the propagated one. */
+
+	double t;
+	vector_t middle, speed, check;
+
+	t=86400.0*(time-segment->start);
+
+	if (segment->sat!=x || segment->id!=tle_id || t<0.0 || t>segment->step)
+	{
+		segment->sat=x;
+		segment->id=tle_id;
+		segment->start=time;
+		segment->step=60.0;
+
+		Propagate(time,&segment->pos[0],&segment->vel[0]);
+
+		do
+		{
+			segment->step*=0.5;
+
+			Propagate(time+segment->step/86400.0,&segment->pos[1],&segment->vel[1]);
+			Propagate(time+0.5*segment->step/86400.0,&check,&speed);
+			Hermite(segment,0.5*segment->step,&middle,&speed);
+
+			check.x-=middle.x;
+			check.y-=middle.y;
+			check.z-=middle.z;
+			Magnitude(&check);
+
+		} while (check.w>interp_error && segment->step>0.5);
+
+		t=0.0;
+	}
+
+	Hermite(segment,t,pos,vel);
+}
+
+void CalcPosition(segment, x, time)
+segment_t *segment;
+int x;
+double time;
+{
+	/* This function is a cheaper alternative to Calc() for
+	   tracking at high rates.  Only the azimuth, elevation,
+	   range, and range rate of satellite x at "time" are
+	   calculated, from its position interpolated over
+	   "segment". */
+
+	vector_t pos, vel, obs_set;
+
+	Interpolate(segment,x,time,&pos,&vel);
+
+	daynum=time;
+	jul_utc=time+2444238.5;
+
+	Calculate_Obs(jul_utc, &pos, &vel, &obs_geodetic, &obs_set);
+
+	sat_azi=Degrees(obs_set.x);
+	sat_ele=Degrees(obs_set.y);
+	sat_clear=sat_ele-Horizon(sat_azi);
+	sat_range=obs_set.z;
+	sat_range_rate=obs_set.w;
+}
+
+int Workers()
+{
+	/* This function returns the number of worker threads used
+	   for batch calculations: one per online processor, but
+	   no more than one per satellite. */
+
+	long n;
+
+	n=sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n<1)
+		n=1;
+
+	if (n>24)
+		n=24;
+
+	return (int)n;
+}
+
+int NextJob(w)
+int w;
+{
+	/* This function returns the next job for worker "w".  Jobs
+	   are taken from the front of the worker's own queue.  Once
+	   that is empty, jobs are stolen from the back of the queues
+	   of the other workers.  A -1 is returned when no work is
+	   left anywhere. */
+
+	int x, v, job=-1;
+
+	pthread_mutex_lock(&workqueue[w].lock);
+
+	if (workqueue[w].head<workqueue[w].tail)
+		job=workqueue[w].head++;
+
+	pthread_mutex_unlock(&workqueue[w].lock);
+
+	for (x=1; x<workers && job==-1; x++)
+	{
+		v=(w+x)%workers;
+
+		pthread_mutex_lock(&workqueue[v].lock);
+
+		if (workqueue[v].head<workqueue[v].tail)
+			job=--workqueue[v].tail;
+
+		pthread_mutex_unlock(&workqueue[v].lock);
+	}
+
+	return job;
+}
+
+void *Worker(arg)
+void *arg;
+{
+	/* Thread body of the batch worker pool.  Each job number
+	   is handed to the function registered by RunWorkers(). */
+
+	int w, job;
+
+	w=(int)(long)arg;
+
+	while ((job=NextJob(w))!=-1)
+		workfunction(job);
+
+	return NULL;
+}
+
+void RunWorkers(jobs, function)
+int jobs;
+void (*function)();
+{
+	/* This function runs function(0) through function(jobs-1)
+	   on a pool of worker threads, and returns when all of
+	   them have finished.  The jobs are initially divided
+	   into equal contiguous ranges, one range per worker.
+	   Nothing is done if there are no jobs. */
+
+	int x;
+	pthread_t thread[24];
+
+	if (jobs<=0)
+		return;
+
+	workers=Workers();
+
+	if (workers>jobs)
+		workers=jobs;
+
+	workfunction=function;
+
+	for (x=0; x<workers; x++)
+	{
+		pthread_mutex_init(&workqueue[x].lock,NULL);
+		workqueue[x].head=(x*jobs)/workers;
+		workqueue[x].tail=((x+1)*jobs)/workers;
+	}
+
+	for (x=1; x<workers; x++)
+		pthread_create(&thread[x],NULL,Worker,(void *)(long)x);
+
+	/* The calling thread doubles as worker 0 */
+
+	Worker((void *)0L);
+
+	for (x=1; x<workers; x++)
+		pthread_join(thread[x],NULL);
+
+	for (x=0; x<workers; x++)
+		pthread_mutex_destroy(&workqueue[x].lock);
+}
+
+char AosHappens(x)
+int x;
+{
+	/* This function returns a 1 if the satellite pointed to by
+	   "x" can ever rise above the horizon mask of the ground station. */
+
+	double lin, sma, apogee;
+
+	if (sat[x].meanmo==0.0)
+		return 0;
+	else
+	{
+		lin=sat[x].incl;
+
+		if (lin>=90.0)
+			lin=180.0-lin;
+
+		sma=331.25*exp(log(1440.0/sat[x].meanmo)*(2.0/3.0));
+		apogee=sma*(1.0+sat[x].eccn)-xkmper;
+
+		if ((acos(xkmper*cos(horizon_min*deg2rad)/(apogee+xkmper))-horizon_min*deg2rad+(lin*deg2rad)) > fabs(qth.stnlat*deg2rad))
+			return 1;
+		else
+			return 0;
+	}
+}
+
+char Decayed(x,time)
+int x;
+double time;
+{
+	/* This function returns a 1 if it appears that the
+	   satellite pointed to by 'x' has decayed at the
+	   time of 'time'.  If 'time' is 0.0, then the
+	   current date/time is used. */
+
+	double satepoch;
+
+	if (time==0.0)
+		time=CurrentDaynum();
+
+	satepoch=DayNum(1,0,sat[x].year)+sat[x].refepoch;
+
+	if (satepoch+((16.666666-sat[x].meanmo)/(10.0*fabs(sat[x].drag))) < time)
+		return 1;
+	else
+		return 0;
+}
+
+char Geostationary(x)
+int x;
+{
+	/* This function returns a 1 if the satellite pointed
+	   to by "x" appears to be in a geostationary orbit */
+
+	if (fabs(sat[x].meanmo-1.0027)<0.0002) 
+
+		return 1;
+	else
+		return 0;
+}
+
+double FindAOS()
+{
+	/* This function finds and returns the time of AOS (aostime). */
+
+	aostime=0.0;
+
+	if (AosHappens(indx) && Geostationary(indx)==0 && Decayed(indx,daynum)==0)
+	{
+		Calc();
+
+		/* Get the satellite in range */
+
+		while (sat_clear<-1.0)
+		{
+			daynum-=0.00035*(sat_clear*((sat_alt/8400.0)+0.46)-2.0);
+			daynum=SkipInvisible(daynum);
+			Calc();
+		}
+
+		/* Find AOS */
+
+		while (aostime==0.0)
+		{
+			if (fabs(sat_clear)<0.03)
+				aostime=daynum;
+			else
+			{
+				daynum-=sat_clear*sqrt(sat_alt)/530000.0;
+				Calc();
+			}
+		}
+	}
+
+	return aostime;
+}
+
+double FindLOS()
+{
+	lostime=0.0;
+
+	if (Geostationary(indx)==0 && AosHappens(indx)==1 && Decayed(indx,daynum)==0)
+	{
+		Calc();
+
+		do
+		{
+			daynum+=sat_clear*sqrt(sat_alt)/502500.0;
+			Calc();
+
+			if (fabs(sat_clear) < 0.03)
+				lostime=daynum;
+
+		} while (lostime==0.0);
+	}
+
+	return lostime;
+}
+
+double FindLOS2()
+{
+	/* This function steps through the pass to find LOS.
+	   FindLOS() is called to "fine tune" and return the result. */
+
+	do
+	{
+		daynum+=cos((sat_ele-1.0)*deg2rad)*sqrt(sat_alt)/25000.0;
+		Calc();
+
+	} while (sat_clear>=0.0);
+
+	return(FindLOS());
+}
+
+double NextAOS()
+{
+	/* This function finds and returns the time of the next
+	   AOS for a satellite that is currently in range. */
+
+	aostime=0.0;
+
+	if (AosHappens(indx) && Geostationary(indx)==0 && Decayed(indx,daynum)==0)
+		daynum=FindLOS2()+0.014;  /* Move to LOS + 20 minutes */
+
+	return (FindAOS());
+}
+
+double ElevationFunction(time)
+double time;
+{
+	/* Elevation of the current satellite at "time" */
+
+	daynum=time;
+	Calc();
+
+	return sat_ele;
+}
+
+double RangeFunction(time)
+double time;
+{
+	/* Negated slant range of the current satellite at "time",
+	   so that its maximum is the point of closest approach */
+
+	daynum=time;
+	Calc();
+
+	return -sat_range;
+}
+
+double GoldenSection(function,start,end)
+double (*function)(), start, end;
+{
+	/* This function performs a golden section search between
+	   "start" and "end" and returns the time at which function()
+	   reaches its maximum.  The search stops once the interval
+	   is narrower than ~0.05 seconds. */
+
+	double a, b, c, d, fc, fd, ratio=0.61803398874989484;
+
+	a=start;
+	b=end;
+	c=b-ratio*(b-a);
+	d=a+ratio*(b-a);
+
+	fc=function(c);
+	fd=function(d);
+
+	while ((b-a)>6.0e-7)
+	{
+		if (fc>fd)
+		{
+			b=d;
+			d=c;
+			fd=fc;
+			c=b-ratio*(b-a);
+			fc=function(c);
+		}
+
+		else
+		{
+			a=c;
+			c=d;
+			fc=fd;
+			d=a+ratio*(b-a);
+			fd=function(d);
+		}
+	}
+
+	return (0.5*(a+b));
+}
+
+double FindRoot(function,a,b,fa,fb)
+double (*function)(), a, b, fa, fb;
+{
+	/* This function returns the time between "a" and "b" at
+	   which function() crosses zero, given its values "fa" and
+	   "fb" at either end.  The Illinois variant of the regula
+	   falsi method is used, and the search stops once successive
+	   estimates agree to within ~0.05 seconds. */
+
+	double c=a, fc, lastc;
+	int x, side=0;
+
+	for (x=0, lastc=a; x<50; x++)
+	{
+		c=(a*fb-b*fa)/(fb-fa);
+		fc=function(c);
+
+		if (fc==0.0 || fabs(c-lastc)<6.0e-7)
+			break;
+
+		lastc=c;
+
+		if (fc*fb>0.0)
+		{
+			b=c;
+			fb=fc;
+
+			if (side==-1)
+				fa*=0.5;
+
+			side=-1;
+		}
+
+		else
+		{
+			a=c;
+			fa=fc;
+
+			if (side==1)
+				fb*=0.5;
+
+			side=1;
+		}
+	}
+
+	return c;
+}
+
+double RangeRateFunction(time)
+double time;
+{
+	/* Range rate of the current satellite at "time" */
+
+	daynum=time;
+	Calc();
+
+	return sat_range_rate;
+}
+
+double SunFunction(time)
+double time;
+{
+	/* Elevation of the Sun at "time" relative to the -12
+	   degree threshold used for optical visibility.  No
+	   satellite propagation is required. */
+
+	vector_t zero_vector={0,0,0,0}, solar_vector, solar_set;
+	double jd;
+
+	jd=time+2444238.5;
+
+	Calculate_Solar_Position(jd, &solar_vector);
+	Calculate_Obs(jd, &solar_vector, &zero_vector, &obs_geodetic, &solar_set);
+
+	return (Degrees(solar_set.y)+12.0);
+}
+
+double EclipseFunction(time)
+double time;
+{
+	/* Eclipse depth of the current satellite at "time".  It is
+	   negative while the satellite is in sunlight. */
+
+	daynum=time;
+	Calc();
+
+	return eclipse_depth;
+}
+
+int NegativeIntervals(function,start,end,step,list,max)
+double (*function)(), start, end, step, list[][2];
+int max;
+{
+	/* This function finds the intervals between "start" and
+	   "end" over which function() is negative.  The function
+	   is sampled every "step" days, and each change of sign
+	   is refined by FindRoot().  A sample that is a positive
+	   local minimum is also checked, by fitting a parabola
+	   through it and its neighbors, for a brief dip below
+	   zero that falls between samples.  Up to "max" intervals
+	   are placed in "list", and the number found is returned. */
+
+	double t0, t1, tp=0.0, f0, f1, fp=0.0, d1, d2, a, tv, fv, root;
+	int n=0;
+
+	t0=start;
+	f0=function(t0);
+
+	if (f0<0.0)
+		list[0][0]=start;
+
+	while (t0<end && n<max)
+	{
+		t1=t0+step;
+
+		if (t1>end)
+			t1=end;
+
+		f1=function(t1);
+
+		if (t0>start && f0>=0.0 && f1>=0.0 && f0<fp && f0<f1)
+		{
+			d1=(f0-fp)/(t0-tp);
+			d2=(f1-f0)/(t1-t0);
+			a=(d2-d1)/(t1-tp);
+			tv=0.5*(tp+t0)-d1/(2.0*a);
+
+			if (fp+d1*(tv-tp)+a*(tv-tp)*(tv-t0)<0.0)
+			{
+				fv=function(tv);
+
+				if (fv<0.0)
+				{
+					list[n][0]=FindRoot(function,tp,tv,fp,fv);
+					list[n++][1]=FindRoot(function,tv,t1,fv,f1);
+				}
+			}
+		}
+
+		if ((f0<0.0)!=(f1<0.0) && n<max)
+		{
+			root=FindRoot(function,t0,t1,f0,f1);
+
+			if (f1<0.0)
+				list[n][0]=root;
+			else
+				list[n++][1]=root;
+		}
+
+		tp=t0;
+		fp=f0;
+		t0=t1;
+		f0=f1;
+	}
+
+	if (f0<0.0 && n<max)
+		list[n++][1]=end;
+
+	return n;
+}
+
+double FindTCA(aos,los)
+double aos, los;
+{
+	/* This function returns the time of closest approach
+	   between "aos" and "los".  TCA is the zero crossing of
+	   the range rate.  If the range rate does not change sign
+	   over the interval (a truncated pass), a golden section
+	   search for minimum range is used instead. */
+
+	double fa, fb;
+
+	fa=RangeRateFunction(aos);
+	fb=RangeRateFunction(los);
+
+	if (fa*fb>0.0)
+		return (GoldenSection(RangeFunction,aos,los));
+
+	return (FindRoot(RangeRateFunction,aos,los,fa,fb));
+}
+
+char VisibleWindow(aos,los,pass)
+double aos, los;
+pass_t *pass;
+{
+	/* This function finds the part of the pass between "aos"
+	   and "los" during which the satellite may be optically
+	   visible: while it is in sunlight and the Sun is at least
+	   12 degrees below the horizon.  The intervals of darkness
+	   are found first, since they require no propagation of
+	   the satellite, and the intervals of sunlight are then
+	   searched for only within them.  If the satellite is
+	   visible more than once during the pass, as when it
+	   passes through the Earth's shadow, the longest of those
+	   intervals is stored in pass->vis_start and pass->vis_end,
+	   and a 1 is returned if it lasts at least one minute. */
+
+	double dark[4][2], lit[4][2];
+	int x, y, n, m;
+
+	pass->vis_start=0.0;
+	pass->vis_end=0.0;
+
+	n=NegativeIntervals(SunFunction,aos,los,0.0035,dark,4);
+
+	for (x=0; x<n; x++)
+	{
+		m=NegativeIntervals(EclipseFunction,dark[x][0],dark[x][1],0.0007,lit,4);
+
+		for (y=0; y<m; y++)
+		{
+			if ((lit[y][1]-lit[y][0])>(pass->vis_end-pass->vis_start))
+			{
+				pass->vis_start=lit[y][0];
+				pass->vis_end=lit[y][1];
+			}
+		}
+	}
+
+	return ((pass->vis_end-pass->vis_start)>=(1.0/1440.0));
+}
+
+void PassDetails(aos,los,pass)
+double aos, los;
+pass_t *pass;
+{
+	/* This function fills the pass structure with the times
+	   of AOS, TCA, maximum elevation, and LOS for the pass of
+	   the satellite pointed to by "indx" that spans "aos" to
+	   "los", along with the azimuth headings at each event.
+	   It modifies daynum and the values set by Calc(). */
+
+	pass->sat=indx;
+	pass->vis_start=0.0;
+	pass->vis_end=0.0;
+
+	pass->aos=aos;
+	daynum=aos;
+	Calc();
+	pass->aos_az=sat_azi;
+
+	pass->los=los;
+	daynum=los;
+	Calc();
+	pass->los_az=sat_azi;
+
+	pass->tca=FindTCA(aos,los);
+	daynum=pass->tca;
+	Calc();
+	pass->tca_az=sat_azi;
+	pass->tca_el=sat_ele;
+	pass->tca_range=sat_range;
+
+	pass->maxel_time=GoldenSection(ElevationFunction,aos,los);
+	daynum=pass->maxel_time;
+	Calc();
+	pass->maxel=sat_ele;
+	pass->maxel_az=sat_azi;
+}
+
+char NextPass(x, start, pass)
+int x;
+double start;
+pass_t *pass;
+{
+	/* This function fills "pass" with the details of the pass
+	   of satellite "x" in progress at, or following, day number
+	   "start", returning 0 if there is none.  It is used by the
+	   GET_PASS command of the binary protocol, and modifies
+	   indx, daynum, and the values set by Calc(). */
+
+	double aos, los;
+
+	indx=x;
+	daynum=start;
+	PreCalc(x);
+	Calc();
+
+	if (sat[x].meanmo==0.0 || AosHappens(x)==0 || Geostationary(x)==1 || Decayed(x,daynum)==1)
+		return 0;
+
+	aos=FindAOS();
+	los=FindLOS2();
+	PassDetails(aos,los,pass);
+
+	return 1;
+}
+
+char *Pass2String(pass)
+pass_t *pass;
+{
+	/* This function formats a pass summary as a single line of
+	   text suitable for the -p output and the GET_PASS socket
+	   command.  The fields are the keyword "PASS", followed by
+	   the Unix time and azimuth of AOS, the Unix time, azimuth,
+	   elevation, and slant range at TCA, the Unix time, elevation
+	   and azimuth of maximum elevation, and the Unix time and
+	   azimuth of LOS. */
+
+	static __thread char string[128];
+
+	sprintf(string,"PASS %.0f %5.1f %.0f %5.1f %4.1f %6.0f %.0f %4.1f %5.1f %.0f %5.1f\n",floor(86400.0*(3651.0+pass->aos)),pass->aos_az,floor(86400.0*(3651.0+pass->tca)),pass->tca_az,pass->tca_el,pass->tca_range,floor(86400.0*(3651.0+pass->maxel_time)),pass->maxel,pass->maxel_az,floor(86400.0*(3651.0+pass->los)),pass->los_az);
+
+	return string;
+}
+
+int Print(string,mode)
+char *string, mode;
+{
+	/* This function buffers and displays orbital predictions
+	   and allows screens to be saved to a disk file. */
+
+	char type[20], spaces[80], head1[160], head2[70],
+	     head3[72], satellite_name[25];
+	int key, ans=0, l, x, t;
+	static char buffer[1450], lines, quit;
+	static FILE *fd;
+
+	/* Pass a NULL string to initialize the buffer, counter, and flags */
+
+	if (string[0]==0)
+	{
+		lines=0;
+		quit=0;
+		buffer[0]=0;
+		fd=NULL;
+	}
+
+	else
+	{
+		if (mode=='m')
+		{
+			sprintf(head1,"\n                    %s's Orbit Calendar for the Moon",qth.callsign);
+			strncpy(satellite_name,"Moon\0",5);
+		}
+
+		if (mode=='o')
+		{
+			sprintf(head1,"\n                    %s's Orbit Calendar for the Sun",qth.callsign);
+			strncpy(satellite_name,"Sun\0",4);
+		}
+	
+		if (mode=='m' || mode=='o')
+
+			sprintf(head2,"\n\t   Date     Time    El   Az   RA     Dec    GHA     Vel   Range\n");
+
+
+		if (mode=='p')
+			strcpy(type,"Orbit");
+
+		if (mode=='v')
+			strcpy(type,"Visual");
+
+		if (mode=='s')
+			strcpy(type,"Solar Illumination");
+
+		if (mode!='m' && mode!='o')
+		{
+			strcpy(satellite_name,sat[indx].name);
+
+			l=strlen(qth.callsign)+strlen(satellite_name)+strlen(type);
+
+			spaces[0]=0;
+
+			for (x=l; x<60; x+=2)
+				strcat(spaces," ");
+
+			sprintf(head1,"\n%s%s's %s Calendar For %s", spaces, qth.callsign, type, satellite_name);
+
+			if (mode=='s')
+				sprintf(head2,"\n\t  Date     Mins/Day    Sun%c          Date      Mins/Day    Sun%c\n",37,37);
+			else
+			{
+				if (calc_squint)
+
+					sprintf(head2,"\n\t   Date     Time    El   Az  Phase  %s   %s    Range  Squint\n",(io_lat=='N'?"LatN":"LatS"),(io_lon=='W'?"LonW":"LonE"));
+				else
+
+					sprintf(head2,"\n\t   Date     Time    El   Az  Phase  %s   %s    Range  Orbit\n",(io_lat=='N'?"LatN":"LatS"),(io_lon=='W'?"LonW":"LonE"));
+			}
+		}
+
+		sprintf(head3,"      -----------------------------------------------------------------");
+
+		strcat(buffer,string);
+		lines++;
+
+		if (lines==18)
+		{
+			bkgdset(COLOR_PAIR(2)|A_BOLD);
+			clear();
+			addstr(head1);
+			attrset(COLOR_PAIR(4)|A_BOLD);
+			addstr(head2);
+			addstr(head3);
+			attrset(COLOR_PAIR(3)|A_BOLD);
+
+			if (buffer[0]!='\n')
+				printw("\n");
+
+			addstr(buffer);
+			attrset(COLOR_PAIR(4)|A_BOLD);
+
+			if (buffer[0]=='\n')
+				printw("\n");
+
+			if (fd==NULL)
+				mvprintw(23,63,"        ");
+			else
+				mvprintw(23,63,"Log = ON");
+
+			mvprintw(23,6,"More? [y/n] >> ");
+			curs_set(1);
+			refresh();
+
+			while (ans==0)
+			{
+				key=toupper(GetKey());
+
+				if (key=='Y' || key=='\n' || key==' ')
+				{
+					key='Y';
+					ans=1;
+					quit=0;
+				}
+			
+				if (key=='N' || key=='Q' || key==27)
+				{
+					key='N';
+					ans=1;
+					quit=1;
+				}
+
+				/* 'L' logs output to "satname.txt" */
+
+				if (key=='L' && fd==NULL && buffer[0])
+				{
+					sprintf(temp,"%s.txt",satellite_name);
+
+					l=strlen(temp)-4;
+
+					for (x=0; x<l; x++)
+					{
+						t=temp[x];
+
+						if (t==32 || t==17 || t==92 || t==42 || t==46 || t==47)
+							t='_';
+
+						temp[x]=t;
+					}
+
+					fd=fopen(temp,"a");
+					fprintf(fd,"%s%s%s\n",head1,head2,head3);
+					fprintf(fd,"%s",buffer);
+					mvprintw(23,63,"Log = ON");
+					move(23,21);
+					refresh();
+				}
+
+				else if (fd!=NULL)
+				{
+					if (key=='L' || key=='N')
+					{
+						fprintf(fd,"%s\n\n",buffer);
+						fclose(fd);
+						fd=NULL;
+						mvprintw(23,63,"        ");
+						move(23,21);
+						refresh();
+					}
+
+					else
+						fprintf(fd,"%s",buffer);
+				}
+				buffer[0]=0;
+			}
+
+			lines=0;
+			curs_set(0);
+		}
+	}
+	return (quit);
+}
+
+void Predict(mode)
+char mode;
+{
+	/* This function predicts satellite passes.  It displays
+	   output through the Print() function.  If mode=='p', all
+	   passes are shown.  If mode=='v', the extent of each pass
+	   is found first, and only passes that VisibleWindow()
+	   finds to be optically visible are shown. */
+
+	int quit=0, lastel=0, breakout=0;
+	char string[80], type[10], visible=1;
+	double aos, los;
+	pass_t pass;
+
+	PreCalc(indx);
+	daynum=GetStartTime(0);
+	clear();
+
+	/* Trap geostationary orbits and passes that cannot occur. */
+
+	if (AosHappens(indx) && Geostationary(indx)==0 && Decayed(indx,daynum)==0)
+	{
+		if (xterm)
+		{
+			strcpy(type,"Orbit");  /* Default */
+
+			if (mode=='v')
+				strcpy(type,"Visual");
+
+			fprintf(stderr,"\033]0;PREDICT: %s's %s Calendar For %s\007",qth.callsign, type, sat[indx].name);
+		}
+
+		do
+		{
+			daynum=FindAOS();
+
+			if (mode=='v')
+			{
+				nodelay(stdscr,TRUE);
+				attrset(COLOR_PAIR(4));
+				mvprintw(23,6,"                 Calculating... Press [ESC] To Quit");
+				refresh();
+
+				/* Allow a way out if this
+				   should continue forever... */
+
+				if (GetKey()==27)
+					breakout=1;
+
+				nodelay(stdscr,FALSE);
+
+				aos=daynum;
+				los=FindLOS2();
+				visible=VisibleWindow(aos,los,&pass);
+
+				daynum=(visible ? aos : los);
+				Calc();
+			}
+
+			lastel=0;
+
+			/* Display the pass */
+
+			while (visible && rint(sat_clear)>=0.0 && quit==0)
+			{
+				if (calc_squint)
+
+					sprintf(string,"      %s%4d %4d  %4d  %4d   %4d   %6ld  %4.0f %c\n",Daynum2String(daynum),iel,iaz,ma256,(io_lat=='N'?+1:-1)*isplat,(io_lon=='W'?isplong:360-isplong),irk,squint,findsun);
+
+				else
+					sprintf(string,"      %s%4d %4d  %4d  %4d   %4d   %6ld  %6ld %c\n",Daynum2String(daynum),iel,iaz,ma256,(io_lat=='N'?+1:-1)*isplat,(io_lon=='W'?isplong:360-isplong),irk,rv,findsun);
+
+				lastel=iel;
+				quit=Print(string,mode);
+
+				daynum+=cos((sat_ele-1.0)*deg2rad)*sqrt(sat_alt)/25000.0;
+				Calc();
+			}
+
+			if (lastel!=0)
+			{
+				daynum=FindLOS();
+				Calc();
+
+				if (calc_squint)
+					sprintf(string,"      %s%4d %4d  %4d  %4d   %4d   %6ld  %4.0f %c\n",Daynum2String(daynum),iel,iaz,ma256,(io_lat=='N'?+1:-1)*isplat,(io_lon=='W'?isplong:360-isplong),irk,squint,findsun);
+
+				else
+					sprintf(string,"      %s%4d %4d  %4d  %4d   %4d   %6ld  %6ld %c\n",Daynum2String(daynum),iel,iaz,ma256,(io_lat=='N'?+1:-1)*isplat,(io_lon=='W'?isplong:360-isplong),irk,rv,findsun);
+
+				quit=Print(string,mode);
+			}
+
+			if (visible)
+				quit=Print("\n",mode);
+
+			/* Move to next orbit */
+			daynum=NextAOS();
+
+		}  while (quit==0 && breakout==0 && AosHappens(indx) && Decayed(indx,daynum)==0);
+	}
+
+	else
+	{
+		bkgdset(COLOR_PAIR(5)|A_BOLD);
+		clear();
+
+		if (AosHappens(indx)==0 || Decayed(indx,daynum)==1)
+			mvprintw(12,5,"*** Passes for %s cannot occur for your ground station! ***\n",sat[indx].name);
+
+		if (Geostationary(indx)==1)
+			mvprintw(12,3,"*** Orbital predictions cannot be made for a geostationary satellite! ***\n");
+
+		beep();
+		bkgdset(COLOR_PAIR(7)|A_BOLD);
+		AnyKey();
+		refresh();
+	}
+}
+
+void CelestialCache(body, day)
+char body;
+double day;
+{
+	/* This function samples the position of the Sun (body=='s')
+	   or Moon (body=='m') at five points spanning the day that
+	   begins at "day", and stores the divided differences of the
+	   fourth order polynomial through them. */
+
+	int x, i, k;
+	double jd, ra, dec, hp;
+	vector_t solar_vector;
+
+	x=(body=='m');
+	celestial[x].day=day;
+
+	for (i=0; i<5; i++)
+	{
+		jd=day+0.25*i+2444238.5;
+
+		if (body=='m')
+			MoonPosition(jd,&ra,&dec,&hp);
+		else
+		{
+			Calculate_Solar_Position(jd,&solar_vector);
+			ra=AcTan(solar_vector.y,solar_vector.x);
+			dec=asin(solar_vector.z/solar_vector.w);
+			hp=Degrees(asin(xkmper/solar_vector.w));
+		}
+
+		/* Keep right ascension continuous across the day */
+
+		if (i>0)
+		{
+			while (ra-celestial[x].ra[i-1]>pi)
+				ra-=twopi;
+
+			while (ra-celestial[x].ra[i-1]<-pi)
+				ra+=twopi;
+		}
+
+		celestial[x].ra[i]=ra;
+		celestial[x].dec[i]=dec;
+		celestial[x].hp[i]=hp;
+	}
+
+	for (k=1; k<5; k++)
+		for (i=4; i>=k; i--)
+		{
+			celestial[x].ra[i]=(celestial[x].ra[i]-celestial[x].ra[i-1])/k;
+			celestial[x].dec[i]=(celestial[x].dec[i]-celestial[x].dec[i-1])/k;
+			celestial[x].hp[i]=(celestial[x].hp[i]-celestial[x].hp[i-1])/k;
+		}
+}
+
+double CelestialPosition(body, time, az)
+char body;
+double time, *az;
+{
+	/* This function returns the geocentric elevation (degrees) of
+	   the Sun or Moon at "time", and places its azimuth in "az"
+	   unless it is NULL.  Right ascension and declination are
+	   interpolated from the coefficients cached for the day,
+	   which are refreshed whenever a new day is entered. */
+
+	int x, i;
+	double u, ra, dec, teg, t, h, n;
+
+	x=(body=='m');
+
+	if (floor(time)!=celestial[x].day)
+		CelestialCache(body,floor(time));
+
+	u=4.0*(time-celestial[x].day);
+	ra=celestial[x].ra[4];
+	dec=celestial[x].dec[4];
+
+	for (i=3; i>=0; i--)
+	{
+		ra=ra*(u-i)+celestial[x].ra[i];
+		dec=dec*(u-i)+celestial[x].dec[i];
+	}
+
+	/* Find siderial time, as in FindMoon() */
+
+	t=(time+2444238.5-2451545.0)/36525.0;
+	teg=280.46061837+360.98564736629*(time+2444238.5-2451545.0)+(0.000387933*t-t*t/38710000.0)*t;
+
+	n=qth.stnlat*deg2rad;
+	h=(teg-qth.stnlong)*deg2rad-ra;
+
+	cel_hour=h;
+
+	if (az!=NULL)
+		*az=Degrees(FMod2p(atan2(sin(h),cos(h)*sin(n)-tan(dec)*cos(n))+pi));
+
+	return (Degrees(asin(sin(n)*sin(dec)+cos(n)*cos(dec)*cos(h))));
+}
+
+double ThresholdFunction(time)
+double time;
+{
+	/* Negative while cel_body is above the current threshold */
+
+	int x, i;
+	double u, hp;
+
+	x=(cel_body=='m');
+	hp=0.0;
+
+	if (cel_parallax!=0.0)
+	{
+		if (floor(time)!=celestial[x].day)
+			CelestialCache(cel_body,floor(time));
+
+		u=4.0*(time-celestial[x].day);
+		hp=celestial[x].hp[4];
+
+		for (i=3; i>=0; i--)
+			hp=hp*(u-i)+celestial[x].hp[i];
+	}
+
+	return (cel_threshold+cel_parallax*hp-CelestialPosition(cel_body,time,NULL));
+}
+
+double HourAngleFunction(time)
+double time;
+{
+	/* Local hour angle of cel_body, reduced to -180..+180 degrees.
+	   Upper transit is the point where it passes through zero. */
+
+	CelestialPosition(cel_body,time,NULL);
+
+	return Degrees(atan2(sin(cel_hour),cos(cel_hour)));
+}
+
+int CelestialEvents(body, start, end, event, max)
+char body;
+double start, end;
+celestial_t *event;
+int max;
+{
+	/* This is the celestial event engine.  It finds the times
+	   between "start" and "end" at which the Sun (body=='s') or
+	   Moon (body=='m') rises, transits, and sets, along with the
+	   beginning and end of civil, nautical, and astronomical
+	   twilight for the Sun.  Rise and set refer to the upper limb
+	   with standard refraction, and include the Moon's parallax.
+	   Each event is located by root-finding on the interpolated
+	   position, so FindMoon() is never called.  Up to "max"
+	   events are placed in "event" in time order, and the number
+	   found is returned. */
+
+	static char *names[8]={"rise", "set", "civil_dawn", "civil_dusk",
+		"nautical_dawn", "nautical_dusk", "astronomical_dawn",
+		"astronomical_dusk"};
+	double thresholds[4]={-0.8333, -6.0, -12.0, -18.0}, (*list)[2],
+		t0, t1, f0, f1;
+	int x, y, n, size, count=0;
+	celestial_t swap;
+
+	cel_body=body;
+
+	/* Neither body rises more than once a day, but room
+	   is left for brief dips around the thresholds */
+
+	size=2*(int)ceil(end-start)+4;
+	list=(double (*)[2])malloc(size*sizeof(*list));
+
+	for (x=0; x<(body=='m'?1:4); x++)
+	{
+		cel_threshold=(body=='m' ? -0.5667 : thresholds[x]);
+		cel_parallax=(body=='m' ? 0.7275 : 0.0);
+
+		n=NegativeIntervals(ThresholdFunction,start,end,1.0/24.0,list,size);
+
+		for (y=0; y<n; y++)
+		{
+			if (list[y][0]>start && count<max)
+			{
+				event[count].name=names[2*x];
+				event[count++].time=list[y][0];
+			}
+
+			if (list[y][1]<end && count<max)
+			{
+				event[count].name=names[2*x+1];
+				event[count++].time=list[y][1];
+			}
+		}
+	}
+
+	/* Upper transits */
+
+	for (t0=start, f0=HourAngleFunction(t0); t0<end && count<max; t0=t1, f0=f1)
+	{
+		t1=t0+1.0/24.0;
+
+		if (t1>end)
+			t1=end;
+
+		f1=HourAngleFunction(t1);
+
+		if (f0<0.0 && f1>=0.0 && f1-f0<180.0)
+		{
+			event[count].name="transit";
+			event[count++].time=FindRoot(HourAngleFunction,t0,t1,f0,f1);
+		}
+	}
+
+	free(list);
+
+	for (x=0; x<count; x++)
+	{
+		event[x].body=body;
+		event[x].el=CelestialPosition(body,event[x].time,&event[x].az);
+	}
+
+	for (x=1; x<count; x++)
+		for (y=x; y>0 && event[y].time<event[y-1].time; y--)
+		{
+			swap=event[y];
+			event[y]=event[y-1];
+			event[y-1]=swap;
+		}
+
+	return count;
+}
+
+void PredictMoon()
+{
+	/* This function predicts "passes" of the Moon */
+
+	int iaz, iel, lastel=0;
+	char string[80], quit=0;
+	double daynum, lastdaynum, moonrise=0.0;
+
+	daynum=GetStartTime('m');
+	clear();
+
+	if (xterm)
+		fprintf(stderr,"\033]0;PREDICT: %s's Orbit Calendar for the Moon\007",qth.callsign);
+
+	do
+	{
+		/* Determine moonrise */
+
+		FindMoon(daynum);
+
+		while (moonrise==0.0)
+		{
+			if (fabs(moon_el)<0.03)
+				moonrise=daynum;
+			else
+			{
+				daynum-=(0.004*moon_el);
+				FindMoon(daynum);
+			}
+		}
+
+		FindMoon(moonrise);
+		daynum=moonrise;
+		iaz=(int)rint(moon_az);
+		iel=(int)rint(moon_el);
+
+		do
+		{
+			/* Display pass of the moon */
+
+			sprintf(string,"      %s%4d %4d  %5.1f  %5.1f  %5.1f  %6.1f%7.3f\n",Daynum2String(daynum), iel, iaz, moon_ra, moon_dec, moon_gha, moon_dv, moon_dx);
+			quit=Print(string,'m');
+			lastel=iel;
+			lastdaynum=daynum;
+			daynum+=0.04*(cos(deg2rad*(moon_el+0.5)));
+			FindMoon(daynum);
+			iaz=(int)rint(moon_az);
+			iel=(int)rint(moon_el);
+
+		} while (iel>3 && quit==0);
+
+		while (lastel!=0 && quit==0)
+		{
+			daynum=lastdaynum;
+
+			do
+			{
+				/* Determine setting time */
+
+				daynum+=0.004*(sin(deg2rad*(moon_el+0.5)));
+				FindMoon(daynum);
+				iaz=(int)rint(moon_az);
+				iel=(int)rint(moon_el);
+
+			} while (iel>0);
+
+			/* Print moonset */
+
+			sprintf(string,"      %s%4d %4d  %5.1f  %5.1f  %5.1f  %6.1f%7.3f\n",Daynum2String(daynum), iel, iaz, moon_ra, moon_dec, moon_gha, moon_dv, moon_dx);
+			quit=Print(string,'m');
+			lastel=iel;
+		}
+
+		quit=Print("\n",'m');
+		daynum+=0.4;
+		moonrise=0.0;
+
+	} while (quit==0);
+}
+
+void PredictSun()
+{
+	/* This function predicts "passes" of the Sun. */
+
+	int iaz, iel, lastel=0;
+	char string[80], quit=0;
+	double daynum, lastdaynum, sunrise=0.0;
+
+	daynum=GetStartTime('o');
+	clear();
+
+	if (xterm)
+		fprintf(stderr,"\033]0;PREDICT: %s's Orbit Calendar for the Sun\007",qth.callsign);
+
+	do
+	{
+		/* Determine sunrise */
+
+		FindSun(daynum);
+
+		while (sunrise==0.0)
+		{
+			if (fabs(sun_ele)<0.03)
+				sunrise=daynum;
+			else
+			{
+				daynum-=(0.004*sun_ele);
+				FindSun(daynum);
+			}
+		}
+
+		FindSun(sunrise);
+		daynum=sunrise;
+		iaz=(int)rint(sun_azi);
+		iel=(int)rint(sun_ele);
+
+		/* Print time of sunrise */
+
+		do
+		{
+			/* Display pass of the sun */
+
+			sprintf(string,"      %s%4d %4d  %5.1f  %5.1f  %5.1f  %6.1f%7.3f\n",Daynum2String(daynum), iel, iaz, sun_ra, sun_dec, sun_lon, sun_range_rate, sun_range);
+			quit=Print(string,'o');
+			lastel=iel;
+			lastdaynum=daynum;
+			daynum+=0.04*(cos(deg2rad*(sun_ele+0.5)));
+			FindSun(daynum);
+			iaz=(int)rint(sun_azi);
+			iel=(int)rint(sun_ele);
+
+		} while (iel>3 && quit==0);
+
+		while (lastel!=0 && quit==0)
+		{
+			daynum=lastdaynum;
+
+			do
+			{
+				/* Find sun set */
+
+				daynum+=0.004*(sin(deg2rad*(sun_ele+0.5)));
+				FindSun(daynum);
+				iaz=(int)rint(sun_azi);
+				iel=(int)rint(sun_ele);
+
+			} while (iel>0);
+
+			/* Print time of sunset */
+
+			sprintf(string,"      %s%4d %4d  %5.1f  %5.1f  %5.1f  %6.1f%7.3f\n",Daynum2String(daynum), iel, iaz, sun_ra, sun_dec, sun_lon, sun_range_rate, sun_range);
+			quit=Print(string,'o');
+			lastel=iel;
+		}
+
+		quit=Print("\n",'o');
+		daynum+=0.4;
+		sunrise=0.0;
+
+	} while (quit==0);
+}
+
+char KbEdit(x,y)
+int x,y;
+{
+	/* This function is used when editing QTH
+	   and orbital data via the keyboard. */
+
+	char need2save=0, input[25];
+
+	echo();
+	move(y-1,x-1);
+	GetString(input,24);
+
+	if (strlen(input)!=0)
+	{
+		need2save=1;  /* Save new data to variables */
+		resave=1;     /* Save new data to disk files */
+		strncpy(temp,input,24);
+	}
+
+	mvprintw(y-1,x-1,"%-25s",temp);
+
+	refresh();
+	noecho();
+
+	return need2save;
+}
+
+void ShowOrbitData()
+{
+	/* This function permits displays a satellite's orbital
+	   data.  The age of the satellite data is also provided. */
+
+	int c, x, namelength, age;	
+	double an_period, no_period, sma, c1, e2, satepoch;
+	char days[5];
+
+	x=Select();
+
+	while (x!=-1)
+	{
+		if (sat[x].meanmo!=0.0)
+		{
+			bkgdset(COLOR_PAIR(2)|A_BOLD);
+			clear();
+			sma=331.25*exp(log(1440.0/sat[x].meanmo)*(2.0/3.0));
+			an_period=1440.0/sat[x].meanmo;
+			c1=cos(sat[x].incl*deg2rad);
+			e2=1.0-(sat[x].eccn*sat[x].eccn); 
+			no_period=(an_period*360.0)/(360.0+(4.97*pow((xkmper/sma),3.5)*((5.0*c1*c1)-1.0)/(e2*e2))/sat[x].meanmo);
+			satepoch=DayNum(1,0,sat[x].year)+sat[x].refepoch;
+			age=(int)rint(CurrentDaynum()-satepoch);
+
+			if (age==1)
+				strcpy(days,"day");
+			else
+				strcpy(days,"days");
+
+			namelength=strlen(sat[x].name);
+
+			printw("\n");
+
+			for (c=41; c>namelength; c-=2)
+				printw(" ");
+	
+			printw("Orbital Data For %s / Catalog Number %ld\n",sat[x].name,sat[x].catnum);
+			attrset(COLOR_PAIR(3)|A_BOLD);
+			printw("\n\t\t  Issued %d %s ago on %s UTC\n\n",age,days,Daynum2String(satepoch));
+
+			attrset(COLOR_PAIR(4)|A_BOLD);
+			mvprintw(5,21,"Reference Epoch");
+			mvprintw(6,21,"Inclination");
+			mvprintw(7,21,"RAAN");
+			mvprintw(8,21,"Eccentricity");
+			mvprintw(9,21,"Arg of Perigee");
+			mvprintw(10,21,"Mean Anomaly");
+			mvprintw(11,21,"Mean Motion");
+			mvprintw(12,21,"Decay Rate");
+			mvprintw(13,21,"Nddot/6 Drag");
+			mvprintw(14,21,"Bstar Drag Factor");
+			mvprintw(15,21,"Semi-Major Axis");
+			mvprintw(16,21,"Apogee Altitude");
+			mvprintw(17,21,"Perigee Altitude");
+			mvprintw(18,21,"Anomalistic Period");
+			mvprintw(19,21,"Nodal Period");
+			mvprintw(20,21,"Orbit Number");
+			mvprintw(21,21,"Element Set Number");
+
+			attrset(COLOR_PAIR(2)|A_BOLD);
+			mvprintw(5,40,": %02d %.8f",sat[x].year,sat[x].refepoch);
+			mvprintw(6,40,": %.4f deg",sat[x].incl);
+			mvprintw(7,40,": %.4f deg",sat[x].raan);
+			mvprintw(8,40,": %g",sat[x].eccn);
+			mvprintw(9,40,": %.4f deg",sat[x].argper);
+			mvprintw(10,40,": %.4f deg",sat[x].meanan);
+			mvprintw(11,40,": %.8f rev/day",sat[x].meanmo);
+			mvprintw(12,40,": %g rev/day/day",sat[x].drag);
+			mvprintw(13,40,": %g rev/day/day/day",sat[x].nddot6);
+			mvprintw(14,40,": %g 1/earth radii",sat[x].bstar);
+			mvprintw(15,40,": %.4f km",sma);
+			mvprintw(16,40,": %.4f km",sma*(1.0+sat[x].eccn)-xkmper);
+			mvprintw(17,40,": %.4f km",sma*(1.0-sat[x].eccn)-xkmper);
+			mvprintw(18,40,": %.4f mins",an_period);
+			mvprintw(19,40,": %.4f mins",no_period);
+			mvprintw(20,40,": %ld",sat[x].orbitnum);
+			mvprintw(21,40,": %ld",sat[x].setnum);
+
+			attrset(COLOR_PAIR(3)|A_BOLD);
+			refresh();
+			AnyKey();
+		}
+
+		x=Select();
+	 };
+}	
+
+void KepEdit()
+{
+	/* This function permits keyboard editing of the orbital database. */
+
+	int x;
+	char mode;
+
+	mode=data_hold;
+	HoldData('w');
+
+	do
+	{
+		x=Select();
+
+		if (x!=-1)
+		{
+			bkgdset(COLOR_PAIR(3)|A_BOLD);
+			clear();
+			mvprintw(3,1,"\t\t   *  Orbital Database Editing Utility  *\n\n\n");
+			attrset(COLOR_PAIR(4)|A_BOLD);
+
+			printw("\n\t\t\tSpacecraft Name :");
+			printw("\n\t\t\tCatalog Number  :");
+			printw("\n\t\t\tDesignator      :");
+			printw("\n\t\t\tReference Epoch :");
+			printw("\n\t\t\tInclination     :");
+			printw("\n\t\t\tRAAN            :");
+			printw("\n\t\t\tEccentricity    :");
+			printw("\n\t\t\tArg of Perigee  :");
+			printw("\n\t\t\tMean Anomaly    :");
+			printw("\n\t\t\tMean Motion     :");
+			printw("\n\t\t\tDecay Rate      :");
+			printw("\n\t\t\tNddot/6         :");
+			printw("\n\t\t\tBstar Drag Term :");        
+			printw("\n\t\t\tOrbit Number    :");
+			printw("\n\t\t\tElement Set No. :");
+
+			attrset(COLOR_PAIR(2)|A_BOLD);
+
+			mvprintw(7,42,"%s",sat[x].name);
+			mvprintw(8,42,"%ld",sat[x].catnum);
+			mvprintw(9,42,"%s",sat[x].designator);
+			mvprintw(10,42,"%02d %.8f",sat[x].year,sat[x].refepoch);
+			mvprintw(11,42,"%.4f",sat[x].incl);
+			mvprintw(12,42,"%.4f",sat[x].raan);
+			mvprintw(13,42,"%g",sat[x].eccn);
+			mvprintw(14,42,"%.4f",sat[x].argper);
+			mvprintw(15,42,"%.4f",sat[x].meanan);
+			mvprintw(16,42,"%.8f",sat[x].meanmo);
+			mvprintw(17,42,"%g",sat[x].drag);
+			mvprintw(18,42,"%g",sat[x].nddot6);
+			mvprintw(19,42,"%g",sat[x].bstar);
+			mvprintw(20,42,"%ld",sat[x].orbitnum);
+			mvprintw(21,42,"%ld",sat[x].setnum);
+
+			curs_set(1);
+			refresh();
+
+			sprintf(temp,"%s",sat[x].name);
+
+			if (KbEdit(43,8))
+				strncpy(sat[x].name,temp,24);
+
+			sprintf(temp,"%ld",sat[x].catnum);
+
+			if (KbEdit(43,9))
+				sscanf(temp,"%ld",&sat[x].catnum);
+
+			sprintf(temp,"%s",sat[x].designator);
+
+			if (KbEdit(43,10))
+				sscanf(temp,"%s",sat[x].designator);
+
+			sprintf(temp,"%02d %4.8f",sat[x].year,sat[x].refepoch);
+
+			if (KbEdit(43,11))
+				sscanf(temp,"%d %lf",&sat[x].year,&sat[x].refepoch);
+
+			sprintf(temp,"%4.4f",sat[x].incl);
+
+			if (KbEdit(43,12))
+				sscanf(temp,"%lf",&sat[x].incl);
+			    
+			sprintf(temp,"%4.4f",sat[x].raan);
+
+			if (KbEdit(43,13))
+				sscanf(temp,"%lf",&sat[x].raan);
+
+			sprintf(temp,"%g",sat[x].eccn);
+
+			if (KbEdit(43,14))
+				sscanf(temp,"%lf",&sat[x].eccn);
+			    
+			sprintf(temp,"%4.4f",sat[x].argper);
+
+			if (KbEdit(43,15))
+				sscanf(temp,"%lf",&sat[x].argper);
+			    
+			sprintf(temp,"%4.4f",sat[x].meanan);
+
+			if (KbEdit(43,16))
+				sscanf(temp,"%lf",&sat[x].meanan);
+
+			sprintf(temp,"%4.8f",sat[x].meanmo);
+
+			if (KbEdit(43,17))
+				sscanf(temp,"%lf",&sat[x].meanmo);
+			    
+			sprintf(temp,"%g",sat[x].drag);
+
+			if (KbEdit(43,18))
+				sscanf(temp,"%lf",&sat[x].drag);
+			    
+			sprintf(temp,"%g",sat[x].nddot6);
+
+			if (KbEdit(43,19))
+				sscanf(temp,"%lf",&sat[x].nddot6);
+
+			sprintf(temp,"%g",sat[x].bstar);
+
+			if (KbEdit(43,20))
+				sscanf(temp,"%lf",&sat[x].bstar);
+
+			sprintf(temp,"%ld",sat[x].orbitnum);
+
+			if (KbEdit(43,21))
+				sscanf(temp,"%ld",&sat[x].orbitnum);
+
+			sprintf(temp,"%ld",sat[x].setnum);
+
+			if (KbEdit(43,22))
+				sscanf(temp,"%ld",&sat[x].setnum);
+		  	
+			curs_set(0);
+		}
+
+	} while (x!=-1);
+
+	if (resave)
+	{
+		SaveTLE();
+		resave=0;
+	}
+
+	HoldData(mode);
+}	
+
+void QthEdit()
+{
+	/* This function permits keyboard editing of
+	   the ground station's location information. */
+
+	char mode;
+
+	mode=data_hold;
+	HoldData('w');
+
+	bkgdset(COLOR_PAIR(3)|A_BOLD);
+	clear();
+	curs_set(1);
+	mvprintw(7,0,"\t\t *  Ground Station Location Editing Utility  *\n\n\n");
+
+	attrset(COLOR_PAIR(4)|A_BOLD);
+	printw("\n\t\t\tStation Callsign  :");
+	printw("\n\t\t\tStation Latitude  :");
+	printw("\n\t\t\tStation Longitude :");
+	printw("\n\t\t\tStation Altitude  :");
+
+	attrset(COLOR_PAIR(2)|A_BOLD);
+	mvprintw(11,44,"%s",qth.callsign);
+
+	if (io_lat=='N')
+		mvprintw(12,44,"%g [DegN]",+qth.stnlat);
+	else
+		mvprintw(12,44,"%g [DegS]",-qth.stnlat);
+
+	if (io_lon=='W')
+		mvprintw(13,44,"%g [DegW]",+qth.stnlong);
+	else
+		mvprintw(13,44,"%g [DegE]",-qth.stnlong);
+
+	mvprintw(14,44,"%d [m]",qth.stnalt);
+
+	refresh();
+
+	sprintf(temp,"%s",qth.callsign);
+
+	mvprintw(18,12,"Enter the callsign or identifier of your ground station");
+
+	if (KbEdit(45,12))
+		strncpy(qth.callsign,temp,16);
+
+	if (io_lat=='N')
+		sprintf(temp,"%g [DegN]",+qth.stnlat);
+	else
+		sprintf(temp,"%g [DegS]",-qth.stnlat);
+
+	if (io_lat=='N')
+		mvprintw(18,12,"Enter your latitude in degrees NORTH  (south=negative) ");
+	else
+		mvprintw(18,12,"Enter your latitude in degrees SOUTH  (north=negative) ");
+ 
+	mvprintw(19,12,"  Decimal (74.2467) or DMS (74 14 48) format allowed");
+
+	if (KbEdit(45,13))
+	{
+		if (io_lat=='N')
+			qth.stnlat=+ReadBearing(temp);
+		else
+			qth.stnlat=-ReadBearing(temp);
+	}
+ 
+	if (io_lon=='W')
+		sprintf(temp,"%g [DegW]",+qth.stnlong);
+	else
+		sprintf(temp,"%g [DegE]",-qth.stnlong);
+ 
+	if (io_lon=='W')
+		mvprintw(18,12,"Enter your longitude in degrees WEST   (east=negative) ");
+	else
+		mvprintw(18,12,"Enter your longitude in degrees EAST   (west=negative) ");
+ 
+	if (KbEdit(45,14))
+	{
+		if (io_lon=='W')
+			qth.stnlong=+ReadBearing(temp);
+		else
+			qth.stnlong=-ReadBearing(temp);
+	}
+ 
+	move(19,12);
+	clrtoeol();
+	mvprintw(18,12,"    Enter your altitude above sea level (in meters)   ");
+
+	sprintf(temp,"%d",qth.stnalt);
+
+	if (KbEdit(45,15))
+		sscanf(temp,"%d",&qth.stnalt);
+
+	if (resave)
+	{
+		SaveQTH();
+		resave=0;
+	}
+
+	HoldData(mode);
+}
+
+char FlipPass()
+{
+	/* This function is called with daynum during a pass of
+	   the satellite being calculated.  It follows the rest of
+	   the pass in 10 second steps, and returns 1 if the pass
+	   carries the azimuth through north but not through south,
+	   so that it is better tracked by a rotator flipped over to
+	   the opposite azimuth. */
+
+	int n;
+	char north=0, south=0;
+	double last;
+
+	Calc();
+	last=sat_azi;
+
+	for (n=0; n<720; n++)
+	{
+		daynum+=10.0/86400.0;
+		Calc();
+
+		if (sat_ele<0.0)
+			break;
+
+		if (fabs(sat_azi-last)>180.0)
+			north=1;
+
+		else if ((last-180.0)*(sat_azi-180.0)<=0.0)
+			south=1;
+
+		last=sat_azi;
+	}
+
+	return (north && !south);
+}
+
+char QueueCommand(a, command)
+antenna_t *a;
+command_t *command;
+{
+	/* This function adds "command" to the queue of antenna
+	   "a", and returns 0 if the queue is full. */
+
+	pthread_mutex_lock(&a->lock);
+
+	if (a->count==256)
+	{
+		pthread_mutex_unlock(&a->lock);
+		return 0;
+	}
+
+	a->queue[(a->head+a->count)%256]=*command;
+	a->count++;
+
+	pthread_cond_signal(&a->cond);
+	pthread_mutex_unlock(&a->lock);
+
+	return 1;
+}
+
+int AntennaSatellite(a, time)
+antenna_t *a;
+double time;
+{
+	/* This function returns the satellite that antenna "a"
+	   is to track at "time", or -1 if there is none. */
+
+	int x, y;
+
+	if (a->assignments==0)
+		return rotator_sat;
+
+	for (x=0; x<a->assignments; x++)
+	{
+		if ((a->start[x]==0.0 && a->end[x]==0.0) || (time>=a->start[x] && time<a->end[x]))
+		{
+			for (y=0; y<24; y++)
+				if (sat[y].catnum==a->catnum[x] && sat[y].meanmo!=0.0)
+					return y;
+		}
+	}
+
+	return -1;
+}
+
+void *RotatorPlanner(arg)
+void *arg;
+{
+	/* This function is the body of the thread that plans the
+	   movements of every antenna's rotator.  Positions of the
+	   satellite each antenna is tracking are interpolated every
+	   quarter second of its trajectory (or at track_rate in
+	   high-rate tracking), from a single propagation of each
+	   satellite shared by the antennas tracking it.  A command
+	   is queued whenever an antenna's heading changes by a
+	   degree (or a tenth of a degree in high-rate tracking, or
+	   each second for rotators that require it).  Whether to
+	   flip a rotator is decided at the start of each pass, and
+	   holds until its end. */
+
+	int x, y, oldsat[8];
+	char inpass[8], flip[8];
+	long second, lastsecond[8];
+	double plan[8], now, step, scale, time, heading_az=0.0,
+	       heading_el=0.0, oldaz[8], oldel[8];
+	command_t command;
+	segment_t segment[24];
+
+	for (y=0; y<24; y++)
+		segment[y].sat=-1;
+
+	for (x=0; x<antennas; x++)
+	{
+		oldsat[x]=-1;
+		inpass[x]=0;
+		flip[x]=0;
+		lastsecond[x]=0;
+		plan[x]=0.0;
+		oldaz[x]=-1.0;
+		oldel[x]=-1.0;
+	}
+
+	while (1)
+	{
+		HoldData('r');
+		now=CurrentDaynum();
+
+		if (hires)
+		{
+			step=1.0/(86400.0*track_rate);
+			scale=10.0;
+		}
+
+		else
+		{
+			step=0.25/86400.0;
+			scale=1.0;
+		}
+
+		for (x=0; x<antennas; x++)
+		{
+			/* Skip over any time lost while stalled */
+
+			if (plan[x]<now)
+				plan[x]=now;
+
+			while (plan[x]<now+rotator_ahead/86400.0)
+			{
+				y=AntennaSatellite(&antenna[x],plan[x]);
+
+				if (y!=oldsat[x])
+				{
+					if (antenna[x].assignments==0)
+					{
+						/* Discard the commands queued for
+						   the satellite previously tracked
+						   on the tracking screen */
+
+						pthread_mutex_lock(&antenna[x].lock);
+						antenna[x].count=0;
+						pthread_mutex_unlock(&antenna[x].lock);
+
+						plan[x]=now;
+					}
+
+					oldsat[x]=y;
+					inpass[x]=0;
+					oldaz[x]=-1.0;
+					oldel[x]=-1.0;
+				}
+
+				if (y==-1)
+				{
+					plan[x]+=step;
+					continue;
+				}
+
+				/* Set up each time, since the propagator
+				   serves all of the antennas' satellites */
+
+				PreCalc(y);
+				time=plan[x]+antenna[x].lead/86400.0;
+				CalcPosition(&segment[y],y,time);
+
+				if (sat_ele>=0.0)
+				{
+					if (inpass[x]==0)
+					{
+						daynum=time;
+						flip[x]=(antenna[x].flip && FlipPass());
+						inpass[x]=1;
+						CalcPosition(&segment[y],y,time);
+					}
+
+					if (flip[x])
+					{
+						heading_az=rint(scale*fmod(sat_azi+180.0,360.0))/scale;
+						heading_el=rint(scale*(180.0-sat_ele))/scale;
+					}
+
+					else
+					{
+						heading_az=rint(scale*sat_azi)/scale;
+						heading_el=rint(scale*sat_ele)/scale;
+					}
+
+					second=(long)(86400.0*(plan[x]+3651.0));
+
+					if (heading_az!=oldaz[x] || heading_el!=oldel[x] || (antenna[x].once && second>lastsecond[x]))
+					{
+						command.time=plan[x];
+						command.az=(float)heading_az;
+						command.el=(float)heading_el;
+
+						if (QueueCommand(&antenna[x],&command)==0)
+							break;
+
+						oldaz[x]=heading_az;
+						oldel[x]=heading_el;
+						lastsecond[x]=second;
+					}
+				}
+
+				else
+					inpass[x]=0;
+
+				plan[x]+=step;
+			}
+		}
+
+		HoldData(0);
+
+		/* Plan four times a second of simulated time,
+		   so the lookahead keeps up with a time warp */
+
+		if (clock_warp>1000000)
+			usleep((useconds_t)(250000LL*1000000LL/clock_warp));
+		else
+			usleep(250000);
+	}
+
+	return NULL;
+}
+
+void *RotatorOutput(arg)
+void *arg;
+{
+	/* This function is the body of the thread that sends the
+	   planned headings of antenna "arg" to its rotator as they
+	   come due.  Any that are overdue are superseded by the
+	   latest.  If the serial port fails, it is closed and
+	   reopened at most every two seconds, and headings that
+	   come due while the rotator is away are dropped. */
+
+	double now, due, retry=0.0;
+	command_t command;
+	struct timespec wait;
+	antenna_t *a;
+
+	a=(antenna_t *)arg;
+
+	while (1)
+	{
+		pthread_mutex_lock(&a->lock);
+
+		while (a->count==0)
+			pthread_cond_wait(&a->cond,&a->lock);
+
+		now=CurrentDaynum();
+		due=a->queue[a->head].time;
+
+		if (due>now)
+		{
+			/* Sleep until the command is due, or
+			   until the queue is changed */
+
+			ClockDeadline(due,&wait);
+			pthread_cond_timedwait(&a->cond,&a->lock,&wait);
+			pthread_mutex_unlock(&a->lock);
+			continue;
+		}
+
+		do
+		{
+			command=a->queue[a->head];
+			a->head=(a->head+1)%256;
+			a->count--;
+
+		} while (a->count>0 && a->queue[a->head].time<=now);
+
+		pthread_mutex_unlock(&a->lock);
+
+		if (a->fd==-1 && now>retry)
+		{
+			a->fd=OpenRotator(a);
+			retry=now+2.0/86400.0;
+		}
+
+		if (a->fd!=-1)
+		{
+			if (TrackDataOut(a->fd,command.el,command.az)==-1)
+			{
+				close(a->fd);
+				a->fd=-1;
+				a->state=2;
+			}
+
+			else
+				a->state=1;
+		}
+	}
+
+	return NULL;
+}
+
+void ReadAntennas(file)
+char *file;
+{
+	/* This function reads the antennas described in "file",
+	   adding them to any given on the command line.  Each
+	   antenna begins with a line holding the serial port of
+	   its rotator, followed by "a1" if the rotator needs a
+	   heading every second, "flip" if its elevation travels
+	   to 180 degrees, and "lead" and the number of seconds by
+	   which headings are to be sent early, as needed.  Each
+	   of the lines that follow assigns the antenna a satellite
+	   (by name or object number), optionally preceded by the
+	   Unix times at which the assignment starts and ends.  The
+	   first assignment that applies at any time is the one
+	   used, and an antenna without assignments follows the
+	   satellite being tracked on the tracking screen.  Lines
+	   starting with '#' are ignored. */
+
+	int x, y, n;
+	double start, end;
+	char line[80], *name;
+	antenna_t *a=NULL;
+	FILE *fd;
+
+	fd=fopen(file,"r");
+
+	if (fd==NULL)
+		return;
+
+	while (fgets(line,80,fd)!=NULL)
+	{
+		line[strcspn(line,"\r\n")]=0;
+
+		if (line[0]=='#' || line[0]==0)
+			continue;
+
+		if (line[0]=='/')
+		{
+			if (antennas==8)
+				break;
+
+			a=&antenna[antennas++];
+			sscanf(line,"%49s",a->port);
+			a->once=(strstr(line," a1")!=NULL);
+			a->flip=(strstr(line," flip")!=NULL);
+			a->fd=-1;
+
+			name=strstr(line," lead ");
+
+			if (name!=NULL)
+				a->lead=atof(name+6);
+
+			continue;
+		}
+
+		if (a==NULL || a->assignments==16)
+			continue;
+
+		start=0.0;
+		end=0.0;
+		n=0;
+
+		if (sscanf(line,"%lf %lf %n",&start,&end,&n)<2 || n==0)
+		{
+			start=0.0;
+			end=0.0;
+			n=0;
+		}
+
+		for (name=line+n; *name==' ' || *name=='\t'; name++);
+
+		for (y=0; y<24; y++)
+			if (sat[y].meanmo!=0.0 && (strcmp(name,sat[y].name)==0 || atol(name)==sat[y].catnum))
+				break;
+
+		if (y<24)
+		{
+			x=a->assignments++;
+			a->catnum[x]=sat[y].catnum;
+
+			if (start!=0.0 || end!=0.0)
+			{
+				a->start[x]=start/86400.0-3651.0;
+				a->end[x]=end/86400.0-3651.0;
+			}
+		}
+	}
+
+	fclose(fd);
+}
+
+void StartRotators()
+{
+	/* This function starts the thread that plans the
+	   movements of the antenna rotators, and a thread
+	   for each antenna that sends them. */
+
+	int x;
+	pthread_t thread;
+	pthread_condattr_t attr;
+
+	/* Commands come due on the simulation clock,
+	   so they are waited for on the monotonic clock */
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr,CLOCK_MONOTONIC);
+
+	for (x=0; x<antennas; x++)
+	{
+		pthread_mutex_init(&antenna[x].lock,NULL);
+		pthread_cond_init(&antenna[x].cond,&attr);
+		pthread_create(&thread,NULL,RotatorOutput,(void *)&antenna[x]);
+		pthread_detach(thread);
+	}
+
+	pthread_create(&thread,NULL,RotatorPlanner,NULL);
+	pthread_detach(thread);
+}
+
+sound_t *FindSound(name)
+char *name;
+{
+	/* This function returns the announcement clip of the
+	   given name, or NULL if there isn't one. */
+
+	int x;
+
+	for (x=0; x<39; x++)
+		if (strcmp(sound[x].name,name)==0)
+			return &sound[x];
+
+	return NULL;
+}
+
+char LoadSound(clip)
+sound_t *clip;
+{
+	/* This function reads the uncompressed PCM .wav file
+	   of an announcement clip from the vocalizer directory,
+	   and keeps its samples in memory.  It returns 1 if
+	   the clip was loaded. */
+
+	int x, y;
+	long bytes;
+	unsigned char *buffer;
+	char filename[120];
+	FILE *fd;
+
+	sprintf(filename,"%svocalizer/%s.wav",predictpath,clip->name);
+
+	fd=fopen(filename,"r");
+
+	if (fd==NULL)
+		return 0;
+
+	fseek(fd,0L,SEEK_END);
+	bytes=ftell(fd);
+	rewind(fd);
+
+	buffer=(unsigned char *)malloc(bytes+8);
+
+	if (buffer==NULL || bytes<44 || fread(buffer,1,bytes,fd)!=(size_t)bytes)
+	{
+		free(buffer);
+		fclose(fd);
+		return 0;
+	}
+
+	fclose(fd);
+
+	y=((buffer[0]^'R')  | (buffer[1]^'I') |
+  	   (buffer[2]^'F')  | (buffer[3]^'F') |
+	   (buffer[8]^'W')  | (buffer[9]^'A') |
+	   (buffer[10]^'V') | (buffer[11]^'E'));
+
+	/* Find the format of the samples */
+
+	for (x=12; y==0 && x<bytes-24 && memcmp(buffer+x,"fmt ",4); x++);
+
+	if (y || x>=bytes-24 || (buffer[x+8]|(buffer[x+9]<<8))!=1)
+	{
+		free(buffer);
+		return 0;
+	}
+
+	clip->channels=buffer[x+10]|(buffer[x+11]<<8);
+	clip->rate=buffer[x+12]|(buffer[x+13]<<8)|(buffer[x+14]<<16)|(buffer[x+15]<<24);
+	clip->bits=buffer[x+22]|(buffer[x+23]<<8);
+
+	/* ...and then the samples themselves */
+
+	for (x=12; x<bytes-8 && memcmp(buffer+x,"data",4); x++);
+
+	if (x>=bytes-8)
+	{
+		free(buffer);
+		return 0;
+	}
+
+	clip->bytes=buffer[x+4]|(buffer[x+5]<<8)|(buffer[x+6]<<16)|((long)buffer[x+7]<<24);
+
+	if (clip->bytes>bytes-(x+8))
+		clip->bytes=bytes-(x+8);
+
+	clip->pcm=buffer+x+8;
+
+	return 1;
+}
+
+int SayNumber(words, n, num)
+char **words;
+int n, num;
+{
+	/* This function adds the words that speak the number
+	   "num" (0 to 999) to the announcement "words" of n
+	   words, and returns the new length. */
+
+	char string[10];
+
+	sprintf(string,"%4d",num);
+
+	if (string[1]!=32)
+	{
+		words[n++]=sound[string[1]-48].name;
+		words[n++]="hundred";
+	}
+
+	if (string[2]=='1')
+		words[n++]=sound[10+(string[3]-48)].name;
+
+	else if (string[2]>='2' && string[2]<='9')
+		words[n++]=sound[18+(string[2]-48)].name;
+
+	if (string[3]!=32 && string[3]!=0 && string[2]!='1' && string[3]!='0')
+		words[n++]=sound[string[3]-48].name;
+
+	if (string[3]=='0' && string[2]==32 && string[1]==32)
+		words[n++]="zero";
+
+	return n;
+}
+
+void Announce(words, n)
+char **words;
+int n;
+{
+	/* This function queues an announcement of n words
+	   for the audio worker.  If announcements are backed
+	   up, it is dropped, since it would be out of date by
+	   the time it was heard. */
+
+	int x;
+
+	pthread_mutex_lock(&speech_lock);
+
+	if (speech_count<4)
+	{
+		x=(speech_head+speech_count)%4;
+
+		memcpy(speech_queue[x],words,n*sizeof(char *));
+		speech_length[x]=n;
+		speech_count++;
+
+		pthread_cond_signal(&speech_cond);
+	}
+
+	pthread_mutex_unlock(&speech_lock);
+}
+
+void AnnounceEvent(event)
+char *event;
+{
+	/* This function announces an eclipse, sunlight, or
+	   loss of signal, as "vocalizer <event>" once did. */
+
+	char *words[2];
+
+	if (strcmp(event,"los")==0)
+	{
+		words[0]="los";
+		Announce(words,1);
+	}
+
+	else
+	{
+		words[0]="alarm";
+		words[1]=event;
+		Announce(words,2);
+	}
+}
+
+void AnnouncePosition(azimuth, elevation, approaching, visibility)
+int azimuth, elevation;
+char approaching, visibility;
+{
+	/* This function announces the azimuth and elevation of
+	   the satellite being tracked, whether it is approaching
+	   or receding, and whether it is visible. */
+
+	int n;
+	char *words[16];
+
+	words[0]="intro";
+	n=SayNumber(words,1,azimuth);
+	words[n++]="azimuth";
+	n=SayNumber(words,n,elevation);
+	words[n++]="elevation";
+
+	if (approaching=='+')
+		words[n++]="approaching";
+
+	if (approaching=='-')
+		words[n++]="receding";
+
+	if (visibility=='V')
+		words[n++]="visible";
+
+	Announce(words,n);
+}
+
+void *AudioWorker(arg)
+void *arg;
+{
+	/* This function is the body of the thread that speaks
+	   queued announcements through the soundcard.  The sound
+	   device is opened for the length of each announcement,
+	   and set up again only when the format of the samples
+	   changes from one clip to the next. */
+
+	int x, n, dsp, channels, bits, rate;
+	long done;
+	ssize_t written;
+	char *words[16];
+	sound_t *clip;
+
+	while (1)
+	{
+		pthread_mutex_lock(&speech_lock);
+
+		while (speech_count==0)
+			pthread_cond_wait(&speech_cond,&speech_lock);
+
+		n=speech_length[speech_head];
+		memcpy(words,speech_queue[speech_head],n*sizeof(char *));
+		speech_head=(speech_head+1)%4;
+		speech_count--;
+
+		pthread_mutex_unlock(&speech_lock);
+
+		dsp=open("/dev/dsp",O_WRONLY);
+
+		if (dsp==-1)
+			continue;
+
+		channels=0;
+		bits=0;
+		rate=0;
+
+		for (x=0; x<n; x++)
+		{
+			clip=FindSound(words[x]);
+
+			if (clip==NULL || clip->pcm==NULL)
+				continue;
+
+			if (clip->channels!=channels || clip->rate!=rate || clip->bits!=bits)
+			{
+				if (channels)
+					ioctl(dsp,SNDCTL_DSP_SYNC,0);
+
+				channels=clip->channels;
+				rate=clip->rate;
+				bits=clip->bits;
+
+				ioctl(dsp,SOUND_PCM_WRITE_CHANNELS,&channels);
+				ioctl(dsp,SOUND_PCM_WRITE_RATE,&rate);
+				ioctl(dsp,SOUND_PCM_WRITE_BITS,&bits);
+			}
+
+			for (done=0; done<clip->bytes; done+=written)
+			{
+				written=write(dsp,clip->pcm+done,clip->bytes-done);
+
+				if (written<=0)
+					break;
+			}
+		}
+
+		close(dsp);
+	}
+
+	return NULL;
+}
+
+void StartAudio()
+{
+	/* This function loads the announcement clips into
+	   memory, and starts the thread that speaks them. */
+
+	int x;
+	pthread_t thread;
+
+	for (x=0; x<39; x++)
+		LoadSound(&sound[x]);
+
+	pthread_create(&thread,NULL,AudioWorker,NULL);
+	pthread_detach(thread);
+}
+
+void SingleTrack(x,speak)
+int x;
+char speak;
+{
+	/* This function tracks a single satellite in real-time
+	   until 'Q' or ESC is pressed.  x represents the index
+	   of the satellite being tracked.  If speak=='T', then
+	   the speech routines are enabled. */
+
+	int	ans, length, xponder=0,
+		polarity=0, tshift, bshift, mask, ant;
+	char	approaching=0, comsat, aos_alarm=0, rotator=0,
+		geostationary=0, aoshappens=0, decayed=0,
+		eclipse_alarm=0, visibility=0, old_visibility=0;
+	double	oldtime=0.0, nextaos=0.0, lostime=0.0, aoslos=0.0,
+		downlink=0.0, uplink=0.0, downlink_start=0.0,
+		downlink_end=0.0, uplink_start=0.0, uplink_end=0.0,
+		dopp, doppler100=0.0, delay, loss, shift;
+
+	PreCalc(x);
+	indx=x;
+	mask=horizon_id;
+	rotator_sat=x;
+
+	if (sat_db[x].transponders>0)
+	{
+		comsat=1;
+		tshift=0;
+		bshift=0;
+	}
+
+	else
+	{
+		comsat=0;
+		tshift=2;
+		bshift=-2;
+	}
+
+	if (comsat)
+	{
+		downlink_start=sat_db[x].downlink_start[xponder];
+		downlink_end=sat_db[x].downlink_end[xponder];
+		uplink_start=sat_db[x].uplink_start[xponder];
+		uplink_end=sat_db[x].uplink_end[xponder];
+
+		if (downlink_start>downlink_end)
+			polarity=-1;
+
+		if (downlink_start<downlink_end)
+			polarity=1;
+
+		if (downlink_start==downlink_end)
+			polarity=0;
+
+		downlink=0.5*(downlink_start+downlink_end);
+		uplink=0.5*(uplink_start+uplink_end);
+	}
+
+	daynum=CurrentDaynum();
+	aoshappens=AosHappens(indx);
+	geostationary=Geostationary(indx);
+	decayed=Decayed(indx,0.0);
+
+	if (xterm)
+		fprintf(stderr,"\033]0;PREDICT: Tracking %-10s\007",sat[x].name); 
+	halfdelay(2);
+	curs_set(0);
+	bkgdset(COLOR_PAIR(3));
+	clear();
+
+	attrset(COLOR_PAIR(6)|A_REVERSE|A_BOLD);
+
+	printw("                                                                                ");
+	printw("                     PREDICT Real-Time Satellite Tracking                        ");
+	printw("                 Tracking: %-10sOn                                       ",Abbreviate(sat[x].name,9));
+	printw("                                                                                 ");
+
+	attrset(COLOR_PAIR(4)|A_BOLD);
+
+	mvprintw(5+tshift,1,"Satellite     Direction     Velocity     Footprint    Altitude     Slant Range");
+	mvprintw(6+tshift,1,"---------     ---------     --------     ---------    --------     -----------");
+	mvprintw(7+tshift,1,"        .            Az           mi            mi          mi              mi");
+	mvprintw(8+tshift,1,"        .            El           km            km          km              km");
+	mvprintw(16+bshift,1,"Eclipse Depth   Orbital Phase   Orbital Model   Squint Angle      AutoTracking");
+	mvprintw(17+bshift,1,"-------------   -------------   -------------   ------------      ------------");
+
+	if (comsat)
+	{
+		mvprintw(12,1,"Uplink   :");
+		mvprintw(13,1,"Downlink :");
+		mvprintw(14,1,"Delay    :");
+		mvprintw(14,55,"Echo      :");
+		mvprintw(13,29,"RX:");
+		mvprintw(13,55,"Path loss :");
+		mvprintw(12,29,"TX:");
+		mvprintw(12,55,"Path loss :");
+	}
+
+	do
+	{
+		attrset(COLOR_PAIR(6)|A_REVERSE|A_BOLD);
+		daynum=CurrentDaynum();
+		mvprintw(2,41,"%s",Daynum2String(daynum));
+		attrset(COLOR_PAIR(2)|A_BOLD);
+		Calc();
+
+		mvprintw(7+tshift,1,"%-6.2f",(io_lat=='N'?+1:-1)*sat_lat);
+		attrset(COLOR_PAIR(4)|A_BOLD);
+		mvprintw(7+tshift,8,(io_lat=='N'?"N":"S"));
+		mvprintw(8+tshift,8,(io_lon=='W'?"W":"E"));
+
+		fk=12756.33*acos(xkmper/(xkmper+sat_alt));
+		fm=fk*km2mi;
+
+		attrset(COLOR_PAIR(2)|A_BOLD);
+
+		mvprintw(7+tshift,55,"%0.f ",sat_alt*km2mi);
+		mvprintw(8+tshift,55,"%0.f ",sat_alt);
+		mvprintw(7+tshift,68,"%-5.0f",sat_range*km2mi);
+		mvprintw(8+tshift,68,"%-5.0f",sat_range);
+
+		mvprintw(8+tshift,1,"%-7.2f",(io_lon=='W'?360.0-sat_lon:sat_lon));
+		mvprintw(7+tshift,15,"%-7.2f",sat_azi);
+		mvprintw(8+tshift,14,"%+-6.2f",sat_ele);
+		mvprintw(7+tshift,29,"%0.f ",(3600.0*sat_vel)*km2mi);
+		mvprintw(8+tshift,29,"%0.f ",3600.0*sat_vel);
+
+		mvprintw(18+bshift,3,"%+6.2f%c  ",eclipse_depth/deg2rad,176);
+		mvprintw(18+bshift,20,"%5.1f",256.0*(phase/twopi));
+		mvprintw(18+bshift,37,"%s",ephem);
+
+		if (sat_sun_status)
+		{
+			if (sun_ele<=-12.0 && sat_ele>=0.0)
+				visibility='V';
+			else
+				visibility='D';
+		}
+
+		else
+			visibility='N';
+
+		if (comsat)
+		{
+			if (downlink!=0.0)
+				mvprintw(13,11,"%11.5f MHz",downlink);
+
+			else
+				mvprintw(13,11,"               ");
+
+			if (uplink!=0.0)
+				mvprintw(12,11,"%11.5f MHz",uplink);
+
+			else
+				mvprintw(12,11,"               ");
+		}
 
-						/* Update only if TLE epoch >= epoch in data file
-						   so we don't overwrite current data with older
-						   data. */
+		/* Report on the first rotator that
+		   follows the tracking screen */
 
-						if (tle_epoch>=database_epoch)
-						{
-							if (saveflag==0)
-							{
-								if (interactive)
-								{
-									clear();
-									bkgdset(COLOR_PAIR(2));
-									mvprintw(3,35,"Updating.....");
-									refresh();
-									move(7,0);
-								}
-								saveflag=1;
-							}
+		for (ant=0, rotator=0; ant<antennas && rotator==0; ant++)
+			if (antenna[ant].assignments==0)
+				rotator=antenna[ant].state;
 
-							if (interactive)
-							{
-								bkgdset(COLOR_PAIR(3));
-								printw("     %-15s",sat[i].name);
-							}
+		if (rotator==2)
+			mvprintw(18+bshift,67,"Reconnecting");
 
-							savecount++;
+		else if (rotator==1)
+		{
+			if (sat_ele>=0.0)
+				mvprintw(18+bshift,67,"   Active   ");
+			else
+				mvprintw(18+bshift,67,"Standing  By");
+		}
+		else
+			mvprintw(18+bshift,67,"Not  Enabled");
 
-							/* Copy TLE data into the sat data structure */
+		if (calc_squint)
+			mvprintw(18+bshift,52,"%+6.2f",squint);
+		else
+			mvprintw(18+bshift,54,"N/A");
 
-							strncpy(sat[i].line1,line1,69);
-							strncpy(sat[i].line2,line2,69);
-							InternalUpdate(i);
-						}
-					}
+		doppler100=-100.0e06*((sat_range_rate*1000.0)/299792458.0);
+		delay=1000.0*((1000.0*sat_range)/299792458.0);
 
-					 fgets(str0,75,fd);     	
-					 fgets(str1,75,fd);
-					 fgets(str2,75,fd);
+		if (sat_clear>=0.0)
+		{
+			if (aos_alarm==0)
+			{
+				beep();
+				aos_alarm=1;
+			}
+
+			if (comsat)
+			{
+				attrset(COLOR_PAIR(4)|A_BOLD);
+
+				if (fabs(sat_range_rate)<0.1)
+					mvprintw(14,34,"    TCA    ");
+
+				else
+				{
+					if (sat_range_rate<0.0)
+						mvprintw(14,34,"Approaching");
+
+					if (sat_range_rate>0.0)
+						mvprintw(14,34,"  Receding ");
+				}
+
+				attrset(COLOR_PAIR(2)|A_BOLD);
+
+				if (downlink!=0.0)
+				{
+					dopp=1.0e-08*(doppler100*downlink);
+					mvprintw(13,32,"%11.5f MHz",downlink+dopp);
+					loss=32.4+(20.0*log10(downlink))+(20.0*log10(sat_range));
+					mvprintw(13,67,"%7.3f dB",loss);
+					mvprintw(14,13,"%7.3f   ms",delay);
 				}
 
 				else
 				{
-					strcpy(str0,str1);   
-					strcpy(str1,str2);   
-					fgets(str2,75,fd);
+					mvprintw(13,32,"                ");
+					mvprintw(13,67,"          ");
+					mvprintw(14,13,"            ");
 				}
-			
-			} while (feof(fd)==0);
 
-			fclose(fd);
+				if (uplink!=0.0)
+				{
+					dopp=1.0e-08*(doppler100*uplink);
+					mvprintw(12,32,"%11.5f MHz",uplink-dopp);
+					loss=32.4+(20.0*log10(uplink))+(20.0*log10(sat_range));
+					mvprintw(12,67,"%7.3f dB",loss);
+				}
 
-			if (interactive)
-			{
-				bkgdset(COLOR_PAIR(2));
+				else
+				{
+					mvprintw(12,32,"                ");
+					mvprintw(12,67,"          ");
+				}
+
+				if (uplink!=0.0 && downlink!=0.0)
+					mvprintw(14,67,"%7.3f ms",2.0*delay);
 
-				if (kepcount==1)
-					mvprintw(18,21,"  Only 1 NASA Two Line Element was found.");
 				else
-					mvprintw(18,21,"%3u NASA Two Line Elements were read.",kepcount);
+					mvprintw(14,67,"              ");
+			}
 
-				if (saveflag)
+			if (speak=='T' && soundcard)
+			{
+				if (eclipse_alarm==0 && fabs(eclipse_depth)<0.015) /* ~1 deg */
 				{
-					if (savecount==1)
-						mvprintw(19,21,"  Only 1 satellite was updated.");
-					else
+					/* Hold off regular announcements if
+					   satellite is within about 2 degrees
+					   of entering into or out of an
+					   eclipse. */
+
+					oldtime=CurrentDaynum();
+
+					if ((old_visibility=='V' || old_visibility=='D') && visibility=='N')
 					{
-						if (savecount==24)
-							mvprintw(19,21,"  All satellites were updated!");
-						else
-							mvprintw(19,21,"%3u out of 24 satellites were updated.",savecount);
+						AnnounceEvent("eclipse");
+						eclipse_alarm=1;
+						oldtime-=0.000015*sqrt(sat_alt);
+					}
+
+					if (old_visibility=='N' && (visibility=='V' || visibility=='D'))
+					{
+						AnnounceEvent("sunlight");
+						eclipse_alarm=1;
+						oldtime-=0.000015*sqrt(sat_alt);
 					}
 				}
 
-				refresh();
+				if ((CurrentDaynum()-oldtime)>(0.00003*sqrt(sat_alt)))
+				{
+					if (sat_range_rate<0.0)
+						approaching='+';
+
+					if (sat_range_rate>0.0)
+						approaching='-';
+
+					AnnouncePosition((int)rint(sat_azi),(int)rint(sat_ele),approaching,visibility);
+  					oldtime=CurrentDaynum();
+					old_visibility=visibility;
+				}
+
+				if (sat_ele<=1.0 && approaching=='-')
+				{
+					/* Suspend regular announcements
+					   as we approach LOS. */
+
+					oldtime=CurrentDaynum();
+				}
+			}
+		}
+
+		else
+		{
+			lostime=0.0;
+			aos_alarm=0;
+			eclipse_alarm=0;
+
+			if (comsat)
+			{
+				mvprintw(12,32,"                ");
+				mvprintw(12,67,"          ");
+				mvprintw(13,32,"                ");
+				mvprintw(13,67,"          ");
+				mvprintw(14,13,"            ");
+				mvprintw(14,34,"           ");
+				mvprintw(14,67,"          ");
+			}
+		}
+
+		mvprintw(7+tshift,42,"%0.f ",fm);
+		mvprintw(8+tshift,42,"%0.f ",fk);
+
+		attrset(COLOR_PAIR(3)|A_BOLD);
+
+		mvprintw(21,22,"Orbit Number: %ld",rv);
+
+		/* Data is sent to the serial port antenna
+		   tracker by the rotator threads. */
+
+		mvprintw(23,22,"Spacecraft is currently ");
+
+		if (visibility=='V')
+			mvprintw(23,46,"visible    ");
+
+		if (visibility=='D')
+			mvprintw(23,46,"in sunlight");
+
+		if (visibility=='N')
+			mvprintw(23,46,"in eclipse ");
+
+		attrset(COLOR_PAIR(4)|A_BOLD);
+		mvprintw(20,5,"   Sun   ");
+		mvprintw(21,5,"---------");
+		attrset(COLOR_PAIR(3)|A_BOLD);
+		mvprintw(22,5,"%-7.2fAz",sun_azi);
+		mvprintw(23,4,"%+-6.2f  El",sun_ele);
+
+		FindMoon(daynum);
+
+		attrset(COLOR_PAIR(4)|A_BOLD);
+		mvprintw(20,65,"  Moon  ");
+		mvprintw(21,65,"---------");
+		attrset(COLOR_PAIR(3)|A_BOLD);
+		mvprintw(22,65,"%-7.2fAz",moon_az);
+		mvprintw(23,64,"%+-6.2f  El",moon_el);
+
+		if (geostationary==1 && sat_ele>=0.0)
+		{
+			mvprintw(22,22,"Satellite orbit is geostationary");
+			aoslos=-3651.0;
+		}
+
+		if (geostationary==1 && sat_ele<0.0)
+		{
+			mvprintw(22,22,"This satellite never reaches AOS");
+			aoslos=-3651.0;
+		}
+
+		if (aoshappens==0 || decayed==1)
+		{
+			mvprintw(22,22,"This satellite never reaches AOS");
+			aoslos=-3651.0;
+		}
+
+		if (mask!=horizon_id)
+		{
+			/* The horizon mask has changed */
+
+			lostime=0.0;
+			aoslos=0.0;
+			mask=horizon_id;
+		}
+
+		if (sat_clear>=0.0 && geostationary==0 && decayed==0 && daynum>lostime)
+		{
+			lostime=FindLOS2();
+			mvprintw(22,22,"LOS at: %s UTC  ",Daynum2String(lostime));
+			aoslos=lostime;
+		}
+
+		else if (sat_clear<0.0 && geostationary==0 && decayed==0 && aoshappens==1 && daynum>aoslos)
+		{
+			daynum+=0.003;  /* Move ahead slightly... */
+			nextaos=FindAOS();
+			mvprintw(22,22,"Next AOS: %s UTC",Daynum2String(nextaos));
+			aoslos=nextaos;
+
+			if (oldtime!=0.0 && speak=='T' && soundcard)
+			{
+				/* Announce LOS */
+
+				AnnounceEvent("los");
 			}
 		}
 
-		if (interactive)
+		/* The data served through the socket is kept up
+		   to date by the tracking engine.  Only the mode
+		   is reported from here. */
+
+		if (socket_flag)
+			sprintf(tracking_mode, "%s\n%c",sat[indx].name,0);
+
+		/* Get input from keyboard */
+
+		ans=tolower(GetKey());
+
+		/* We can force PREDICT to speak by pressing 'T' */
+
+		if (ans=='t')
+			oldtime=0.0;
+
+		/* If we receive a RELOAD_TLE command through the
+		   socket connection or an 'r' through the keyboard,
+		   reload the TLE file.  */
+
+		if (__atomic_load_n(&reload_tle,__ATOMIC_ACQUIRE) || ans=='r')
 		{
-			noecho();
+			if (__atomic_load_n(&engine_running,__ATOMIC_ACQUIRE))
+				__atomic_store_n(&reload_tle,1,__ATOMIC_RELEASE);
 
-			if (strlen(filename) && fd!=NULL) 
+			else
 			{
-				attrset(COLOR_PAIR(4)|A_BOLD);
-				AnyKey();
+				__atomic_store_n(&reload_tle,0,__ATOMIC_RELEASE);
+				ReadDataFiles();
 			}
 		}
 
-		if (saveflag)
-			SaveTLE();
-	}
-	while (success==0 && interactive);
+		if (comsat)
+		{
+			if (ans==' ' && sat_db[x].transponders>1)
+			{
+				xponder++;
 
-	return (saveflag ? 0 : -1);
-}
+				if (xponder>=sat_db[x].transponders)
+					xponder=0;
 
-int Select()
-{
-	/* This function displays the names of satellites contained
-	   within the program's database and returns an index that
-	   corresponds to the satellite selected by the user.  An
-	   ESC or CR returns a -1. */
+				move(10,1);
+				clrtoeol();
 
-	int x, y, z, key=0;
+				downlink_start=sat_db[x].downlink_start[xponder];
+				downlink_end=sat_db[x].downlink_end[xponder];
+				uplink_start=sat_db[x].uplink_start[xponder];
+				uplink_end=sat_db[x].uplink_end[xponder];
 
-	clear();
+				if (downlink_start>downlink_end)
+					polarity=-1;
 
-	bkgdset(COLOR_PAIR(2)|A_BOLD);
-	printw("\n\n\t\t\t      Select a Satellite:\n\n");
+				if (downlink_start<downlink_end)
+					polarity=1;
 
-	attrset(COLOR_PAIR(3)|A_BOLD);
+				if (downlink_start==downlink_end)
+					polarity=0;
 
-	for (x=0, y=8, z=16; y<16; ++x, ++y, ++z)
-	{
-		printw("\n\t[%c]: %-15s", x+'A', Abbreviate(sat[x].name,15));
-		printw("\t[%c]: %-15s", y+'A', Abbreviate(sat[y].name,15));
-		printw("\t[%c]: %-15s\n", z+'A', Abbreviate(sat[z].name,15));
-	}
+				downlink=0.5*(downlink_start+downlink_end);
+				uplink=0.5*(uplink_start+uplink_end);
+			}
 
-	attrset(COLOR_PAIR(4)|A_BOLD);
+			if (ans=='>' || ans=='.')
+			{
+				if (ans=='>')
+					shift=0.001;  /* 1 kHz */
+				else
+					shift=0.0001; /* 100 Hz */
 
-	printw("\n\n\t\t<< Enter Selection  -  Press [ESC] To Exit >>");
-	refresh();
+				/* Raise uplink frequency */
 
-	do
-	{
-		key=toupper(getch());
+				uplink+=shift*(double)abs(polarity);
+				downlink=downlink+(shift*(double)polarity);
 
-		if (key==27 || key=='\n')
-			return -1;
+				if (uplink>uplink_end)
+				{
+					uplink=uplink_start;
+					downlink=downlink_start;
+				}
+			}
 
-	} while (key<'A' || key>'X');
+			if (ans=='<' || ans== ',')
+			{
+				if (ans=='<')
+					shift=0.001;  /* 1 kHz */
+				else
+					shift=0.0001; /* 100 Hz */
 
-	return(key-'A');
-}
+				/* Lower uplink frequency */
 
-long DayNum(m,d,y)
-int  m, d, y;
-{
-	/* This function calculates the day number from m/d/y. */
+				uplink-=shift*(double)abs(polarity);
+				downlink=downlink-(shift*(double)polarity);
 
-	long dn;
-	double mm, yy;
+				if (uplink<uplink_start)
+				{
+					uplink=uplink_end;
+					downlink=downlink_end;
+				}
+			}
 
-	if (m<3)
-	{ 
-		y--; 
-		m+=12; 
-	}
+			length=strlen(sat_db[x].transponder_name[xponder])/2;
+			mvprintw(10,40-length,"%s",sat_db[x].transponder_name[xponder]);
+		}
 
-	if (y<57)
-		y+=100;
+		refresh();
 
-	yy=(double)y;
-	mm=(double)m;
-	dn=(long)(floor(365.25*(yy-80.0))-floor(19.0+yy/100.0)+floor(4.75+yy/400.0)-16.0);
-	dn+=d+30*m+(long)floor(0.6*mm-0.3);
-	return dn;
+		halfdelay(2);
+
+	} while (ans!='q' && ans!=27);
+
+	cbreak();
+	sprintf(tracking_mode, "NONE\n%c",0);
+	rotator_sat=-1;
 }
 
-double CurrentDaynum()
+void UpdateFrequencies(x)
+int x;
 {
-	/* Read the system clock and return the number
-	   of days since 31Dec79 00:00:00 UTC (daynum 0) */
+	/* This function corrects the uplink and downlink frequencies
+	   of every transponder of satellite x for the Doppler shift
+	   held in doppler[x].  A frequency is only changed once it
+	   has moved by doppler_step Hz or more. */
 
-	/* int x; */
-	struct timeval tptr;
-	double usecs, seconds;
+	int t;
+	double up, down;
 
-	/* x=gettimeofday(&tptr,NULL); */
-	(void)gettimeofday(&tptr,NULL);
+	for (t=0; t<10; t++)
+	{
+		if (t<sat_db[x].transponders)
+		{
+			down=0.5*(sat_db[x].downlink_start[t]+sat_db[x].downlink_end[t]);
+			up=0.5*(sat_db[x].uplink_start[t]+sat_db[x].uplink_end[t]);
 
-	usecs=0.000001*(double)tptr.tv_usec;
-	seconds=usecs+(double)tptr.tv_sec;
+			down+=1.0e-08*(doppler[x]*down);
+			up-=1.0e-08*(doppler[x]*up);
+		}
 
-	return ((seconds/86400.0)-3651.0);
-}
+		else
+		{
+			down=0.0;
+			up=0.0;
+		}
 
-char *Daynum2String(daynum)
-double daynum;
-{
-	/* This function takes the given epoch as a fractional number of
-	   days since 31Dec79 00:00:00 UTC and returns the corresponding
-	   date as a string of the form "Tue 12Oct99 17:22:37". */
+		if (down!=downlink_array[x][t] && (down==0.0 || fabs(down-downlink_array[x][t])>=1.0e-06*doppler_step))
+		{
+			downlink_array[x][t]=down;
+			doppler_changed=1;
+		}
 
-	char timestr[26];
-	time_t t;
-	int x;
+		if (up!=uplink_array[x][t] && (up==0.0 || fabs(up-uplink_array[x][t])>=1.0e-06*doppler_step))
+		{
+			uplink_array[x][t]=up;
+			doppler_changed=1;
+		}
+	}
+}
 
-	/* Convert daynum to Unix time (seconds since 01-Jan-70) */
-	t=(time_t)(86400.0*(daynum+3651.0));
+void CreateFeed()
+{
+	/* This function creates the shared memory Doppler feed.
+	   The feed is simply left out if it can't be created. */
 
-	sprintf(timestr,"%s",asctime(gmtime(&t)));
+	int fd;
+	void *map;
 
-	if (timestr[8]==' ')
-		timestr[8]='0';
+	fd=shm_open(feedname,O_CREAT|O_RDWR,0644);
 
-	for (x=0; x<=3; output[x]=timestr[x], x++);
+	if (fd==-1)
+		return;
 
-	output[4]=timestr[8];
-	output[5]=timestr[9];
-	output[6]=timestr[4];
-	output[7]=timestr[5];
-	output[8]=timestr[6];
-	output[9]=timestr[22];
-	output[10]=timestr[23];
-	output[11]=' ';
+	if (ftruncate(fd,sizeof(feed_t))==0)
+	{
+		map=mmap(NULL,sizeof(feed_t),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
 
-	for (x=12; x<=19; output[x]=timestr[x-1], x++);
+		if (map!=MAP_FAILED)
+		{
+			feed=(feed_t *)map;
+			memset(feed,0,sizeof(feed_t));
+			feed->magic=PREDICT_DOPPLER_MAGIC;
+			feed->version=PREDICT_DOPPLER_VERSION;
+			feed->pid=(int32_t)getpid();
+		}
+	}
 
-	output[20]=0;
-	return output;
+	close(fd);
 }
 
-double GetStartTime(mode)
-char mode;
+void CreateCatalog()
 {
-	/* This function prompts the user for the time and date
-	   the user wishes to begin prediction calculations,
-	   and returns the corresponding fractional day number.
-	   31Dec79 00:00:00 returns 0.  Default is NOW. */
+	/* This function creates the shared memory catalog.
+	   Like the Doppler feed, it is simply left out if it
+	   can't be created. */
 
-	int	x, hr, min, sec ,mm=0, dd=0, yy; 
-	char	good, mon[5], line[30], string[30], bozo_count=0,
-		*month[12]= {"Jan", "Feb", "Mar", "Apr", "May",
-		"Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+	int fd;
+	void *map;
 
-	do
-	{
-		bkgdset(COLOR_PAIR(2)|A_BOLD);
-		clear();
+	fd=shm_open(catalogname,O_CREAT|O_RDWR,0644);
 
-		if (mode=='m')
-			printw("\n\n\n\t     Starting UTC Date and Time for Predictions of the Moon\n\n");
+	if (fd==-1)
+		return;
 
-		if (mode=='o')
-			printw("\n\n\n\t     Starting UTC Date and Time for Predictions of the Sun\n\n");
+	if (ftruncate(fd,sizeof(catalog_t))==0)
+	{
+		map=mmap(NULL,sizeof(catalog_t),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
 
-		if (mode!='m' && mode!='o')
-			printw("\n\n\n\t     Starting UTC Date and Time for Predictions of %-15s\n\n",sat[indx].name);
+		if (map!=MAP_FAILED)
+		{
+			catalog=(catalog_t *)map;
+			memset(catalog,0,sizeof(catalog_t));
+			catalog->magic=PREDICT_CATALOG_MAGIC;
+			catalog->version=PREDICT_CATALOG_VERSION;
+			catalog->pid=(int32_t)getpid();
+		}
+	}
 
-		bozo_count++;
+	close(fd);
+}
 
-		strcpy(string,Daynum2String(CurrentDaynum()));
+void PublishCatalog()
+{
+	/* This function copies the snapshot just published by the
+	   tracking engine to the shared memory catalog.  As the
+	   engine is the only writer of the snapshots, the current
+	   one can be read here without retrying. */
 
-		for (x=4; x<24; x++)
-			string[x-4]=string[x];
+	int x;
+	unsigned int seq;
+	snapshot_t *view;
+	struct predict_sat *entry;
 
-		attrset(COLOR_PAIR(4)|A_BOLD);
-		printw("\t\t    Format: %s -or- ",string);
-		string[7]=0;
-		printw("%s",string);
-		attrset(COLOR_PAIR(2)|A_BOLD);
-		mvprintw(21,30,"Default is `NOW'");
-		attrset(COLOR_PAIR(3)|A_BOLD);
-		mvprintw(13,1,"Enter Start Date & Time >> ");
-		curs_set(1);
-		refresh();
-		echo();
-		string[0]=0;
-		wgetnstr(stdscr,string,29);
-		curs_set(0);
-		noecho();
-		       
-		if (strlen(string)!=0)
-			strcpy(line,string);
-		else
-			/* Select `NOW' */
-			return(CurrentDaynum());
+	if (catalog==NULL)
+		return;
 
-		if (strlen(line)==7)
-		{
-			line[7]=' ';
-			line[8]='0';
-			line[9]='0';
-			line[10]=':';
-			line[11]='0';
-			line[12]='0';
-			line[13]=':';
-			line[14]='0';
-			line[15]='0';
-			line[16]=0;
-		}
-			
-		/* Check Day */
-		good = (isdigit(line[0]) && isdigit(line[1])) ? 1 : 0;
+	view=&snapshot[snapshot_current];
+	seq=catalog->seq;
 
-		/* Month */
-		good = (good && isalpha(line[2]) && isalpha(line[3]) && isalpha(line[4])) ? 1 : 0;
+	__atomic_store_n(&catalog->seq,seq+1,__ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	for (x=0; x<24; x++)
+	{
+		entry=&catalog->sat[x];
+
+		strncpy(entry->name,sat[x].name,24);
+		entry->catnum=(int)sat[x].catnum;
+		entry->orbitnum=(int)view->orbitnum[x];
+		entry->visibility=view->visibility[x];
+		entry->in_view=(sat[x].meanmo!=0.0 && view->el[x]>=Horizon(view->az[x]));
+		entry->az=view->az[x];
+		entry->el=view->el[x];
+		entry->range=view->range[x];
+		entry->range_rate=-view->doppler[x]*299792458.0/100.0e09;
+		entry->lat=view->lat[x];
+		entry->lon=view->lon[x];
+		entry->altitude=view->altitude[x];
+		entry->velocity=view->velocity[x];
+		entry->footprint=view->footprint[x];
+		entry->doppler=view->doppler[x];
+		entry->next_event=rint(86400.0*(view->nextevent[x]+3651.0));
+		entry->phase=view->phase[x];
+		entry->eclipse_depth=view->eclipse_depth[x];
+		entry->squint=view->squint[x];
+	}
 
-		/* Year */
-		good = (good && isdigit(line[5]) && isdigit(line[6]) && (line[7]==' ')) ? 1 : 0;
+	catalog->satellites=24;
+	catalog->generation=(unsigned int)view->generation;
+	catalog->time=86400.0*(view->time+3651.0);
+	catalog->sun_az=view->sun_azi;
+	catalog->sun_el=view->sun_ele;
+	catalog->moon_az=view->moon_az;
+	catalog->moon_el=view->moon_el;
 
-		/* Hour */
-		good = (good && isdigit(line[8]) && isdigit(line[9]) && (line[10]==':')) ? 1 : 0;
+	__atomic_store_n(&catalog->seq,seq+2,__ATOMIC_RELEASE);
+}
 
-		/* Minute */
-		good = (good && isdigit(line[11]) && isdigit(line[12]) && (line[13]==':')) ? 1 : 0;
+void PublishFeed(time)
+double time;
+{
+	/* This function writes the tracking engine's Doppler
+	   corrected frequencies for "time" to the shared memory
+	   feed, if they (or the satellites in view) have changed
+	   since they were last written. */
 
-		/* Seconds */
-		good = (good && isdigit(line[14]) && isdigit(line[15])) ? 1 : 0;
+	int x, t;
+	char in_view[24], changed;
+	uint32_t seq;
 
-	     	if (good)
-		{ 
-			/* Decode Day */
-			dd=10*(line[0]-'0')+line[1]-'0';
+	if (feed==NULL)
+		return;
 
-			/* Decode Month Number */
-			line[2]=toupper(line[2]);
-			line[3]=tolower(line[3]);
-			line[4]=tolower(line[4]);
+	changed=doppler_changed;
 
-			mon[0]=line[2];
-			mon[1]=line[3];
-			mon[2]=line[4];
-			mon[3]=0;
+	for (x=0; x<24; x++)
+	{
+		in_view[x]=(sat[x].meanmo!=0.0 && el_array[x]>=Horizon(az_array[x]));
 
-			for (mm=0; (mm<12 && strcmp(mon,month[mm])!=0); mm++);
+		if (in_view[x]!=feed->sat[x].in_view)
+			changed=1;
+	}
 
-			mm++;
-	
-			good=(mm>12) ? 0 : 1;
-		}
+	if (changed==0)
+		return;
 
-		if (good==0)
-			beep();
+	seq=feed->seq;
 
-	} while (good==0 && bozo_count<6);
+	__atomic_store_n(&feed->seq,seq+1,__ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
 
-	if (good==0)
+	for (x=0; x<24; x++)
 	{
-		/* If the user can't enter the starting date/time
-		   correctly after several attempts, then the user
-		   is a "bozo" and obviously can't follow directions. */
+		strncpy(feed->sat[x].name,sat[x].name,24);
+		feed->sat[x].catnum=sat[x].catnum;
+		feed->sat[x].in_view=in_view[x];
+		feed->sat[x].transponders=sat_db[x].transponders;
 
-		bailout("Too Many Errors");
-		exit(-1);
+		for (t=0; t<10; t++)
+		{
+			strncpy(feed->sat[x].transponder[t],sat_db[x].transponder_name[t],79);
+			feed->sat[x].uplink[t]=uplink_array[x][t];
+			feed->sat[x].downlink[t]=downlink_array[x][t];
+		}
 	}
 
-	/* Decode Year */
-	yy=10*(line[5]-'0')+line[6]-'0';
-
-	/* Decode Time */
-	for (x=8; x<16; x++)
-		string[x-8]=line[x];
+	feed->generation++;
+	feed->time=86400.0*(time+3651.0);
 
-	string[8]=0;
+	__atomic_store_n(&feed->seq,seq+2,__ATOMIC_RELEASE);
 
-	hr=10*(line[8]-'0')+line[9]-'0';
-	min=10*(line[11]-'0')+line[12]-'0';
-	sec=10*(line[14]-'0')+line[15]-'0';
-	
-	return ((double)DayNum(mm,dd,yy)+((hr/24.0)+(min/1440.0)+(sec/86400.0)));
+	doppler_changed=0;
 }
 
-void FindMoon(daynum)
-double daynum;
+double UpdateSatellite(x, time)
+int x;
+double time;
 {
-	/* This function determines the position of the moon, including
-	   the azimuth and elevation headings, relative to the latitude
-	   and longitude of the tracking station.  This code was derived
-	   from a Javascript implementation of the Meeus method for
-	   determining the exact position of the Moon found at:
-	   http://www.geocities.com/s_perona/ingles/poslun.htm. */
-
-	double	jd, ss, t, t1, t2, t3, d, ff, l1, m, m1, ex, om, l,
-		b, w1, w2, bt, p, lm, h, ra, dec, z, ob, n, el, az,
-		teg, th, mm, dv;
+	/* This function recalculates the data served through the
+	   socket for satellite "x" at "time", and returns the time
+	   at which it is next due to be updated.  The satellite's
+	   next AOS and LOS are found again only once they have
+	   passed, and then the AOS is that of the following pass. */
 
-	jd=daynum+2444238.5;
+	char sunstat, inrange;
+	double idle;
 
-	t=(jd-2415020.0)/36525.0;
-	t2=t*t;
-	t3=t2*t;
-	l1=270.434164+481267.8831*t-0.001133*t2+0.0000019*t3;
-	m=358.475833+35999.0498*t-0.00015*t2-0.0000033*t3;
-	m1=296.104608+477198.8491*t+0.009192*t2+0.0000144*t3;
-	d=350.737486+445267.1142*t-0.001436*t2+0.0000019*t3;
-	ff=11.250889+483202.0251*t-0.003211*t2-0.0000003*t3;
-	om=259.183275-1934.142*t+0.002078*t2+0.0000022*t3;
-	om=om*deg2rad;
-	
-	/* Additive terms */
+	idle=time+idle_period/86400.0;
 
-	l1=l1+0.000233*sin((51.2+20.2*t)*deg2rad);
-	ss=0.003964*sin((346.56+132.87*t-0.0091731*t2)*deg2rad);
-	l1=l1+ss+0.001964*sin(om);
-	m=m-0.001778*sin((51.2+20.2*t)*deg2rad);
-	m1=m1+0.000817*sin((51.2+20.2*t)*deg2rad);
-	m1=m1+ss+0.002541*sin(om);
-	d=d+0.002011*sin((51.2+20.2*t)*deg2rad);
-	d=d+ss+0.001964*sin(om);
-	ff=ff+ss-0.024691*sin(om);
-	ff=ff-0.004328*sin(om+(275.05-2.3*t)*deg2rad);
-	ex=1.0-0.002495*t-0.00000752*t2;
-	om=om*deg2rad;
+	if (Decayed(x,time))
+	{
+		az_array[x]=0.0;
+		el_array[x]=0.0;
+		lat_array[x]=0.0;
+		long_array[x]=0.0;
+		footprint_array[x]=0.0;
+		range_array[x]=0.0;
+		altitude_array[x]=0.0;
+		velocity_array[x]=0.0;
+		orbitnum_array[x]=0L;
+		visibility_array[x]='N';
+		eclipse_depth_array[x]=0.0;
+		phase_array[x]=0.0;
+		doppler[x]=0.0;
+		squint_array[x]=0.0;
+		nextevent[x]=-3651.0;
+		return idle;
+	}
 
-	l1=PrimeAngle(l1);
-	m=PrimeAngle(m);
-	m1=PrimeAngle(m1);
-	d=PrimeAngle(d);
-	ff=PrimeAngle(ff);
-	om=PrimeAngle(om);
+	indx=x;
+	daynum=time;
+	PreCalc(x);
 
-	m=m*deg2rad;
-	m1=m1*deg2rad;
-	d=d*deg2rad;
-	ff=ff*deg2rad;
+	/* Satellites in range are fully recalculated once a
+	   second.  In between, only their positions and Doppler
+	   shifts are updated, from interpolated positions. */
 
-	/* Ecliptic Longitude */
+	if (time>=engine_full[x] && time<engine_full[x]+1.0/86400.0)
+	{
+		CalcPosition(&engine_segment[x],x,time);
 
-	l=l1+6.28875*sin(m1)+1.274018*sin(2.0*d-m1)+0.658309*sin(2.0*d);
-	l=l+0.213616*sin(2.0*m1)-ex*0.185596*sin(m)-0.114336*sin(2.0*ff);
-	l=l+0.058793*sin(2.0*d-2.0*m1)+ex*0.057212*sin(2.0*d-m-m1)+0.05332*sin(2.0*d+m1);
-	l=l+ex*0.045874*sin(2.0*d-m)+ex*0.041024*sin(m1-m)-0.034718*sin(d);
-	l=l-ex*0.030465*sin(m+m1)+0.015326*sin(2.0*d-2.0*ff)-0.012528*sin(2.0*ff+m1);
-	
-	l=l-0.01098*sin(2.0*ff-m1)+0.010674*sin(4.0*d-m1)+0.010034*sin(3.0*m1);
-	l=l+0.008548*sin(4.0*d-2.0*m1)-ex*0.00791*sin(m-m1+2.0*d)-ex*0.006783*sin(2.0*d+m);
-	
-	l=l+0.005162*sin(m1-d)+ex*0.005*sin(m+d)+ex*0.004049*sin(m1-m+2.0*d);
-	l=l+0.003996*sin(2.0*m1+2.0*d)+0.003862*sin(4.0*d)+0.003665*sin(2.0*d-3.0*m1);
+		if (sat_clear>=0.0)
+		{
+			az_array[x]=sat_azi;
+			el_array[x]=sat_ele;
+			range_array[x]=sat_range;
+			doppler[x]=-100e06*((sat_range_rate*1000.0)/299792458.0);
+			UpdateFrequencies(x);
 
-	l=l+ex*0.002695*sin(2.0*m1-m)+0.002602*sin(m1-2.0*ff-2.0*d)+ex*0.002396*sin(2.0*d-m-2.0*m1);
+			return time;
+		}
+	}
 
-	l=l-0.002349*sin(m1+d)+ex*ex*0.002249*sin(2.0*d-2.0*m)-ex*0.002125*sin(2.0*m1+m);
+	Calc();
 
-	l=l-ex*ex*0.002079*sin(2.0*m)+ex*ex*0.002059*sin(2.0*d-m1-2.0*m)-0.001773*sin(m1+2.0*d-2.0*ff);
+	if (sat_sun_status)
+	{
+		if (sun_ele<=-12.0 && sat_ele>=0.0)
+			sunstat='V';
+		else
+			sunstat='D';
+	}
 
-	l=l+ex*0.00122*sin(4.0*d-m-m1)-0.00111*sin(2.0*m1+2.0*ff)+0.000892*sin(m1-3.0*d);
+	else
+		sunstat='N';
+
+	az_array[x]=sat_azi;
+	el_array[x]=sat_ele;
+	lat_array[x]=sat_lat;
+	long_array[x]=360.0-sat_lon;
+	footprint_array[x]=fk;
+	range_array[x]=sat_range;
+	altitude_array[x]=sat_alt;
+	velocity_array[x]=sat_vel;
+	orbitnum_array[x]=rv;
+	visibility_array[x]=sunstat;
+	eclipse_depth_array[x]=eclipse_depth/deg2rad;
+	phase_array[x]=360.0*(phase/twopi);
+
+	doppler[x]=-100e06*((sat_range_rate*1000.0)/299792458.0);
+	UpdateFrequencies(x);
 
-	l=l-ex*0.000811*sin(m+m1+2.0*d)+ex*0.000761*sin(4.0*d-m-2.0*m1)+ex*ex*.000717*sin(m1-2.0*m);
+	if (calc_squint)
+		squint_array[x]=squint;
+	else
+		squint_array[x]=360.0;
 
-	l=l+ex*ex*0.000704*sin(m1-2.0*m-2.0*d)+ex*0.000693*sin(m-2.0*m1+2.0*d)+ex*0.000598*sin(2.0*d-m-2.0*ff)+0.00055*sin(m1+4.0*d);
+	inrange=(sat_clear>=0.0);
 
-	l=l+0.000538*sin(4.0*m1)+ex*0.000521*sin(4.0*d-m)+0.000486*sin(2.0*m1-d);
+	if (inrange)
+		engine_full[x]=time;
 
-	l=l-0.001595*sin(2.0*ff+2.0*d);
+	/* Calculate Next Event (AOS/LOS) Times */
 
-	/* Ecliptic latitude */
+	if (Geostationary(x)==1 || AosHappens(x)==0)
+	{
+		nextevent[x]=-3651.0;
+		return (inrange ? time : idle);
+	}
 
-	b=5.128189*sin(ff)+0.280606*sin(m1+ff)+0.277693*sin(m1-ff)+0.173238*sin(2.0*d-ff);
-	b=b+0.055413*sin(2.0*d+ff-m1)+0.046272*sin(2.0*d-ff-m1)+0.032573*sin(2.0*d+ff);
+	if (inrange)
+	{
+		if (time>engine_los[x])
+		{
+			engine_los[x]=FindLOS2();
+			daynum=engine_los[x]+0.014;  /* LOS + 20 minutes */
+			engine_aos[x]=FindAOS();
+		}
 
-	b=b+0.017198*sin(2.0*m1+ff)+9.266999e-03*sin(2.0*d+m1-ff)+0.008823*sin(2.0*m1-ff);
-	b=b+ex*0.008247*sin(2.0*d-m-ff)+0.004323*sin(2.0*d-ff-2.0*m1)+0.0042*sin(2.0*d+ff+m1);
+		nextevent[x]=engine_los[x];
 
-	b=b+ex*0.003372*sin(ff-m-2.0*d)+ex*0.002472*sin(2.0*d+ff-m-m1)+ex*0.002222*sin(2.0*d+ff-m);
+		return time;
+	}
 
-	b=b+0.002072*sin(2.0*d-ff-m-m1)+ex*0.001877*sin(ff-m+m1)+0.001828*sin(4.0*d-ff-m1);
+	if (time>engine_aos[x])
+		engine_aos[x]=FindAOS();
 
-	b=b-ex*0.001803*sin(ff+m)-0.00175*sin(3.0*ff)+ex*0.00157*sin(m1-m-ff)-0.001487*sin(ff+d)-ex*0.001481*sin(ff+m+m1)+ex*0.001417*sin(ff-m-m1)+ex*0.00135*sin(ff-m)+0.00133*sin(ff-d);
+	nextevent[x]=engine_aos[x];
 
-	b=b+0.001106*sin(ff+3.0*m1)+0.00102*sin(4.0*d-ff)+0.000833*sin(ff+4.0*d-m1);
+	if (engine_aos[x]>time && engine_aos[x]<idle)
+		return engine_aos[x];
 
-	b=b+0.000781*sin(m1-3.0*ff)+0.00067*sin(ff+4.0*d-2.0*m1)+0.000606*sin(2.0*d-3.0*ff);
+	return idle;
+}
 
-	b=b+0.000597*sin(2.0*d+2.0*m1-ff)+ex*0.000492*sin(2.0*d+m1-m-ff)+0.00045*sin(2.0*m1-ff-2.0*d);
+char ScheduleBefore(a, b)
+schedule_t *a, *b;
+{
+	/* Ordering used by the tracking engine's schedule */
 
-	b=b+0.000439*sin(3.0*m1-ff)+0.000423*sin(ff+2.0*d+2.0*m1)+0.000422*sin(2.0*d-ff-3.0*m1);
+	if (a->time!=b->time)
+		return (a->time<b->time);
 
-	b=b-ex*0.000367*sin(m+ff+2.0*d-m1)-ex*0.000353*sin(m+ff+2.0*d)+0.000331*sin(ff+4.0*d);
+	return (a->sat<b->sat);
+}
 
-	b=b+ex*0.000317*sin(2.0*d+ff-m+m1)+ex*ex*0.000306*sin(2.0*d-2.0*m-ff)-0.000283*sin(m1+3.0*ff);
+void PushSchedule(heap, n, entry)
+schedule_t *heap, *entry;
+int *n;
+{
+	/* Adds "entry" to the binary min-heap "heap" of *n entries. */
 
-	w1=0.0004664*cos(om*deg2rad);
-	w2=0.0000754*cos((om+275.05-2.3*t)*deg2rad);
-	bt=b*(1.0-w1-w2);
+	int x, parent;
+	schedule_t swap;
 
-	/* Parallax calculations */
+	x=(*n)++;
+	heap[x]=*entry;
 
-	p=0.950724+0.051818*cos(m1)+0.009531*cos(2.0*d-m1)+0.007843*cos(2.0*d)+0.002824*cos(2.0*m1)+0.000857*cos(2.0*d+m1)+ex*0.000533*cos(2.0*d-m)+ex*0.000401*cos(2.0*d-m-m1);
+	while (x>0)
+	{
+		parent=(x-1)/2;
 
-	p=p+0.000173*cos(3.0*m1)+0.000167*cos(4.0*d-m1)-ex*0.000111*cos(m)+0.000103*cos(4.0*d-2.0*m1)-0.000084*cos(2.0*m1-2.0*d)-ex*0.000083*cos(2.0*d+m)+0.000079*cos(2.0*d+2.0*m1);
+		if (ScheduleBefore(&heap[parent],&heap[x]))
+			break;
 
-	p=p+0.000072*cos(4.0*d)+ex*0.000064*cos(2.0*d-m+m1)-ex*0.000063*cos(2.0*d+m-m1);
+		swap=heap[parent];
+		heap[parent]=heap[x];
+		heap[x]=swap;
+		x=parent;
+	}
+}
 
-	p=p+ex*0.000041*cos(m+d)+ex*0.000035*cos(2.0*m1-m)-0.000033*cos(3.0*m1-2.0*d);
+void PopSchedule(heap, n)
+schedule_t *heap;
+int *n;
+{
+	/* Removes the earliest entry from the binary min-heap "heap". */
 
-	p=p-0.00003*cos(m1+d)-0.000029*cos(2.0*ff-2.0*d)-ex*0.000029*cos(2.0*m1+m);
+	int x=0, child;
+	schedule_t swap;
 
-	p=p+ex*ex*0.000026*cos(2.0*d-2.0*m)-0.000023*cos(2.0*ff-2.0*d+m1)+ex*0.000019*cos(4.0*d-m-m1);
+	heap[0]=heap[--(*n)];
 
-	b=bt*deg2rad;
-	lm=l*deg2rad;
-	moon_dx=3.0/(pi*p);
+	while ((child=2*x+1)<*n)
+	{
+		if (child+1<*n && ScheduleBefore(&heap[child+1],&heap[child]))
+			child++;
 
-	/* Semi-diameter calculation */
-	/* sem=10800.0*asin(0.272488*p*deg2rad)/pi; */
+		if (ScheduleBefore(&heap[x],&heap[child]))
+			break;
 
-	/* Convert ecliptic coordinates to equatorial coordinates */
+		swap=heap[x];
+		heap[x]=heap[child];
+		heap[child]=swap;
+		x=child;
+	}
+}
 
-	z=(jd-2415020.5)/365.2422;
-	ob=23.452294-(0.46845*z+5.9e-07*z*z)/3600.0;
-	ob=ob*deg2rad;
-	dec=asin(sin(b)*cos(ob)+cos(b)*sin(ob)*sin(lm));
-	ra=acos(cos(b)*cos(lm)/cos(dec));
-	
-	if (lm>pi)
-		ra=twopi-ra;
+void *TrackingEngine(arg)
+void *arg;
+{
+	/* This function is the body of the tracking engine thread.
+	   Satellites are kept in a schedule ordered by the time at
+	   which each is next due to be updated.  Each tick updates
+	   only the satellites that have come due, so satellites in
+	   range are updated every tick while the others are updated
+	   at the idle rate, or at AOS.  The positions of the Sun and
+	   Moon are updated every tick.  Ticks are scheduled against
+	   absolute deadlines of the monotonic clock, so the time
+	   spent calculating doesn't accumulate as drift.  A tick
+	   that runs past its deadline moves the schedule back
+	   rather than being followed by a burst of catch-up ticks.
+	   The engine also reloads the data files when asked to.
+	   Its state is published in a snapshot after every tick. */
+
+	int x, n=0, mask=-1, due;
+	long period;
+	double now;
+	schedule_t heap[24], done[24];
+	struct timespec next, clock;
+
+	period=(long)(1.0e9/track_rate);
+	clock_gettime(CLOCK_MONOTONIC,&next);
 
-	/* ra = right ascension */
-	/* dec = declination */
+	while (1)
+	{
+		/* A reload asked for while the files are
+		   being read is made on the next tick */
 
-	n=qth.stnlat*deg2rad;    /* North latitude of tracking station */
+		if (__atomic_exchange_n(&reload_tle,0,__ATOMIC_ACQ_REL))
+		{
+			ReadDataFiles();
+			mask=-1;
+		}
 
-	/* Find siderial time in radians */
+		HoldData('r');
 
-	t=(jd-2451545.0)/36525.0;
-	teg=280.46061837+360.98564736629*(jd-2451545.0)+(0.000387933*t-t*t/38710000.0)*t;
+		now=CurrentDaynum();
 
-	while (teg>360.0)
-		teg-=360.0;
+		/* Start over with new orbital data or
+		   a different horizon mask, discarding
+		   the AOS/LOS times found with the old */
 
-	th=FixAngle((teg-qth.stnlong)*deg2rad);
-	h=th-ra;
+		if (mask!=horizon_id)
+		{
+			for (x=0, n=0; x<24; x++)
+			{
+				engine_aos[x]=0.0;
+				engine_los[x]=0.0;
+				engine_full[x]=0.0;
 
-	az=atan2(sin(h),cos(h)*sin(n)-tan(dec)*cos(n))+pi;
-	el=asin(sin(n)*sin(dec)+cos(n)*cos(dec)*cos(h));
+				if (sat[x].meanmo!=0.0)
+				{
+					done[0].time=now;
+					done[0].sat=x;
+					PushSchedule(heap,&n,&done[0]);
+				}
+			}
 
-	moon_az=az/deg2rad;
-	moon_el=el/deg2rad;
+			mask=horizon_id;
+		}
 
-	/* Radial velocity approximation.  This code was derived
-	   from "Amateur Radio Software", by John Morris, GM4ANB,
-	   published by the RSGB in 1985. */
+		/* Update the satellites that are due, and
+		   put them back on the schedule afterwards */
 
-	mm=FixAngle(1.319238+daynum*0.228027135);  /* mean moon position */
-	t2=0.10976;
-	t1=mm+t2*sin(mm);
-	dv=0.01255*moon_dx*moon_dx*sin(t1)*(1.0+t2*cos(mm));
-	dv=dv*4449.0;
-	t1=6378.0;
-	t2=384401.0;
-	t3=t1*t2*(cos(dec)*cos(n)*sin(h));
-	t3=t3/sqrt(t2*t2-t2*t1*sin(el));
-	moon_dv=dv+t3*0.0753125;
+		for (due=0; n>0 && heap[0].time<=now; due++)
+		{
+			done[due].sat=heap[0].sat;
+			done[due].time=UpdateSatellite(heap[0].sat,now);
+			PopSchedule(heap,&n);
+		}
 
-	moon_dec=dec/deg2rad;
-	moon_ra=ra/deg2rad;
-	moon_gha=teg-moon_ra;
+		for (x=0; x<due; x++)
+			PushSchedule(heap,&n,&done[x]);
 
-	if (moon_gha<0.0)
-		moon_gha+=360.0;
-}
+		FindSun(now);
+		FindMoon(now);
+		PublishSnapshot(now);
+		PublishCatalog();
+		PublishFeed(now);
+		HoldData(0);
 
-void FindSun(daynum)
-double daynum;
-{
-	/* This function finds the position of the Sun */
+		next.tv_nsec+=period;
 
-	/* Zero vector for initializations */
-	vector_t zero_vector={0,0,0,0};
+		while (next.tv_nsec>=1000000000L)
+		{
+			next.tv_nsec-=1000000000L;
+			next.tv_sec++;
+		}
 
-	/* Solar ECI position vector  */
-	vector_t solar_vector=zero_vector;
+		clock_gettime(CLOCK_MONOTONIC,&clock);
 
-	/* Solar observed azi and ele vector  */
-	vector_t solar_set=zero_vector;
+		if (clock.tv_sec>next.tv_sec || (clock.tv_sec==next.tv_sec && clock.tv_nsec>next.tv_nsec))
+			next=clock;
 
-	/* Solar right ascension and declination vector */
-	vector_t solar_rad=zero_vector;
+		clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&next,NULL);
+	}
 
-	/* Solar lat, long, alt vector */
-	geodetic_t solar_latlonalt;
+	return NULL;
+}
 
-	jul_utc=daynum+2444238.5;
+void Terminate(sig)
+int sig;
+{
+	/* This signal handler removes the shared memory segments
+	   when PREDICT is terminated by SIGTERM or SIGINT, so they
+	   aren't left behind for clients to find.  The signal is
+	   then passed on to the handler it replaced (that of curses,
+	   which restores the terminal), or PREDICT dies of it. */
 
-	Calculate_Solar_Position(jul_utc, &solar_vector);
-	Calculate_Obs(jul_utc, &solar_vector, &zero_vector, &obs_geodetic, &solar_set);
-	sun_azi=Degrees(solar_set.x); 
-	sun_ele=Degrees(solar_set.y);
-	sun_range=1.0+((solar_set.z-AU)/AU);
-	sun_range_rate=1000.0*solar_set.w;
+	struct sigaction *old;
 
-	Calculate_LatLonAlt(jul_utc, &solar_vector, &solar_latlonalt);
+	if (feed!=NULL)
+		shm_unlink(feedname);
 
-	sun_lat=Degrees(solar_latlonalt.lat);
-	sun_lon=360.0-Degrees(solar_latlonalt.lon);
+	if (catalog!=NULL)
+		shm_unlink(catalogname);
 
-	Calculate_RADec(jul_utc, &solar_vector, &zero_vector, &obs_geodetic, &solar_rad);
+	old=(sig==SIGTERM ? &old_sigterm : &old_sigint);
 
-	sun_ra=Degrees(solar_rad.x);
-	sun_dec=Degrees(solar_rad.y);
+	if (old->sa_handler!=SIG_DFL && old->sa_handler!=SIG_IGN)
+		old->sa_handler(sig);
+
+	signal(sig,SIG_DFL);
+	raise(sig);
 }
 
-void PreCalc(x)
-int x;
+void StartEngine()
 {
-	/* This function copies TLE data from PREDICT's sat structure
-	   to the SGP4/SDP4's single dimensioned tle structure, and
-	   prepares the tracking code for the update. */
+	/* This function starts the tracking engine
+	   thread unless it is already running. */
 
-	strcpy(tle.sat_name,sat[x].name);
-	strcpy(tle.idesg,sat[x].designator);
-	tle.catnr=sat[x].catnum;
-	tle.epoch=(1000.0*(double)sat[x].year)+sat[x].refepoch;
-	tle.xndt2o=sat[x].drag;
-	tle.xndd6o=sat[x].nddot6;
-	tle.bstar=sat[x].bstar;
-	tle.xincl=sat[x].incl;
-	tle.xnodeo=sat[x].raan;
-	tle.eo=sat[x].eccn;
-	tle.omegao=sat[x].argper;
-	tle.xmo=sat[x].meanan;
-	tle.xno=sat[x].meanmo;
-	tle.revnum=sat[x].orbitnum;
+	pthread_t thread;
+	struct sigaction action;
 
-	if (sat_db[x].squintflag)
+	if (__atomic_load_n(&engine_running,__ATOMIC_ACQUIRE)==0)
 	{
-		calc_squint=1;
-		alat=deg2rad*sat_db[x].alat;
-		alon=deg2rad*sat_db[x].alon;
-	}
-	else
-		calc_squint=0;
- 
-	/* Clear all flags */
+		CreateFeed();
+		CreateCatalog();
 
-	ClearFlag(ALL_FLAGS);
+		memset(&action,0,sizeof(action));
+		action.sa_handler=Terminate;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGTERM,&action,&old_sigterm);
+		sigaction(SIGINT,&action,&old_sigint);
 
-	/* Select ephemeris type.  This function will set or clear the
-	   DEEP_SPACE_EPHEM_FLAG depending on the TLE parameters of the
-	   satellite.  It will also pre-process tle members for the
-	   ephemeris functions SGP4 or SDP4, so this function must
-	   be called each time a new tle set is used. */
+		/* Leave ignored signals ignored */
 
-	select_ephemeris(&tle);
+		if (old_sigterm.sa_handler==SIG_IGN)
+			sigaction(SIGTERM,&old_sigterm,NULL);
+
+		if (old_sigint.sa_handler==SIG_IGN)
+			sigaction(SIGINT,&old_sigint,NULL);
+		__atomic_store_n(&engine_running,1,__ATOMIC_RELEASE);
+		pthread_create(&thread,NULL,TrackingEngine,NULL);
+		pthread_detach(thread);
+	}
 }
 
-void Calc()
+void MultiTrack()
 {
-	/* This is the stuff we need to do repetitively while tracking. */
-
-	/* Zero vector for initializations */
-	vector_t zero_vector={0,0,0,0};
+	/* This function tracks all satellites in the program's
+	   database simultaneously until 'Q' or ESC is pressed.
+	   Satellites in range are HIGHLIGHTED.  Coordinates
+	   for the Sun and Moon are also displayed.  All of the
+	   data displayed is calculated by the tracking engine,
+	   which is started here if it isn't already running. */
 
-	/* Satellite position and velocity vectors */
-	vector_t vel=zero_vector;
-	vector_t pos=zero_vector;
+	int		x, y, z, ans;
 
-	/* Satellite Az, El, Range, Range rate */
-	vector_t obs_set;
+	unsigned char	satindex[24], ok2predict[24];
 
-	/* Solar ECI position vector  */
-	vector_t solar_vector=zero_vector;
+	double		aos2[24], temptime, nextcalctime=0.0;
 
-	/* Solar observed azi and ele vector  */
-	vector_t solar_set;
+	snapshot_t	view;
 
-	/* Satellite's predicted geodetic position */
-	geodetic_t sat_geodetic;
+	if (xterm)
+		fprintf(stderr,"\033]0;PREDICT: Multi-Satellite Tracking Mode\007");
 
-	jul_utc=daynum+2444238.5;
+	curs_set(0);
+	attrset(COLOR_PAIR(6)|A_REVERSE|A_BOLD);
+	clear();
 
-	/* Convert satellite's epoch time to Julian  */
-	/* and calculate time since epoch in minutes */
+	printw("                                                                                ");
+	printw("                     PREDICT Real-Time Multi-Tracking Mode                      ");
+	printw("                    Current Date/Time:                                          ");
+	printw("                                                                                ");
 
-	jul_epoch=Julian_Date_of_Epoch(tle.epoch);
-	tsince=(jul_utc-jul_epoch)*xmnpda;
-	age=jul_utc-jul_epoch;
+	attrset(COLOR_PAIR(2)|A_REVERSE);
 
-	/* Copy the ephemeris type in use to ephem string. */
+	printw(" Satellite  Az   El %s  %s  Range  | Satellite  Az   El %s  %s  Range   ",(io_lat=='N'?"LatN":"LatS"),(io_lon=='W'?"LonW":"LonE"),(io_lat=='N'?"LatN":"LatS"),(io_lon=='W'?"LonW":"LonE"));
 
-		if (isFlagSet(DEEP_SPACE_EPHEM_FLAG))
-			strcpy(ephem,"SDP4");
+	for (x=0; x<24; x++)
+	{
+		if (Geostationary(x)==0 && AosHappens(x)==1 && Decayed(x,0.0)!=1)
+			ok2predict[x]=1;
 		else
-			strcpy(ephem,"SGP4");
+			ok2predict[x]=0;
 
-	/* Call NORAD routines according to deep-space flag. */
+		aos2[x]=0.0;
+	}
 
-	if (isFlagSet(DEEP_SPACE_EPHEM_FLAG))
-		SDP4(tsince, &tle, &pos, &vel);
-	else
-		SGP4(tsince, &tle, &pos, &vel);
+	StartEngine();
 
-	/* Scale position and velocity vectors to km and km/sec */
+	do
+	{
+		ReadSnapshot(&view);
 
-	Convert_Sat_State(&pos, &vel);
+		for (z=0; z<24; z++)
+		{
+			y=z/2;
 
-	/* Calculate velocity of satellite */
+			if (z%2)
+			{
+				indx=y+12;
+				x=41;
+			}
 
-	Magnitude(&vel);
-	sat_vel=vel.w;
+			else
+			{
+				indx=y;
+				x=1;
+			}
 
-	/** All angles in rads. Distance in km. Velocity in km/s **/
-	/* Calculate satellite Azi, Ele, Range and Range-rate */
+			if (sat[indx].meanmo!=0.0 && Decayed(indx,0.0)!=1)
+			{
+				if (view.el[indx]>=Horizon(view.az[indx]))
+					attrset(COLOR_PAIR(2)|A_BOLD);
+				else
+					attrset(COLOR_PAIR(2));
 
-	Calculate_Obs(jul_utc, &pos, &vel, &obs_geodetic, &obs_set);
+				mvprintw(y+6,x,"%-10s%3.0f  %+3.0f  %3.0f   %3.0f %6.0f %c", Abbreviate(sat[indx].name,9),view.az[indx],view.el[indx],(io_lat=='N'?+1:-1)*view.lat[indx],(io_lon=='W'?view.lon[indx]:360.0-view.lon[indx]),view.range[indx],view.visibility[indx]);
 
-	/* Calculate satellite Lat North, Lon East and Alt. */
+				if (socket_flag)
+					sprintf(tracking_mode,"MULTI\n%c",0);
 
-	Calculate_LatLonAlt(jul_utc, &pos, &sat_geodetic);
+				aos2[indx]=view.aos[indx];
+				satindex[indx]=indx;
+			}
 
-	/* Calculate squint angle */
+			if (Decayed(indx,0.0))
+			{
+				attrset(COLOR_PAIR(2));
+				mvprintw(y+6,x,"%-10s---------- Decayed ---------", Abbreviate(sat[indx].name,9));
+			}
+ 		}
 
-	if (calc_squint)
-		squint=(acos(-(ax*rx+ay*ry+az*rz)/obs_set.z))/deg2rad;
+		attrset(COLOR_PAIR(4)|A_BOLD);
+		mvprintw(20,5,"   Sun   ");
+		mvprintw(21,5,"---------");
+		attrset(COLOR_PAIR(3)|A_BOLD);
+		mvprintw(22,5,"%-7.2fAz",view.sun_azi);
+		mvprintw(23,4,"%+-6.2f  El",view.sun_ele);
 
-	/* Calculate solar position and satellite eclipse depth. */
-	/* Also set or clear the satellite eclipsed flag accordingly. */
+		attrset(COLOR_PAIR(4)|A_BOLD);
+		mvprintw(20,65,"  Moon  ");
+		mvprintw(21,65,"---------");
+		attrset(COLOR_PAIR(3)|A_BOLD);
+		mvprintw(22,65,"%-7.2fAz",view.moon_az);
+		mvprintw(23,64,"%+-6.2f  El",view.moon_el);
 
-	Calculate_Solar_Position(jul_utc, &solar_vector);
-	Calculate_Obs(jul_utc, &solar_vector, &zero_vector, &obs_geodetic, &solar_set);
+		attrset(COLOR_PAIR(6)|A_REVERSE|A_BOLD);
 
-	if (Sat_Eclipsed(&pos, &solar_vector, &eclipse_depth))
-		SetFlag(SAT_ECLIPSED_FLAG);
-	else
-		ClearFlag(SAT_ECLIPSED_FLAG);
+		daynum=CurrentDaynum();
+		mvprintw(2,39,"%s",Daynum2String(daynum));
 
-	if (isFlagSet(SAT_ECLIPSED_FLAG))
-		sat_sun_status=0;  /* Eclipse */
-	else
-		sat_sun_status=1; /* In sunlight */
+		if (daynum>nextcalctime)
+		{
+			/* Bubble sort the AOS times */
 
-	/* Convert satellite and solar data */
-	sat_azi=Degrees(obs_set.x);
-	sat_ele=Degrees(obs_set.y);
-	sat_range=obs_set.z;
-	sat_range_rate=obs_set.w;
-	sat_lat=Degrees(sat_geodetic.lat);
-	sat_lon=Degrees(sat_geodetic.lon);
-	sat_alt=sat_geodetic.alt;
+			for (z=22; z>=0; z--)
+				for (y=0; y<=z; y++)
+					if (aos2[y]>=aos2[y+1])
+					{
+						temptime=aos2[y];
+						aos2[y]=aos2[y+1];
+						aos2[y+1]=temptime;
 
-	fk=12756.33*acos(xkmper/(xkmper+sat_alt));
-	fm=fk/1.609344;
+						x=satindex[y];
+						satindex[y]=satindex[y+1];
+						satindex[y+1]=x;
+					}
 
-	rv=(long)floor((tle.xno*xmnpda/twopi+age*tle.bstar*ae)*age+tle.xmo/twopi)+tle.revnum;
+			/* Display list of upcoming passes */
 
-	sun_azi=Degrees(solar_set.x); 
-	sun_ele=Degrees(solar_set.y);
+			attrset(COLOR_PAIR(4)|A_BOLD);
+			mvprintw(19,31,"Upcoming Passes");
+			mvprintw(20,31,"---------------");
+			attrset(COLOR_PAIR(3)|A_BOLD);
 
-	irk=(long)rint(sat_range);
-	isplat=(int)rint(sat_lat);
-	isplong=(int)rint(360.0-sat_lon);
-	iaz=(int)rint(sat_azi);
-	iel=(int)rint(sat_ele);
-	ma256=(int)rint(256.0*(phase/twopi));
+			for (x=0, y=0, z=-1; x<21 && y!=3; x++)
+			{
+				if (ok2predict[satindex[x]] && aos2[x]!=0.0)
+				{
+					mvprintw(y+21,19,"%10s on %s UTC",Abbreviate(sat[(int)satindex[x]].name,9),Daynum2String(aos2[x]));
 
-	if (sat_sun_status)
-	{
-		if (sun_ele<=-12.0 && rint(sat_ele)>=0.0)
-			findsun='+';
-		else
-			findsun='*';
-	}
-	else
-		findsun=' ';
+					if (z==-1)
+						z=x;
+					y++;
+				}
+			}
+
+			if (z!=-1)
+				nextcalctime=aos2[z];
+		}
+
+		refresh();
+		halfdelay(2);  /* Increase if CPU load is too high */
+		ans=tolower(GetKey());
+
+		/* If we receive a RELOAD_TLE command through the
+		   socket connection, or an 'r' through the keyboard,
+		   have the tracking engine reload the TLE file. */
+
+		if (__atomic_load_n(&reload_tle,__ATOMIC_ACQUIRE) || ans=='r')
+		{
+			__atomic_store_n(&reload_tle,1,__ATOMIC_RELEASE);
+			nextcalctime=0.0;
+		}
+
+	} while (ans!='q' && ans!=27);
+
+	cbreak();
+	sprintf(tracking_mode, "NONE\n%c",0);
 }
 
-char AosHappens(x)
-int x;
+void ShadowAngles(time, umbra, penumb)
+double time, *umbra, *penumb;
 {
-	/* This function returns a 1 if the satellite pointed to by
-	   "x" can ever rise above the horizon of the ground station. */
+	/* This function returns the angular depth of the current
+	   satellite within the Earth's umbra and penumbra at "time".
+	   Each is positive while the satellite is inside the shadow
+	   and negative while it is outside.  Only the satellite's
+	   state vector is needed, so Propagate() is used. */
+
+	double sd_sun, sd_earth, delta;
+	vector_t pos, vel, sol, Rho, earth;
+
+	Propagate(time, &pos, &vel);
+	Calculate_Solar_Position(time+2444238.5, &sol);
+
+	sd_earth=ArcSin(xkmper/pos.w);
+	Vec_Sub(&sol,&pos,&Rho);
+	sd_sun=ArcSin(sr/Rho.w);
+	Scalar_Multiply(-1,&pos,&earth);
+	delta=Angle(&sol,&earth);
 
-	double lin, sma, apogee;
+	*umbra=sd_earth-sd_sun-delta;
+	*penumb=sd_earth+sd_sun-delta;
+}
 
-	if (sat[x].meanmo==0.0)
-		return 0;
-	else
-	{
-		lin=sat[x].incl;
+double UmbraFunction(time)
+double time;
+{
+	/* Negative while the satellite is in the umbra */
 
-		if (lin>=90.0)
-			lin=180.0-lin;
+	double umbra, penumb;
 
-		sma=331.25*exp(log(1440.0/sat[x].meanmo)*(2.0/3.0));
-		apogee=sma*(1.0+sat[x].eccn)-xkmper;
+	ShadowAngles(time,&umbra,&penumb);
 
-		if ((acos(xkmper/(apogee+xkmper))+(lin*deg2rad)) > fabs(qth.stnlat*deg2rad))
-			return 1;
-		else
-			return 0;
-	}
+	return -umbra;
 }
 
-char Decayed(x,time)
-int x;
+double PenumbraFunction(time)
 double time;
 {
-	/* This function returns a 1 if it appears that the
-	   satellite pointed to by 'x' has decayed at the
-	   time of 'time'.  If 'time' is 0.0, then the
-	   current date/time is used. */
-
-	double satepoch;
+	/* Negative while the satellite is in the penumbra or umbra */
 
-	if (time==0.0)
-		time=CurrentDaynum();
+	double umbra, penumb;
 
-	satepoch=DayNum(1,0,sat[x].year)+sat[x].refepoch;
+	ShadowAngles(time,&umbra,&penumb);
 
-	if (satepoch+((16.666666-sat[x].meanmo)/(10.0*fabs(sat[x].drag))) < time)
-		return 1;
-	else
-		return 0;
+	return -penumb;
 }
 
-char Geostationary(x)
+void IlluminationJob(x)
 int x;
 {
-	/* This function returns a 1 if the satellite pointed
-	   to by "x" appears to be in a geostationary orbit */
+	/* This function finds the eclipses of satellite illum_sat
+	   during day "x" of the illumination engine's window, and
+	   integrates the fraction of the day spent in sunlight.
+	   The shadow function is sampled every 10 degrees of mean
+	   anomaly (and at least every 15 minutes), and each entry
+	   and exit is found by root-finding. */
+
+	int y, z, n, m;
+	double step, dark, umbral[40][2], penumbral[40][2];
+	illum_t *day;
+
+	day=&illum_day[x];
+	day->start=illum_start+(double)x;
+	day->end=illum_start+(double)(x+1);
+	day->count=0;
+	day->sunlit=1.0;
+
+	if (day->end>illum_end)
+		day->end=illum_end;
+
+	if (day->end<=day->start)
+		return;
 
-	if (fabs(sat[x].meanmo-1.0027)<0.0002) 
+	PreCalc(illum_sat);
 
-		return 1;
-	else
-		return 0;
-}
+	step=1.0/(36.0*sat[illum_sat].meanmo);
 
-double FindAOS()
-{
-	/* This function finds and returns the time of AOS (aostime). */
+	if (step>0.01)
+		step=0.01;
 
-	aostime=0.0;
+	n=NegativeIntervals(UmbraFunction,day->start,day->end,step,umbral,40);
 
-	if (AosHappens(indx) && Geostationary(indx)==0 && Decayed(indx,daynum)==0)
+	for (y=0, dark=0.0; y<n; y++)
+		dark+=umbral[y][1]-umbral[y][0];
+
+	if (penumbra)
 	{
-		Calc();
+		/* Each umbral interval lies within a penumbral one */
 
-		/* Get the satellite in range */
+		m=NegativeIntervals(PenumbraFunction,day->start,day->end,step,penumbral,40);
 
-		while (sat_ele<-1.0)
+		for (y=0, z=0; y<m; y++)
 		{
-			daynum-=0.00035*(sat_ele*((sat_alt/8400.0)+0.46)-2.0);
-			Calc();
+			day->eclipse[y].penumbra_entry=penumbral[y][0];
+			day->eclipse[y].penumbra_exit=penumbral[y][1];
+			day->eclipse[y].entry=0.0;
+			day->eclipse[y].exit=0.0;
+
+			if (z<n && umbral[z][0]>=penumbral[y][0] && umbral[z][1]<=penumbral[y][1])
+			{
+				day->eclipse[y].entry=umbral[z][0];
+				day->eclipse[y].exit=umbral[z][1];
+				z++;
+			}
+
+			dark+=0.5*(penumbral[y][1]-penumbral[y][0]-(day->eclipse[y].exit-day->eclipse[y].entry));
 		}
 
-		/* Find AOS */
+		day->count=m;
+	}
 
-		while (aostime==0.0)
+	else
+	{
+		for (y=0; y<n; y++)
 		{
-			if (fabs(sat_ele)<0.03)
-				aostime=daynum;
-			else
-			{
-				daynum-=sat_ele*sqrt(sat_alt)/530000.0;
-				Calc();
-			}
+			day->eclipse[y].entry=umbral[y][0];
+			day->eclipse[y].exit=umbral[y][1];
+			day->eclipse[y].penumbra_entry=umbral[y][0];
+			day->eclipse[y].penumbra_exit=umbral[y][1];
 		}
+
+		day->count=n;
 	}
 
-	return aostime;
+	day->sunlit=1.0-dark/(day->end-day->start);
 }
 
-double FindLOS()
+void Illuminate(x, start, end)
+int x;
+double start, end;
 {
-	lostime=0.0;
-
-	if (Geostationary(indx)==0 && AosHappens(indx)==1 && Decayed(indx,daynum)==0)
-	{
-		Calc();
-
-		do
-		{
-			daynum+=sat_ele*sqrt(sat_alt)/502500.0;
-			Calc();
+	/* This is the illumination engine.  It finds the eclipses
+	   of satellite "x" between "start" and "end", along with
+	   the fraction of each day spent in sunlight, and leaves
+	   the results in illum_day[].  Days are computed in
+	   parallel by the worker pool. */
 
-			if (fabs(sat_ele) < 0.03)
-				lostime=daynum;
+	illum_sat=x;
+	illum_start=start;
+	illum_end=end;
+	illum_days=(int)ceil(end-start);
 
-		} while (lostime==0.0);
-	}
+	illum_day=(illum_t *)realloc(illum_day,illum_days*sizeof(illum_t));
 
-	return lostime;
+	RunWorkers(illum_days,IlluminationJob);
 }
 
-double FindLOS2()
+void Illumination()
 {
-	/* This function steps through the pass to find LOS.
-	   FindLOS() is called to "fine tune" and return the result. */
+	double startday;
+	int x, quit=0, breakout=0;
+	char string1[365], string[725], datestring[25];
+
+	startday=floor(GetStartTime(0));
+
+	curs_set(0);
+	clear();
+
+	if (xterm)
+		fprintf(stderr,"\033]0;PREDICT: %s's Solar Illumination Calendar For %s\007",qth.callsign, sat[indx].name);
 
 	do
 	{
-		daynum+=cos((sat_ele-1.0)*deg2rad)*sqrt(sat_alt)/25000.0;
-		Calc();
+		attrset(COLOR_PAIR(4));
+		mvprintw(23,6,"                 Calculating... Press [ESC] To Quit");
+		refresh();
 
-	} while (sat_ele>=0.0);
+		/* Each screen shows two columns of 18 days */
 
-	return(FindLOS());
-}
+		Illuminate(indx,startday,startday+36.0);
 
-double NextAOS()
-{
-	/* This function finds and returns the time of the next
-	   AOS for a satellite that is currently in range. */
+		for (x=0; x<18 && quit!=1; x++)
+		{
+			strcpy(datestring,Daynum2String(illum_day[x].start));
+			datestring[11]=0;
+			sprintf(string1,"      %s    %4d    %6.2f%c",datestring,(int)rint(1440.0*illum_day[x].sunlit),100.0*illum_day[x].sunlit,37);
+
+			strcpy(datestring,Daynum2String(illum_day[x+18].start));
+			datestring[11]=0;
+			sprintf(string,"%s\t %s    %4d    %6.2f%c\n",string1,datestring,(int)rint(1440.0*illum_day[x+18].sunlit),100.0*illum_day[x+18].sunlit,37);
+			quit=Print(string,'s');
+		}
 
-	aostime=0.0;
+		/* Allow a quick way out */
 
-	if (AosHappens(indx) && Geostationary(indx)==0 && Decayed(indx,daynum)==0)
-		daynum=FindLOS2()+0.014;  /* Move to LOS + 20 minutes */
+		nodelay(stdscr,TRUE);
 
-	return (FindAOS());
+		if (GetKey()==27)
+			breakout=1;
+
+		nodelay(stdscr,FALSE);
+
+		startday+=36.0;
+	}
+	while (quit!=1 && breakout!=1 && Decayed(indx,startday)==0);
 }
 
-int Print(string,mode)
-char *string, mode;
+void MainMenu()
 {
-	/* This function buffers and displays orbital predictions
-	   and allows screens to be saved to a disk file. */
+	/* Start-up menu.  Your wish is my command. :-) */
 
-	char type[20], spaces[80], head1[160], head2[70],
-	     head3[72], satellite_name[25];
-	int key, ans=0, l, x, t;
-	static char buffer[1450], lines, quit;
-	static FILE *fd;
+	Banner();
+	attrset(COLOR_PAIR(4)|A_BOLD);
+	mvprintw(10,28,"--==[ Main Menu ]==--");
 
-	/* Pass a NULL string to initialize the buffer, counter, and flags */
+	attrset(COLOR_PAIR(3)|A_BOLD);
+	mvprintw(13,1,"[P]: Predict Satellite Passes");
+	mvprintw(14,1,"[V]: Predict Visible Passes");
+	mvprintw(15,1,"[S]: Solar Illumination Predictions");
+	mvprintw(16,1,"[L]: Lunar Predictions");
+	mvprintw(17,1,"[O]: Solar Predictions");
+	mvprintw(18,1,"[T]: Single Satellite Tracking Mode");
+	mvprintw(19,1,"[M]: Multi-Satellite Tracking Mode");
 
-	if (string[0]==0)
+	mvprintw(13,40,"[I]: Program Information");
+	mvprintw(14,40,"[G]: Edit Ground Station Information");
+	mvprintw(15,40,"[D]: Display Satellite Orbital Data");
+	mvprintw(16,40,"[U]: Update Sat Elements From File");
+	mvprintw(17,40,"[E]: Manually Edit Orbital Elements");
+	mvprintw(18,40,"[B]: Edit Transponder Database");
+	mvprintw(19,40,"[Q]: Exit PREDICT");
+
+	if (socket_flag)
 	{
-		lines=0;
-		quit=0;
-		buffer[0]=0;
-		fd=NULL;
+		attrset(COLOR_PAIR(4)|A_BOLD);
+		mvprintw(22,33,"Server Mode");
 	}
 
-	else
-	{
-		if (mode=='m')
-		{
-			sprintf(head1,"\n                    %s's Orbit Calendar for the Moon",qth.callsign);
-			strncpy(satellite_name,"Moon\0",5);
-		}
+	refresh();
 
-		if (mode=='o')
-		{
-			sprintf(head1,"\n                    %s's Orbit Calendar for the Sun",qth.callsign);
-			strncpy(satellite_name,"Sun\0",4);
-		}
-	
-		if (mode=='m' || mode=='o')
+	if (xterm)
+		fprintf(stderr,"\033]0;PREDICT: Version %s\007",version); 
+}
 
-			sprintf(head2,"\n\t   Date     Time    El   Az   RA     Dec    GHA     Vel   Range\n");
+void ProgramInfo()
+{
+	Banner();
+	attrset(COLOR_PAIR(3)|A_BOLD);
 
+	printw("\n\n\n\n\n\t\tPREDICT version : %s\n",version);
+	printw("\t\tQTH file loaded : %s\n",qthfile);
+	printw("\t\tTLE file loaded : %s\n",tlefile);
+	printw("\t\tDatabase file   : ");
 
-		if (mode=='p')
-			strcpy(type,"Orbit");
+	if (database)
+		printw("Loaded\n");
+	else
+		printw("Not loaded\n");
 
-		if (mode=='v')
-			strcpy(type,"Visual");
+	if (antennas>0)
+	{
+		printw("\t\tAutoTracking    : Sending data to %s",antenna[0].port);
 
-		if (mode=='s')
-			strcpy(type,"Solar Illumination");
+		if (antenna[0].once)
+			printw(" every second");
 
-		if (mode!='m' && mode!='o')
-		{
-			strcpy(satellite_name,sat[indx].name);
+		if (antennas>1)
+			printw(" and %d more",antennas-1);
 
-			l=strlen(qth.callsign)+strlen(satellite_name)+strlen(type);
+		printw("\n");
+	}
 
-			spaces[0]=0;
+	else
+		printw("\t\tAutoTracking    : Not enabled\n");
 
-			for (x=l; x<60; x+=2)
-				strcat(spaces," ");
+	printw("\t\tRunning Mode    : ");
 
-			sprintf(head1,"\n%s%s's %s Calendar For %s", spaces, qth.callsign, type, satellite_name);
+	if (socket_flag)
+		printw("Network server on port \"%s\"\n",netport);
+	else
+		printw("Standalone\n");
 
-			if (mode=='s')
-				sprintf(head2,"\n\t  Date     Mins/Day    Sun%c          Date      Mins/Day    Sun%c\n",37,37);
-			else
-			{
-				if (calc_squint)
+	printw("\t\tVocalizer       : ");
 
-					sprintf(head2,"\n\t   Date     Time    El   Az  Phase  %s   %s    Range  Squint\n",(io_lat=='N'?"LatN":"LatS"),(io_lon=='W'?"LonW":"LonE"));
-				else
+	if (soundcard)
+		printw("Soundcard present");
+	else
+		printw("No soundcard available");
 
-					sprintf(head2,"\n\t   Date     Time    El   Az  Phase  %s   %s    Range  Orbit\n",(io_lat=='N'?"LatN":"LatS"),(io_lon=='W'?"LonW":"LonE"));
-			}
-		}
+	refresh();
+	attrset(COLOR_PAIR(4)|A_BOLD);
+	AnyKey();
+}
 
-		sprintf(head3,"      -----------------------------------------------------------------");
+void NewUser()
+{
+	int *mkdir();
 
-		strcat(buffer,string);
-		lines++;
+	Banner();
+	attrset(COLOR_PAIR(3)|A_BOLD);
 
-		if (lines==18)
-		{
-			bkgdset(COLOR_PAIR(2)|A_BOLD);
-			clear();
-			addstr(head1);
-			attrset(COLOR_PAIR(4)|A_BOLD);
-			addstr(head2);
-			addstr(head3);
-			attrset(COLOR_PAIR(3)|A_BOLD);
+	mvprintw(12,2,"WELCOME to PREDICT!  Since you are a new user to the program, default\n");
+	printw("  orbital data and ground station location information was copied into\n");
+	printw("  your home directory to get you going.  Please select option [G] from\n");
+	printw("  PREDICT's main menu to edit your ground station information, and update\n");
+	printw("  your orbital database using option [U] or [E].  Enjoy the program!  :-)");
+	refresh();
 
-			if (buffer[0]!='\n')
-				printw("\n");
+	/* Make "~/.predict" subdirectory */
 
-			addstr(buffer);
-			attrset(COLOR_PAIR(4)|A_BOLD);
+	sprintf(temp,"%s/.predict",getenv("HOME"));
+	mkdir(temp,0777);
 
-			if (buffer[0]=='\n')
-				printw("\n");
+	/* Copy default files into ~/.predict directory */
 
-			if (fd==NULL)
-				mvprintw(23,63,"        ");
-			else
-				mvprintw(23,63,"Log = ON");
+	sprintf(temp,"%sdefault/predict.tle",predictpath);
 
-			mvprintw(23,6,"More? [y/n] >> ");
-			curs_set(1);
-			refresh();
+	CopyFile(temp,tlefile);
 
-			while (ans==0)
-			{
-				key=toupper(getch());
+	sprintf(temp,"%sdefault/predict.db",predictpath);
 
-				if (key=='Y' || key=='\n' || key==' ')
-				{
-					key='Y';
-					ans=1;
-					quit=0;
-				}
-			
-				if (key=='N' || key=='Q' || key==27)
-				{
-					key='N';
-					ans=1;
-					quit=1;
-				}
+	CopyFile(temp,dbfile);
 
-				/* 'L' logs output to "satname.txt" */
+	sprintf(temp,"%sdefault/predict.qth",predictpath);
 
-				if (key=='L' && fd==NULL && buffer[0])
-				{
-					sprintf(temp,"%s.txt",satellite_name);
+	CopyFile(temp,qthfile);
 
-					l=strlen(temp)-4;
+	attrset(COLOR_PAIR(4)|A_BOLD);
+	AnyKey();
+}
 
-					for (x=0; x<l; x++)
-					{
-						t=temp[x];
+void db_edit()
+{
+	clear();
+	attrset(COLOR_PAIR(3)|A_BOLD);
+	mvprintw(2,15,"* PREDICT Transponder Database Editing Utility *");
+	attrset(COLOR_PAIR(2)|A_BOLD);
+	mvprintw(13,33,"Coming Soon!");
+	attrset(COLOR_PAIR(4)|A_BOLD);
+	refresh();
+	AnyKey();
+}
 
-						if (t==32 || t==17 || t==92 || t==42 || t==46 || t==47)
-							t='_';
+void WritePositions(string, fd, deadline)
+char *string;
+FILE *fd;
+long long deadline;
+{
+	/* This function writes the positions of the satellite
+	   named in "string" at the times that follow it to "fd",
+	   for the -f option and the GET_SAT_POS command.  A list
+	   is abandoned once the monotonic clock passes "deadline"
+	   (ns), unless it is 0. */
 
-						temp[x]=t;
-					}
+	int x, y, z, step=1;
+	long start, now, end, count;
+	char satname[50], startstr[20], endstr[20];
+	time_t t;
 
-					fd=fopen(temp,"a");
-					fprintf(fd,"%s%s%s\n",head1,head2,head3);
-					fprintf(fd,"%s",buffer);
-					mvprintw(23,63,"Log = ON");
-					move(23,21);
-					refresh();
-				}
+	startstr[0]=0;
+	endstr[0]=0;
 
-				else if (fd!=NULL)
-				{
-					if (key=='L' || key=='N')
-					{
-						fprintf(fd,"%s\n\n",buffer);
-						fclose(fd);
-						fd=NULL;
-						mvprintw(23,63,"        ");
-						move(23,21);
-						refresh();
-					}
+	for (x=0; x<48 && string[x]!=0 && string[x]!='\n'; x++)
+		satname[x]=string[x];
 
-					else
-						fprintf(fd,"%s",buffer);
-				}
-				buffer[0]=0;
-			}
+	satname[x]=0;
+	x++;
 
-			lines=0;
-			curs_set(0);
-		}
-	}
-	return (quit);
-}
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		startstr[y]=string[x+y];
 
-int PrintVisible(string)
-char *string;
-{
-	/* This function acts as a filter to display passes that could
-	   possibly be optically visible to the ground station.  It works
-	   by first buffering prediction data generated by the Predict()
-	   function and then checking it to see if at least a part of the
-	   pass is visible.  If it is, then the buffered prediction data
-	   is sent to the Print() function so it can be displayed
-	   to the user and optionally logged to a file. */
+	startstr[y]=0;
+	y++;
 
-	static char buffer[10000];
-	char line[80], plus, asterisk, visible;
-	int x, y, quit=0;
+	for (z=0; z<19 && string[x+y+z]!=0 && string[x+y+z]!='\n'; z++)
+		endstr[z]=string[x+y+z];
 
-	if (string[0]==0)
-		buffer[0]=0;
-	else
-	{
-		strcat(buffer,string);
+	endstr[z]=0;
+ 
+	/* Do a simple search for the matching satellite name */
 
-		if (string[0]=='\n')
+	for (z=0; z<24; z++)
+	{
+		if ((strcmp(sat[z].name,satname)==0) || (atol(satname)==sat[z].catnum))
 		{
-			plus=0;
-			visible=0;
-			asterisk=0;
+			start=atol(startstr);
+
+			if (endstr[0]!=0 && endstr[strlen(endstr)-1]=='m')
+			{
+				step=60;
+				endstr[strlen(endstr)-1]=0;
+			}
+			
+			if (endstr[0]=='+')
+				end=start+((long)step)*atol(endstr);
+			else
+				end=atol(endstr);
+
+			indx=z;
+
+			t=ClockTime();
+			now=(long)t;
+
+			if (start==0)
+				start=now;
 
-			for (x=0; buffer[x]!=0 && visible==0; x++)
+			if (startstr[0]=='+')
 			{
-				if (buffer[x]=='+')
-					plus++;
+				start=now;
+
+				if (startstr[strlen(startstr)-1]=='m')
+				{
+					step=60;
+					startstr[strlen(startstr)-1]=0;
+				}
 
-				if (buffer[x]=='*')
-					asterisk++;
+				end=start+((long)step)*atol(startstr);
+			}
 
-				/* At least 3 +'s or at least 2 +'s
-				   combined with at least 2 *'s is
-				   worth displaying as a visible pass. */
+			/* Prevent a list greater than 24 hours from
+			   being produced, whether its end was given
+			   as +N or as a time */
 
-				if ((plus>3) || (plus>2 && asterisk>2))
-					visible=1;
+			if (end!=0 && (end-start)>86400)
+			{
+				start=now;
+				end=now-1;
 			}
 
-			if (visible)
+			if ((start>=now-31557600) && (start<=now+31557600) && end==0)
 			{
-				/* Dump buffer to Print() line by line */
+				/* Start must be one year from now */
+				/* Display a single position */
+				daynum=((start/86400.0)-3651.0);
+				PreCalc(indx);
+				Calc();
+
+				if (Decayed(indx,daynum)==0)
+					fprintf(fd,"%ld %s %4d %4d %4d %4d %4d %6ld %6ld %c\n",start,Daynum2String(daynum),iel,iaz,ma256,isplat,isplong,irk,rv,findsun);
+				break;
+			}
 
-				for (x=0, y=0; buffer[x]!=0 && quit==0; x++)
-				{	
-					line[y]=buffer[x];
+			else
+			{
+				/* Display a whole list */
+				for (count=start; count<=end; count+=step)
+				{
+					if (deadline && Monotonic()>deadline)
+						break;
 
-					if (line[y]=='\n')
-					{
-						line[y+1]=0;
-						quit=Print(line,'v');
-						line[0]=0;
-						y=0;
-					}
+					daynum=((count/86400.0)-3651.0);
+					PreCalc(indx);
+					Calc();
 
-					else
-						y++;
+					if (Decayed(indx,daynum)==0)
+						fprintf(fd,"%ld %s %4d %4d %4d %4d %4d %6ld %6ld %c\n",count,Daynum2String(daynum),iel,iaz,ma256,isplat,isplong,irk,rv,findsun);
 				}
+				break;
 			}
-
-			buffer[0]=0;
 		}
 	}
-
-	return quit;
 }
 
-void Predict(mode)
-char mode;
+int QuickFind(string, outputfile)
+char *string, *outputfile;
 {
-	/* This function predicts satellite passes.  It displays
-	   output through the Print() function if mode=='p' (show
-	   all passes), or through the PrintVisible() function if
-	   mode=='v' (show optically visible passes only). */
-
-	int quit=0, lastel=0, breakout=0;
-	char string[80], type[10];
-
-	PreCalc(indx);
-	daynum=GetStartTime(0);
-	clear();
-
-	/* Trap geostationary orbits and passes that cannot occur. */
+	FILE *fd;
 
-	if (AosHappens(indx) && Geostationary(indx)==0 && Decayed(indx,daynum)==0)
-	{
-		if (xterm)
-		{
-			strcpy(type,"Orbit");  /* Default */
+	if (outputfile[0])
+		fd=fopen(outputfile,"w");
+	else
+		fd=stdout;
 
-			if (mode=='v')
-				strcpy(type,"Visual");
+	ReadDataFiles();
+	WritePositions(string,fd,0LL);
 
-			fprintf(stderr,"\033]0;PREDICT: %s's %s Calendar For %s\007",qth.callsign, type, sat[indx].name);
-		}
+	if (outputfile[0])
+		fclose(fd);
 
-		do
-		{
-			daynum=FindAOS();
-		
-			/* Display the pass */
+	return 0;
+}
 
-			while (iel>=0 && quit==0)
-			{
-				if (calc_squint)
+void WritePass(string, fd, summary, deadline)
+char *string;
+FILE *fd;
+char summary;
+long long deadline;
+{
+	/* This function writes the next pass of the satellite
+	   named in "string" after the time that follows it to
+	   "fd", for the -p option and the PREDICT command.  The
+	   pass is followed by its summary line if "summary" is
+	   set (for -p and GET_PASS, but not PREDICT, whose
+	   clients expect nothing but rows of tracking data).
+	   The pass is abandoned once the monotonic clock passes
+	   "deadline" (ns), unless it is 0. */
 
-					sprintf(string,"      %s%4d %4d  %4d  %4d   %4d   %6ld  %4.0f %c\n",Daynum2String(daynum),iel,iaz,ma256,(io_lat=='N'?+1:-1)*isplat,(io_lon=='W'?isplong:360-isplong),irk,squint,findsun);
+	int x, y, z, lastel=0;
+	long start, now;
+	double doppler100=0.0, aos;
+	pass_t pass;
+	char satname[50], startstr[20];
+	time_t t;
 
-				else
-					sprintf(string,"      %s%4d %4d  %4d  %4d   %4d   %6ld  %6ld %c\n",Daynum2String(daynum),iel,iaz,ma256,(io_lat=='N'?+1:-1)*isplat,(io_lon=='W'?isplong:360-isplong),irk,rv,findsun);
+	startstr[0]=0;
 
-				lastel=iel;
+	for (x=0; x<48 && string[x]!=0 && string[x]!='\n'; x++)
+		satname[x]=string[x];
 
-				if (mode=='p')
-					quit=Print(string,'p');
+	satname[x]=0;
+	x++;
 
-				if (mode=='v')
-				{
-					nodelay(stdscr,TRUE);
-					attrset(COLOR_PAIR(4));
-					mvprintw(23,6,"                 Calculating... Press [ESC] To Quit");
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		startstr[y]=string[x+y];
 
-					/* Allow a way out if this
-					   should continue forever... */
+	startstr[y]=0;
+	y++;
 
-					if (getch()==27)
-						breakout=1;
+	/* Do a simple search for the matching satellite name */
 
-					nodelay(stdscr,FALSE);
+	for (z=0; z<24; z++)
+	{
+		if ((strcmp(sat[z].name,satname)==0) || (atol(satname)==sat[z].catnum))
+		{
+			start=atol(startstr);
+			indx=z;
 
-					quit=PrintVisible(string);
-				}
+			t=ClockTime();
+			now=(long)t;
 
-				daynum+=cos((sat_ele-1.0)*deg2rad)*sqrt(sat_alt)/25000.0;
-				Calc();
-			}
+			if (start==0)
+				start=now;
 
-			if (lastel!=0)
+			if ((start>=now-31557600) && (start<=now+31557600))
 			{
-				daynum=FindLOS();
+				/* Start must within one year of now */
+				daynum=((start/86400.0)-3651.0);
+				PreCalc(indx);
 				Calc();
 
-				if (calc_squint)
-					sprintf(string,"      %s%4d %4d  %4d  %4d   %4d   %6ld  %4.0f %c\n",Daynum2String(daynum),iel,iaz,ma256,(io_lat=='N'?+1:-1)*isplat,(io_lon=='W'?isplong:360-isplong),irk,squint,findsun);
+				if (AosHappens(indx) && Geostationary(indx)==0 && Decayed(indx,daynum)==0)
+				{
+					/* Make Predictions */
+					daynum=FindAOS();
+					aos=daynum;
+
+					/* Display the pass */
 
-				else
-					sprintf(string,"      %s%4d %4d  %4d  %4d   %4d   %6ld  %6ld %c\n",Daynum2String(daynum),iel,iaz,ma256,(io_lat=='N'?+1:-1)*isplat,(io_lon=='W'?isplong:360-isplong),irk,rv,findsun);
+					while (rint(sat_clear)>=0.0)
+					{
+						if (deadline && Monotonic()>deadline)
+							return;
 
-				if (mode=='p')
-					quit=Print(string,'p');
+						fprintf(fd,"%.0f %s %4d %4d %4d %4d %4d %6ld %6ld %c %f\n",floor(86400.0*(3651.0+daynum)),Daynum2String(daynum),iel,iaz,ma256,isplat,isplong,irk,rv,findsun,doppler100);
+						lastel=iel;
+						daynum+=cos((sat_ele-1.0)*deg2rad)*sqrt(sat_alt)/25000.0;
+						Calc();
+					}
 
-				if (mode=='v')
-					quit=PrintVisible(string);
-			}
+					/* LOS is found whatever the elevation
+					   of the last row was rounded to */
 
-			if (mode=='p')
-				quit=Print("\n",'p');
+					daynum=FindLOS();
+					Calc();
 
-			if (mode=='v')
-				quit=PrintVisible("\n");
+					if (lastel!=0)
+						fprintf(fd,"%.0f %s %4d %4d %4d %4d %4d %6ld %6ld %c %f\n",floor(86400.0*(3651.0+daynum)),Daynum2String(daynum),iel,iaz,ma256,isplat,isplong,irk,rv,findsun,doppler100);
 
-			/* Move to next orbit */
-			daynum=NextAOS();
+					/* Summarize the pass */
 
-		}  while (quit==0 && breakout==0 && AosHappens(indx) && Decayed(indx,daynum)==0);
+					if (summary)
+					{
+						PassDetails(aos,daynum,&pass);
+						fprintf(fd,"%s",Pass2String(&pass));
+					}
+				}
+				break;
+			}
+		}
 	}
+}
+
+int QuickPredict(string, outputfile)
+char *string, *outputfile;
+{
+	FILE *fd;
 
+	if (outputfile[0])
+		fd=fopen(outputfile,"w");
 	else
-	{
-		bkgdset(COLOR_PAIR(5)|A_BOLD);
-		clear();
+		fd=stdout;
 
-		if (AosHappens(indx)==0 || Decayed(indx,daynum)==1)
-			mvprintw(12,5,"*** Passes for %s cannot occur for your ground station! ***\n",sat[indx].name);
+	ReadDataFiles();
+	WritePass(string,fd,1,0LL);
 
-		if (Geostationary(indx)==1)
-			mvprintw(12,3,"*** Orbital predictions cannot be made for a geostationary satellite! ***\n");
+	if (outputfile[0])
+		fclose(fd);
 
-		beep();
-		bkgdset(COLOR_PAIR(7)|A_BOLD);
-		AnyKey();
-		refresh();
-	}
+	return 0;
 }
 
-void PredictMoon()
+int QuickDoppler100(string, outputfile)
+char *string, *outputfile;
 {
-	/* This function predicts "passes" of the Moon */
 
-	int iaz, iel, lastel=0;
-	char string[80], quit=0;
-	double daynum, lastdaynum, moonrise=0.0;
+	/* Do a quick predict of the doppler for non-geo sattelites, returns UTC epoch seconds, 
+	   UTC time and doppler normalized to 100MHz for every 5 seconds of satellite-pass as a CSV*/
 
-	daynum=GetStartTime('m');
-	clear();
+	int x, y, z, lastel=0;
+	long start, now;
+	double doppler100;
+	char satname[50], startstr[20];
+	time_t t;
+	FILE *fd;
 
-	if (xterm)
-		fprintf(stderr,"\033]0;PREDICT: %s's Orbit Calendar for the Moon\007",qth.callsign);
+	if (outputfile[0])
+		fd=fopen(outputfile,"w");
+	else
+		fd=stdout;
 
-	do
-	{
-		/* Determine moonrise */
+	startstr[0]=0;
 
-		FindMoon(daynum);
+	ReadDataFiles();
 
-		while (moonrise==0.0)
-		{
-			if (fabs(moon_el)<0.03)
-				moonrise=daynum;
-			else
-			{
-				daynum-=(0.004*moon_el);
-				FindMoon(daynum);
-			}
-		}
+	for (x=0; x<48 && string[x]!=0 && string[x]!='\n'; x++)
+		satname[x]=string[x];
 
-		FindMoon(moonrise);
-		daynum=moonrise;
-		iaz=(int)rint(moon_az);
-		iel=(int)rint(moon_el);
+	satname[x]=0;
+	x++;
 
-		do
-		{
-			/* Display pass of the moon */
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		startstr[y]=string[x+y];
 
-			sprintf(string,"      %s%4d %4d  %5.1f  %5.1f  %5.1f  %6.1f%7.3f\n",Daynum2String(daynum), iel, iaz, moon_ra, moon_dec, moon_gha, moon_dv, moon_dx);
-			quit=Print(string,'m');
-			lastel=iel;
-			lastdaynum=daynum;
-			daynum+=0.04*(cos(deg2rad*(moon_el+0.5)));
-			FindMoon(daynum);
-			iaz=(int)rint(moon_az);
-			iel=(int)rint(moon_el);
+	startstr[y]=0;
+	y++;
 
-		} while (iel>3 && quit==0);
+	/* Do a simple search for the matching satellite name */
 
-		while (lastel!=0 && quit==0)
+	for (z=0; z<24; z++)
+	{
+		if ((strcmp(sat[z].name,satname)==0) || (atol(satname)==sat[z].catnum))
 		{
-			daynum=lastdaynum;
+			start=atol(startstr);
+			indx=z;
 
-			do
+			t=ClockTime();
+			now=(long)t;
+
+			if (start==0)
+				start=now;
+
+			if ((start>=now-31557600) && (start<=now+31557600))
 			{
-				/* Determine setting time */
+				/* Start must within one year of now */
+				daynum=((start/86400.0)-3651.0);
+				PreCalc(indx);
+				Calc();
 
-				daynum+=0.004*(sin(deg2rad*(moon_el+0.5)));
-				FindMoon(daynum);
-				iaz=(int)rint(moon_az);
-				iel=(int)rint(moon_el);
+				if (AosHappens(indx) && Geostationary(indx)==0 && Decayed(indx,daynum)==0)
+				{
+					/* Make Predictions */
+					daynum=FindAOS();
 
-			} while (iel>0);
+					/* Display the pass */
 
-			/* Print moonset */
+					while (rint(sat_clear)>=0.0)
+					{
+						doppler100=-100.0e06*((sat_range_rate*1000.0)/299792458.0);
+						fprintf(fd,"%.0f,%s,%f\n",floor(86400.0*(3651.0+daynum)),Daynum2String(daynum),doppler100);
+						lastel=iel;
+						daynum+=cos((sat_ele-1.0)*deg2rad)*sqrt(sat_alt)/500000.0;
+						Calc();
+					}
 
-			sprintf(string,"      %s%4d %4d  %5.1f  %5.1f  %5.1f  %6.1f%7.3f\n",Daynum2String(daynum), iel, iaz, moon_ra, moon_dec, moon_gha, moon_dv, moon_dx);
-			quit=Print(string,'m');
-			lastel=iel;
+					if (lastel!=0)
+					{
+						doppler100=-100.0e06*((sat_range_rate*1000.0)/299792458.0);
+						daynum=FindLOS();
+						Calc();
+						fprintf(fd,"%.0f,%s,%f\n",floor(86400.0*(3651.0+daynum)),Daynum2String(daynum),doppler100);
+					}
+				}
+				break;
+			}
 		}
+	}
 
-		quit=Print("\n",'m');
-		daynum+=0.4;
-		moonrise=0.0;
+	if (outputfile[0])
+		fclose(fd);
 
-	} while (quit==0);
+	return 0;
 }
 
-void PredictSun()
+
+long ParseTime(string, base)
+char *string;
+long base;
 {
-	/* This function predicts "passes" of the Sun. */
+	/* This function converts a time given on the command line
+	   to Unix time.  An argument of the form "+N" is taken as
+	   N seconds past "base", and may carry an 'm', 'h', or 'd'
+	   suffix for minutes, hours, or days.  Anything else is
+	   read as a Unix time, where 0 (or nothing) means "base". */
 
-	int iaz, iel, lastel=0;
-	char string[80], quit=0;
-	double daynum, lastdaynum, sunrise=0.0;
+	long value, step=1;
+	int x;
 
-	daynum=GetStartTime('o');
-	clear();
+	x=strlen(string);
 
-	if (xterm)
-		fprintf(stderr,"\033]0;PREDICT: %s's Orbit Calendar for the Sun\007",qth.callsign);
+	if (x==0)
+		return base;
 
-	do
+	if (string[0]=='+')
 	{
-		/* Determine sunrise */
+		if (string[x-1]=='m')
+			step=60;
 
-		FindSun(daynum);
+		if (string[x-1]=='h')
+			step=3600;
 
-		while (sunrise==0.0)
-		{
-			if (fabs(sun_ele)<0.03)
-				sunrise=daynum;
-			else
-			{
-				daynum-=(0.004*sun_ele);
-				FindSun(daynum);
-			}
-		}
+		if (string[x-1]=='d')
+			step=86400;
 
-		FindSun(sunrise);
-		daynum=sunrise;
-		iaz=(int)rint(sun_azi);
-		iel=(int)rint(sun_ele);
+		return (base+step*atol(string+1));
+	}
 
-		/* Print time of sunrise */
+	value=atol(string);
 
-		do
-		{
-			/* Display pass of the sun */
+	if (value==0)
+		return base;
 
-			sprintf(string,"      %s%4d %4d  %5.1f  %5.1f  %5.1f  %6.1f%7.3f\n",Daynum2String(daynum), iel, iaz, sun_ra, sun_dec, sun_lon, sun_range_rate, sun_range);
-			quit=Print(string,'o');
-			lastel=iel;
-			lastdaynum=daynum;
-			daynum+=0.04*(cos(deg2rad*(sun_ele+0.5)));
-			FindSun(daynum);
-			iaz=(int)rint(sun_azi);
-			iel=(int)rint(sun_ele);
+	return value;
+}
 
-		} while (iel>3 && quit==0);
+void PassJob(x)
+int x;
+{
+	/* This function finds every pass of satellite "x" that
+	   ends after batch_start and begins before batch_end,
+	   and writes a pass_t record for each one, in time
+	   order, to the satellite's temporary pass file.  If
+	   batch_visual is set, only optically visible passes
+	   are written. */
 
-		while (lastel!=0 && quit==0)
-		{
-			daynum=lastdaynum;
+	double aos, los;
+	pass_t pass, vis;
 
-			do
-			{
-				/* Find sun set */
+	if (sat[x].meanmo==0.0)
+		return;
 
-				daynum+=0.004*(sin(deg2rad*(sun_ele+0.5)));
-				FindSun(daynum);
-				iaz=(int)rint(sun_azi);
-				iel=(int)rint(sun_ele);
+	vis.vis_start=0.0;
+	vis.vis_end=0.0;
 
-			} while (iel>0);
+	indx=x;
+	PreCalc(x);
+	daynum=batch_start;
 
-			/* Print time of sunset */
+	if (AosHappens(x)==0 || Geostationary(x)==1 || Decayed(x,daynum)==1)
+		return;
 
-			sprintf(string,"      %s%4d %4d  %5.1f  %5.1f  %5.1f  %6.1f%7.3f\n",Daynum2String(daynum), iel, iaz, sun_ra, sun_dec, sun_lon, sun_range_rate, sun_range);
-			quit=Print(string,'o');
-			lastel=iel;
-		}
+	while (1)
+	{
+		aos=FindAOS();
 
-		quit=Print("\n",'o');
-		daynum+=0.4;
-		sunrise=0.0;
+		if (aos==0.0 || aos>batch_end || Decayed(x,aos)==1)
+			break;
 
-	} while (quit==0);
-}
+		los=FindLOS2();
 
-char KbEdit(x,y)
-int x,y;
-{
-	/* This function is used when editing QTH
-	   and orbital data via the keyboard. */
+		if (batch_visual==0 || VisibleWindow(aos,los,&vis))
+		{
+			PassDetails(aos,los,&pass);
+			pass.vis_start=vis.vis_start;
+			pass.vis_end=vis.vis_end;
 
-	char need2save=0, input[25];
+			if (los>=batch_start)
+				fwrite(&pass,sizeof(pass_t),1,passfile[x]);
+		}
 
-	echo();
-	move(y-1,x-1);
-	wgetnstr(stdscr,input,24);
+		/* Move to LOS + 20 minutes */
 
-	if (strlen(input)!=0)
-	{
-		need2save=1;  /* Save new data to variables */
-		resave=1;     /* Save new data to disk files */
-		strncpy(temp,input,24);
+		daynum=los+0.014;
 	}
+}
 
-	mvprintw(y-1,x-1,"%-25s",temp);
+char PassBefore(a, b)
+pass_t *a, *b;
+{
+	/* Ordering used by the pass heap: earliest AOS first, with
+	   ties broken by the satellite's position in the database. */
 
-	refresh();
-	noecho();
+	if (a->aos!=b->aos)
+		return (a->aos<b->aos);
 
-	return need2save;
+	return (a->sat<b->sat);
 }
 
-void ShowOrbitData()
+void PushPass(heap, n, pass)
+pass_t *heap, *pass;
+int *n;
 {
-	/* This function permits displays a satellite's orbital
-	   data.  The age of the satellite data is also provided. */
+	/* Adds "pass" to the binary min-heap "heap" of *n entries. */
 
-	int c, x, namelength, age;	
-	double an_period, no_period, sma, c1, e2, satepoch;
-	char days[5];
+	int x, parent;
+	pass_t swap;
 
-	x=Select();
+	x=(*n)++;
+	heap[x]=*pass;
 
-	while (x!=-1)
+	while (x>0)
 	{
-		if (sat[x].meanmo!=0.0)
-		{
-			bkgdset(COLOR_PAIR(2)|A_BOLD);
-			clear();
-			sma=331.25*exp(log(1440.0/sat[x].meanmo)*(2.0/3.0));
-			an_period=1440.0/sat[x].meanmo;
-			c1=cos(sat[x].incl*deg2rad);
-			e2=1.0-(sat[x].eccn*sat[x].eccn); 
-			no_period=(an_period*360.0)/(360.0+(4.97*pow((xkmper/sma),3.5)*((5.0*c1*c1)-1.0)/(e2*e2))/sat[x].meanmo);
-			satepoch=DayNum(1,0,sat[x].year)+sat[x].refepoch;
-			age=(int)rint(CurrentDaynum()-satepoch);
+		parent=(x-1)/2;
 
-			if (age==1)
-				strcpy(days,"day");
-			else
-				strcpy(days,"days");
+		if (PassBefore(&heap[parent],&heap[x]))
+			break;
 
-			namelength=strlen(sat[x].name);
+		swap=heap[parent];
+		heap[parent]=heap[x];
+		heap[x]=swap;
+		x=parent;
+	}
+}
 
-			printw("\n");
+void PopPass(heap, n)
+pass_t *heap;
+int *n;
+{
+	/* Removes the earliest pass from the binary min-heap "heap". */
 
-			for (c=41; c>namelength; c-=2)
-				printw(" ");
-	
-			printw("Orbital Data For %s / Catalog Number %ld\n",sat[x].name,sat[x].catnum);
-			attrset(COLOR_PAIR(3)|A_BOLD);
-			printw("\n\t\t  Issued %d %s ago on %s UTC\n\n",age,days,Daynum2String(satepoch));
+	int x=0, child;
+	pass_t swap;
 
-			attrset(COLOR_PAIR(4)|A_BOLD);
-			mvprintw(5,21,"Reference Epoch");
-			mvprintw(6,21,"Inclination");
-			mvprintw(7,21,"RAAN");
-			mvprintw(8,21,"Eccentricity");
-			mvprintw(9,21,"Arg of Perigee");
-			mvprintw(10,21,"Mean Anomaly");
-			mvprintw(11,21,"Mean Motion");
-			mvprintw(12,21,"Decay Rate");
-			mvprintw(13,21,"Nddot/6 Drag");
-			mvprintw(14,21,"Bstar Drag Factor");
-			mvprintw(15,21,"Semi-Major Axis");
-			mvprintw(16,21,"Apogee Altitude");
-			mvprintw(17,21,"Perigee Altitude");
-			mvprintw(18,21,"Anomalistic Period");
-			mvprintw(19,21,"Nodal Period");
-			mvprintw(20,21,"Orbit Number");
-			mvprintw(21,21,"Element Set Number");
+	heap[0]=heap[--(*n)];
 
-			attrset(COLOR_PAIR(2)|A_BOLD);
-			mvprintw(5,40,": %02d %.8f",sat[x].year,sat[x].refepoch);
-			mvprintw(6,40,": %.4f deg",sat[x].incl);
-			mvprintw(7,40,": %.4f deg",sat[x].raan);
-			mvprintw(8,40,": %g",sat[x].eccn);
-			mvprintw(9,40,": %.4f deg",sat[x].argper);
-			mvprintw(10,40,": %.4f deg",sat[x].meanan);
-			mvprintw(11,40,": %.8f rev/day",sat[x].meanmo);
-			mvprintw(12,40,": %g rev/day/day",sat[x].drag);
-			mvprintw(13,40,": %g rev/day/day/day",sat[x].nddot6);
-			mvprintw(14,40,": %g 1/earth radii",sat[x].bstar);
-			mvprintw(15,40,": %.4f km",sma);
-			mvprintw(16,40,": %.4f km",sma*(1.0+sat[x].eccn)-xkmper);
-			mvprintw(17,40,": %.4f km",sma*(1.0-sat[x].eccn)-xkmper);
-			mvprintw(18,40,": %.4f mins",an_period);
-			mvprintw(19,40,": %.4f mins",no_period);
-			mvprintw(20,40,": %ld",sat[x].orbitnum);
-			mvprintw(21,40,": %ld",sat[x].setnum);
+	while ((child=2*x+1)<*n)
+	{
+		if (child+1<*n && PassBefore(&heap[child+1],&heap[child]))
+			child++;
 
-			attrset(COLOR_PAIR(3)|A_BOLD);
-			refresh();
-			AnyKey();
-		}
+		if (PassBefore(&heap[x],&heap[child]))
+			break;
 
-		x=Select();
-	 };
-}	
+		swap=heap[x];
+		heap[x]=heap[child];
+		heap[child]=swap;
+		x=child;
+	}
+}
 
-void KepEdit()
+int QuickPasses(string, outputfile, mode)
+char *string, *outputfile, mode;
 {
-	/* This function permits keyboard editing of the orbital database. */
+	/* This function lists all passes of all satellites between
+	   a starting and ending date/time as a single list sorted
+	   by time of AOS.  The satellites are divided among a pool
+	   of worker threads, each of which writes the passes it
+	   finds to a temporary file per satellite.  The files are
+	   then combined through a k-way merge so that no more than
+	   one pass per satellite is held in memory at any time.
+	   If mode=='v', only optically visible passes are listed,
+	   along with the times at which visibility begins and ends. */
+
+	int x, y, n=0;
+	long start, end, now;
+	char startstr[20], endstr[20];
+	pass_t heap[24], pass;
+	FILE *fd;
 
-	int x;
+	if (outputfile[0])
+		fd=fopen(outputfile,"w");
+	else
+		fd=stdout;
 
-	do
+	if (fd==NULL)
 	{
-		x=Select();
-
-		if (x!=-1)
-		{
-			bkgdset(COLOR_PAIR(3)|A_BOLD);
-			clear();
-			mvprintw(3,1,"\t\t   *  Orbital Database Editing Utility  *\n\n\n");
-			attrset(COLOR_PAIR(4)|A_BOLD);
-
-			printw("\n\t\t\tSpacecraft Name :");
-			printw("\n\t\t\tCatalog Number  :");
-			printw("\n\t\t\tDesignator      :");
-			printw("\n\t\t\tReference Epoch :");
-			printw("\n\t\t\tInclination     :");
-			printw("\n\t\t\tRAAN            :");
-			printw("\n\t\t\tEccentricity    :");
-			printw("\n\t\t\tArg of Perigee  :");
-			printw("\n\t\t\tMean Anomaly    :");
-			printw("\n\t\t\tMean Motion     :");
-			printw("\n\t\t\tDecay Rate      :");
-			printw("\n\t\t\tNddot/6         :");
-			printw("\n\t\t\tBstar Drag Term :");        
-			printw("\n\t\t\tOrbit Number    :");
-			printw("\n\t\t\tElement Set No. :");
+		fprintf(stderr,"*** PREDICT: Unable to write \"%s\"!\n",outputfile);
+		return 1;
+	}
 
-			attrset(COLOR_PAIR(2)|A_BOLD);
+	for (x=0; x<19 && string[x]!=0 && string[x]!='\n'; x++)
+		startstr[x]=string[x];
 
-			mvprintw(7,42,"%s",sat[x].name);
-			mvprintw(8,42,"%ld",sat[x].catnum);
-			mvprintw(9,42,"%s",sat[x].designator);
-			mvprintw(10,42,"%02d %.8f",sat[x].year,sat[x].refepoch);
-			mvprintw(11,42,"%.4f",sat[x].incl);
-			mvprintw(12,42,"%.4f",sat[x].raan);
-			mvprintw(13,42,"%g",sat[x].eccn);
-			mvprintw(14,42,"%.4f",sat[x].argper);
-			mvprintw(15,42,"%.4f",sat[x].meanan);
-			mvprintw(16,42,"%.8f",sat[x].meanmo);
-			mvprintw(17,42,"%g",sat[x].drag);
-			mvprintw(18,42,"%g",sat[x].nddot6);
-			mvprintw(19,42,"%g",sat[x].bstar);
-			mvprintw(20,42,"%ld",sat[x].orbitnum);
-			mvprintw(21,42,"%ld",sat[x].setnum);
+	startstr[x]=0;
 
-			curs_set(1);
-			refresh();
+	if (string[x]=='\n')
+		x++;
 
-			sprintf(temp,"%s",sat[x].name);
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		endstr[y]=string[x+y];
 
-			if (KbEdit(43,8))
-				strncpy(sat[x].name,temp,24);
+	endstr[y]=0;
 
-			sprintf(temp,"%ld",sat[x].catnum);
+	now=(long)ClockTime();
+	start=ParseTime(startstr,now);
+	end=ParseTime(endstr,start);
 
-			if (KbEdit(43,9))
-				sscanf(temp,"%ld",&sat[x].catnum);
+	/* Default to a one day window */
 
-			sprintf(temp,"%s",sat[x].designator);
+	if (end<=start)
+		end=start+86400;
 
-			if (KbEdit(43,10))
-				sscanf(temp,"%s",sat[x].designator);
+	batch_start=(start/86400.0)-3651.0;
+	batch_end=(end/86400.0)-3651.0;
+	batch_visual=(mode=='v');
 
-			sprintf(temp,"%02d %4.8f",sat[x].year,sat[x].refepoch);
+	/* Each satellite's passes are collected in a temporary
+	   file of its own by the workers, and merged below */
 
-			if (KbEdit(43,11))
-				sscanf(temp,"%d %lf",&sat[x].year,&sat[x].refepoch);
+	for (x=0; x<24; x++)
+	{
+		passfile[x]=tmpfile();
 
-			sprintf(temp,"%4.4f",sat[x].incl);
+		if (passfile[x]==NULL)
+		{
+			fprintf(stderr,"*** PREDICT: Unable to create a temporary file!\n");
 
-			if (KbEdit(43,12))
-				sscanf(temp,"%lf",&sat[x].incl);
-			    
-			sprintf(temp,"%4.4f",sat[x].raan);
+			while (x>0)
+				fclose(passfile[--x]);
 
-			if (KbEdit(43,13))
-				sscanf(temp,"%lf",&sat[x].raan);
+			if (outputfile[0])
+				fclose(fd);
 
-			sprintf(temp,"%g",sat[x].eccn);
+			return 1;
+		}
+	}
 
-			if (KbEdit(43,14))
-				sscanf(temp,"%lf",&sat[x].eccn);
-			    
-			sprintf(temp,"%4.4f",sat[x].argper);
+	RunWorkers(24,PassJob);
 
-			if (KbEdit(43,15))
-				sscanf(temp,"%lf",&sat[x].argper);
-			    
-			sprintf(temp,"%4.4f",sat[x].meanan);
+	/* Prime the heap with the first pass of each satellite */
 
-			if (KbEdit(43,16))
-				sscanf(temp,"%lf",&sat[x].meanan);
+	for (x=0; x<24; x++)
+	{
+		rewind(passfile[x]);
 
-			sprintf(temp,"%4.8f",sat[x].meanmo);
+		if (fread(&pass,sizeof(pass_t),1,passfile[x])==1)
+			PushPass(heap,&n,&pass);
+	}
 
-			if (KbEdit(43,17))
-				sscanf(temp,"%lf",&sat[x].meanmo);
-			    
-			sprintf(temp,"%g",sat[x].drag);
+	/* Repeatedly emit the earliest pass, and replace it with
+	   the next pass of the same satellite. */
 
-			if (KbEdit(43,18))
-				sscanf(temp,"%lf",&sat[x].drag);
-			    
-			sprintf(temp,"%g",sat[x].nddot6);
+	while (n>0)
+	{
+		x=heap[0].sat;
 
-			if (KbEdit(43,19))
-				sscanf(temp,"%lf",&sat[x].nddot6);
+		if (batch_visual)
+			fprintf(fd,"%.0f %s %.0f %.0f %4.1f %5.1f %5.1f %5.1f %.0f %.0f %5ld %s\n",floor(86400.0*(3651.0+heap[0].aos)),Daynum2String(heap[0].aos),floor(86400.0*(3651.0+heap[0].tca)),floor(86400.0*(3651.0+heap[0].los)),heap[0].maxel,heap[0].aos_az,heap[0].tca_az,heap[0].los_az,floor(86400.0*(3651.0+heap[0].vis_start)),floor(86400.0*(3651.0+heap[0].vis_end)),sat[x].catnum,sat[x].name);
+		else
+			fprintf(fd,"%.0f %s %.0f %.0f %4.1f %5.1f %5.1f %5.1f %5ld %s\n",floor(86400.0*(3651.0+heap[0].aos)),Daynum2String(heap[0].aos),floor(86400.0*(3651.0+heap[0].tca)),floor(86400.0*(3651.0+heap[0].los)),heap[0].maxel,heap[0].aos_az,heap[0].tca_az,heap[0].los_az,sat[x].catnum,sat[x].name);
 
-			sprintf(temp,"%g",sat[x].bstar);
+		PopPass(heap,&n);
 
-			if (KbEdit(43,20))
-				sscanf(temp,"%lf",&sat[x].bstar);
+		if (fread(&pass,sizeof(pass_t),1,passfile[x])==1)
+			PushPass(heap,&n,&pass);
+	}
 
-			sprintf(temp,"%ld",sat[x].orbitnum);
+	for (x=0; x<24; x++)
+		fclose(passfile[x]);
 
-			if (KbEdit(43,21))
-				sscanf(temp,"%ld",&sat[x].orbitnum);
+	if (outputfile[0])
+		fclose(fd);
 
-			sprintf(temp,"%ld",sat[x].setnum);
+	return 0;
+}
 
-			if (KbEdit(43,22))
-				sscanf(temp,"%ld",&sat[x].setnum);
-		  	
-			curs_set(0);
-		}
+void PrintEclipse(fd, eclipse)
+FILE *fd;
+eclipse_t *eclipse;
+{
+	/* This function writes one line of the eclipse timeline
+	   produced by QuickEclipses(). */
 
-	} while (x!=-1);
+	daynum=eclipse->penumbra_entry;
+	Calc();
 
-	if (resave)
-	{
-		SaveTLE();
-		resave=0;
-	}
-}	
+	if (eclipse->entry!=0.0)
+		fprintf(fd,"%ld,%.0f,%s,%.0f,%.0f,%.0f,%.1f,%.1f\n",rv,86400.0*(3651.0+eclipse->penumbra_entry),Daynum2String(eclipse->penumbra_entry),86400.0*(3651.0+eclipse->entry),86400.0*(3651.0+eclipse->exit),86400.0*(3651.0+eclipse->penumbra_exit),86400.0*(eclipse->exit-eclipse->entry),86400.0*(eclipse->penumbra_exit-eclipse->penumbra_entry));
+	else
+		fprintf(fd,"%ld,%.0f,%s,,,%.0f,0.0,%.1f\n",rv,86400.0*(3651.0+eclipse->penumbra_entry),Daynum2String(eclipse->penumbra_entry),86400.0*(3651.0+eclipse->penumbra_exit),86400.0*(eclipse->penumbra_exit-eclipse->penumbra_entry));
+}
 
-void QthEdit()
+int QuickEclipses(string, outputfile)
+char *string, *outputfile;
 {
-	/* This function permits keyboard editing of
-	   the ground station's location information. */
-
-	bkgdset(COLOR_PAIR(3)|A_BOLD);
-	clear();
-	curs_set(1);
-	mvprintw(7,0,"\t\t *  Ground Station Location Editing Utility  *\n\n\n");
-
-	attrset(COLOR_PAIR(4)|A_BOLD);
-	printw("\n\t\t\tStation Callsign  :");
-	printw("\n\t\t\tStation Latitude  :");
-	printw("\n\t\t\tStation Longitude :");
-	printw("\n\t\t\tStation Altitude  :");
+	/* This function writes the eclipse timeline of a satellite
+	   between a starting and ending date/time as CSV, one line
+	   per eclipse.  The fields are the orbit number, the Unix
+	   time and UTC date/time at which the satellite enters the
+	   Earth's shadow, the Unix times of umbra entry and exit,
+	   the Unix time at which it leaves the shadow, and the
+	   durations of the umbral phase and of the whole eclipse
+	   in seconds.  Without the penumbra model (-pn), the shadow
+	   and the umbra are the same.  Eclipses that continue across
+	   the engine's day boundaries are joined together. */
+
+	int x, y, z;
+	long start, end, now;
+	char satname[50], startstr[20], endstr[20];
+	eclipse_t current, *next;
+	FILE *fd;
 
-	attrset(COLOR_PAIR(2)|A_BOLD);
-	mvprintw(11,44,"%s",qth.callsign);
+	for (x=0; x<48 && string[x]!=0 && string[x]!='\n'; x++)
+		satname[x]=string[x];
 
-	if (io_lat=='N')
-		mvprintw(12,44,"%g [DegN]",+qth.stnlat);
-	else
-		mvprintw(12,44,"%g [DegS]",-qth.stnlat);
+	satname[x]=0;
 
-	if (io_lon=='W')
-		mvprintw(13,44,"%g [DegW]",+qth.stnlong);
-	else
-		mvprintw(13,44,"%g [DegE]",-qth.stnlong);
+	if (string[x]=='\n')
+		x++;
 
-	mvprintw(14,44,"%d [m]",qth.stnalt);
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		startstr[y]=string[x+y];
 
-	refresh();
+	startstr[y]=0;
+	x+=y;
 
-	sprintf(temp,"%s",qth.callsign);
+	if (string[x]=='\n')
+		x++;
 
-	mvprintw(18,12,"Enter the callsign or identifier of your ground station");
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		endstr[y]=string[x+y];
 
-	if (KbEdit(45,12))
-		strncpy(qth.callsign,temp,16);
+	endstr[y]=0;
 
-	if (io_lat=='N')
-		sprintf(temp,"%g [DegN]",+qth.stnlat);
-	else
-		sprintf(temp,"%g [DegS]",-qth.stnlat);
+	/* Do a simple search for the matching satellite name */
 
-	if (io_lat=='N')
-		mvprintw(18,12,"Enter your latitude in degrees NORTH  (south=negative) ");
-	else
-		mvprintw(18,12,"Enter your latitude in degrees SOUTH  (north=negative) ");
- 
-	mvprintw(19,12,"  Decimal (74.2467) or DMS (74 14 48) format allowed");
+	for (z=0; z<24; z++)
+		if ((strcmp(sat[z].name,satname)==0) || (atol(satname)==sat[z].catnum))
+			break;
 
-	if (KbEdit(45,13))
+	if (z==24 || sat[z].meanmo==0.0)
 	{
-		if (io_lat=='N')
-			qth.stnlat=+ReadBearing(temp);
-		else
-			qth.stnlat=-ReadBearing(temp);
+		fprintf(stderr,"*** PREDICT: Satellite \"%s\" not found!\n",satname);
+		return 1;
 	}
- 
-	if (io_lon=='W')
-		sprintf(temp,"%g [DegW]",+qth.stnlong);
-	else
-		sprintf(temp,"%g [DegE]",-qth.stnlong);
- 
-	if (io_lon=='W')
-		mvprintw(18,12,"Enter your longitude in degrees WEST   (east=negative) ");
+
+	if (outputfile[0])
+		fd=fopen(outputfile,"w");
 	else
-		mvprintw(18,12,"Enter your longitude in degrees EAST   (west=negative) ");
- 
-	if (KbEdit(45,14))
+		fd=stdout;
+
+	if (fd==NULL)
 	{
-		if (io_lon=='W')
-			qth.stnlong=+ReadBearing(temp);
-		else
-			qth.stnlong=-ReadBearing(temp);
+		fprintf(stderr,"*** PREDICT: Unable to write \"%s\"!\n",outputfile);
+		return 1;
 	}
- 
-	move(19,12);
-	clrtoeol();
-	mvprintw(18,12,"    Enter your altitude above sea level (in meters)   ");
-
-	sprintf(temp,"%d",qth.stnalt);
 
-	if (KbEdit(45,15))
-		sscanf(temp,"%d",&qth.stnalt);
+	now=(long)ClockTime();
+	start=ParseTime(startstr,now);
+	end=ParseTime(endstr,start);
 
-	if (resave)
-	{
-		SaveQTH();
-		resave=0;
-	}
-}
+	/* Default to a one day window */
 
-void SingleTrack(x,speak)
-int x;
-char speak;
-{
-	/* This function tracks a single satellite in real-time
-	   until 'Q' or ESC is pressed.  x represents the index
-	   of the satellite being tracked.  If speak=='T', then
-	   the speech routines are enabled. */
+	if (end<=start)
+		end=start+86400;
 
-	int	ans, oldaz=0, oldel=0, length, xponder=0,
-		polarity=0, tshift, bshift;
-	char	approaching=0, command[80], comsat, aos_alarm=0,
-		geostationary=0, aoshappens=0, decayed=0,
-		eclipse_alarm=0, visibility=0, old_visibility=0;
-	double	oldtime=0.0, nextaos=0.0, lostime=0.0, aoslos=0.0,
-		downlink=0.0, uplink=0.0, downlink_start=0.0,
-		downlink_end=0.0, uplink_start=0.0, uplink_end=0.0,
-		dopp, doppler100=0.0, delay, loss, shift;
-	long	newtime, lasttime=0;
+	Illuminate(z,(start/86400.0)-3651.0,(end/86400.0)-3651.0);
 
-	PreCalc(x);
-	indx=x;
+	indx=z;
+	PreCalc(z);
+	current.penumbra_exit=-1.0;
 
-	if (sat_db[x].transponders>0)
+	for (x=0; x<illum_days; x++)
 	{
-		comsat=1;
-		tshift=0;
-		bshift=0;
-	}
+		for (y=0; y<illum_day[x].count; y++)
+		{
+			next=&illum_day[x].eclipse[y];
 
-	else
-	{
-		comsat=0;
-		tshift=2;
-		bshift=-2;
-	}
+			/* Join an eclipse that was split at a day boundary */
 
-	if (comsat)
-	{
-		downlink_start=sat_db[x].downlink_start[xponder];
-		downlink_end=sat_db[x].downlink_end[xponder];
-		uplink_start=sat_db[x].uplink_start[xponder];
-		uplink_end=sat_db[x].uplink_end[xponder];
+			if (next->penumbra_entry==current.penumbra_exit)
+			{
+				current.penumbra_exit=next->penumbra_exit;
 
-		if (downlink_start>downlink_end)
-			polarity=-1;
+				if (current.entry==0.0)
+				{
+					current.entry=next->entry;
+					current.exit=next->exit;
+				}
 
-		if (downlink_start<downlink_end)
-			polarity=1;
+				else if (next->entry!=0.0)
+					current.exit=next->exit;
 
-		if (downlink_start==downlink_end)
-			polarity=0;
+				continue;
+			}
 
-		downlink=0.5*(downlink_start+downlink_end);
-		uplink=0.5*(uplink_start+uplink_end);
-	}
+			if (current.penumbra_exit>0.0)
+				PrintEclipse(fd,&current);
 
-	daynum=CurrentDaynum();
-	aoshappens=AosHappens(indx);
-	geostationary=Geostationary(indx);
-	decayed=Decayed(indx,0.0);
+			current=*next;
+		}
+	}
 
-	if (xterm)
-		fprintf(stderr,"\033]0;PREDICT: Tracking %-10s\007",sat[x].name); 
-	halfdelay(2);
-	curs_set(0);
-	bkgdset(COLOR_PAIR(3));
-	clear();
+	if (current.penumbra_exit>0.0)
+		PrintEclipse(fd,&current);
 
-	attrset(COLOR_PAIR(6)|A_REVERSE|A_BOLD);
+	if (outputfile[0])
+		fclose(fd);
 
-	printw("                                                                                ");
-	printw("                     PREDICT Real-Time Satellite Tracking                        ");
-	printw("                 Tracking: %-10sOn                                       ",Abbreviate(sat[x].name,9));
-	printw("                                                                                 ");
+	return 0;
+}
 
-	attrset(COLOR_PAIR(4)|A_BOLD);
+void ConjunctionJob(x)
+int x;
+{
+	/* This function propagates satellite "x" through every
+	   time step of the current chunk of the conjunction screen,
+	   including one extra step at either end.  The satellite's
+	   orbit at the start of the chunk is also recorded for use
+	   by OrbitsMeet(). */
 
-	mvprintw(5+tshift,1,"Satellite     Direction     Velocity     Footprint    Altitude     Slant Range");
-	mvprintw(6+tshift,1,"---------     ---------     --------     ---------    --------     -----------");
-	mvprintw(7+tshift,1,"        .            Az           mi            mi          mi              mi");
-	mvprintw(8+tshift,1,"        .            El           km            km          km              km");
-	mvprintw(16+bshift,1,"Eclipse Depth   Orbital Phase   Orbital Model   Squint Angle      AutoTracking");
-	mvprintw(17+bshift,1,"-------------   -------------   -------------   ------------      ------------");
+	int k;
+	double e;
+	vector_t vel, *pos, ecc, vxh;
 
-	if (comsat)
+	if (sat[x].meanmo==0.0 || Decayed(x,cs_start))
 	{
-		mvprintw(12,1,"Uplink   :");
-		mvprintw(13,1,"Downlink :");
-		mvprintw(14,1,"Delay    :");
-		mvprintw(14,55,"Echo      :");
-		mvprintw(13,29,"RX:");
-		mvprintw(13,55,"Path loss :");
-		mvprintw(12,29,"TX:");
-		mvprintw(12,55,"Path loss :");
+		cs_orbit[x].p=0.0;
+		return;
 	}
 
-	do
-	{
-		attrset(COLOR_PAIR(6)|A_REVERSE|A_BOLD);
-		daynum=CurrentDaynum();
-		mvprintw(2,41,"%s",Daynum2String(daynum));
-		attrset(COLOR_PAIR(2)|A_BOLD);
-		Calc();
+	PreCalc(x);
 
-		mvprintw(7+tshift,1,"%-6.2f",(io_lat=='N'?+1:-1)*sat_lat);
-		attrset(COLOR_PAIR(4)|A_BOLD);
-		mvprintw(7+tshift,8,(io_lat=='N'?"N":"S"));
-		mvprintw(8+tshift,8,(io_lon=='W'?"W":"E"));
+	for (k=0; k<cs_steps+2; k++)
+	{
+		pos=&cs_pos[x*(cs_steps+2)+k];
+		Propagate(cs_start+(k-1)*(20.0/86400.0),pos,&vel);
 
-		fk=12756.33*acos(xkmper/(xkmper+sat_alt));
-		fm=fk*km2mi;
+		if (k==1)
+		{
+			/* Angular momentum and eccentricity vectors */
 
-		attrset(COLOR_PAIR(2)|A_BOLD);
+			Cross(pos,&vel,&cs_orbit[x].normal);
+			cs_orbit[x].p=Sqr(cs_orbit[x].normal.w)/ge;
+			Normalize(&cs_orbit[x].normal);
 
-		mvprintw(7+tshift,55,"%0.f ",sat_alt*km2mi);
-		mvprintw(8+tshift,55,"%0.f ",sat_alt);
-		mvprintw(7+tshift,68,"%-5.0f",sat_range*km2mi);
-		mvprintw(8+tshift,68,"%-5.0f",sat_range);
+			Cross(&vel,&cs_orbit[x].normal,&vxh);
+			Scalar_Multiply(cs_orbit[x].p*sqrt(ge/cs_orbit[x].p)/ge,&vxh,&ecc);
+			cs_orbit[x].ecc.x=ecc.x-pos->x/pos->w;
+			cs_orbit[x].ecc.y=ecc.y-pos->y/pos->w;
+			cs_orbit[x].ecc.z=ecc.z-pos->z/pos->w;
+			Magnitude(&cs_orbit[x].ecc);
 
-		mvprintw(8+tshift,1,"%-7.2f",(io_lon=='W'?360.0-sat_lon:sat_lon));
-		mvprintw(7+tshift,15,"%-7.2f",sat_azi);
-		mvprintw(8+tshift,14,"%+-6.2f",sat_ele);
-		mvprintw(7+tshift,29,"%0.f ",(3600.0*sat_vel)*km2mi);
-		mvprintw(8+tshift,29,"%0.f ",3600.0*sat_vel);
+			e=cs_orbit[x].ecc.w;
 
-		mvprintw(18+bshift,3,"%+6.2f%c  ",eclipse_depth/deg2rad,176);
-		mvprintw(18+bshift,20,"%5.1f",256.0*(phase/twopi));
-		mvprintw(18+bshift,37,"%s",ephem);
+			if (e>0.99)
+				e=0.99;
 
-		if (sat_sun_status)
-		{
-			if (sun_ele<=-12.0 && sat_ele>=0.0)
-				visibility_array[indx]='V';
-			else
-				visibility_array[indx]='D';
+			cs_orbit[x].perigee=cs_orbit[x].p/(1.0+e);
+			cs_orbit[x].apogee=cs_orbit[x].p/(1.0-e);
 		}
+	}
+}
 
-		else
-			visibility_array[indx]='N';
+char OrbitsMeet(a,b)
+int a, b;
+{
+	/* This function applies the apogee/perigee and orbit path
+	   filters of the conjunction screen to satellites "a" and
+	   "b".  A 0 is returned if their orbits cannot come within
+	   cs_threshold km of each other.  The orbit path filter
+	   compares the radii of both orbits along the line where
+	   their planes intersect.  A margin allows for short period
+	   perturbations and for the motion of the planes over a
+	   chunk. */
+
+	int x;
+	double margin, ra, rb;
+	vector_t node;
 
-		visibility=visibility_array[indx];
+	margin=cs_threshold+25.0+0.02*(cs_orbit[a].ecc.w*cs_orbit[a].p+cs_orbit[b].ecc.w*cs_orbit[b].p);
 
-		if (comsat)
-		{
-			if (downlink!=0.0)
-				mvprintw(13,11,"%11.5f MHz",downlink);
+	if (cs_orbit[a].perigee-cs_orbit[b].apogee>margin || cs_orbit[b].perigee-cs_orbit[a].apogee>margin)
+		return 0;
 
-			else
-				mvprintw(13,11,"               ");
+	Cross(&cs_orbit[a].normal,&cs_orbit[b].normal,&node);
 
-			if (uplink!=0.0)
-				mvprintw(12,11,"%11.5f MHz",uplink);
+	/* Nearly coplanar orbits always pass */
 
-			else
-				mvprintw(12,11,"               ");
-		}
+	if (node.w<0.01)
+		return 1;
 
-		if (antfd!=-1)
-		{
-			if (sat_ele>=0.0)
-				mvprintw(18+bshift,67,"   Active   ");
-			else
-				mvprintw(18+bshift,67,"Standing  By");
-		}
-		else
-			mvprintw(18+bshift,67,"Not  Enabled");
+	Normalize(&node);
 
-		if (calc_squint)
-			mvprintw(18+bshift,52,"%+6.2f",squint);
-		else
-			mvprintw(18+bshift,54,"N/A");
+	for (x=0; x<2; x++)
+	{
+		ra=cs_orbit[a].p/(1.0+Dot(&cs_orbit[a].ecc,&node));
+		rb=cs_orbit[b].p/(1.0+Dot(&cs_orbit[b].ecc,&node));
 
-		doppler100=-100.0e06*((sat_range_rate*1000.0)/299792458.0);
-		delay=1000.0*((1000.0*sat_range)/299792458.0);
+		if (fabs(ra-rb)<margin)
+			return 1;
 
-		if (sat_ele>=0.0)
-		{
-			if (aos_alarm==0)
-			{
-				beep();
-				aos_alarm=1;
-			}
+		Scalar_Multiply(-1.0,&node,&node);
+	}
 
-			if (comsat)
-			{
-				attrset(COLOR_PAIR(4)|A_BOLD);
+	return 0;
+}
 
-				if (fabs(sat_range_rate)<0.1)
-					mvprintw(14,34,"    TCA    ");
+void RelativeState(time, dr, dv)
+double time;
+vector_t *dr, *dv;
+{
+	/* This function returns the position and velocity of
+	   satellite cs_b relative to satellite cs_a at "time". */
 
-				else
-				{
-					if (sat_range_rate<0.0)
-						mvprintw(14,34,"Approaching");
+	vector_t pa, va, pb, vb;
 
-					if (sat_range_rate>0.0)
-						mvprintw(14,34,"  Receding ");
-				}
+	PreCalc(cs_a);
+	Propagate(time,&pa,&va);
+	PreCalc(cs_b);
+	Propagate(time,&pb,&vb);
+
+	Vec_Sub(&pb,&pa,dr);
+	Vec_Sub(&vb,&va,dv);
+}
+
+double RelativeRangeRate(time)
+double time;
+{
+	/* Rate of change of the distance between cs_a and cs_b */
+
+	vector_t dr, dv;
+
+	RelativeState(time,&dr,&dv);
+
+	return (Dot(&dr,&dv)/dr.w);
+}
+
+double RelativeRangeFunction(time)
+double time;
+{
+	/* Negated distance between cs_a and cs_b, so that its
+	   maximum is the point of closest approach */
 
-				attrset(COLOR_PAIR(2)|A_BOLD);
+	vector_t dr, dv;
 
-				if (downlink!=0.0)
-				{
-					dopp=1.0e-08*(doppler100*downlink);
-					mvprintw(13,32,"%11.5f MHz",downlink+dopp);
-					loss=32.4+(20.0*log10(downlink))+(20.0*log10(sat_range));
-					mvprintw(13,67,"%7.3f dB",loss);
-					mvprintw(14,13,"%7.3f   ms",delay);
-				}
+	RelativeState(time,&dr,&dv);
 
-				else
-				{
-					mvprintw(13,32,"                ");
-					mvprintw(13,67,"          ");
-					mvprintw(14,13,"            ");
-				}
+	return -dr.w;
+}
 
-				if (uplink!=0.0)
-				{
-					dopp=1.0e-08*(doppler100*uplink);
-					mvprintw(12,32,"%11.5f MHz",uplink-dopp);
-					loss=32.4+(20.0*log10(uplink))+(20.0*log10(sat_range));
-					mvprintw(12,67,"%7.3f dB",loss);
-				}
+void RefineJob(x)
+int x;
+{
+	/* This function refines candidate close approach "x".  The
+	   sampled approach lies within one step either side of the
+	   stored time, and TCA is found there as the zero crossing
+	   of the relative range rate. */
+
+	double a, b, fa, fb;
+	vector_t dr, dv;
+	conjunction_t *c;
+
+	c=&cs_list[x];
+	cs_a=c->a;
+	cs_b=c->b;
+
+	a=c->tca-20.0/86400.0;
+	b=c->tca+20.0/86400.0;
+	fa=RelativeRangeRate(a);
+	fb=RelativeRangeRate(b);
+
+	if (fa*fb>0.0)
+		c->tca=GoldenSection(RelativeRangeFunction,a,b);
+	else
+		c->tca=FindRoot(RelativeRangeRate,a,b,fa,fb);
 
-				else
-				{
-					mvprintw(12,32,"                ");
-					mvprintw(12,67,"          ");
-				}
+	RelativeState(c->tca,&dr,&dv);
+	c->miss=dr.w;
+	c->speed=dv.w;
+}
 
-				if (uplink!=0.0 && downlink!=0.0)
-					mvprintw(14,67,"%7.3f ms",2.0*delay);
+void ScreenStep(k)
+int k;
+{
+	/* This function bins the positions of all satellites at
+	   step "k" of the current chunk into a spatial hash grid,
+	   and compares each satellite only against those in its
+	   own and neighboring cells.  The cells are large enough
+	   that a pair which comes within cs_threshold km between
+	   steps is always found in neighboring cells at the nearest
+	   step.  A pair whose sampled distance is a local minimum
+	   within that bound, and whose orbits can meet, is added to
+	   cs_list[] for refinement. */
 
-				else
-					mvprintw(14,67,"              ");
-			}
+	int x, y, i, j, h, dx, dy, dz, n=cs_steps+2;
+	double size, limit, d, dp, dn;
+	vector_t *pos, diff;
 
-			if (speak=='T' && soundcard)
-			{
-				if (eclipse_alarm==0 && fabs(eclipse_depth)<0.015) /* ~1 deg */
-				{
-					/* Hold off regular announcements if
-					   satellite is within about 2 degrees
-					   of entering into or out of an
-					   eclipse. */
+	/* Allow for 16 km/sec of relative motion over half a step */
 
-					oldtime=CurrentDaynum();
+	limit=cs_threshold+0.5*16.0*20.0;
+	size=limit;
 
-					if ((old_visibility=='V' || old_visibility=='D') && visibility=='N')
-					{
-						sprintf(command,"%svocalizer/vocalizer eclipse &",predictpath);
-						system(command);
-						eclipse_alarm=1;
-						oldtime-=0.000015*sqrt(sat_alt);
-					}
+	for (x=0; x<1024; x++)
+		cs_hash[x]=-1;
 
-					if (old_visibility=='N' && (visibility=='V' || visibility=='D'))
-					{
-						sprintf(command,"%svocalizer/vocalizer sunlight &",predictpath);
-						system(command);
-						eclipse_alarm=1;
-						oldtime-=0.000015*sqrt(sat_alt);
-					}
-				}
+	for (x=0; x<24; x++)
+	{
+		if (cs_orbit[x].p==0.0)
+			continue;
 
-				if ((CurrentDaynum()-oldtime)>(0.00003*sqrt(sat_alt)))
-				{
-					if (sat_range_rate<0.0)
-						approaching='+';
+		pos=&cs_pos[x*n+k];
+		cs_cell[x][0]=(int)floor(pos->x/size);
+		cs_cell[x][1]=(int)floor(pos->y/size);
+		cs_cell[x][2]=(int)floor(pos->z/size);
 
-					if (sat_range_rate>0.0)
-						approaching='-';
+		h=((cs_cell[x][0]*73856093)^(cs_cell[x][1]*19349663)^(cs_cell[x][2]*83492791))&1023;
+		cs_next[x]=cs_hash[h];
+		cs_hash[h]=x;
+	}
 
-					sprintf(command,"%svocalizer/vocalizer %.0f %.0f %c %c &",predictpath,sat_azi,sat_ele,approaching,visibility);
-					system(command);
-  					oldtime=CurrentDaynum();
-					old_visibility=visibility;
-				}
+	for (i=0; i<24; i++)
+	{
+		if (cs_orbit[i].p==0.0)
+			continue;
 
-				if (sat_ele<=1.0 && approaching=='-')
+		for (dx=-1; dx<=1; dx++)
+			for (dy=-1; dy<=1; dy++)
+				for (dz=-1; dz<=1; dz++)
 				{
-					/* Suspend regular announcements
-					   as we approach LOS. */
+					h=(((cs_cell[i][0]+dx)*73856093)^((cs_cell[i][1]+dy)*19349663)^((cs_cell[i][2]+dz)*83492791))&1023;
 
-					oldtime=CurrentDaynum();
-				}
-			}
-		}
+					for (j=cs_hash[h]; j!=-1; j=cs_next[j])
+					{
+						/* Skip other cells sharing this bucket */
 
-		else
-		{
-			lostime=0.0;
-			aos_alarm=0;
-			eclipse_alarm=0;
+						if (j<=i || cs_cell[j][0]!=cs_cell[i][0]+dx || cs_cell[j][1]!=cs_cell[i][1]+dy || cs_cell[j][2]!=cs_cell[i][2]+dz)
+							continue;
 
-			if (comsat)
-			{
-				mvprintw(12,32,"                ");
-				mvprintw(12,67,"          ");
-				mvprintw(13,32,"                ");
-				mvprintw(13,67,"          ");
-				mvprintw(14,13,"            ");
-				mvprintw(14,34,"           ");
-				mvprintw(14,67,"          ");
-			}
-		}
+						Vec_Sub(&cs_pos[j*n+k],&cs_pos[i*n+k],&diff);
+						d=diff.w;
 
-		mvprintw(7+tshift,42,"%0.f ",fm);
-		mvprintw(8+tshift,42,"%0.f ",fk);
+						if (d>=limit)
+							continue;
 
-		attrset(COLOR_PAIR(3)|A_BOLD);
+						Vec_Sub(&cs_pos[j*n+k-1],&cs_pos[i*n+k-1],&diff);
+						dp=diff.w;
+						Vec_Sub(&cs_pos[j*n+k+1],&cs_pos[i*n+k+1],&diff);
+						dn=diff.w;
 
-		mvprintw(21,22,"Orbit Number: %ld",rv);
+						if (d>dp || d>=dn || OrbitsMeet(i,j)==0)
+							continue;
 
-		/* Send data to serial port antenna tracker
-		   either as needed (when it changes), or
-		   once per second. */
+						if (cs_count==cs_size)
+						{
+							cs_size+=256;
+							cs_list=(conjunction_t *)realloc(cs_list,cs_size*sizeof(conjunction_t));
+						}
 
-		if (sat_ele>=0.0 && antfd!=-1)
-		{
-			newtime=(long)time(NULL);
+						y=cs_count++;
+						cs_list[y].a=i;
+						cs_list[y].b=j;
+						cs_list[y].tca=cs_start+(k-1)*(20.0/86400.0);
+						cs_list[y].miss=d;
+						cs_list[y].speed=0.0;
+					}
+				}
+	}
+}
 
-			if ((oldel!=iel || oldaz!=iaz) || (once_per_second && newtime>lasttime))
-			{
-				TrackDataOut(antfd,(float)iel,(float)iaz);
-				oldel=iel;
-				oldaz=iaz;
-				lasttime=newtime;
-			}
-		}
+int QuickConjunctions(string, outputfile)
+char *string, *outputfile;
+{
+	/* This function screens every satellite in the orbital
+	   database against every other for close approaches between
+	   a starting and ending date/time, and lists each approach
+	   within a threshold distance (10 km by default) in order of
+	   time.  The window is processed in chunks of six hours.
+	   The satellites are propagated in parallel at 20 second
+	   steps, each step is screened through a spatial hash grid,
+	   and the surviving candidates are refined in parallel. */
+
+	int x, y, k, first, steps;
+	long start, end, now;
+	char startstr[20], endstr[20], kmstr[20];
+	conjunction_t swap;
+	FILE *fd;
 
-		mvprintw(23,22,"Spacecraft is currently ");
+	for (x=0; x<19 && string[x]!=0 && string[x]!='\n'; x++)
+		startstr[x]=string[x];
 
-		if (visibility=='V')
-			mvprintw(23,46,"visible    ");
+	startstr[x]=0;
 
-		if (visibility=='D')
-			mvprintw(23,46,"in sunlight");
+	if (string[x]=='\n')
+		x++;
 
-		if (visibility=='N')
-			mvprintw(23,46,"in eclipse ");
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		endstr[y]=string[x+y];
 
-		attrset(COLOR_PAIR(4)|A_BOLD);
-		mvprintw(20,5,"   Sun   ");
-		mvprintw(21,5,"---------");
-		attrset(COLOR_PAIR(3)|A_BOLD);
-		mvprintw(22,5,"%-7.2fAz",sun_azi);
-		mvprintw(23,4,"%+-6.2f  El",sun_ele);
+	endstr[y]=0;
+	x+=y;
 
-		FindMoon(daynum);
+	if (string[x]=='\n')
+		x++;
 
-		attrset(COLOR_PAIR(4)|A_BOLD);
-		mvprintw(20,65,"  Moon  ");
-		mvprintw(21,65,"---------");
-		attrset(COLOR_PAIR(3)|A_BOLD);
-		mvprintw(22,65,"%-7.2fAz",moon_az);
-		mvprintw(23,64,"%+-6.2f  El",moon_el);
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		kmstr[y]=string[x+y];
 
-		if (geostationary==1 && sat_ele>=0.0)
-		{
-			mvprintw(22,22,"Satellite orbit is geostationary");
-			aoslos=-3651.0;
-		}
+	kmstr[y]=0;
 
-		if (geostationary==1 && sat_ele<0.0)
-		{
-			mvprintw(22,22,"This satellite never reaches AOS");
-			aoslos=-3651.0;
-		}
+	if (outputfile[0])
+		fd=fopen(outputfile,"w");
+	else
+		fd=stdout;
 
-		if (aoshappens==0 || decayed==1)
-		{
-			mvprintw(22,22,"This satellite never reaches AOS");
-			aoslos=-3651.0;
-		}
+	if (fd==NULL)
+	{
+		fprintf(stderr,"*** PREDICT: Unable to write \"%s\"!\n",outputfile);
+		return 1;
+	}
 
-		if (sat_ele>=0.0 && geostationary==0 && decayed==0 && daynum>lostime)
-		{
-			lostime=FindLOS2();
-			mvprintw(22,22,"LOS at: %s UTC  ",Daynum2String(lostime));
-			aoslos=lostime;
-		}
+	now=(long)ClockTime();
+	start=ParseTime(startstr,now);
+	end=ParseTime(endstr,start);
 
-		else if (sat_ele<0.0 && geostationary==0 && decayed==0 && aoshappens==1 && daynum>aoslos)
-		{
-			daynum+=0.003;  /* Move ahead slightly... */
-			nextaos=FindAOS();
-			mvprintw(22,22,"Next AOS: %s UTC",Daynum2String(nextaos));
-			aoslos=nextaos;
+	/* Default to a one day window */
 
-			if (oldtime!=0.0 && speak=='T' && soundcard)
-			{
-				/* Announce LOS */
+	if (end<=start)
+		end=start+86400;
 
-				sprintf(command,"%svocalizer/vocalizer los &",predictpath);
-				system(command);
-			}
-		}
+	cs_threshold=atof(kmstr);
 
-		/* This is where the variables for the socket server are updated. */
+	if (cs_threshold<=0.0)
+		cs_threshold=10.0;
 
-		if (socket_flag)
-		{
-			az_array[indx]=sat_azi;
-			el_array[indx]=sat_ele;
-			lat_array[indx]=sat_lat;
-			long_array[indx]=360.0-sat_lon;
-			footprint_array[indx]=fk;
-			range_array[indx]=sat_range;
-			altitude_array[indx]=sat_alt;
-			velocity_array[indx]=sat_vel;
-			orbitnum_array[indx]=rv;
-			doppler[indx]=doppler100;
-			nextevent[indx]=aoslos;
-			eclipse_depth_array[indx]=eclipse_depth/deg2rad;
-			phase_array[indx]=360.0*(phase/twopi);
-
-			if (calc_squint)
-				squint_array[indx]=squint;
-			else
-				squint_array[indx]=360.0;
+	steps=(int)ceil((end-start)/20.0);
+	cs_pos=(vector_t *)malloc(24*(1080+2)*sizeof(vector_t));
+	cs_size=0;
 
-			FindSun(daynum);
+	for (k=0; k<steps; k+=1080)
+	{
+		cs_start=(start/86400.0)-3651.0+k*(20.0/86400.0);
+		cs_steps=(steps-k<1080 ? steps-k : 1080);
 
-			sprintf(tracking_mode, "%s\n%c",sat[indx].name,0);
-		}
+		RunWorkers(24,ConjunctionJob);
 
-		/* Get input from keyboard */
+		cs_count=0;
 
-		ans=tolower(getch());
+		for (x=1; x<=cs_steps; x++)
+			ScreenStep(x);
 
-		/* We can force PREDICT to speak by pressing 'T' */
+		RunWorkers(cs_count,RefineJob);
 
-		if (ans=='t')
-			oldtime=0.0;
+		/* Sort the approaches found in this chunk by time */
 
-		/* If we receive a RELOAD_TLE command through the
-		   socket connection or an 'r' through the keyboard,
-		   reload the TLE file.  */
+		for (x=1; x<cs_count; x++)
+			for (y=x; y>0 && cs_list[y].tca<cs_list[y-1].tca; y--)
+			{
+				swap=cs_list[y];
+				cs_list[y]=cs_list[y-1];
+				cs_list[y-1]=swap;
+			}
 
-		if (reload_tle || ans=='r')
+		for (x=0; x<cs_count; x++)
 		{
-			ReadDataFiles();
-			reload_tle=0;
-		}
+			if (cs_list[x].miss>cs_threshold)
+				continue;
 
-		if (comsat)
-		{
-			if (ans==' ' && sat_db[x].transponders>1)
-			{
-				xponder++;
+			first=cs_list[x].a;
+			y=cs_list[x].b;
 
-				if (xponder>=sat_db[x].transponders)
-					xponder=0;
+			fprintf(fd,"%.0f %s %8.3f %6.3f %5ld %5ld %s %s\n",floor(86400.0*(3651.0+cs_list[x].tca)),Daynum2String(cs_list[x].tca),cs_list[x].miss,cs_list[x].speed,sat[first].catnum,sat[y].catnum,sat[first].name,sat[y].name);
+		}
+	}
 
-				move(10,1);
-				clrtoeol();
+	free(cs_pos);
+	free(cs_list);
+	cs_list=NULL;
 
-				downlink_start=sat_db[x].downlink_start[xponder];
-				downlink_end=sat_db[x].downlink_end[xponder];
-				uplink_start=sat_db[x].uplink_start[xponder];
-				uplink_end=sat_db[x].uplink_end[xponder];
+	if (outputfile[0])
+		fclose(fd);
 
-				if (downlink_start>downlink_end)
-					polarity=-1;
+	return 0;
+}
 
-				if (downlink_start<downlink_end)
-					polarity=1;
+char ReadStation(file, st)
+char *file;
+int st;
+{
+	/* This function reads the qth file "file" into station "st"
+	   of the mutual visibility mode.  A 1 is returned if the
+	   file was read successfully. */
 
-				if (downlink_start==downlink_end)
-					polarity=0;
+	double lat, lon;
+	int alt;
+	FILE *fd;
 
-				downlink=0.5*(downlink_start+downlink_end);
-				uplink=0.5*(uplink_start+uplink_end);
-			}
+	fd=fopen(file,"r");
 
-			if (ans=='>' || ans=='.')
-			{
-				if (ans=='>')
-					shift=0.001;  /* 1 kHz */
-				else
-					shift=0.0001; /* 100 Hz */
+	if (fd==NULL)
+		return 0;
 
-				/* Raise uplink frequency */
+	fgets(station_call[st],16,fd);
+	station_call[st][strlen(station_call[st])-1]=0;
+	fscanf(fd,"%lf", &lat);
+	fscanf(fd,"%lf", &lon);
+	fscanf(fd,"%d", &alt);
+	fclose(fd);
 
-				uplink+=shift*(double)abs(polarity);
-				downlink=downlink+(shift*(double)polarity);
+	station[st].lat=lat*deg2rad;
+	station[st].lon=-lon*deg2rad;
+	station[st].alt=((double)alt)/1000.0;
+	station[st].theta=0.0;
 
-				if (uplink>uplink_end)
-				{
-					uplink=uplink_start;
-					downlink=downlink_start;
-				}
-			}
+	return 1;
+}
 
-			if (ans=='<' || ans== ',')
-			{
-				if (ans=='<')
-					shift=0.001;  /* 1 kHz */
-				else
-					shift=0.0001; /* 100 Hz */
+double StationClearance(st, obs_set)
+int st;
+vector_t *obs_set;
+{
+	/* This function returns the elevation found in "obs_set"
+	   relative to the minimum elevation at station "st".  The
+	   horizon mask also applies at the first station.  It is
+	   negative while the satellite is above the minimum. */
 
-				/* Lower uplink frequency */
+	double minel;
 
-				uplink-=shift*(double)abs(polarity);
-				downlink=downlink-(shift*(double)polarity);
+	minel=mv_minel;
 
-				if (uplink<uplink_start)
-				{
-					uplink=uplink_end;
-					downlink=downlink_end;
-				}
-			}
+	if (st==0 && Horizon(Degrees(obs_set->x))>minel)
+		minel=Horizon(Degrees(obs_set->x));
 
-			length=strlen(sat_db[x].transponder_name[xponder])/2;
-			mvprintw(10,40-length,"%s",sat_db[x].transponder_name[xponder]);
-		}
+	return (minel-Degrees(obs_set->y));
+}
 
-		refresh();
+double StationFunction(time)
+double time;
+{
+	/* Elevation of the current satellite at station mv_station
+	   relative to the minimum elevation.  It is negative while
+	   the satellite is above the minimum elevation. */
 
-		halfdelay(2);
+	vector_t pos, vel, obs_set;
 
-	} while (ans!='q' && ans!=27);
+	Propagate(time,&pos,&vel);
+	Calculate_Obs(time+2444238.5,&pos,&vel,&station[mv_station],&obs_set);
 
-	cbreak();
-	sprintf(tracking_mode, "NONE\n%c",0);
+	return StationClearance(mv_station,&obs_set);
 }
 
-void MultiTrack()
+int IntersectIntervals(a, na, b, nb, out)
+double *a, *b, *out;
+int na, nb;
 {
-	/* This function tracks all satellites in the program's
-	   database simultaneously until 'Q' or ESC is pressed.
-	   Satellites in range are HIGHLIGHTED.  Coordinates
-	   for the Sun and Moon are also displayed. */
+	/* This function intersects two time ordered lists of non-
+	   overlapping intervals, "a" and "b", each held as pairs of
+	   start and end times.  The two lists are merged in a single
+	   pass, advancing whichever interval ends first.  The
+	   intersection is placed in "out", and the number of
+	   intervals it holds is returned. */
 
-	int		x, y, z, ans;
+	int x=0, y=0, n=0;
+	double start, end;
 
-	unsigned char	satindex[24], inrange[24], sunstat=0, ok2predict[24];
+	while (x<na && y<nb)
+	{
+		start=(a[2*x]>b[2*y] ? a[2*x] : b[2*y]);
+		end=(a[2*x+1]<b[2*y+1] ? a[2*x+1] : b[2*y+1]);
 
-	double		aos[24], aos2[24], temptime,
-			nextcalctime=0.0, los[24], aoslos[24];
+		if (start<end)
+		{
+			out[2*n]=start;
+			out[2*n+1]=end;
+			n++;
+		}
 
-	if (xterm)
-		fprintf(stderr,"\033]0;PREDICT: Multi-Satellite Tracking Mode\007");
+		if (a[2*x+1]<b[2*y+1])
+			x++;
+		else
+			y++;
+	}
 
-	curs_set(0);
-	attrset(COLOR_PAIR(6)|A_REVERSE|A_BOLD);
-	clear();
+	return n;
+}
 
-	printw("                                                                                ");
-	printw("                     PREDICT Real-Time Multi-Tracking Mode                      ");
-	printw("                    Current Date/Time:                                          ");
-	printw("                                                                                ");
+int QuickMutual(string, outputfile)
+char *string, *outputfile;
+{
+	/* This function lists the intervals between a starting and
+	   ending date/time during which a satellite is above a
+	   minimum elevation at every ground station at once.  The
+	   satellite is propagated once per step, and its position
+	   is shared by all stations.  Each change of visibility at a
+	   station is refined by root-finding, and the intervals of
+	   all stations are then intersected. */
+
+	int x, y, z, st, n[8]={0}, size[8], count;
+	long start, end, now;
+	double step, t0, t1, f0[8], f1, root, *window[8]={NULL}, *mutual, *merged;
+	char satname[50], startstr[20], endstr[20], elstr[20];
+	vector_t pos, vel, obs_set;
+	FILE *fd;
 
-	attrset(COLOR_PAIR(2)|A_REVERSE);
+	for (x=0; x<48 && string[x]!=0 && string[x]!='\n'; x++)
+		satname[x]=string[x];
 
-	printw(" Satellite  Az   El %s  %s  Range  | Satellite  Az   El %s  %s  Range   ",(io_lat=='N'?"LatN":"LatS"),(io_lon=='W'?"LonW":"LonE"),(io_lat=='N'?"LatN":"LatS"),(io_lon=='W'?"LonW":"LonE"));
+	satname[x]=0;
 
-	for (x=0; x<24; x++)
-	{
-		if (Geostationary(x)==0 && AosHappens(x)==1 && Decayed(x,0.0)!=1)
-			ok2predict[x]=1;
-		else
-			ok2predict[x]=0;
+	if (string[x]=='\n')
+		x++;
 
-		aoslos[x]=0.0;
-		los[x]=0.0;
-		aos[x]=0.0;
-		aos2[x]=0.0;
-	}
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		startstr[y]=string[x+y];
 
-	do
-	{
-		for (z=0; z<24; z++)
-		{
-			y=z/2;
+	startstr[y]=0;
+	x+=y;
 
-			if (z%2)
-			{
-				indx=y+12;
-				x=41;
-			}
+	if (string[x]=='\n')
+		x++;
 
-			else
-			{
-				indx=y;
-				x=1;
-			}
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		endstr[y]=string[x+y];
 
-			if (sat[indx].meanmo!=0.0 && Decayed(indx,0.0)!=1)
-			{
-				daynum=CurrentDaynum();
-				PreCalc(indx);
-				Calc();
+	endstr[y]=0;
+	x+=y;
 
-				if (sat_ele>=0.0)
-				{
-					attrset(COLOR_PAIR(2)|A_BOLD);
-					inrange[indx]=1;
-				}
+	if (string[x]=='\n')
+		x++;
 
-				else
-				{
-					attrset(COLOR_PAIR(2));
-					inrange[indx]=0;
-				}
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		elstr[y]=string[x+y];
 
-				if (sat_sun_status)
-				{
-					if (sun_ele<=-12.0 && sat_ele>=0.0)
-						sunstat='V';
-					else
-						sunstat='D';
-				}
+	elstr[y]=0;
 
-				else
-					sunstat='N';
+	/* Do a simple search for the matching satellite name */
 
-				mvprintw(y+6,x,"%-10s%3.0f  %+3.0f  %3.0f   %3.0f %6.0f %c", Abbreviate(sat[indx].name,9),sat_azi,sat_ele,(io_lat=='N'?+1:-1)*sat_lat,(io_lon=='W'?360.0-sat_lon:sat_lon),sat_range,sunstat);
+	for (z=0; z<24; z++)
+		if ((strcmp(sat[z].name,satname)==0) || (atol(satname)==sat[z].catnum))
+			break;
 
-				if (socket_flag)
-				{
-					az_array[indx]=sat_azi;
-					el_array[indx]=sat_ele;
-					lat_array[indx]=sat_lat;
-					long_array[indx]=360.0-sat_lon;
-					footprint_array[indx]=fk;
-					range_array[indx]=sat_range;
-					altitude_array[indx]=sat_alt;
-					velocity_array[indx]=sat_vel;
-					orbitnum_array[indx]=rv;
-					visibility_array[indx]=sunstat;
-					eclipse_depth_array[indx]=eclipse_depth/deg2rad;
-					phase_array[indx]=360.0*(phase/twopi);
-
-					doppler[indx]=-100e06*((sat_range_rate*1000.0)/299792458.0);
-
-					if (calc_squint)
-						squint_array[indx]=squint;
-					else
-						squint_array[indx]=360.0;
+	if (z==24 || sat[z].meanmo==0.0)
+	{
+		fprintf(stderr,"*** PREDICT: Satellite \"%s\" not found!\n",satname);
+		return 1;
+	}
 
-					FindSun(daynum);
-					sprintf(tracking_mode,"MULTI\n%c",0);
-				}
+	station[0]=obs_geodetic;
+	strcpy(station_call[0],qth.callsign);
 
-				attrset(COLOR_PAIR(4)|A_BOLD);
-				mvprintw(20,5,"   Sun   ");
-				mvprintw(21,5,"---------");
-				attrset(COLOR_PAIR(3)|A_BOLD);
-				mvprintw(22,5,"%-7.2fAz",sun_azi);
-				mvprintw(23,4,"%+-6.2f  El",sun_ele);
+	for (st=1; st<stations; st++)
+	{
+		if (ReadStation(station_file[st],st)==0)
+		{
+			fprintf(stderr,"*** PREDICT: Unable to read \"%s\"!\n",station_file[st]);
+			return 1;
+		}
+	}
 
-				FindMoon(daynum);
+	if (outputfile[0])
+		fd=fopen(outputfile,"w");
+	else
+		fd=stdout;
 
-				attrset(COLOR_PAIR(4)|A_BOLD);
-				mvprintw(20,65,"  Moon  ");
-				mvprintw(21,65,"---------");
-				attrset(COLOR_PAIR(3)|A_BOLD);
-				mvprintw(22,65,"%-7.2fAz",moon_az);
-				mvprintw(23,64,"%+-6.2f  El",moon_el);
+	if (fd==NULL)
+	{
+		fprintf(stderr,"*** PREDICT: Unable to write \"%s\"!\n",outputfile);
+		return 1;
+	}
 
-				/* Calculate Next Event (AOS/LOS) Times */
+	now=(long)ClockTime();
+	start=ParseTime(startstr,now);
+	end=ParseTime(endstr,start);
 
-				if (ok2predict[indx] && daynum>los[indx] && inrange[indx])
-					los[indx]=FindLOS2();
+	/* Default to a one day window */
 
-				if (ok2predict[indx] && daynum>aos[indx])
-				{
-					if (inrange[indx])
-						aos[indx]=NextAOS();
-					else
-						aos[indx]=FindAOS();
-				}
+	if (end<=start)
+		end=start+86400;
 
-				if (inrange[indx])
-					aoslos[indx]=los[indx];
-				else
-					aoslos[indx]=aos[indx];
+	mv_minel=atof(elstr);
 
-				if (socket_flag)
-				{
-					if (ok2predict[indx])
-						nextevent[indx]=aoslos[indx];
+	indx=z;
+	PreCalc(z);
 
-					else
-						nextevent[indx]=-3651.0;
-				}
+	/* Sample every 2 degrees of mean anomaly */
 
-				aos2[indx]=aos[indx];
-				satindex[indx]=indx;
-			}
+	step=1.0/(180.0*sat[z].meanmo);
 
-			if (Decayed(indx,0.0))
-			{
-				attrset(COLOR_PAIR(2));
-				mvprintw(y+6,x,"%-10s---------- Decayed ---------", Abbreviate(sat[indx].name,9));
+	if (step>0.01)
+		step=0.01;
 
-				if (socket_flag)
-				{
-					az_array[indx]=0.0;
-					el_array[indx]=0.0;
-					lat_array[indx]=0.0;
-					long_array[indx]=0.0;
-					footprint_array[indx]=0.0;
-					range_array[indx]=0.0;
-					altitude_array[indx]=0.0;
-					velocity_array[indx]=0.0;
-					orbitnum_array[indx]=0L;
-					visibility_array[indx]='N';
-					eclipse_depth_array[indx]=0.0;
-					phase_array[indx]=0.0;
-					doppler[indx]=0.0;
-					squint_array[indx]=0.0;
-					nextevent[indx]=-3651.0;
-				}
-			}
- 		}
+	t0=(start/86400.0)-3651.0;
+	Propagate(t0,&pos,&vel);
 
-		attrset(COLOR_PAIR(6)|A_REVERSE|A_BOLD);
+	for (st=0; st<stations; st++)
+	{
+		n[st]=0;
+		size[st]=64;
+		window[st]=(double *)malloc(2*size[st]*sizeof(double));
 
-		daynum=CurrentDaynum();
-		mvprintw(2,39,"%s",Daynum2String(daynum));
+		Calculate_Obs(t0+2444238.5,&pos,&vel,&station[st],&obs_set);
+		f0[st]=StationClearance(st,&obs_set);
 
-		if (daynum>nextcalctime)
-		{
-			/* Bubble sort the AOS times */
+		if (f0[st]<0.0)
+			window[st][0]=t0;
+	}
 
-			for (z=22; z>=0; z--)
-				for (y=0; y<=z; y++)
-					if (aos2[y]>=aos2[y+1])
-					{
-						temptime=aos2[y];
-						aos2[y]=aos2[y+1];
-						aos2[y+1]=temptime;
+	while (t0<(end/86400.0)-3651.0 && Decayed(z,t0)==0)
+	{
+		t1=t0+step;
 
-						x=satindex[y];
-						satindex[y]=satindex[y+1];
-						satindex[y+1]=x;
-					}
+		if (t1>(end/86400.0)-3651.0)
+			t1=(end/86400.0)-3651.0;
 
-			/* Display list of upcoming passes */
+		Propagate(t1,&pos,&vel);
 
-			attrset(COLOR_PAIR(4)|A_BOLD);
-			mvprintw(19,31,"Upcoming Passes");
-			mvprintw(20,31,"---------------");
-			attrset(COLOR_PAIR(3)|A_BOLD);
+		for (st=0; st<stations; st++)
+		{
+			Calculate_Obs(t1+2444238.5,&pos,&vel,&station[st],&obs_set);
+			f1=StationClearance(st,&obs_set);
 
-			for (x=0, y=0, z=-1; x<21 && y!=3; x++)
+			if ((f0[st]<0.0)!=(f1<0.0))
 			{
-				if (ok2predict[satindex[x]] && aos2[x]!=0.0)
+				mv_station=st;
+				root=FindRoot(StationFunction,t0,t1,f0[st],f1);
+
+				if (f1<0.0)
+					window[st][2*n[st]]=root;
+				else
 				{
-					mvprintw(y+21,19,"%10s on %s UTC",Abbreviate(sat[(int)satindex[x]].name,9),Daynum2String(aos2[x]));
+					window[st][2*n[st]+1]=root;
+					n[st]++;
 
-					if (z==-1)
-						z=x;
-					y++;
+					if (n[st]==size[st])
+					{
+						size[st]*=2;
+						window[st]=(double *)realloc(window[st],2*size[st]*sizeof(double));
+					}
 				}
 			}
 
-			if (z!=-1)
-				nextcalctime=aos2[z];
+			f0[st]=f1;
 		}
 
-		refresh();
-		halfdelay(2);  /* Increase if CPU load is too high */
-		ans=tolower(getch());
+		t0=t1;
+	}
 
-		/* If we receive a RELOAD_TLE command through the
-		   socket connection, or an 'r' through the keyboard,
-		   reload the TLE file.  */
+	/* Close any interval still open at the end of the window */
 
-		if (reload_tle || ans=='r')
+	for (st=0; st<stations; st++)
+	{
+		if (f0[st]<0.0)
 		{
-			ReadDataFiles();
-			reload_tle=0;
-			nextcalctime=0.0;
+			window[st][2*n[st]+1]=t0;
+			n[st]++;
 		}
+	}
 
-	} while (ans!='q' && ans!=27);
+	/* Intersect the stations' intervals one station at a time */
 
-	cbreak();
-	sprintf(tracking_mode, "NONE\n%c",0);
-}
+	count=n[0];
+	mutual=(double *)malloc(2*(count+1)*sizeof(double));
+	memcpy(mutual,window[0],2*count*sizeof(double));
 
-void Illumination()
-{
-	double startday, oneminute, sunpercent;
-	int eclipses, minutes, quit, breakout=0;
-	char string1[365], string[725], datestring[25], count;
+	for (st=1; st<stations; st++)
+	{
+		merged=(double *)malloc(2*(count+n[st]+1)*sizeof(double));
+		count=IntersectIntervals(mutual,count,window[st],n[st],merged);
+		free(mutual);
+		mutual=merged;
+	}
 
-	oneminute=1.0/(24.0*60.0);
+	for (x=0; x<count; x++)
+		fprintf(fd,"%.0f %s %.0f %6.0f %5ld %s\n",floor(86400.0*(3651.0+mutual[2*x])),Daynum2String(mutual[2*x]),floor(86400.0*(3651.0+mutual[2*x+1])),86400.0*(mutual[2*x+1]-mutual[2*x]),sat[z].catnum,sat[z].name);
 
-	PreCalc(indx);
-	daynum=floor(GetStartTime(0));
-	startday=daynum;
-	count=0;
+	for (st=0; st<stations; st++)
+		free(window[st]);
 
-	curs_set(0);
-	clear();
+	free(mutual);
 
-	if (xterm)
-		fprintf(stderr,"\033]0;PREDICT: %s's Solar Illumination Calendar For %s\007",qth.callsign, sat[indx].name);
+	if (outputfile[0])
+		fclose(fd);
 
-	do
-	{
-		attrset(COLOR_PAIR(4));
-		mvprintw(23,6,"                 Calculating... Press [ESC] To Quit");
-		refresh();
+	return 0;
+}
 
-		count++;
-		daynum=startday;
+void FootprintMask(lat, lon, alt, bit)
+double lat, lon, alt;
+unsigned long long bit;
+{
+	/* This function sets "bit" in the coverage mask of every
+	   grid cell whose center lies within the footprint of a
+	   satellite at latitude "lat", east longitude "lon" (both
+	   in radians), and altitude "alt" (km).  The footprint is
+	   a spherical cap, so the span of longitude it covers is
+	   found analytically for each row of the grid. */
 
-		for (minutes=0, eclipses=0; minutes<1440; minutes++)
-		{
-			Calc();
+	int r, c, c0, c1, rows, row;
+	double cap, phi, cosdl, dl, res;
+	unsigned long long *mask;
 
-			if (sat_sun_status==0)
-				eclipses++;
+	res=cov_res*deg2rad;
+	cap=acos(xkmper/(xkmper+alt));
 
-			daynum=startday+(oneminute*(double)minutes);
-		}
+	if (lon>pi)
+		lon-=twopi;
 
-		sunpercent=((double)eclipses)/((double)minutes);
-		sunpercent=100.0-(sunpercent*100.0);
+	r=(int)floor((pio2-(lat+cap))/res);
+	rows=(int)ceil((pio2-(lat-cap))/res);
 
-		strcpy(datestring,Daynum2String(startday));
-		datestring[11]=0;
-		sprintf(string1,"      %s    %4d    %6.2f%c",datestring,1440-eclipses,sunpercent,37);
+	if (r<0)
+		r=0;
 
-		/* Allow a quick way out */
+	if (rows>cov_rows)
+		rows=cov_rows;
 
-		nodelay(stdscr,TRUE);
+	for (; r<rows; r++)
+	{
+		phi=pio2-(r+0.5)*res;
+		mask=cov_mask+r*cov_cols;
 
-		if (getch()==27)
-			breakout=1;
+		cosdl=(cos(cap)-sin(phi)*sin(lat))/(cos(phi)*cos(lat));
 
-		nodelay(stdscr,FALSE);
+		if (cosdl>=1.0)
+			continue;
+
+		if (cosdl<=-1.0)
+		{
+			/* The footprint covers a pole, and this
+			   entire row of the grid along with it */
+
+			for (c=0; c<cov_cols; c++)
+				mask[c]|=bit;
 
-		startday+=18.0;
+			continue;
+		}
 
-		daynum=startday;
+		dl=acos(cosdl);
+		c0=(int)ceil((lon-dl+pi)/res-0.5);
+		c1=(int)floor((lon+dl+pi)/res-0.5);
 
-		for (minutes=0, eclipses=0; minutes<1440; minutes++)
+		if (c1-c0>=cov_cols)
 		{
-			Calc();
+			c0=0;
+			c1=cov_cols-1;
+		}
+
+		for (c=c0; c<=c1; c++)
+		{
+			row=c%cov_cols;
 
-			if (sat_sun_status==0)
-				eclipses++;
+			if (row<0)
+				row+=cov_cols;
 
-			daynum=startday+(oneminute*(double)minutes);
+			mask[row]|=bit;
 		}
+	}
+}
 
-		sunpercent=((double)eclipses)/((double)minutes);
-		sunpercent=100.0-(sunpercent*100.0);
+void CoverageJob(x)
+int x;
+{
+	/* This function accumulates the coverage provided by all
+	   satellites in the database over chunk "x" of the coverage
+	   window.  A chunk spans 64 one-minute steps, so each cell's
+	   mask holds one bit per step.  Satellites are processed one
+	   after another, and a cell covered by several of them at
+	   the same step is only counted once. */
+
+	int z, k, n, cells, count;
+	double t;
+	unsigned long long m;
+	vector_t pos, vel;
+	geodetic_t geo;
+
+	cells=cov_rows*cov_cols;
+
+	if (cov_mine==NULL)
+	{
+		cov_mine=(long *)calloc(cells,sizeof(long));
+		cov_mask=(unsigned long long *)calloc(cells,sizeof(unsigned long long));
+
+		pthread_mutex_lock(&cov_lock);
+		cov_grid[cov_threads]=cov_mine;
+		cov_masks[cov_threads]=cov_mask;
+		cov_threads++;
+		pthread_mutex_unlock(&cov_lock);
+	}
 
-		strcpy(datestring,Daynum2String(startday));
-		datestring[11]=0;
-		sprintf(string,"%s\t %s    %4d    %6.2f%c\n",string1,datestring,1440-eclipses,sunpercent,37);
-		quit=Print(string,'s');
+	n=cov_minutes-64*x;
 
-		/* Allow a quick way out */
+	if (n>64)
+		n=64;
 
-		nodelay(stdscr,TRUE);
+	for (z=0; z<24; z++)
+	{
+		if (sat[z].meanmo==0.0)
+			continue;
 
-		if (getch()==27)
-			breakout=1;
+		PreCalc(z);
 
-		nodelay(stdscr,FALSE);
+		for (k=0; k<n; k++)
+		{
+			t=cov_start+(64*x+k)/1440.0;
 
-		if (count<18)
-			startday-=17.0;
-		else
+			if (Decayed(z,t))
+				break;
+
+			Propagate(t,&pos,&vel);
+			Calculate_LatLonAlt(t+2444238.5,&pos,&geo);
+			FootprintMask(geo.lat,geo.lon,geo.alt,1ULL<<k);
+		}
+	}
+
+	for (k=0; k<cells; k++)
+	{
+		if (cov_mask[k])
 		{
-			count=0;
-			startday+=1.0;
+			for (m=cov_mask[k], count=0; m; count++)
+				m&=m-1;
+
+			cov_mine[k]+=count;
+			cov_mask[k]=0;
 		}
 	}
-	while (quit!=1 && breakout!=1 && Decayed(indx,daynum)==0);
 }
 
-void MainMenu()
+int QuickCoverage(string, outputfile)
+char *string, *outputfile;
 {
-	/* Start-up menu.  Your wish is my command. :-) */
+	/* This function produces a heatmap of the number of minutes
+	   each cell of a latitude/longitude grid spends within the
+	   footprint of at least one satellite between a starting
+	   and ending date/time.  The window is divided into chunks
+	   that are handed to the worker pool, and the per-thread
+	   grids are summed at the end.  The map is written as a PGM
+	   image (north up, starting at 180 degrees West) scaled so
+	   that white means coverage throughout the window, and a
+	   CSV file summarizes the coverage of each row of the grid
+	   along with the area-weighted coverage of the globe. */
+
+	int x, y, r, c;
+	long start, end, now, *grid, lo, hi;
+	double sum, weight, total, wsum, wtotal;
+	char startstr[20], endstr[20], resstr[20], filename[60];
+	FILE *fd;
 
-	Banner();
-	attrset(COLOR_PAIR(4)|A_BOLD);
-	mvprintw(10,28,"--==[ Main Menu ]==--");
+	for (x=0; x<19 && string[x]!=0 && string[x]!='\n'; x++)
+		startstr[x]=string[x];
 
-	attrset(COLOR_PAIR(3)|A_BOLD);
-	mvprintw(13,1,"[P]: Predict Satellite Passes");
-	mvprintw(14,1,"[V]: Predict Visible Passes");
-	mvprintw(15,1,"[S]: Solar Illumination Predictions");
-	mvprintw(16,1,"[L]: Lunar Predictions");
-	mvprintw(17,1,"[O]: Solar Predictions");
-	mvprintw(18,1,"[T]: Single Satellite Tracking Mode");
-	mvprintw(19,1,"[M]: Multi-Satellite Tracking Mode");
+	startstr[x]=0;
+
+	if (string[x]=='\n')
+		x++;
+
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		endstr[y]=string[x+y];
+
+	endstr[y]=0;
+	x+=y;
+
+	if (string[x]=='\n')
+		x++;
+
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		resstr[y]=string[x+y];
+
+	resstr[y]=0;
+
+	now=(long)ClockTime();
+	start=ParseTime(startstr,now);
+	end=ParseTime(endstr,start);
+
+	/* Default to a one day window */
+
+	if (end<=start)
+		end=start+86400;
+
+	/* Default to a one degree grid */
+
+	cov_res=atof(resstr);
 
-	mvprintw(13,40,"[I]: Program Information");
-	mvprintw(14,40,"[G]: Edit Ground Station Information");
-	mvprintw(15,40,"[D]: Display Satellite Orbital Data");
-	mvprintw(16,40,"[U]: Update Sat Elements From File");
-	mvprintw(17,40,"[E]: Manually Edit Orbital Elements");
-	mvprintw(18,40,"[B]: Edit Transponder Database");
-	mvprintw(19,40,"[Q]: Exit PREDICT");
+	if (cov_res<=0.0 || cov_res>30.0)
+		cov_res=1.0;
 
-	if (socket_flag)
+	cov_rows=(int)rint(180.0/cov_res);
+	cov_cols=2*cov_rows;
+	cov_res=180.0/cov_rows;
+
+	cov_start=(start/86400.0)-3651.0;
+	cov_minutes=(int)ceil((end-start)/60.0);
+
+	RunWorkers((cov_minutes+63)/64,CoverageJob);
+
+	/* Reduce the per-thread grids into the first one */
+
+	grid=cov_grid[0];
+
+	for (x=1; x<cov_threads; x++)
+		for (y=0; y<cov_rows*cov_cols; y++)
+			grid[y]+=cov_grid[x][y];
+
+	sprintf(filename,"%s.pgm",outputfile[0]?outputfile:"coverage");
+	fd=fopen(filename,"wb");
+
+	if (fd==NULL)
 	{
-		attrset(COLOR_PAIR(4)|A_BOLD);
-		mvprintw(22,33,"Server Mode");
+		fprintf(stderr,"*** PREDICT: Unable to write \"%s\"!\n",filename);
+		return 1;
 	}
 
-	refresh();
+	fprintf(fd,"P5\n%d %d\n255\n",cov_cols,cov_rows);
 
-	if (xterm)
-		fprintf(stderr,"\033]0;PREDICT: Version %s\007",version); 
-}
+	for (y=0; y<cov_rows*cov_cols; y++)
+		fputc((int)rint(255.0*grid[y]/cov_minutes),fd);
 
-void ProgramInfo()
-{
-	Banner();
-	attrset(COLOR_PAIR(3)|A_BOLD);
+	fclose(fd);
 
-	printw("\n\n\n\n\n\t\tPREDICT version : %s\n",version);
-	printw("\t\tQTH file loaded : %s\n",qthfile);
-	printw("\t\tTLE file loaded : %s\n",tlefile);
-	printw("\t\tDatabase file   : ");
+	sprintf(filename,"%s.csv",outputfile[0]?outputfile:"coverage");
+	fd=fopen(filename,"w");
 
-	if (database)
-		printw("Loaded\n");
-	else
-		printw("Not loaded\n");
+	if (fd==NULL)
+	{
+		fprintf(stderr,"*** PREDICT: Unable to write \"%s\"!\n",filename);
+		return 1;
+	}
 
-	if (antfd!=-1)
+	/* Each row: latitude of the row's center, followed by the
+	   mean, minimum, and maximum percentage of the window that
+	   its cells were covered */
+
+	for (r=0, wsum=0.0, wtotal=0.0; r<cov_rows; r++)
 	{
-		printw("\t\tAutoTracking    : Sending data to %s",serial_port);
+		lo=cov_minutes;
+		hi=0;
 
-		if (once_per_second)
-			printw(" every second");
+		for (c=0, sum=0.0; c<cov_cols; c++)
+		{
+			y=grid[r*cov_cols+c];
+			sum+=y;
 
-		printw("\n");
-	}
+			if (y<lo)
+				lo=y;
 
-	else
-		printw("\t\tAutoTracking    : Not enabled\n");
+			if (y>hi)
+				hi=y;
+		}
 
-	printw("\t\tRunning Mode    : ");
+		total=(double)cov_cols*cov_minutes;
+		weight=cos((90.0-(r+0.5)*cov_res)*deg2rad);
+		wsum+=weight*sum;
+		wtotal+=weight*total;
 
-	if (socket_flag)
-		printw("Network server on port \"%s\"\n",netport);
-	else
-		printw("Standalone\n");
+		fprintf(fd,"%.3f,%.2f,%.2f,%.2f\n",90.0-(r+0.5)*cov_res,100.0*sum/total,100.0*lo/cov_minutes,100.0*hi/cov_minutes);
+	}
 
-	printw("\t\tVocalizer       : ");
+	fprintf(fd,"global,%.2f\n",100.0*wsum/wtotal);
+	fclose(fd);
 
-	if (soundcard)
-		printw("Soundcard present");
-	else
-		printw("No soundcard available");
+	for (x=0; x<cov_threads; x++)
+	{
+		free(cov_grid[x]);
+		free(cov_masks[x]);
+	}
 
-	refresh();
-	attrset(COLOR_PAIR(4)|A_BOLD);
-	AnyKey();
+	cov_threads=0;
+	cov_mine=NULL;
+	cov_mask=NULL;
+
+	return 0;
 }
 
-void NewUser()
+void WriteEvents(string, fd)
+char *string;
+FILE *fd;
 {
-	int *mkdir();
+	/* This function lists the rise, transit, and set times of
+	   the Sun and Moon, along with the beginning and end of each
+	   twilight, between a starting and ending date/time as seen
+	   from the ground station.  The window defaults to one day. */
 
-	Banner();
-	attrset(COLOR_PAIR(3)|A_BOLD);
+	int x, y, n, m;
+	long start, end, now;
+	char startstr[20], endstr[20];
+	celestial_t *event, swap;
 
-	mvprintw(12,2,"WELCOME to PREDICT!  Since you are a new user to the program, default\n");
-	printw("  orbital data and ground station location information was copied into\n");
-	printw("  your home directory to get you going.  Please select option [G] from\n");
-	printw("  PREDICT's main menu to edit your ground station information, and update\n");
-	printw("  your orbital database using option [U] or [E].  Enjoy the program!  :-)");
-	refresh();
+	for (x=0; x<19 && string[x]!=0 && string[x]!='\n'; x++)
+		startstr[x]=string[x];
 
-	/* Make "~/.predict" subdirectory */
+	startstr[x]=0;
 
-	sprintf(temp,"%s/.predict",getenv("HOME"));
-	mkdir(temp,0777);
+	if (string[x]=='\n')
+		x++;
 
-	/* Copy default files into ~/.predict directory */
+	for (y=0; y<19 && string[x+y]!=0 && string[x+y]!='\n'; y++)
+		endstr[y]=string[x+y];
 
-	sprintf(temp,"%sdefault/predict.tle",predictpath);
+	endstr[y]=0;
 
-	CopyFile(temp,tlefile);
+	now=(long)ClockTime();
+	start=ParseTime(startstr,now);
+	end=ParseTime(endstr,start);
 
-	sprintf(temp,"%sdefault/predict.db",predictpath);
+	if (end<=start)
+		end=start+86400;
 
-	CopyFile(temp,dbfile);
+	/* At most nine Sun events and four Moon events per day */
 
-	sprintf(temp,"%sdefault/predict.qth",predictpath);
+	m=14*((end-start)/86400+2);
+	event=(celestial_t *)malloc(m*sizeof(celestial_t));
 
-	CopyFile(temp,qthfile);
+	n=CelestialEvents('s',(start/86400.0)-3651.0,(end/86400.0)-3651.0,event,m);
+	n+=CelestialEvents('m',(start/86400.0)-3651.0,(end/86400.0)-3651.0,event+n,m-n);
 
-	attrset(COLOR_PAIR(4)|A_BOLD);
-	AnyKey();
-}
+	for (x=1; x<n; x++)
+		for (y=x; y>0 && event[y].time<event[y-1].time; y--)
+		{
+			swap=event[y];
+			event[y]=event[y-1];
+			event[y-1]=swap;
+		}
 
-void db_edit()
-{
-	clear();
-	attrset(COLOR_PAIR(3)|A_BOLD);
-	mvprintw(2,15,"* PREDICT Transponder Database Editing Utility *");
-	attrset(COLOR_PAIR(2)|A_BOLD);
-	mvprintw(13,33,"Coming Soon!");
-	attrset(COLOR_PAIR(4)|A_BOLD);
-	refresh();
-	AnyKey();
+	for (x=0; x<n; x++)
+		fprintf(fd,"%.0f %s %-4s %-17s %5.1f %5.1f\n",rint(86400.0*(3651.0+event[x].time)),Daynum2String(event[x].time),event[x].body=='m'?"moon":"sun",event[x].name,event[x].az,event[x].el);
+
+	free(event);
 }
 
-int QuickFind(string, outputfile)
+int QuickEvents(string, outputfile)
 char *string, *outputfile;
 {
-	int x, y, z, step=1;
-	long start, now, end, count;
-	char satname[50], startstr[20], endstr[20];
-	time_t t;
 	FILE *fd;
 
 	if (outputfile[0])
@@ -5904,300 +11743,372 @@ char *string, *outputfile;
 	else
 		fd=stdout;
 
-	startstr[0]=0;
-	endstr[0]=0;
-
-	ReadDataFiles();
+	if (fd==NULL)
+	{
+		fprintf(stderr,"*** PREDICT: Unable to write \"%s\"!\n",outputfile);
+		return 1;
+	}
 
-	for (x=0; x<48 && string[x]!=0 && string[x]!='\n'; x++)
-		satname[x]=string[x];
+	WriteEvents(string,fd);
 
-	satname[x]=0;
-	x++;
+	if (outputfile[0])
+		fclose(fd);
 
-	for (y=0; string[x+y]!=0 && string[x+y]!='\n'; y++)
-		startstr[y]=string[x+y];
+	return 0;
+}
 
-	startstr[y]=0;
-	y++;
+void WriteDopplerPass(x)
+int x;
+{
+	/* This function writes the samples of pass "x" of the
+	   Doppler table export to dx_fd, and frees them.  Each
+	   holds the Doppler shift normalized to 100 MHz along with
+	   the frequency offsets to apply to the downlink and uplink
+	   of every transponder. */
 
-	for (z=0; string[x+y+z]!=0 && string[x+y+z]!='\n'; z++)
-		endstr[z]=string[x+y+z];
+	int y;
+	long k;
+	double doppler100, offset[20];
+	float record[22];
+	sample_t *sample;
 
-	endstr[z]=0;
- 
-	/* Do a simple search for the matching satellite name */
+	sample=dx_sample[x];
 
-	for (z=0; z<24; z++)
+	for (k=0; k<dx_count[x]; k++)
 	{
-		if ((strcmp(sat[z].name,satname)==0) || (atol(satname)==sat[z].catnum))
+		doppler100=-100.0e06*((sample[k].range_rate*1000.0)/299792458.0);
+
+		/* The received downlink is shifted by the Doppler
+		   offset, so the uplink is corrected by its inverse */
+
+		for (y=0; y<dx_xponders; y++)
 		{
-			start=atol(startstr);
+			offset[2*y]=0.01*doppler100*dx_downlink[y];
+			offset[2*y+1]=(dx_uplink[y]!=0.0 ? -0.01*doppler100*dx_uplink[y] : 0.0);
+		}
 
-			if (endstr[strlen(endstr)-1]=='m')
-			{
-				step=60;
-				endstr[strlen(endstr)-1]=0;
-			}
-			
-			if (endstr[0]=='+')
-				end=start+((long)step)*atol(endstr);
-			else
-				end=atol(endstr);
+		if (dx_binary)
+		{
+			/* Record: time, then elevation, range rate,
+			   and the downlink and uplink offsets in Hz
+			   of each transponder as floats */
 
-			indx=z;
+			record[0]=sample[k].el;
+			record[1]=(float)sample[k].range_rate;
 
-			t=time(NULL);
-			now=(long)t;
+			for (y=0; y<2*dx_xponders; y++)
+				record[2+y]=(float)offset[y];
 
-			if (start==0)
-				start=now;
+			fwrite(&sample[k].time,sizeof(double),1,dx_fd);
+			fwrite(record,sizeof(float),2+2*dx_xponders,dx_fd);
+		}
 
-			if (startstr[0]=='+')
-			{
-				start=now;
+		else
+		{
+			fprintf(dx_fd,"%.3f,%.2f,%.5f,%.2f",sample[k].time,sample[k].el,sample[k].range_rate,doppler100);
 
-				if (startstr[strlen(startstr)-1]=='m')
-				{
-					step=60;
-					startstr[strlen(startstr)-1]=0;
-				}
+			for (y=0; y<2*dx_xponders; y++)
+				fprintf(dx_fd,",%.1f",offset[y]);
 
-				end=start+((long)step)*atol(startstr);
+			fprintf(dx_fd,"\n");
+		}
+	}
 
-				/* Prevent a list greater than
-				   24 hours from being produced */
+	free(sample);
+	dx_sample[x]=NULL;
+}
 
-				if ((end-start)>86400)
-				{
-					start=now;
-					end=now-1;
-				}
-			}
+void DopplerJob(x)
+int x;
+{
+	/* This function samples pass dx_first+x of the Doppler table
+	   export at dx_rate samples per second.  Samples fall on whole
+	   multiples of the sample period in Unix time, so that tables
+	   made at the same rate line up with each other.  Only the
+	   propagator and the observer geometry are evaluated.  The
+	   pass is then written, along with any that follow it and
+	   were finished first, once every pass before it has been. */
 
-			if ((start>=now-31557600) && (start<=now+31557600) && end==0)
-			{
-				/* Start must be one year from now */
-				/* Display a single position */
-				daynum=((start/86400.0)-3651.0);
-				PreCalc(indx);
-				Calc();
+	long k, k0, k1, count;
+	double t;
+	vector_t pos, vel, obs_set;
+	sample_t *sample;
 
-				if (Decayed(indx,daynum)==0)
-					fprintf(fd,"%ld %s %4d %4d %4d %4d %4d %6ld %6ld %c\n",start,Daynum2String(daynum),iel,iaz,ma256,isplat,isplong,irk,rv,findsun);
-				break;
-			}
+	x+=dx_first;
 
-			else
-			{
-				/* Display a whole list */
-				for (count=start; count<=end; count+=step)
-				{
-					daynum=((count/86400.0)-3651.0);
-					PreCalc(indx);
-					Calc();
+	PreCalc(dx_sat);
 
-					if (Decayed(indx,daynum)==0)
-						fprintf(fd,"%ld %s %4d %4d %4d %4d %4d %6ld %6ld %c\n",count,Daynum2String(daynum),iel,iaz,ma256,isplat,isplong,irk,rv,findsun);
-				}
-				break;
-			}
-		}
+	k0=(long)ceil(86400.0*(3651.0+dx_pass[x][0])*dx_rate);
+	k1=(long)floor(86400.0*(3651.0+dx_pass[x][1])*dx_rate);
+
+	if (k1<k0)
+		k1=k0-1;
+
+	count=k1-k0+1;
+	sample=(sample_t *)malloc((count+1)*sizeof(sample_t));
+
+	for (k=k0; k<=k1; k++)
+	{
+		t=(k/dx_rate)/86400.0-3651.0;
+
+		Propagate(t,&pos,&vel);
+		Calculate_Obs(t+2444238.5,&pos,&vel,&obs_geodetic,&obs_set);
+
+		sample[k-k0].time=k/dx_rate;
+		sample[k-k0].range_rate=obs_set.w;
+		sample[k-k0].el=(float)Degrees(obs_set.y);
 	}
 
-	if (outputfile[0])
-		fclose(fd);
+	pthread_mutex_lock(&dx_lock);
 
-	return 0;
+	dx_count[x]=count;
+	dx_sample[x]=sample;
+
+	while (dx_next<dx_passes && dx_sample[dx_next]!=NULL)
+		WriteDopplerPass(dx_next++);
+
+	pthread_mutex_unlock(&dx_lock);
 }
 
-int QuickPredict(string, outputfile)
+int QuickDopplerTable(string, outputfile)
 char *string, *outputfile;
 {
-	int x, y, z, lastel=0;
-	long start, now;
-	double doppler100=0.0;
-	char satname[50], startstr[20];
-	time_t t;
-	FILE *fd;
-
-	if (outputfile[0])
-		fd=fopen(outputfile,"w");
-	else
-		fd=stdout;
+	/* This function writes a table of the Doppler shift seen by
+	   the ground station over a number of passes of a satellite.
+	   The arguments are the satellite name or object number, the
+	   starting date/time, either an ending date/time or a number
+	   of passes followed by 'p' (one pass if omitted), the rate
+	   in samples per second (1 if omitted), and the format: "csv"
+	   (the default) or "bin".  The passes are found first, and
+	   then sampled in parallel by the worker pool, a few per
+	   worker at a time, so memory use doesn't grow with the
+	   length of the table. */
+
+	int x, y, z, n, max, size=64;
+	long start, end, now;
+	double aos, los, freq;
+	char arg[5][20];
+	static char buffer[1048576];
+
+	for (x=0, y=0; y<5; y++)
+	{
+		for (z=0; z<19 && string[x]!=0 && string[x]!='\n'; x++, z++)
+			arg[y][z]=string[x];
 
-	startstr[0]=0;
+		arg[y][z]=0;
 
-	ReadDataFiles();
+		if (string[x]=='\n')
+			x++;
+	}
 
-	for (x=0; x<48 && string[x]!=0 && string[x]!='\n'; x++)
-		satname[x]=string[x];
+	for (z=0, dx_sat=-1; z<24 && dx_sat==-1; z++)
+		if ((strcmp(sat[z].name,arg[0])==0) || (atol(arg[0])==sat[z].catnum))
+			dx_sat=z;
 
-	satname[x]=0;
-	x++;
+	if (dx_sat==-1 || sat[dx_sat].meanmo==0.0)
+	{
+		fprintf(stderr,"*** Satellite \"%s\" not found!\n",arg[0]);
+		return 1;
+	}
 
-	for (y=0; string[x+y]!=0 && string[x+y]!='\n'; y++)
-		startstr[y]=string[x+y];
+	now=(long)ClockTime();
+	start=ParseTime(arg[1],now);
+	end=0;
+	max=1;
 
-	startstr[y]=0;
-	y++;
+	n=strlen(arg[2]);
 
-	/* Do a simple search for the matching satellite name */
+	if (n>0 && arg[2][n-1]=='p')
+		max=atoi(arg[2]);
 
-	for (z=0; z<24; z++)
+	else if (n>0)
 	{
-		if ((strcmp(sat[z].name,satname)==0) || (atol(satname)==sat[z].catnum))
-		{
-			start=atol(startstr);
-			indx=z;
+		end=ParseTime(arg[2],start);
+		max=0;
+	}
 
-			t=time(NULL);
-			now=(long)t;
+	dx_rate=atof(arg[3]);
 
-			if (start==0)
-				start=now;
+	if (dx_rate<=0.0)
+		dx_rate=1.0;
 
-			if ((start>=now-31557600) && (start<=now+31557600))
-			{
-				/* Start must within one year of now */
-				daynum=((start/86400.0)-3651.0);
-				PreCalc(indx);
-				Calc();
+	if (dx_rate>1000.0)
+		dx_rate=1000.0;
+
+	dx_binary=(strcmp(arg[4],"bin")==0);
+
+	if (outputfile[0])
+		dx_fd=fopen(outputfile,"wb");
+	else
+		dx_fd=stdout;
+
+	if (dx_fd==NULL)
+	{
+		fprintf(stderr,"*** PREDICT: Unable to write \"%s\"!\n",outputfile);
+		return 1;
+	}
 
-				if (AosHappens(indx) && Geostationary(indx)==0 && Decayed(indx,daynum)==0)
-				{
-					/* Make Predictions */
-					daynum=FindAOS();
+	/* Output is written in large blocks */
 
-					/* Display the pass */
+	setvbuf(dx_fd,buffer,_IOFBF,sizeof(buffer));
 
-					while (iel>=0)
-					{
-						fprintf(fd,"%.0f %s %4d %4d %4d %4d %4d %6ld %6ld %c %f\n",floor(86400.0*(3651.0+daynum)),Daynum2String(daynum),iel,iaz,ma256,isplat,isplong,irk,rv,findsun,doppler100);
-						lastel=iel;
-						daynum+=cos((sat_ele-1.0)*deg2rad)*sqrt(sat_alt)/25000.0;
-						Calc();
-					}
+	/* Find the passes */
 
-					if (lastel!=0)
-					{
-						daynum=FindLOS();
-						Calc();
-						fprintf(fd,"%.0f %s %4d %4d %4d %4d %4d %6ld %6ld %c %f\n",floor(86400.0*(3651.0+daynum)),Daynum2String(daynum),iel,iaz,ma256,isplat,isplong,irk,rv,findsun,doppler100);
-					}
-				}
-				break;
-			}
-		}
-	}
+	indx=dx_sat;
+	PreCalc(dx_sat);
+	daynum=(start/86400.0)-3651.0;
+	dx_passes=0;
+	dx_pass=(double (*)[2])malloc(size*sizeof(dx_pass[0]));
 
-	if (outputfile[0])
-		fclose(fd);
+	if (AosHappens(dx_sat) && Geostationary(dx_sat)==0 && Decayed(dx_sat,daynum)==0)
+	{
+		Calc();
 
-	return 0;
-}
+		/* Include a pass that is under way */
 
-int QuickDoppler100(string, outputfile)
-char *string, *outputfile;
-{
+		if (sat_clear>=0.0)
+		{
+			daynum=(start/86400.0)-3651.0;
+			aos=daynum;
+			los=FindLOS2();
+		}
 
-	/* Do a quick predict of the doppler for non-geo sattelites, returns UTC epoch seconds, 
-	   UTC time and doppler normalized to 100MHz for every 5 seconds of satellite-pass as a CSV*/
+		else
+		{
+			aos=FindAOS();
+			los=FindLOS2();
+		}
 
-	int x, y, z, lastel=0;
-	long start, now;
-	double doppler100;
-	char satname[50], startstr[20];
-	time_t t;
-	FILE *fd;
+		while (aos!=0.0 && (max==0 ? aos<(end/86400.0)-3651.0 : dx_passes<max) && Decayed(dx_sat,aos)==0)
+		{
+			if (dx_passes==size)
+			{
+				size*=2;
+				dx_pass=(double (*)[2])realloc(dx_pass,size*sizeof(dx_pass[0]));
+			}
 
-	if (outputfile[0])
-		fd=fopen(outputfile,"w");
-	else
-		fd=stdout;
+			if (aos<(start/86400.0)-3651.0)
+				aos=(start/86400.0)-3651.0;
 
-	startstr[0]=0;
+			if (max==0 && los>(end/86400.0)-3651.0)
+				los=(end/86400.0)-3651.0;
 
-	ReadDataFiles();
+			dx_pass[dx_passes][0]=aos;
+			dx_pass[dx_passes][1]=los;
+			dx_passes++;
 
-	for (x=0; x<48 && string[x]!=0 && string[x]!='\n'; x++)
-		satname[x]=string[x];
+			/* Move to LOS + 20 minutes */
 
-	satname[x]=0;
-	x++;
+			daynum=los+0.014;
+			aos=FindAOS();
+			los=FindLOS2();
+		}
+	}
 
-	for (y=0; string[x+y]!=0 && string[x+y]!='\n'; y++)
-		startstr[y]=string[x+y];
+	/* Center frequencies of the transponders (MHz) */
 
-	startstr[y]=0;
-	y++;
+	dx_xponders=sat_db[dx_sat].transponders;
 
-	/* Do a simple search for the matching satellite name */
+	for (y=0; y<dx_xponders; y++)
+	{
+		dx_downlink[y]=0.5*(sat_db[dx_sat].downlink_start[y]+sat_db[dx_sat].downlink_end[y]);
+		dx_uplink[y]=0.5*(sat_db[dx_sat].uplink_start[y]+sat_db[dx_sat].uplink_end[y]);
+	}
 
-	for (z=0; z<24; z++)
+	if (dx_binary)
 	{
-		if ((strcmp(sat[z].name,satname)==0) || (atol(satname)==sat[z].catnum))
+		/* Header: magic, number of transponders, rate, and the
+		   downlink and uplink center frequencies in Hz */
+
+		fwrite("PDX1",1,4,dx_fd);
+		fwrite(&dx_xponders,sizeof(int),1,dx_fd);
+		fwrite(&dx_rate,sizeof(double),1,dx_fd);
+
+		for (y=0; y<dx_xponders; y++)
 		{
-			start=atol(startstr);
-			indx=z;
+			freq=1.0e6*dx_downlink[y];
+			fwrite(&freq,sizeof(double),1,dx_fd);
+			freq=1.0e6*dx_uplink[y];
+			fwrite(&freq,sizeof(double),1,dx_fd);
+		}
+	}
 
-			t=time(NULL);
-			now=(long)t;
+	else
+	{
+		fprintf(dx_fd,"time,elevation,range_rate,doppler100");
 
-			if (start==0)
-				start=now;
+		for (y=0; y<dx_xponders; y++)
+			fprintf(dx_fd,",\"%s downlink\",\"%s uplink\"",sat_db[dx_sat].transponder_name[y],sat_db[dx_sat].transponder_name[y]);
 
-			if ((start>=now-31557600) && (start<=now+31557600))
-			{
-				/* Start must within one year of now */
-				daynum=((start/86400.0)-3651.0);
-				PreCalc(indx);
-				Calc();
+		fprintf(dx_fd,"\n");
+	}
 
-				if (AosHappens(indx) && Geostationary(indx)==0 && Decayed(indx,daynum)==0)
-				{
-					/* Make Predictions */
-					daynum=FindAOS();
+	/* Sample and write the passes, four per worker at a time */
 
-					/* Display the pass */
+	dx_count=(long *)malloc((dx_passes+1)*sizeof(long));
+	dx_sample=(sample_t **)calloc(dx_passes+1,sizeof(sample_t *));
+	dx_next=0;
 
-					while (iel>=0)
-					{
-						doppler100=-100.0e06*((sat_range_rate*1000.0)/299792458.0);
-						fprintf(fd,"%.0f,%s,%f\n",floor(86400.0*(3651.0+daynum)),Daynum2String(daynum),doppler100);
-						lastel=iel;
-						daynum+=cos((sat_ele-1.0)*deg2rad)*sqrt(sat_alt)/500000.0;
-						Calc();
-					}
+	for (dx_first=0; dx_first<dx_passes; dx_first+=n)
+	{
+		n=4*Workers();
 
-					if (lastel!=0)
-					{
-						doppler100=-100.0e06*((sat_range_rate*1000.0)/299792458.0);
-						daynum=FindLOS();
-						Calc();
-						fprintf(fd,"%.0f,%s,%f\n",floor(86400.0*(3651.0+daynum)),Daynum2String(daynum),doppler100);
-					}
-				}
-				break;
-			}
-		}
+		if (n>dx_passes-dx_first)
+			n=dx_passes-dx_first;
+
+		RunWorkers(n,DopplerJob);
 	}
 
+	fflush(dx_fd);
+
 	if (outputfile[0])
-		fclose(fd);
+		fclose(dx_fd);
+
+	free(dx_sample);
+	free(dx_count);
+	free(dx_pass);
 
 	return 0;
 }
 
+int QuickArgs(string, size, argv, x, y)
+char *string, *argv[];
+int size, x, y;
+{
+	/* This function appends the arguments that follow option
+	   argv[x] on the command line, up to the next option or
+	   argv[y], to "string" (of "size" bytes), one per line and
+	   each cut to 15 characters.  The index of the last one is
+	   returned.  PREDICT exits if they don't all fit. */
+
+	int z;
+
+	for (z=x+1; z<=y && argv[z][0] && argv[z][0]!='-'; z++)
+	{
+		if (strlen(string)+(strlen(argv[z])<15?strlen(argv[z]):15)+2>(unsigned)size)
+		{
+			fprintf(stderr,"*** PREDICT: Too many arguments to %s!\n",argv[x]);
+			exit(1);
+		}
+
+		strncat(string,argv[z],15);
+		strcat(string,"\n");
+	}
+
+	return z-1;
+}
 
 int main(argc,argv)
 char argc, *argv[];
 {
 	int x, y, z, key=0;
 	char updatefile[80], quickfind=0, quickpredict=0,
-	     quickstring[40], outputfile[42], quickdoppler100=0,
+	     quickstring[128], outputfile[42], quickdoppler100=0,
+	     quickpasses=0, quickeclipses=0, quickconjunctions=0,
+	     quickmutual=0, quickcoverage=0, quickevents=0, quickdx=0,
 	     tle_cli[50], qth_cli[50], interactive=0;
-	struct termios oldtty, newtty;
+	long start=0;
+	double warp=1.0;
 	pthread_t thread;
 	char *env=NULL;
 	FILE *db;
@@ -6220,11 +12131,10 @@ char argc, *argv[];
 	once_per_second=0;
 		
 	y=argc-1;
-	antfd=-1;
 
 	/* Make sure entire "quickstring" array is initialized before use */
 
-	for (x=0; x<40; quickstring[x]=0, x++);
+	for (x=0; x<128; quickstring[x]=0, x++);
 
 	/* Scan command-line arguments */
 
@@ -6233,53 +12143,79 @@ char argc, *argv[];
 		if (strcmp(argv[x],"-f")==0)
 		{
 			quickfind=1;
-			z=x+1;
-			while (z<=y && argv[z][0] && argv[z][0]!='-')
-			{
-				if ((strlen(quickstring)+strlen(argv[z]))<37)
-				{
-					strncat(quickstring,argv[z],15);
-					strcat(quickstring,"\n");
-					z++;
-				}
-			}
-			z--;
+			z=QuickArgs(quickstring,sizeof(quickstring),argv,x,y);
 		}
 
 		if (strcmp(argv[x],"-p")==0)
 		{
 			quickpredict=1;
-			z=x+1;
-
-			while (z<=y && argv[z][0] && argv[z][0]!='-')
-			{
-				if ((strlen(quickstring)+strlen(argv[z]))<37)
-				{
-					strncat(quickstring,argv[z],15);
-					strcat(quickstring,"\n");
-					z++;
-				}
-			}
-			z--;
+			z=QuickArgs(quickstring,sizeof(quickstring),argv,x,y);
 		}
 
 		if (strcmp(argv[x],"-dp")==0)
 		{
 			quickdoppler100=1;
+			z=QuickArgs(quickstring,sizeof(quickstring),argv,x,y);
+		}
+
+		if (strcmp(argv[x],"-ec")==0)
+		{
+			quickeclipses=1;
+			z=QuickArgs(quickstring,sizeof(quickstring),argv,x,y);
+		}
+
+		if (strcmp(argv[x],"-cs")==0)
+		{
+			quickconjunctions=1;
+			z=QuickArgs(quickstring,sizeof(quickstring),argv,x,y);
+		}
+
+		if (strcmp(argv[x],"-mv")==0)
+		{
+			quickmutual=1;
+			z=QuickArgs(quickstring,sizeof(quickstring),argv,x,y);
+		}
+
+		if (strcmp(argv[x],"-cv")==0)
+		{
+			quickcoverage=1;
+			z=QuickArgs(quickstring,sizeof(quickstring),argv,x,y);
+		}
+
+		if (strcmp(argv[x],"-dx")==0)
+		{
+			quickdx=1;
+			z=QuickArgs(quickstring,sizeof(quickstring),argv,x,y);
+		}
+
+		if (strcmp(argv[x],"-ev")==0)
+		{
+			quickevents=1;
+			z=QuickArgs(quickstring,sizeof(quickstring),argv,x,y);
+		}
+
+		if (strcmp(argv[x],"-st")==0)
+		{
 			z=x+1;
 
-			while (z<=y && argv[z][0] && argv[z][0]!='-')
+			while (z<=y && argv[z][0] && argv[z][0]!='-' && stations<8)
 			{
-				if ((strlen(quickstring)+strlen(argv[z]))<37)
-				{
-					strncat(quickstring,argv[z],15);
-					strcat(quickstring,"\n");
-					z++;
-				}
+				strncpy(station_file[stations],argv[z],48);
+				stations++;
+				z++;
 			}
 			z--;
 		}
 
+		if (strcmp(argv[x],"-pn")==0)
+			penumbra=1;
+
+		if (strcmp(argv[x],"-pa")==0 || strcmp(argv[x],"-va")==0)
+		{
+			quickpasses=argv[x][1];
+			z=QuickArgs(quickstring,sizeof(quickstring),argv,x,y);
+		}
+
 		if (strcmp(argv[x],"-u")==0)
 		{
 			z=x+1;
@@ -6310,6 +12246,13 @@ char argc, *argv[];
 				strncpy(qth_cli,argv[z],48);
 		}
 
+		if (strcmp(argv[x],"-hz")==0)
+		{
+			z=x+1;
+			if (z<=y && argv[z][0] && argv[z][0]!='-')
+				strncpy(hznfile,argv[z],48);
+		}
+
 		if (strcmp(argv[x],"-a")==0)
 		{
 			z=x+1;
@@ -6325,6 +12268,30 @@ char argc, *argv[];
 			once_per_second=1;
 		}
 
+		if (strcmp(argv[x],"-lead")==0)
+		{
+			z=x+1;
+			if (z<=y && argv[z][0] && argv[z][0]!='-')
+				rotator_lead=atof(argv[z]);
+		}
+
+		if (strcmp(argv[x],"-flip")==0)
+			rotator_flip=1;
+
+		if (strcmp(argv[x],"-dstep")==0)
+		{
+			z=x+1;
+			if (z<=y && argv[z][0] && argv[z][0]!='-')
+				doppler_step=atof(argv[z]);
+		}
+
+		if (strcmp(argv[x],"-ant")==0)
+		{
+			z=x+1;
+			if (z<=y && argv[z][0] && argv[z][0]!='-')
+				strncpy(antfile,argv[z],48);
+		}
+
 		if (strcmp(argv[x],"-o")==0)
 		{
 			z=x+1;
@@ -6342,6 +12309,41 @@ char argc, *argv[];
 		if (strcmp(argv[x],"-s")==0)
 			socket_flag=1;
 
+		if (strcmp(argv[x],"-daemon")==0)
+		{
+			daemon_mode=1;
+			socket_flag=1;
+			z=x+1;
+
+			if (z<=y && argv[z][0] && argv[z][0]!='-' && atof(argv[z])>0.0)
+				track_rate=atof(argv[z]);
+		}
+
+		if (strcmp(argv[x],"-hires")==0)
+		{
+			hires=1;
+			z=x+1;
+
+			if (z<=y && argv[z][0] && argv[z][0]!='-' && atof(argv[z])>0.0)
+				track_rate=atof(argv[z]);
+			else
+				track_rate=20.0;
+		}
+
+		if (strcmp(argv[x],"-start")==0)
+		{
+			z=x+1;
+			if (z<=y && argv[z][0] && argv[z][0]!='-')
+				start=ParseTime(argv[z],(long)time(NULL));
+		}
+
+		if (strcmp(argv[x],"-warp")==0)
+		{
+			z=x+1;
+			if (z<=y && argv[z][0] && argv[z][0]!='-' && atof(argv[z])>0.0)
+				warp=atof(argv[z]);
+		}
+
 		if (strcmp(argv[x],"-north")==0) /* Default */
 			io_lat='N';
 
@@ -6357,6 +12359,8 @@ char argc, *argv[];
 
 	/* We're done scanning command-line arguments */
 
+	StartClock(start,warp);
+
 	/* If no command-line (-t or -q) arguments have been passed
 	   to PREDICT, create qth and tle filenames based on the
 	   default ($HOME) directory. */
@@ -6375,18 +12379,39 @@ char argc, *argv[];
 		/* sprintf(tlefile,"%s%c",tle_cli,0); */
 		sprintf(tlefile,"%s",tle_cli);
 
+	if (hznfile[0]==0)
+		sprintf(hznfile,"%s/.predict/predict.hzn",env);
+
+	if (antfile[0]==0)
+		sprintf(antfile,"%s/.predict/predict.ant",env);
+
+	if (netport[0]==0)
+	{
+		strcpy(feedname,"/predict-doppler");
+		strcpy(catalogname,"/predict-catalog");
+	}
+
+	else
+	{
+		sprintf(feedname,"/predict-doppler-%s",netport);
+		sprintf(catalogname,"/predict-catalog-%s",netport);
+	}
+
 	/* Test for interactive/non-interactive mode of operation
 	   based on command-line arguments given to PREDICT. */
 
-	if (updatefile[0] || quickfind || quickpredict || quickdoppler100)
+	if (updatefile[0] || quickfind || quickpredict || quickdoppler100 || quickpasses || quickeclipses || quickconjunctions || quickmutual || quickcoverage || quickevents || quickdx || daemon_mode)
 		interactive=0;
 	else
 		interactive=1;
 
+	/* The transponder database is also read in non-interactive
+	   mode, where it is used by the Doppler table export. */
+
+	sprintf(dbfile,"%s/.predict/predict.db",env);
+
 	if (interactive)
 	{
-		sprintf(dbfile,"%s/.predict/predict.db",env);
-
 		/* If the transponder database file doesn't already
 		   exist under $HOME/.predict, and a working environment
 		   is available, place a default copy from the PREDICT
@@ -6448,11 +12473,32 @@ char argc, *argv[];
 
 		if (quickdoppler100)  /* -dp was passed to PREDICT */
 			exit(QuickDoppler100(quickstring,outputfile));
+
+		if (quickpasses)  /* -pa or -va was passed to PREDICT */
+			exit(QuickPasses(quickstring,outputfile,quickpasses));
+
+		if (quickeclipses)  /* -ec was passed to PREDICT */
+			exit(QuickEclipses(quickstring,outputfile));
+
+		if (quickconjunctions)  /* -cs was passed to PREDICT */
+			exit(QuickConjunctions(quickstring,outputfile));
+
+		if (quickmutual)  /* -mv was passed to PREDICT */
+			exit(QuickMutual(quickstring,outputfile));
+
+		if (quickcoverage)  /* -cv was passed to PREDICT */
+			exit(QuickCoverage(quickstring,outputfile));
+
+		if (quickevents)  /* -ev was passed to PREDICT */
+			exit(QuickEvents(quickstring,outputfile));
+
+		if (quickdx)  /* -dx was passed to PREDICT */
+			exit(QuickDopplerTable(quickstring,outputfile));
 	}
 
 	else
 	{
-		if (tle_cli[0] || qth_cli[0])
+		if (tle_cli[0] || qth_cli[0] || daemon_mode)
 		{
 			/* "Houston, we have a problem..." */
 
@@ -6527,50 +12573,76 @@ char argc, *argv[];
 			if (serial_port[x-1]=='/')
 				serial_port[x-1]=0;
 
-			antfd=open(serial_port, O_WRONLY|O_NOCTTY);
+			strcpy(antenna[0].port,serial_port);
+			antenna[0].once=once_per_second;
+			antenna[0].flip=rotator_flip;
+			antenna[0].lead=rotator_lead;
+			antenna[0].fd=OpenRotator(&antenna[0]);
+			antenna[0].state=1;
+			antennas=1;
 
-			if (antfd!=-1)
+			if (antenna[0].fd==-1)
 			{
-				/* Set up serial port */
+				if (interactive)
+					bailout("Unable To Open Antenna Port");
+				else
+					fprintf(stderr,"*** predict: Unable To Open Antenna Port!\n");
 
-				tcgetattr(antfd, &oldtty);
-				memset(&newtty, 0, sizeof(newtty));
+				exit(-1);
+			}
+		}
 
-				/* 9600 baud, 8-bits, no parity,
-				   1-stop bit, no handshaking */
+		/* Add the antennas described in the antenna
+		   file.  Any whose rotator can't be opened yet
+		   are reconnected once it becomes available. */
 
-				newtty.c_cflag=B9600|CS8|CLOCAL;
-				newtty.c_iflag=IGNPAR;
-				newtty.c_oflag=0;
-				newtty.c_lflag=0;
+		for (x=antennas, ReadAntennas(antfile); x<antennas; x++)
+		{
+			antenna[x].fd=OpenRotator(&antenna[x]);
+			antenna[x].state=(antenna[x].fd==-1 ? 2 : 1);
+		}
 
-				tcflush(antfd, TCIFLUSH);
-				tcsetattr(antfd, TCSANOW, &newtty);
-			}
+		if (antennas>0)
+			StartRotators();
 
-			else
-			{
-				bailout("Unable To Open Antenna Port");
-				exit(-1);
-			}
-		}
+		/* From here on, the user interface holds data_lock
+		   except while it waits for keyboard input */
+
+		HoldData('r');
 	
-		/* Socket activated here.  Remember that
-		   the socket data is updated only when
-		   running in the real-time tracking modes. */
+		/* Socket activated here, along with the
+		   tracking engine that keeps the socket
+		   data up to date. */
 
 		if (socket_flag)
 		{
 			pthread_create(&thread,NULL,(void *)socket_server,(void *)argv[0]);
+			StartEngine();
+
+			if (daemon_mode)
+			{
+				/* Run headless until killed */
+
+				sprintf(tracking_mode,"MULTI\n%c",0);
+				HoldData(0);
+				pthread_join(thread,NULL);
+				exit(0);
+			}
+
 			bkgdset(COLOR_PAIR(3));
 			MultiTrack();
 		}
 
+		/* Load the spoken announcements */
+
+		if (soundcard)
+			StartAudio();
+
 		MainMenu();
 
 		do
 		{	
-			key=getch();
+			key=GetKey();
 
 			if (key!='T')
 				key=tolower(key);
@@ -6580,7 +12652,6 @@ char argc, *argv[];
 				case 'p':
 				case 'v':
 					Print("",0);
-					PrintVisible("");
 					indx=Select();
 
 					if (indx!=-1 && sat[indx].meanmo!=0.0 && Decayed(indx,0.0)==0)
@@ -6659,12 +12730,21 @@ char argc, *argv[];
 
 		} while (key!='q' && key!=27);
 
-		if (antfd!=-1)
+		for (x=0; x<antennas; x++)
 		{
-			tcsetattr(antfd,TCSANOW,&oldtty);
-			close(antfd);
+			if (antenna[x].fd!=-1)
+			{
+				tcsetattr(antenna[x].fd,TCSANOW,&antenna[x].tty);
+				close(antenna[x].fd);
+			}
 		}
 
+		if (feed!=NULL)
+			shm_unlink(feedname);
+
+		if (catalog!=NULL)
+			shm_unlink(catalogname);
+
 		curs_set(1);	
 		bkgdset(COLOR_PAIR(1));
 		clear();
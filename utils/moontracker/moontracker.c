@@ -33,6 +33,14 @@ double	qthlat, qthlong, moon_az, moon_el, moonrise,
 	PI=3.141592653589793, TWOPI=6.28318530717958623,
 	deg2rad=1.745329251994330e-2;
 
+/* Right ascension and declination of the Moon sampled every six hours
+   across the day beginning at "day", held as Newton divided differences
+   so that FindMoonRise() can interpolate instead of evaluating the full
+   series at each step of its search. */
+
+struct	{  double day, ra[5], dec[5];
+	}  moon_cache={-1.0};
+
 double FixAngle(x)
 double x;
 {
@@ -150,21 +158,17 @@ double elevation, azimuth;
 	}
 }
 
-void FindMoon(daynum)
-double daynum;
+void MoonPosition(jd, right_ascension, declination)
+double jd, *right_ascension, *declination;
 {
-	/* This function determines the azimuth and elevation headings
-	   for the moon, relative to the latitude and longitude of
-	   the tracking station.  This code was derived from a
-	   Javascript implementation of the Meeus method for
-	   determining the exact position of the Moon found at:
+	/* This function determines the right ascension and declination
+	   (in radians) of the moon at Julian date "jd".  This code was
+	   derived from a Javascript implementation of the Meeus method
+	   for determining the exact position of the Moon found at:
 	   http://www.geocities.com/s_perona/ingles/poslun.htm. */
 
-	double	jd, s, t, t2, t3, d, f, l1, m, m1, ex, om, l,
-		b, w1, w2, bt, p, lm, h, ra, dec, z, ob, n,
-		el, az, teg, th;
-
-	jd=daynum+2444238.5;
+	double	s, t, t2, t3, d, f, l1, m, m1, ex, om, l,
+		b, w1, w2, bt, p, lm, ra, dec, z, ob;
 
 	t=(jd-2415020.0)/36525.0;
 	t2=t*t;
@@ -292,8 +296,19 @@ double daynum;
 	if (lm>PI)
 		ra=TWOPI-ra;
 
-	/* ra = right ascension */
-	/* dec = declination */
+	*right_ascension=ra;
+	*declination=dec;
+}
+
+void MoonAzEl(jd, ra, dec)
+double jd, ra, dec;
+{
+	/* This function determines the azimuth and elevation headings
+	   of the moon from its right ascension and declination,
+	   relative to the latitude and longitude of the tracking
+	   station, and places them in moon_az and moon_el. */
+
+	double	t, teg, th, h, n, az, el;
 
 	n=qthlat*deg2rad;    /* North latitude of tracking station */
 	/* e=-qthlong*deg2rad; */  /* East longitude of tracking station */
@@ -318,27 +333,133 @@ double daynum;
 	moon_el=el/deg2rad;
 }
 
+void FindMoon(daynum)
+double daynum;
+{
+	/* This function determines the azimuth and elevation headings
+	   for the moon, relative to the latitude and longitude of
+	   the tracking station. */
+
+	double ra, dec;
+
+	MoonPosition(daynum+2444238.5,&ra,&dec);
+	MoonAzEl(daynum+2444238.5,ra,dec);
+}
+
+double MoonElevation(daynum)
+double daynum;
+{
+	/* This function returns the elevation of the moon at "daynum"
+	   using right ascension and declination interpolated from
+	   five samples across the day, which are recomputed from
+	   the full series whenever a new day is entered. */
+
+	int i, k;
+	double u, ra, dec;
+
+	if (floor(daynum)!=moon_cache.day)
+	{
+		moon_cache.day=floor(daynum);
+
+		for (i=0; i<5; i++)
+		{
+			MoonPosition(moon_cache.day+0.25*i+2444238.5,&ra,&dec);
+
+			/* Keep right ascension continuous across the day */
+
+			if (i>0)
+			{
+				while (ra-moon_cache.ra[i-1]>PI)
+					ra-=TWOPI;
+
+				while (ra-moon_cache.ra[i-1]<-PI)
+					ra+=TWOPI;
+			}
+
+			moon_cache.ra[i]=ra;
+			moon_cache.dec[i]=dec;
+		}
+
+		for (k=1; k<5; k++)
+			for (i=4; i>=k; i--)
+			{
+				moon_cache.ra[i]=(moon_cache.ra[i]-moon_cache.ra[i-1])/k;
+				moon_cache.dec[i]=(moon_cache.dec[i]-moon_cache.dec[i-1])/k;
+			}
+	}
+
+	u=4.0*(daynum-moon_cache.day);
+	ra=moon_cache.ra[4];
+	dec=moon_cache.dec[4];
+
+	for (i=3; i>=0; i--)
+	{
+		ra=ra*(u-i)+moon_cache.ra[i];
+		dec=dec*(u-i)+moon_cache.dec[i];
+	}
+
+	MoonAzEl(daynum+2444238.5,ra,dec);
+
+	return moon_el;
+}
+
 double FindMoonRise()
 {
-	/* This function finds the daynum of moonrise. */
+	/* This function finds the daynum of moonrise.  If the moon
+	   is up, the rise that began the current pass is returned.
+	   Otherwise, the next rise is found by stepping forward an
+	   hour at a time until the moon is up, and the time it
+	   crosses the horizon is then located by the Illinois
+	   variant of the method of false position. */
+
+	double a, b, c, fa, fb, fc, step;
+	int side=0, x;
+
+	a=CurrentDaynum();
+	fa=MoonElevation(a);
+	step=(fa>=0.0 ? -1.0/24.0 : 1.0/24.0);
 
-	double daynum2;
+	do
+	{
+		b=a;
+		fb=fa;
+		a+=step;
+		fa=MoonElevation(a);
+
+	} while ((fa>=0.0)==(fb>=0.0));
 
-	daynum2=CurrentDaynum();
-	FindMoon(daynum2);
-	moonrise=0.0;
+	c=b;
 
-	while (moonrise==0.0)
+	for (x=0; x<50 && fabs(b-a)>1.0e-6; x++)
 	{
-		if (fabs(moon_el)<0.03)
-			moonrise=daynum2;
+		c=(a*fb-b*fa)/(fb-fa);
+		fc=MoonElevation(c);
+
+		if ((fc>=0.0)==(fb>=0.0))
+		{
+			b=c;
+			fb=fc;
+
+			if (side==1)
+				fa/=2.0;
+
+			side=1;
+		}
+
 		else
 		{
-			daynum2-=(0.003*moon_el);
-			FindMoon(daynum2);
+			a=c;
+			fa=fc;
+
+			if (side==-1)
+				fb/=2.0;
+
+			side=-1;
 		}
 	}
 
+	moonrise=c;
+
 	return moonrise;
 }
 